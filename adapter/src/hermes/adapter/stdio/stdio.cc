@@ -154,8 +154,7 @@ size_t write_internal(std::pair<AdapterStat, bool> &existing, const void *ptr,
             << std::endl;
   for (const auto &item : mapping) {
     hapi::Context ctx;
-    size_t pos = item.second.blob_name_.find(kStringDelimiter) + 1;
-    auto index = std::stol(item.second.blob_name_.substr(pos));
+    auto index = std::stol(item.second.blob_name_);
     auto blob_exists =
         existing.first.st_bkid->ContainsBlob(item.second.blob_name_);
     hapi::Blob put_data((unsigned char *)ptr + data_offset,
@@ -501,15 +500,9 @@ int HERMES_DECL(fflush)(FILE *fp) {
         hermes::api::VBucket file_vbucket(filename, mdm->GetHermes(), true,
                                           ctx);
         auto offset_map = std::unordered_map<std::string, hermes::u64>();
-        std::size_t pos = 0;
         for (const auto &blob_name : blob_names) {
           file_vbucket.Link(blob_name, filename, ctx);
-          /* FIXME(hari): change this once we have blob namespace separated per
-           * bucket.*/
-          if (pos == 0) {
-            pos = blob_name.find(kStringDelimiter) + 1;
-          }
-          auto offset = std::stol(blob_name.substr(pos));
+          auto offset = std::stol(blob_name);
           offset_map.emplace(blob_name, offset * kPageSize);
         }
         auto trait = hermes::api::FileMappingTrait(filename, offset_map,
@@ -548,16 +541,9 @@ int HERMES_DECL(fclose)(FILE *fp) {
           hermes::api::VBucket file_vbucket(filename, mdm->GetHermes(), true,
                                             ctx);
           auto offset_map = std::unordered_map<std::string, hermes::u64>();
-          std::size_t pos = 0;
           for (const auto &blob_name : blob_names) {
             file_vbucket.Link(blob_name, filename, ctx);
-            /* FIXME(hari): change this once we have blob namespace separated
-             * per bucket.*/
-            if (pos == 0) {
-              pos = blob_name.find(kStringDelimiter) + 1;
-            }
-            auto offset_str = blob_name.substr(pos);
-            auto offset = std::stol(offset_str);
+            auto offset = std::stol(blob_name);
             offset_map.emplace(blob_name, offset * kPageSize);
           }
           auto trait = hermes::api::FileMappingTrait(filename, offset_map,
@@ -0,0 +1,160 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <mpi.h>
+
+#include "hermes.h"
+#include "bucket.h"
+#include "utils.h"
+
+/**
+ * Measures daemon startup with and without a checkpoint.
+ *
+ * The first run against an empty checkpoint directory is a cold start: the
+ * daemon comes up empty and the benchmark has to restage every blob. Finalize
+ * then writes a checkpoint, so a second run with the same options is a warm
+ * start that finds the blobs already resident.
+ */
+
+namespace hapi = hermes::api;
+using std::chrono::time_point;
+const auto now = std::chrono::high_resolution_clock::now;
+const char kBucketName[] = "checkpoint_bench";
+
+struct Options {
+  char *checkpoint_dir;
+  int num_blobs;
+  int blob_size;
+};
+
+double GetSeconds(time_point<std::chrono::high_resolution_clock> start,
+                  time_point<std::chrono::high_resolution_clock> end) {
+  double result = std::chrono::duration<double>(end - start).count();
+
+  return result;
+}
+
+void PrintUsage(char *program) {
+  fprintf(stderr, "Usage: %s -d checkpoint_dir [-n num_blobs] [-s blob_size]\n",
+          program);
+  fprintf(stderr, "  -d\n");
+  fprintf(stderr, "     Directory to store the checkpoint in.\n");
+  fprintf(stderr, "  -n\n");
+  fprintf(stderr, "     Number of blobs to stage (default 1024).\n");
+  fprintf(stderr, "  -s\n");
+  fprintf(stderr, "     Size of each blob in bytes (default 4096).\n");
+}
+
+Options HandleArgs(int argc, char **argv) {
+  Options result = {};
+  result.num_blobs = 1024;
+  result.blob_size = KILOBYTES(4);
+  int option = -1;
+
+  while ((option = getopt(argc, argv, "d:n:s:")) != -1) {
+    switch (option) {
+      case 'd': {
+        result.checkpoint_dir = optarg;
+        break;
+      }
+      case 'n': {
+        result.num_blobs = atoi(optarg);
+        break;
+      }
+      case 's': {
+        result.blob_size = atoi(optarg);
+        break;
+      }
+      default:
+        PrintUsage(argv[0]);
+        exit(1);
+    }
+  }
+
+  if (!result.checkpoint_dir) {
+    fprintf(stderr, "A checkpoint directory is required (-d).\n");
+    PrintUsage(argv[0]);
+    exit(1);
+  }
+
+  return result;
+}
+
+int main(int argc, char **argv) {
+  Options opts = HandleArgs(argc, argv);
+
+  int mpi_threads_provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &mpi_threads_provided);
+  if (mpi_threads_provided < MPI_THREAD_MULTIPLE) {
+    fprintf(stderr, "Didn't receive appropriate MPI threading specification\n");
+    return 1;
+  }
+
+  hermes::Config config = {};
+  hermes::InitDefaultConfig(&config);
+  config.checkpoint_mount = opts.checkpoint_dir;
+
+  time_point start_init = now();
+  std::shared_ptr<hapi::Hermes> hermes = hermes::InitHermes(&config, true);
+  time_point end_init = now();
+
+  hapi::Context ctx;
+  hapi::Bucket bucket(kBucketName, hermes, ctx);
+
+  // NOTE(chogan): Restaging is the work a cold start has to redo before the
+  // application can read its data. After a warm start it is just a check that
+  // every blob survived the restart.
+  time_point start_restage = now();
+  bool warm = true;
+  for (int i = 0; i < opts.num_blobs; ++i) {
+    if (!bucket.ContainsBlob(std::to_string(i))) {
+      warm = false;
+      break;
+    }
+  }
+
+  if (!warm) {
+    std::vector<hermes::u8> data(opts.blob_size, 'x');
+    for (int i = 0; i < opts.num_blobs; ++i) {
+      hermes::Status status = bucket.Put(std::to_string(i), data, ctx);
+      if (status != 0) {
+        fprintf(stderr, "Put of blob %d failed\n", i);
+        break;
+      }
+    }
+  }
+  time_point end_restage = now();
+
+  bucket.Close(ctx);
+
+  time_point start_finalize = now();
+  hermes->Finalize(true);
+  time_point end_finalize = now();
+
+  printf("StartType,NumBlobs,BlobSize,InitSeconds,RestageSeconds,"
+         "FinalizeSeconds\n");
+  printf("%s,%d,%d,%f,%f,%f\n", warm ? "warm" : "cold", opts.num_blobs,
+         opts.blob_size, GetSeconds(start_init, end_init),
+         GetSeconds(start_restage, end_restage),
+         GetSeconds(start_finalize, end_finalize));
+
+  MPI_Finalize();
+
+  return 0;
+}
@@ -0,0 +1,205 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <vector>
+
+#include "hermes.h"
+#include "data_placement_engine.h"
+#include "utils.h"
+
+/**
+ * Compares the placement policies on a workload of mostly small blobs mixed
+ * with a few large ones.
+ *
+ * Each blob is placed as its own Put against the default configuration's
+ * Targets, and the placed bytes are taken out of the Targets' remaining
+ * capacity. For every policy the benchmark reports how often blobs were split,
+ * and the modeled time to write them, which charges each fragment its Device
+ * latency plus its size over the Device bandwidth.
+ */
+
+using std::chrono::time_point;
+const auto now = std::chrono::high_resolution_clock::now;
+
+struct Options {
+  int num_blobs;
+  int small_size;
+  int large_size;
+  int large_every;
+};
+
+enum class Policy {
+  kRoundRobin,
+  kMinimizeIoTime,
+  kMinimizeLatency,
+  kCount
+};
+
+const char *kPolicyNames[] = {"round_robin", "minimize_io_time",
+                              "minimize_latency"};
+
+void PrintUsage(char *program) {
+  fprintf(stderr, "Usage: %s [-n num_blobs] [-s small_size] [-l large_size] "
+          "[-e large_every]\n", program);
+  fprintf(stderr, "  -n\n");
+  fprintf(stderr, "     Number of blobs to place (default 1024).\n");
+  fprintf(stderr, "  -s\n");
+  fprintf(stderr, "     Size of the small blobs in bytes (default 4096).\n");
+  fprintf(stderr, "  -l\n");
+  fprintf(stderr, "     Size of the large blobs in bytes (default 1 MiB).\n");
+  fprintf(stderr, "  -e\n");
+  fprintf(stderr, "     Every e-th blob is large (default 16).\n");
+}
+
+Options HandleArgs(int argc, char **argv) {
+  Options result = {};
+  result.num_blobs = 1024;
+  result.small_size = KILOBYTES(4);
+  result.large_size = MEGABYTES(1);
+  result.large_every = 16;
+  int option = -1;
+
+  while ((option = getopt(argc, argv, "e:l:n:s:")) != -1) {
+    switch (option) {
+      case 'e': {
+        result.large_every = atoi(optarg);
+        break;
+      }
+      case 'l': {
+        result.large_size = atoi(optarg);
+        break;
+      }
+      case 'n': {
+        result.num_blobs = atoi(optarg);
+        break;
+      }
+      case 's': {
+        result.small_size = atoi(optarg);
+        break;
+      }
+      default:
+        PrintUsage(argv[0]);
+        exit(1);
+    }
+  }
+
+  if (result.large_every < 1) {
+    fprintf(stderr, "large_every must be positive.\n");
+    exit(1);
+  }
+
+  return result;
+}
+
+int main(int argc, char **argv) {
+  using namespace hermes;  // NOLINT(*)
+  Options opts = HandleArgs(argc, argv);
+
+  hermes::Config config = {};
+  hermes::InitDefaultConfig(&config);
+  const int num_devices = config.num_devices;
+  std::vector<f32> bandwidths(num_devices);
+  std::vector<f64> latencies(num_devices);
+  std::vector<TargetID> targets(num_devices);
+  for (int i = 0; i < num_devices; ++i) {
+    bandwidths[i] = config.bandwidths[i];
+    latencies[i] = config.latencies[i] * 1e-9;
+    targets[i].bits.node_id = 1;
+    targets[i].bits.device_id = (DeviceID)i;
+    targets[i].bits.index = i;
+  }
+
+  printf("Policy,NumBlobs,SmallSize,LargeSize,LargeEvery,FailedPuts,"
+         "SplitBlobs,Fragments,ModeledSmallWriteSeconds,"
+         "ModeledLargeWriteSeconds,PlacementSeconds\n");
+
+  for (int p = 0; p < (int)Policy::kCount; ++p) {
+    Policy policy = (Policy)p;
+    std::vector<u64> node_state(num_devices);
+    for (int i = 0; i < num_devices; ++i) {
+      node_state[i] = config.capacities[i];
+    }
+
+    int failed = 0;
+    int split = 0;
+    u64 fragments = 0;
+    f64 small_seconds = 0;
+    f64 large_seconds = 0;
+    f64 placement_seconds = 0;
+
+    for (int i = 0; i < opts.num_blobs; ++i) {
+      bool is_large = (i % opts.large_every) == opts.large_every - 1;
+      std::vector<size_t> sizes(1, is_large ? opts.large_size :
+                                opts.small_size);
+      std::vector<PlacementSchema> output;
+
+      time_point start = now();
+      Status status = 0;
+      switch (policy) {
+        case Policy::kRoundRobin: {
+          std::vector<u64> state_copy(node_state);
+          status = RoundRobinPlacement(sizes, state_copy, output, targets);
+          break;
+        }
+        case Policy::kMinimizeIoTime: {
+          status = MinimizeIoTimePlacement(sizes, node_state, bandwidths,
+                                           targets, output, latencies);
+          break;
+        }
+        case Policy::kMinimizeLatency: {
+          status = MinimizeLatencyPlacement(sizes, node_state, bandwidths,
+                                            latencies, targets, output);
+          break;
+        }
+        default: {
+          break;
+        }
+      }
+      placement_seconds +=
+        std::chrono::duration<double>(now() - start).count();
+
+      if (status != 0 || output.size() != 1) {
+        failed++;
+        continue;
+      }
+
+      PlacementSchema schema = AggregateBlobSchema(output[0]);
+      if (schema.size() > 1) {
+        split++;
+      }
+      f64 seconds = 0;
+      for (auto [size, target] : schema) {
+        DeviceID device = target.bits.device_id;
+        seconds += latencies[device] + ((f64)size / ((f64)bandwidths[device] *
+                                                     MEGABYTES(1)));
+        node_state[device] -= std::min((u64)size, node_state[device]);
+        fragments++;
+      }
+      if (is_large) {
+        large_seconds += seconds;
+      } else {
+        small_seconds += seconds;
+      }
+    }
+
+    printf("%s,%d,%d,%d,%d,%d,%d,%llu,%f,%f,%f\n", kPolicyNames[p],
+           opts.num_blobs, opts.small_size, opts.large_size, opts.large_every,
+           failed, split, (unsigned long long)fragments, small_seconds,
+           large_seconds, placement_seconds);
+  }
+
+  return 0;
+}
@@ -60,16 +60,12 @@ void Run(int target_node, int rank, int comm_size, int num_requests,
       buffer_ids[i] = id;
     }
 
-    hermes::u32 id_list_offset =
+    hermes::BlobID blob_id =
       hermes::AllocateBufferIdList(&hermes->context_, &hermes->rpc_,
-                                   target_node, buffer_ids);
+                                   target_node, buffer_ids, "bench_blob");
 
     MPI_Barrier(comm);
 
-    hermes::BlobID blob_id = {};
-    blob_id.bits.node_id = target_node;
-    blob_id.bits.buffer_ids_offset = id_list_offset;
-
     time_point start_get = now();
     for (int j = 0; j < num_requests; ++j) {
       std::vector<hermes::BufferID> ids =
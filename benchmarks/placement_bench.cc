@@ -0,0 +1,137 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <vector>
+
+#include "hermes.h"
+#include "data_placement_engine.h"
+#include "utils.h"
+
+/**
+ * Measures how many kMinimizeIoTime placements per second the analytic solver
+ * and the linear programming solver can calculate for Puts of 1 to 1024 blobs.
+ *
+ * The solvers run against a fixed four Target node with the capacities and
+ * bandwidths of the default configuration, so only the solver cost is
+ * measured.
+ */
+
+using std::chrono::time_point;
+const auto now = std::chrono::high_resolution_clock::now;
+
+struct Options {
+  int max_blobs;
+  int blob_size;
+  int iterations;
+};
+
+double GetSeconds(time_point<std::chrono::high_resolution_clock> start,
+                  time_point<std::chrono::high_resolution_clock> end) {
+  double result = std::chrono::duration<double>(end - start).count();
+
+  return result;
+}
+
+void PrintUsage(char *program) {
+  fprintf(stderr, "Usage: %s [-n max_blobs] [-s blob_size] [-i iterations]\n",
+          program);
+  fprintf(stderr, "  -n\n");
+  fprintf(stderr, "     Largest number of blobs per placement (default "
+          "1024).\n");
+  fprintf(stderr, "  -s\n");
+  fprintf(stderr, "     Size of each blob in bytes (default 4096).\n");
+  fprintf(stderr, "  -i\n");
+  fprintf(stderr, "     Placements to time for each blob count (default "
+          "100).\n");
+}
+
+Options HandleArgs(int argc, char **argv) {
+  Options result = {};
+  result.max_blobs = 1024;
+  result.blob_size = KILOBYTES(4);
+  result.iterations = 100;
+  int option = -1;
+
+  while ((option = getopt(argc, argv, "i:n:s:")) != -1) {
+    switch (option) {
+      case 'i': {
+        result.iterations = atoi(optarg);
+        break;
+      }
+      case 'n': {
+        result.max_blobs = atoi(optarg);
+        break;
+      }
+      case 's': {
+        result.blob_size = atoi(optarg);
+        break;
+      }
+      default:
+        PrintUsage(argv[0]);
+        exit(1);
+    }
+  }
+
+  return result;
+}
+
+int main(int argc, char **argv) {
+  using namespace hermes;  // NOLINT(*)
+  Options opts = HandleArgs(argc, argv);
+
+  hermes::Config config = {};
+  hermes::InitDefaultConfig(&config);
+  std::vector<u64> node_state(config.num_devices);
+  std::vector<f32> bandwidths(config.num_devices);
+  std::vector<TargetID> targets(config.num_devices);
+  for (int i = 0; i < config.num_devices; ++i) {
+    node_state[i] = config.capacities[i];
+    bandwidths[i] = config.bandwidths[i];
+    targets[i].bits.node_id = 1;
+    targets[i].bits.device_id = (DeviceID)i;
+    targets[i].bits.index = i;
+  }
+
+  printf("Solver,NumBlobs,BlobSize,Seconds,PlacementsPerSecond\n");
+  for (int num_blobs = 1; num_blobs <= opts.max_blobs; num_blobs *= 2) {
+    std::vector<size_t> blob_sizes(num_blobs, opts.blob_size);
+
+    for (int use_lp = 0; use_lp < 2; ++use_lp) {
+      time_point start = now();
+      for (int i = 0; i < opts.iterations; ++i) {
+        std::vector<PlacementSchema> output;
+        Status status = 0;
+        if (use_lp) {
+          status = MinimizeIoTimePlacementLp(blob_sizes, node_state,
+                                             bandwidths, targets, output);
+        } else {
+          status = MinimizeIoTimePlacement(blob_sizes, node_state, bandwidths,
+                                           targets, output);
+        }
+        if (status != 0) {
+          fprintf(stderr, "Placement of %d blobs failed\n", num_blobs);
+          break;
+        }
+      }
+      double seconds = GetSeconds(start, now());
+
+      printf("%s,%d,%d,%f,%f\n", use_lp ? "lp" : "analytic", num_blobs,
+             opts.blob_size, seconds, opts.iterations / seconds);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,635 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hermes.h"
+#include "data_placement_engine.h"
+#include "utils.h"
+
+/**
+ * Replays a trace of Put, Get, and Delete events against a synthetic set of
+ * Targets with each placement policy, without starting Hermes.
+ *
+ * A trace is a text file with one event per line. Times are in seconds and
+ * sizes in bytes. Lines that start with '#' are ignored.
+ *
+ *   <time> put <name> <size>
+ *   <time> get <name>
+ *   <time> delete <name>
+ *
+ * Without a trace, a random one is generated.
+ *
+ * Each Target serves its fragments one at a time in the order they arrive. A
+ * fragment takes the Target's latency plus its size over the Target's
+ * bandwidth, and a Blob is done when its last fragment is. A Put that can't be
+ * placed spills to swap space, which is modeled as one more Target with
+ * unlimited capacity, the bandwidth given by -w, and the latency of the last
+ * Target.
+ *
+ * For each policy the simulator reports the simulated I/O time of Puts and
+ * Gets, the swap spills, the peak and final usage of each Target, and the CPU
+ * time spent calculating placements. With -i it also prints the usage of each
+ * Target over time.
+ */
+
+using std::chrono::time_point;
+const auto now = std::chrono::high_resolution_clock::now;
+
+namespace hermes {
+
+enum class EventType {
+  kPut,
+  kGet,
+  kDelete,
+};
+
+struct Event {
+  f64 time;
+  EventType type;
+  std::string name;
+  size_t size;
+};
+
+struct SimTarget {
+  u64 capacity;
+  f32 bandwidth_mbps;
+  f64 latency_seconds;
+};
+
+struct Options {
+  const char *trace_path;
+  int num_events;
+  int num_names;
+  size_t max_size;
+  int seed;
+  std::vector<SimTarget> targets;
+  f32 swap_bandwidth_mbps;
+  f64 usage_interval;
+};
+
+enum class Policy {
+  kRoundRobin,
+  kRandom,
+  kMinimizeIoTime,
+  kMinimizeLatency,
+  kCount
+};
+
+const char *kPolicyNames[] = {"round_robin", "random", "minimize_io_time",
+                              "minimize_latency"};
+
+/** A fragment of a Blob: its size and the index of its Target. The index one
+ * past the last Target is swap space. */
+using Fragment = std::pair<size_t, int>;
+
+struct SimResult {
+  int puts;
+  int gets;
+  int deletes;
+  int misses;
+  int spills;
+  u64 spill_bytes;
+  f64 put_seconds;
+  f64 get_seconds;
+  f64 placement_seconds;
+  std::vector<f64> peak_usage;
+  std::vector<f64> final_usage;
+  /** The time, followed by the usage of each Target, at every sample. */
+  std::vector<std::vector<f64>> usage_samples;
+};
+
+void PrintUsage(char *program) {
+  fprintf(stderr, "Usage: %s [-f trace] [-n num_events] [-k num_names] "
+          "[-m max_size] [-s seed] [-t targets] [-w swap_mbps] "
+          "[-i interval]\n", program);
+  fprintf(stderr, "  -f\n");
+  fprintf(stderr, "     Trace to replay. Without one, a random trace is "
+          "generated.\n");
+  fprintf(stderr, "  -n\n");
+  fprintf(stderr, "     Events in the generated trace (default 100000).\n");
+  fprintf(stderr, "  -k\n");
+  fprintf(stderr, "     Distinct Blob names in the generated trace (default "
+          "1024).\n");
+  fprintf(stderr, "  -m\n");
+  fprintf(stderr, "     Largest Blob in the generated trace in bytes. Sizes "
+          "are\n     log-uniform from 4 KiB (default 1 MiB).\n");
+  fprintf(stderr, "  -s\n");
+  fprintf(stderr, "     Seed for the generated trace and the placement "
+          "policies\n     (default 1).\n");
+  fprintf(stderr, "  -t\n");
+  fprintf(stderr, "     Comma separated Targets, fastest first, as "
+          "capacity_mb:mbps:latency_us.\n     Defaults to the Devices of the "
+          "default configuration.\n");
+  fprintf(stderr, "  -w\n");
+  fprintf(stderr, "     Bandwidth of swap space in MiB/s (default 100).\n");
+  fprintf(stderr, "  -i\n");
+  fprintf(stderr, "     Print Target usage every this many simulated seconds "
+          "(default 0, off).\n");
+}
+
+std::vector<SimTarget> GetDefaultTargets() {
+  Config config = {};
+  InitDefaultConfig(&config);
+  std::vector<SimTarget> result(config.num_devices);
+  for (int i = 0; i < config.num_devices; ++i) {
+    result[i].capacity = config.capacities[i];
+    result[i].bandwidth_mbps = config.bandwidths[i];
+    result[i].latency_seconds = config.latencies[i] * 1e-9;
+  }
+
+  return result;
+}
+
+std::vector<SimTarget> ParseTargets(const char *spec) {
+  std::vector<SimTarget> result;
+  std::string targets(spec);
+  size_t start = 0;
+
+  while (start < targets.size()) {
+    size_t end = targets.find(',', start);
+    if (end == std::string::npos) {
+      end = targets.size();
+    }
+    std::string target = targets.substr(start, end - start);
+    double capacity_mb = 0;
+    double mbps = 0;
+    double latency_us = 0;
+    if (sscanf(target.c_str(), "%lf:%lf:%lf", &capacity_mb, &mbps,
+               &latency_us) != 3 || capacity_mb <= 0 || mbps <= 0) {
+      fprintf(stderr, "Invalid Target '%s'\n", target.c_str());
+      exit(1);
+    }
+    SimTarget sim_target = {};
+    sim_target.capacity = (u64)(capacity_mb * MEGABYTES(1));
+    sim_target.bandwidth_mbps = (f32)mbps;
+    sim_target.latency_seconds = latency_us * 1e-6;
+    result.push_back(sim_target);
+    start = end + 1;
+  }
+
+  return result;
+}
+
+Options HandleArgs(int argc, char **argv) {
+  Options result = {};
+  result.num_events = 100000;
+  result.num_names = 1024;
+  result.max_size = MEGABYTES(1);
+  result.seed = 1;
+  result.swap_bandwidth_mbps = 100;
+  int option = -1;
+
+  while ((option = getopt(argc, argv, "f:i:k:m:n:s:t:w:")) != -1) {
+    switch (option) {
+      case 'f': {
+        result.trace_path = optarg;
+        break;
+      }
+      case 'i': {
+        result.usage_interval = atof(optarg);
+        break;
+      }
+      case 'k': {
+        result.num_names = atoi(optarg);
+        break;
+      }
+      case 'm': {
+        result.max_size = atol(optarg);
+        break;
+      }
+      case 'n': {
+        result.num_events = atoi(optarg);
+        break;
+      }
+      case 's': {
+        result.seed = atoi(optarg);
+        break;
+      }
+      case 't': {
+        result.targets = ParseTargets(optarg);
+        break;
+      }
+      case 'w': {
+        result.swap_bandwidth_mbps = atof(optarg);
+        break;
+      }
+      default:
+        PrintUsage(argv[0]);
+        exit(1);
+    }
+  }
+
+  if (result.targets.empty()) {
+    result.targets = GetDefaultTargets();
+  }
+  if (result.num_names < 1 || result.max_size < KILOBYTES(4) ||
+      result.swap_bandwidth_mbps <= 0) {
+    fprintf(stderr, "num_names and swap_mbps must be positive, and max_size "
+            "at least 4096.\n");
+    exit(1);
+  }
+
+  return result;
+}
+
+std::vector<Event> ReadTrace(const char *path) {
+  std::vector<Event> result;
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    perror("fopen failed");
+    exit(1);
+  }
+
+  char line[512];
+  int line_number = 0;
+  while (fgets(line, sizeof(line), file)) {
+    line_number++;
+    if (line[0] == '#' || line[0] == '\n') {
+      continue;
+    }
+    double time = 0;
+    char type[16] = {};
+    char name[kMaxBlobNameSize + 1] = {};
+    unsigned long long size = 0;
+    int num_fields = sscanf(line, "%lf %15s %64s %llu", &time, type, name,
+                            &size);
+
+    Event event = {};
+    event.time = time;
+    event.name = name;
+    event.size = size;
+    if (num_fields == 4 && strcmp(type, "put") == 0) {
+      event.type = EventType::kPut;
+    } else if (num_fields >= 3 && strcmp(type, "get") == 0) {
+      event.type = EventType::kGet;
+    } else if (num_fields >= 3 && strcmp(type, "delete") == 0) {
+      event.type = EventType::kDelete;
+    } else {
+      fprintf(stderr, "Skipping malformed trace line %d\n", line_number);
+      continue;
+    }
+    result.push_back(event);
+  }
+  fclose(file);
+
+  std::stable_sort(result.begin(), result.end(),
+                   [](const Event &a, const Event &b) {
+                     return a.time < b.time;
+                   });
+
+  return result;
+}
+
+/**
+ * Generates @p opts.num_events events a millisecond apart on average: 60%
+ * Puts, 30% Gets, and 10% Deletes of uniformly chosen names.
+ */
+std::vector<Event> GenerateTrace(const Options &opts) {
+  std::vector<Event> result(opts.num_events);
+  std::mt19937_64 rng(opts.seed);
+  std::exponential_distribution<f64> gap_dist(1000.0);
+  std::uniform_int_distribution<int> name_dist(0, opts.num_names - 1);
+  std::uniform_real_distribution<f64> log_size_dist(log(KILOBYTES(4)),
+                                                    log(opts.max_size));
+  std::uniform_int_distribution<int> type_dist(0, 9);
+
+  f64 time = 0;
+  for (int i = 0; i < opts.num_events; ++i) {
+    time += gap_dist(rng);
+    Event &event = result[i];
+    event.time = time;
+    event.name = "blob_" + std::to_string(name_dist(rng));
+    int type = type_dist(rng);
+    if (type < 6) {
+      event.type = EventType::kPut;
+      event.size = (size_t)exp(log_size_dist(rng));
+    } else if (type < 9) {
+      event.type = EventType::kGet;
+    } else {
+      event.type = EventType::kDelete;
+    }
+  }
+
+  return result;
+}
+
+/** Returns the distinct slab buffer sizes of the default configuration. */
+std::vector<size_t> GetDefaultBufferSizes() {
+  Config config = {};
+  InitDefaultConfig(&config);
+  std::set<size_t> sizes;
+  for (int i = 0; i < config.num_devices; ++i) {
+    for (int j = 0; j < config.num_slabs[i]; ++j) {
+      sizes.insert(config.block_sizes[i] * config.slab_unit_sizes[i][j]);
+    }
+  }
+  std::vector<size_t> result(sizes.begin(), sizes.end());
+
+  return result;
+}
+
+class Simulator {
+ public:
+  Simulator(const Options &opts, Policy policy)
+      : opts_(opts), policy_(policy) {
+    num_targets_ = (int)opts.targets.size();
+    remaining_.resize(num_targets_);
+    bandwidths_.resize(num_targets_ + 1);
+    latencies_.resize(num_targets_ + 1);
+    targets_.resize(num_targets_);
+    for (int i = 0; i < num_targets_; ++i) {
+      remaining_[i] = opts.targets[i].capacity;
+      bandwidths_[i] = opts.targets[i].bandwidth_mbps;
+      latencies_[i] = opts.targets[i].latency_seconds;
+      targets_[i].bits.node_id = 1;
+      targets_[i].bits.device_id = (DeviceID)i;
+      targets_[i].bits.index = i;
+    }
+    bandwidths_[num_targets_] = opts.swap_bandwidth_mbps;
+    latencies_[num_targets_] = latencies_[num_targets_ - 1];
+    busy_until_.resize(num_targets_ + 1, 0);
+    buffer_sizes_ = GetDefaultBufferSizes();
+
+    result_ = {};
+    result_.peak_usage.resize(num_targets_, 0);
+    next_sample_ = opts.usage_interval;
+  }
+
+  SimResult Run(const std::vector<Event> &events) {
+    for (const auto &event : events) {
+      SampleUsage(event.time);
+      switch (event.type) {
+        case EventType::kPut: {
+          Put(event);
+          break;
+        }
+        case EventType::kGet: {
+          Get(event);
+          break;
+        }
+        case EventType::kDelete: {
+          result_.deletes++;
+          if (!Free(event.name)) {
+            result_.misses++;
+          }
+          break;
+        }
+      }
+    }
+    result_.final_usage = GetUsage();
+
+    return result_;
+  }
+
+ private:
+  std::vector<f64> GetUsage() {
+    std::vector<f64> result(num_targets_);
+    for (int i = 0; i < num_targets_; ++i) {
+      u64 capacity = opts_.targets[i].capacity;
+      result[i] = (f64)(capacity - remaining_[i]) / (f64)capacity;
+    }
+
+    return result;
+  }
+
+  void SampleUsage(f64 time) {
+    while (opts_.usage_interval > 0 && next_sample_ <= time) {
+      std::vector<f64> sample(1, next_sample_);
+      std::vector<f64> usage = GetUsage();
+      sample.insert(sample.end(), usage.begin(), usage.end());
+      result_.usage_samples.push_back(sample);
+      next_sample_ += opts_.usage_interval;
+    }
+  }
+
+  /** Returns the time at which the last of @p fragments finishes. */
+  f64 Serve(const std::vector<Fragment> &fragments, f64 time) {
+    f64 result = time;
+    for (auto [size, index] : fragments) {
+      f64 start = std::max(time, busy_until_[index]);
+      f64 end = (start + latencies_[index] +
+                 (f64)size / ((f64)bandwidths_[index] * MEGABYTES(1)));
+      busy_until_[index] = end;
+      result = std::max(result, end);
+    }
+
+    return result;
+  }
+
+  bool Free(const std::string &name) {
+    auto iter = blobs_.find(name);
+    bool result = iter != blobs_.end();
+    if (result) {
+      for (auto [size, index] : iter->second) {
+        if (index < num_targets_) {
+          remaining_[index] += size;
+        }
+      }
+      blobs_.erase(iter);
+    }
+
+    return result;
+  }
+
+  Status Place(size_t size, f64 time, std::vector<PlacementSchema> &output) {
+    std::vector<size_t> sizes(1, size);
+    Status result = 0;
+
+    switch (policy_) {
+      case Policy::kRoundRobin: {
+        result = RoundRobinPlacement(sizes, remaining_, output, targets_,
+                                     buffer_sizes_);
+        break;
+      }
+      case Policy::kRandom: {
+        std::multimap<u64, TargetID> ordered_cap;
+        for (int i = 0; i < num_targets_; ++i) {
+          ordered_cap.insert(std::make_pair(remaining_[i], targets_[i]));
+        }
+        result = RandomPlacement(sizes, ordered_cap, output, buffer_sizes_);
+        break;
+      }
+      case Policy::kMinimizeIoTime:
+      case Policy::kMinimizeLatency: {
+        // NOTE(chogan): Same cost model as GetStartupTimes: latency plus the
+        // time to drain the Target's queue.
+        std::vector<f64> startup_times(num_targets_);
+        for (int i = 0; i < num_targets_; ++i) {
+          startup_times[i] = (latencies_[i] +
+                              std::max(0.0, busy_until_[i] - time));
+        }
+        std::vector<f32> bandwidths(bandwidths_.begin(),
+                                    bandwidths_.begin() + num_targets_);
+        if (policy_ == Policy::kMinimizeIoTime) {
+          result = MinimizeIoTimePlacement(sizes, remaining_, bandwidths,
+                                           targets_, output, startup_times);
+        } else {
+          result = MinimizeLatencyPlacement(sizes, remaining_, bandwidths,
+                                            startup_times, targets_, output);
+        }
+        break;
+      }
+      default: {
+        HERMES_INVALID_CODE_PATH;
+        break;
+      }
+    }
+
+    return result;
+  }
+
+  void Put(const Event &event) {
+    result_.puts++;
+    Free(event.name);
+
+    std::vector<PlacementSchema> output;
+    time_point start = now();
+    Status status = Place(event.size, event.time, output);
+    result_.placement_seconds +=
+      std::chrono::duration<f64>(now() - start).count();
+
+    std::vector<Fragment> fragments;
+    bool placed = status == 0 && output.size() == 1;
+    if (placed) {
+      std::vector<u64> needed(num_targets_, 0);
+      for (auto [size, target] : AggregateBlobSchema(output[0])) {
+        int index = target.bits.device_id;
+        needed[index] += size;
+        fragments.push_back(std::make_pair(size, index));
+      }
+      for (int i = 0; i < num_targets_; ++i) {
+        placed = placed && needed[i] <= remaining_[i];
+      }
+    }
+
+    if (placed) {
+      for (auto [size, index] : fragments) {
+        remaining_[index] -= size;
+      }
+      std::vector<f64> usage = GetUsage();
+      for (int i = 0; i < num_targets_; ++i) {
+        result_.peak_usage[i] = std::max(result_.peak_usage[i], usage[i]);
+      }
+    } else {
+      fragments.clear();
+      fragments.push_back(std::make_pair(event.size, num_targets_));
+      result_.spills++;
+      result_.spill_bytes += event.size;
+    }
+
+    result_.put_seconds += Serve(fragments, event.time) - event.time;
+    blobs_[event.name] = fragments;
+  }
+
+  void Get(const Event &event) {
+    result_.gets++;
+    auto iter = blobs_.find(event.name);
+    if (iter == blobs_.end()) {
+      result_.misses++;
+    } else {
+      result_.get_seconds += Serve(iter->second, event.time) - event.time;
+    }
+  }
+
+  const Options &opts_;
+  Policy policy_;
+  int num_targets_;
+  std::vector<u64> remaining_;
+  /** Bandwidths and latencies of each Target, followed by swap space. */
+  std::vector<f32> bandwidths_;
+  std::vector<f64> latencies_;
+  std::vector<f64> busy_until_;
+  std::vector<TargetID> targets_;
+  std::vector<size_t> buffer_sizes_;
+  std::unordered_map<std::string, std::vector<Fragment>> blobs_;
+  f64 next_sample_;
+  SimResult result_;
+};
+
+}  // namespace hermes
+
+int main(int argc, char **argv) {
+  using namespace hermes;  // NOLINT(*)
+  Options opts = HandleArgs(argc, argv);
+
+  std::vector<Event> events;
+  if (opts.trace_path) {
+    events = ReadTrace(opts.trace_path);
+  } else {
+    events = GenerateTrace(opts);
+  }
+
+  std::vector<SimResult> results;
+  for (int p = 0; p < (int)Policy::kCount; ++p) {
+    SeedPlacementRng(opts.seed);
+    Simulator simulator(opts, (Policy)p);
+    results.push_back(simulator.Run(events));
+  }
+
+  int num_targets = (int)opts.targets.size();
+  printf("Policy,Events,Puts,Gets,Deletes,Misses,SwapSpills,SwapBytes,"
+         "PutIoSeconds,GetIoSeconds,PlacementSeconds");
+  for (int i = 0; i < num_targets; ++i) {
+    printf(",PeakUsage%d", i);
+  }
+  for (int i = 0; i < num_targets; ++i) {
+    printf(",FinalUsage%d", i);
+  }
+  printf("\n");
+  for (int p = 0; p < (int)Policy::kCount; ++p) {
+    const SimResult &result = results[p];
+    printf("%s,%zu,%d,%d,%d,%d,%d,%llu,%f,%f,%f", kPolicyNames[p],
+           events.size(), result.puts, result.gets, result.deletes,
+           result.misses, result.spills,
+           (unsigned long long)result.spill_bytes, result.put_seconds,
+           result.get_seconds, result.placement_seconds);
+    for (int i = 0; i < num_targets; ++i) {
+      printf(",%f", result.peak_usage[i]);
+    }
+    for (int i = 0; i < num_targets; ++i) {
+      printf(",%f", result.final_usage[i]);
+    }
+    printf("\n");
+  }
+
+  if (opts.usage_interval > 0) {
+    printf("\nPolicy,Time");
+    for (int i = 0; i < num_targets; ++i) {
+      printf(",Usage%d", i);
+    }
+    printf("\n");
+    for (int p = 0; p < (int)Policy::kCount; ++p) {
+      for (const auto &sample : results[p].usage_samples) {
+        printf("%s", kPolicyNames[p]);
+        for (f64 value : sample) {
+          printf(",%f", value);
+        }
+        printf("\n");
+      }
+    }
+  }
+
+  return 0;
+}
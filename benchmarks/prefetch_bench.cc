@@ -0,0 +1,244 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mpi.h>
+
+#include "hermes.h"
+#include "bucket.h"
+#include "buffer_pool.h"
+#include "buffer_pool_internal.h"
+#include "metadata_management.h"
+#include "metadata_storage.h"
+#include "utils.h"
+
+/**
+ * Measures a strided read scan over blobs that start on the slowest tier.
+ *
+ * The scan is run three times: with no prefetching, with automatic
+ * read-ahead, and with an explicit Bucket::Prefetch of the whole scan before
+ * it starts. Between runs every blob is moved back to the slowest tier. A
+ * simulated compute phase after each read gives the BufferOrganizer time to
+ * stay ahead of the reader.
+ */
+
+namespace hapi = hermes::api;
+using std::chrono::time_point;
+const auto now = std::chrono::high_resolution_clock::now;
+const char kBucketName[] = "prefetch_bench";
+
+enum class PrefetchMode {
+  kNone,
+  kReadAhead,
+  kExplicit,
+};
+
+struct Options {
+  int num_blobs;
+  int blob_size;
+  int stride;
+  int read_ahead_depth;
+  int compute_us;
+};
+
+double GetSeconds(time_point<std::chrono::high_resolution_clock> start,
+                  time_point<std::chrono::high_resolution_clock> end) {
+  double result = std::chrono::duration<double>(end - start).count();
+
+  return result;
+}
+
+void PrintUsage(char *program) {
+  fprintf(stderr, "Usage: %s [-n num_blobs] [-s blob_size] [-t stride] "
+          "[-d read_ahead_depth] [-c compute_us]\n", program);
+  fprintf(stderr, "  -n\n");
+  fprintf(stderr, "     Number of blobs to stage (default 256).\n");
+  fprintf(stderr, "  -s\n");
+  fprintf(stderr, "     Size of each blob in bytes (default 1 MiB).\n");
+  fprintf(stderr, "  -t\n");
+  fprintf(stderr, "     Distance between the indices of consecutive reads "
+          "(default 2).\n");
+  fprintf(stderr, "  -d\n");
+  fprintf(stderr, "     Number of blobs to read ahead (default 4).\n");
+  fprintf(stderr, "  -c\n");
+  fprintf(stderr, "     Microseconds of simulated compute after each read "
+          "(default 1000).\n");
+}
+
+Options HandleArgs(int argc, char **argv) {
+  Options result = {};
+  result.num_blobs = 256;
+  result.blob_size = MEGABYTES(1);
+  result.stride = 2;
+  result.read_ahead_depth = 4;
+  result.compute_us = 1000;
+  int option = -1;
+
+  while ((option = getopt(argc, argv, "c:d:n:s:t:")) != -1) {
+    switch (option) {
+      case 'c': {
+        result.compute_us = atoi(optarg);
+        break;
+      }
+      case 'd': {
+        result.read_ahead_depth = atoi(optarg);
+        break;
+      }
+      case 'n': {
+        result.num_blobs = atoi(optarg);
+        break;
+      }
+      case 's': {
+        result.blob_size = atoi(optarg);
+        break;
+      }
+      case 't': {
+        result.stride = atoi(optarg);
+        break;
+      }
+      default:
+        PrintUsage(argv[0]);
+        exit(1);
+    }
+  }
+
+  if (result.stride < 1 || result.read_ahead_depth < 1) {
+    fprintf(stderr, "The stride and read-ahead depth must be positive.\n");
+    PrintUsage(argv[0]);
+    exit(1);
+  }
+
+  return result;
+}
+
+std::string GetBlobName(int index) {
+  std::string result = "blob_" + std::to_string(index);
+
+  return result;
+}
+
+void WaitForPendingMoves(hermes::SharedMemoryContext *context) {
+  hermes::BufferPool *pool = hermes::GetBufferPoolFromContext(context);
+  while (pool->num_pending_moves.load() > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+}
+
+/** Moves every blob in the scan to @p target and waits for the moves. */
+void DemoteBlobs(std::shared_ptr<hapi::Hermes> hermes, hapi::Bucket &bucket,
+                 const Options &opts, hermes::TargetID target) {
+  hermes::SharedMemoryContext *context = &hermes->context_;
+  hermes::RpcContext *rpc = &hermes->rpc_;
+  WaitForPendingMoves(context);
+
+  hermes::BucketID bucket_id = {};
+  bucket_id.as_int = bucket.GetId();
+  for (int i = 0; i < opts.num_blobs; ++i) {
+    std::string name = GetBlobName(i);
+    hermes::BlobID blob_id = hermes::GetBlobIdByName(context, rpc, name.c_str(),
+                                                     bucket_id);
+    if (hermes::MoveToTarget(context, rpc, blob_id, target) != 0) {
+      fprintf(stderr, "Failed to move blob %d to the slowest target\n", i);
+    }
+  }
+}
+
+double RunScan(hapi::Bucket &bucket, const Options &opts, PrefetchMode mode) {
+  hapi::Context ctx;
+  ctx.read_ahead_depth = (mode == PrefetchMode::kReadAhead ?
+                          opts.read_ahead_depth : 0);
+  hapi::Blob blob(opts.blob_size);
+
+  time_point start = now();
+  if (mode == PrefetchMode::kExplicit) {
+    std::vector<std::string> names;
+    for (int i = 0; i < opts.num_blobs; i += opts.stride) {
+      names.push_back(GetBlobName(i));
+    }
+    if (bucket.Prefetch(names, 0, ctx) != 0) {
+      fprintf(stderr, "Prefetch was only partially queued\n");
+    }
+  }
+
+  for (int i = 0; i < opts.num_blobs; i += opts.stride) {
+    if (bucket.Get(GetBlobName(i), blob, ctx) != blob.size()) {
+      fprintf(stderr, "Get of blob %d failed\n", i);
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(opts.compute_us));
+  }
+  time_point end = now();
+
+  double result = GetSeconds(start, end);
+
+  return result;
+}
+
+int main(int argc, char **argv) {
+  Options opts = HandleArgs(argc, argv);
+
+  int mpi_threads_provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &mpi_threads_provided);
+  if (mpi_threads_provided < MPI_THREAD_MULTIPLE) {
+    fprintf(stderr, "Didn't receive appropriate MPI threading specification\n");
+    return 1;
+  }
+
+  hermes::Config config = {};
+  hermes::InitDefaultConfig(&config);
+  std::shared_ptr<hapi::Hermes> hermes = hermes::InitHermes(&config, true);
+  std::vector<hermes::TargetID> targets =
+    hermes::GetNodeTargets(&hermes->context_);
+
+  hapi::Context ctx;
+  hapi::Bucket bucket(kBucketName, hermes, ctx);
+  std::vector<hermes::u8> data(opts.blob_size, 'x');
+  for (int i = 0; i < opts.num_blobs; ++i) {
+    if (bucket.Put(GetBlobName(i), data, ctx) != 0) {
+      fprintf(stderr, "Put of blob %d failed\n", i);
+    }
+  }
+
+  const PrefetchMode kModes[] = {
+    PrefetchMode::kNone, PrefetchMode::kReadAhead, PrefetchMode::kExplicit
+  };
+  const char *kModeNames[] = {"none", "read_ahead", "explicit"};
+  double seconds[3] = {};
+  for (int i = 0; i < 3; ++i) {
+    DemoteBlobs(hermes, bucket, opts, targets.back());
+    seconds[i] = RunScan(bucket, opts, kModes[i]);
+  }
+  WaitForPendingMoves(&hermes->context_);
+
+  bucket.Destroy(ctx);
+  hermes->Finalize(true);
+
+  printf("Mode,NumBlobs,BlobSize,Stride,ReadAheadDepth,ComputeUs,Seconds,"
+         "MiBPerSecond\n");
+  for (int i = 0; i < 3; ++i) {
+    int blobs_read = (opts.num_blobs + opts.stride - 1) / opts.stride;
+    double mib = (double)blobs_read * opts.blob_size / MEGABYTES(1);
+    printf("%s,%d,%d,%d,%d,%d,%f,%f\n", kModeNames[i], opts.num_blobs,
+           opts.blob_size, opts.stride, opts.read_ahead_depth, opts.compute_us,
+           seconds[i], mib / seconds[i]);
+  }
+
+  MPI_Finalize();
+
+  return 0;
+}
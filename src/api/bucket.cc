@@ -12,12 +12,16 @@
 
 #include "bucket.h"
 
+#include <ctype.h>
+
 #include <iostream>
+#include <utility>
 #include <vector>
 
 #include "utils.h"
 #include "buffer_pool.h"
 #include "metadata_management.h"
+#include "metadata_storage.h"
 
 namespace hermes {
 
@@ -25,7 +29,8 @@ namespace api {
 
 Bucket::Bucket(const std::string &initial_name,
                const std::shared_ptr<Hermes> &h, Context ctx)
-    : name_(initial_name), hermes_(h) {
+    : name_(initial_name), read_ahead_(), pending_reads_(0),
+      pending_bytes_read_(0), hermes_(h) {
   (void)ctx;
 
   if (IsBucketNameTooLong(name_)) {
@@ -53,9 +58,10 @@ Status Bucket::Put(const std::string &name, const u8 *data, size_t size,
   if (IsValid() && ret == 0) {
     std::vector<size_t> sizes(1, size);
     std::vector<PlacementSchema> schemas;
+    CapacityReservation reservation = {};
     HERMES_BEGIN_TIMED_BLOCK("CalculatePlacement");
     ret = CalculatePlacement(&hermes_->context_, &hermes_->rpc_, sizes, schemas,
-                             ctx);
+                             ctx, &reservation);
     HERMES_END_TIMED_BLOCK();
 
     if (ret == 0) {
@@ -65,7 +71,8 @@ Status Bucket::Put(const std::string &name, const u8 *data, size_t size,
       // TODO(chogan): Create a PreallocatedMemory allocator for std::vector so
       // that a single-blob-Put doesn't perform a copy
       memcpy(blobs[0].data(), data, size);
-      ret = PlaceBlobs(schemas, blobs, names, ctx.buffer_organizer_retries);
+      ret = PlaceBlobs(schemas, blobs, names, &reservation);
+      ReleaseCapacity(&hermes_->context_, &reservation);
     } else {
       // TODO(chogan): @errorhandling No space left or contraints unsatisfiable.
       ret = 1;
@@ -84,7 +91,7 @@ size_t Bucket::GetBlobSize(Arena *arena, const std::string &name,
     LOG(INFO) << "Getting Blob " << name << " size from bucket "
               << name_ << '\n';
     BlobID blob_id = GetBlobIdByName(&hermes_->context_, &hermes_->rpc_,
-                                     name.c_str());
+                                     name.c_str(), id_);
     if (!IsNullBlobId(blob_id)) {
       result = GetBlobSizeById(&hermes_->context_, &hermes_->rpc_, arena,
                                blob_id);
@@ -108,15 +115,187 @@ size_t Bucket::Get(const std::string &name, Blob &user_blob, Context &ctx) {
     } else {
       LOG(INFO) << "Getting Blob " << name << " from bucket " << name_ << '\n';
       BlobID blob_id = GetBlobIdByName(&hermes_->context_, &hermes_->rpc_,
-                                       name.c_str());
+                                       name.c_str(), id_);
       ret = ReadBlobById(&hermes_->context_, &hermes_->rpc_,
                          &hermes_->trans_arena_, user_blob, blob_id);
+      RecordRead(ret);
+      if (ctx.read_ahead_depth > 0) {
+        ReadAhead(name, ctx);
+      }
     }
   }
 
   return ret;
 }
 
+void Bucket::RecordRead(u64 bytes) {
+  // NOTE(chogan): ReadBlobById already recorded the read with the Blob's
+  // metadata owner. When this Bucket's metadata is remote, its reads are
+  // batched so that a Get doesn't cost another request.
+  const u64 kMaxPendingReads = 64;
+  bool flush = false;
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    pending_reads_++;
+    pending_bytes_read_ += bytes;
+    flush = (pending_reads_ >= kMaxPendingReads ||
+             id_.bits.node_id == (u32)hermes_->rpc_.node_id);
+  }
+
+  if (flush) {
+    FlushStats();
+  }
+}
+
+void Bucket::FlushStats() {
+  u64 reads = 0;
+  u64 bytes_read = 0;
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    std::swap(reads, pending_reads_);
+    std::swap(bytes_read, pending_bytes_read_);
+  }
+
+  if (reads > 0) {
+    RecordBucketAccess(&hermes_->context_, &hermes_->rpc_, id_,
+                       kAccessType_Read, bytes_read, reads);
+  }
+}
+
+Status Bucket::Prefetch(const std::vector<std::string> &names,
+                        int target_tier, Context &ctx) {
+  Status result = 0;
+
+  if (IsValid()) {
+    SharedMemoryContext *context = &hermes_->context_;
+    RpcContext *rpc = &hermes_->rpc_;
+    std::vector<TargetID> targets = GetNodeTargets(context);
+
+    if (target_tier < 0 || target_tier >= (int)targets.size()) {
+      // TODO(chogan): @errorhandling
+      result = 1;
+      return result;
+    }
+
+    TargetID dest = targets[target_tier];
+    std::vector<BlobID> blob_ids;
+    for (size_t i = 0; i < names.size(); ++i) {
+      BlobID blob_id = GetBlobIdByName(context, rpc, names[i].c_str(), id_);
+      // NOTE(chogan): Blobs in swap space are returned to the hierarchy by the
+      // swap drain, not by moves.
+      if (!IsNullBlobId(blob_id) && !hermes::BlobIsInSwap(blob_id)) {
+        blob_ids.push_back(blob_id);
+      }
+    }
+
+    u32 num_queued = EnqueueBlobMoves(context, rpc, blob_ids, dest,
+                                      ctx.buffer_organizer_retries,
+                                      kBoPriority_Prefetch);
+    if (num_queued < blob_ids.size()) {
+      // TODO(chogan): @errorhandling The BufferOrganizer is saturated, so the
+      // rest of the names are dropped rather than queued behind it.
+      result = 1;
+    }
+  }
+
+  return result;
+}
+
+/**
+ * Records a read of Blob @p index in @p state and returns the names of the
+ * Blobs to prefetch, if any.
+ */
+static std::vector<std::string> GetReadAheadNames(ReadAheadState *state,
+                                                  const std::string &prefix,
+                                                  i64 index, int index_width,
+                                                  int read_ahead_depth) {
+  std::vector<std::string> result;
+
+  if (prefix != state->prefix || index_width != state->index_width) {
+    *state = {};
+    state->prefix = prefix;
+    state->index_width = index_width;
+    state->last_index = index;
+    return result;
+  }
+
+  i64 stride = index - state->last_index;
+  state->last_index = index;
+  if (stride == 0) {
+    return result;
+  }
+  if (stride == state->stride) {
+    state->run_length++;
+  } else {
+    // NOTE(chogan): A new stride invalidates whatever was prefetched for the
+    // old one.
+    state->stride = stride;
+    state->run_length = 1;
+    state->next_prefetch = index + stride;
+  }
+
+  // NOTE(chogan): Wait until the same stride has been seen twice, so that a
+  // single jump doesn't trigger a burst of useless moves.
+  if (state->run_length < 2) {
+    return result;
+  }
+
+  i64 first = index + stride;
+  i64 last = index + stride * read_ahead_depth;
+  if ((state->next_prefetch - first) * stride > 0) {
+    first = state->next_prefetch;
+  }
+
+  for (i64 i = first; (last - i) * stride >= 0 && i >= 0; i += stride) {
+    std::string index_string = std::to_string(i);
+    if ((int)index_string.size() < index_width) {
+      index_string.insert(0, index_width - index_string.size(), '0');
+    }
+    result.push_back(prefix + index_string);
+  }
+
+  if (result.size() > 0) {
+    state->next_prefetch = last + stride;
+  }
+
+  return result;
+}
+
+void Bucket::ReadAhead(const std::string &name, Context &ctx) {
+  // NOTE(chogan): Several threads may read through the same Bucket, so the
+  // state is only touched under the lock. The lock is dropped before the
+  // prefetch is queued.
+  std::vector<std::string> names;
+
+  // NOTE(chogan): Only names that end in a decimal index take part in
+  // read-ahead, e.g., "chunk_7" or "step0042".
+  size_t digits_start = name.size();
+  while (digits_start > 0 && isdigit((unsigned char)name[digits_start - 1])) {
+    --digits_start;
+  }
+  size_t num_digits = name.size() - digits_start;
+  const size_t kMaxIndexDigits = 18;
+  if (num_digits == 0 || num_digits > kMaxIndexDigits) {
+    std::lock_guard<std::mutex> lock(read_ahead_mutex_);
+    read_ahead_ = {};
+  } else {
+    std::string prefix = name.substr(0, digits_start);
+    i64 index = std::stoll(name.substr(digits_start));
+    int index_width = (num_digits > 1 && name[digits_start] == '0' ?
+                       (int)num_digits : 0);
+
+    std::lock_guard<std::mutex> lock(read_ahead_mutex_);
+    names = GetReadAheadNames(&read_ahead_, prefix, index, index_width,
+                              ctx.read_ahead_depth);
+  }
+
+  if (names.size() > 0) {
+    // NOTE(chogan): One request to the BufferOrganizer for the whole window.
+    const int kFastestTier = 0;
+    Prefetch(names, kFastestTier, ctx);
+  }
+}
+
 template<class Predicate>
 Status Bucket::GetV(void *user_blob, Predicate pred, Context &ctx) {
   (void)user_blob;
@@ -149,7 +328,8 @@ Status Bucket::RenameBlob(const std::string &old_name,
     // TODO(chogan): @errorhandling
   } else {
     LOG(INFO) << "Renaming Blob " << old_name << " to " << new_name << '\n';
-    hermes::RenameBlob(&hermes_->context_, &hermes_->rpc_, old_name, new_name);
+    hermes::RenameBlob(&hermes_->context_, &hermes_->rpc_, old_name, new_name,
+                       id_);
   }
 
   return ret;
@@ -162,22 +342,72 @@ bool Bucket::ContainsBlob(const std::string &name) {
   return result;
 }
 
+AccessStats Bucket::GetStats(Context &ctx) {
+  (void)ctx;
+  AccessStats result = {};
+
+  if (IsValid()) {
+    FlushStats();
+    result = GetBucketStats(&hermes_->context_, &hermes_->rpc_, id_);
+  }
+
+  return result;
+}
+
+AccessStats Bucket::GetBlobStats(const std::string &name, Context &ctx) {
+  (void)ctx;
+  AccessStats result = {};
+
+  if (IsValid()) {
+    BlobID blob_id = GetBlobIdByName(&hermes_->context_, &hermes_->rpc_,
+                                     name.c_str(), id_);
+    if (!IsNullBlobId(blob_id)) {
+      result = hermes::GetBlobStats(&hermes_->context_, &hermes_->rpc_,
+                                    blob_id);
+    }
+  }
+
+  return result;
+}
+
 bool Bucket::BlobIsInSwap(const std::string &name) {
   BlobID blob_id = GetBlobIdByName(&hermes_->context_, &hermes_->rpc_,
-                                   name.c_str());
+                                   name.c_str(), id_);
   bool result = hermes::BlobIsInSwap(blob_id);
 
   return result;
 }
 
-template<class Predicate>
-std::vector<std::string> Bucket::GetBlobNames(Predicate pred,
+std::vector<std::string> Bucket::GetBlobNames(const BlobPredicate &pred,
                                               Context &ctx) {
+  std::vector<std::string> result;
+  BlobCursor cursor = {};
+  const u32 kPageSize = 1024;
+
+  while (IsValid() && !cursor.done) {
+    std::vector<std::string> page = GetBlobNames(pred, cursor, kPageSize, ctx);
+    result.insert(result.end(), page.begin(), page.end());
+  }
+
+  return result;
+}
+
+std::vector<std::string> Bucket::GetBlobNames(const BlobPredicate &pred,
+                                              BlobCursor &cursor,
+                                              u32 max_results, Context &ctx) {
   (void)ctx;
+  std::vector<std::string> result;
 
-  LOG(INFO) << "Getting blob names by predicate from bucket " << name_ << '\n';
+  if (IsValid()) {
+    LOG(INFO) << "Getting blob names by predicate from bucket " << name_
+              << '\n';
+    GetBlobIds(&hermes_->context_, &hermes_->rpc_, id_, pred, &cursor,
+               max_results, &result);
+  } else {
+    cursor.done = true;
+  }
 
-  return std::vector<std::string>();
+  return result;
 }
 
 struct bkt_info * Bucket::GetInfo(Context &ctx) {
@@ -205,16 +435,31 @@ Status Bucket::Rename(const std::string &new_name, Context &ctx) {
 }
 
 Status Bucket::Persist(const std::string &file_name, Context &ctx) {
+  WriteBackHandle handle = PersistAsync(file_name, ctx);
+  Status result = WaitForWriteBack(handle);
+
+  return result;
+}
+
+WriteBackHandle Bucket::PersistAsync(const std::string &file_name,
+                                     Context &ctx) {
   (void)ctx;
   // TODO(chogan): Once we have Traits, we need to let users control the mode
   // when we're, for example, updating an existing file. For now we just assume
   // we're always creating a new file.
-  std::string open_mode = "w";
+  const bool truncate = true;
+
+  std::vector<BlobID> blob_ids = GetBlobIds(&hermes_->context_, &hermes_->rpc_,
+                                            id_);
+  std::vector<WriteBackRequest> requests(blob_ids.size());
+  for (size_t i = 0; i < blob_ids.size(); ++i) {
+    requests[i].blob_id = blob_ids[i];
+    requests[i].offset = kWriteBackAppend;
+  }
 
-  // TODO(chogan): Support other storage backends
-  Status result = StdIoPersistBucket(&hermes_->context_, &hermes_->rpc_,
-                                     &hermes_->trans_arena_, id_, file_name,
-                                     open_mode);
+  WriteBackHandle result = EnqueueWriteBack(hermes_->write_back_.get(),
+                                            file_name, -1, truncate,
+                                            std::move(requests));
 
   return result;
 }
@@ -225,6 +470,7 @@ Status Bucket::Close(Context &ctx) {
 
   if (IsValid()) {
     LOG(INFO) << "Closing bucket '" << name_ << "'" << std::endl;
+    FlushStats();
     DecrementRefcount(&hermes_->context_, &hermes_->rpc_, id_);
     id_.as_int = 0;
   }
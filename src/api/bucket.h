@@ -14,6 +14,7 @@
 #define BUCKET_H_
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -29,17 +30,51 @@ namespace hermes {
 
 namespace api {
 
+/** Tracks the Blob names read from a Bucket to detect strided scans. */
+struct ReadAheadState {
+  /** The name of the last Blob read, without its trailing index. */
+  std::string prefix;
+  /** The trailing index of the last Blob read. */
+  i64 last_index;
+  /** The difference between the last two indices read. */
+  i64 stride;
+  /** The number of consecutive reads separated by `stride`. */
+  int run_length;
+  /** The next index that hasn't been prefetched yet. */
+  i64 next_prefetch;
+  /** The number of digits in a zero-padded index, or 0 if it isn't padded. */
+  int index_width;
+};
+
 class Bucket {
  private:
   std::string name_;
   hermes::BucketID id_;
+  /** Guards `read_ahead_`. */
+  std::mutex read_ahead_mutex_;
+  ReadAheadState read_ahead_;
+  /** Guards `pending_reads_` and `pending_bytes_read_`. */
+  std::mutex stats_mutex_;
+  /** Reads not yet added to this Bucket's statistics (see FlushStats). */
+  u64 pending_reads_;
+  u64 pending_bytes_read_;
+
+  /** Prefetches the Blobs that follow @p name if it continues a strided scan.*/
+  void ReadAhead(const std::string &name, Context &ctx);
+
+  /** Adds a read of @p bytes bytes to this Bucket's statistics. */
+  void RecordRead(u64 bytes);
+
+  /** Sends the pending reads to the node that owns this Bucket's metadata. */
+  void FlushStats();
 
  public:
   /** internal Hermes object owned by Bucket */
   std::shared_ptr<Hermes> hermes_;
 
   // TODO(chogan): Think about the Big Three
-  Bucket() : name_(""), id_{0, 0}, hermes_(nullptr) {
+  Bucket() : name_(""), id_{0, 0}, read_ahead_(), pending_reads_(0),
+             pending_bytes_read_(0), hermes_(nullptr) {
     LOG(INFO) << "Create NULL Bucket " << std::endl;
   }
 
@@ -84,7 +119,8 @@ class Bucket {
   template<typename T>
   Status PlaceBlobs(std::vector<PlacementSchema> &schemas,
                     const std::vector<std::vector<T>> &blobs,
-                    const std::vector<std::string> &names, int retries);
+                    const std::vector<std::string> &names,
+                    CapacityReservation *reservation = NULL);
 
   /**
    *
@@ -103,6 +139,15 @@ class Bucket {
   /** use provides buffer */
   size_t Get(const std::string &name, Blob& user_blob, Context &ctx);
 
+  /** Start moving the Blobs called @p names to the Targets of @p target_tier,
+   * where 0 is the fastest tier, so that later Gets don't wait on slow
+   * Targets.
+   *
+   * The moves happen asynchronously in the BufferOrganizer. Returns non-zero
+   * if @p target_tier doesn't exist or the BufferOrganizer queue is full. */
+  Status Prefetch(const std::vector<std::string> &names, int target_tier,
+                  Context &ctx);
+
   /** get blob(s) on this bucket according to predicate */
   /** use provides buffer */
   template<class Predicate>
@@ -118,12 +163,29 @@ class Bucket {
   /** Returns true if the Bucket contains a Blob called `name` */
   bool ContainsBlob(const std::string &name);
 
+  /** Returns the aggregate access statistics of all Blobs in this Bucket.
+   * Reads through other handles to this Bucket whose metadata is remote are
+   * counted in batches, so they may not show up yet. */
+  AccessStats GetStats(Context &ctx);
+
+  /** Returns the access statistics of the Blob called `name` */
+  AccessStats GetBlobStats(const std::string &name, Context &ctx);
+
   /** Returns true if the Blob called `name` in this bucket is in swap space */
   bool BlobIsInSwap(const std::string &name);
 
   /** get a list of blob names filtered by pred */
-  template<class Predicate>
-  std::vector<std::string> GetBlobNames(Predicate pred, Context &ctx);
+  std::vector<std::string> GetBlobNames(const BlobPredicate &pred,
+                                        Context &ctx);
+
+  /**
+   * Get the next page of at most `max_results` blob names filtered by pred,
+   * starting from and advancing `cursor`. Filtering happens on the nodes that
+   * own the blob metadata, so only matches are transferred.
+   */
+  std::vector<std::string> GetBlobNames(const BlobPredicate &pred,
+                                        BlobCursor &cursor, u32 max_results,
+                                        Context &ctx);
 
   /** get information from the bucket at level-of-detail  */
   struct bkt_info * GetInfo(Context &ctx);
@@ -136,6 +198,12 @@ class Bucket {
    * The blobs are written in the same order in which they are `Put`. */
   Status Persist(const std::string &file_name, Context &ctx);
 
+  /** Start saving this bucket's blobs to @p file_name in the background.
+   *
+   * Returns a handle to pass to hermes::WaitForWriteBack. The blobs must not
+   * be modified or destroyed until the write-back completes. */
+  WriteBackHandle PersistAsync(const std::string &file_name, Context &ctx);
+
   /** close this bucket and free its associated resources (?) */
   /** Invalidates handle */
   Status Close(Context &ctx);
@@ -156,19 +224,19 @@ Status Bucket::Put(const std::string &name, const std::vector<T> &data,
 template<typename T>
 Status Bucket::PlaceBlobs(std::vector<PlacementSchema> &schemas,
                           const std::vector<std::vector<T>> &blobs,
-                          const std::vector<std::string> &names, int retries) {
-  Status result = 0;
+                          const std::vector<std::string> &names,
+                          CapacityReservation *reservation) {
+  std::vector<hermes::Blob> internal_blobs(schemas.size());
 
   for (size_t i = 0; i < schemas.size(); ++i) {
-    PlacementSchema &schema = schemas[i];
-    hermes::Blob blob = {};
-    blob.data = (u8 *)blobs[i].data();
-    blob.size = blobs[i].size() * sizeof(T);
+    internal_blobs[i].data = (u8 *)blobs[i].data();
+    internal_blobs[i].size = blobs[i].size() * sizeof(T);
     LOG(INFO) << "Attaching blob '" << names[i] << "' to Bucket '" << name_
               << "'" << std::endl;
-    result = PlaceBlob(&hermes_->context_, &hermes_->rpc_, schema, blob,
-                       names[i], id_, retries);
   }
+  Status result = hermes::PlaceBlobs(&hermes_->context_, &hermes_->rpc_,
+                                     schemas, internal_blobs, names, id_,
+                                     reservation);
 
   return result;
 }
@@ -193,13 +261,15 @@ Status Bucket::Put(std::vector<std::string> &names,
       sizes_in_bytes[i] = blobs[i].size() * sizeof(T);
     }
     std::vector<PlacementSchema> schemas;
+    CapacityReservation reservation = {};
     HERMES_BEGIN_TIMED_BLOCK("CalculatePlacement");
     ret = CalculatePlacement(&hermes_->context_, &hermes_->rpc_, sizes_in_bytes,
-                             schemas, ctx);
+                             schemas, ctx, &reservation);
     HERMES_END_TIMED_BLOCK();
 
     if (ret == 0) {
-      ret = PlaceBlobs(schemas, blobs, names, ctx.buffer_organizer_retries);
+      ret = PlaceBlobs(schemas, blobs, names, &reservation);
+      ReleaseCapacity(&hermes_->context_, &reservation);
     } else {
       // TODO(chogan): @errorhandling No space left or contraints unsatisfiable.
       ret = 1;
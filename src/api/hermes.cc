@@ -21,6 +21,7 @@
 #include "bucket.h"
 #include "buffer_pool.h"
 #include "buffer_pool_internal.h"
+#include "checkpoint.h"
 #include "metadata_management_internal.h"
 
 namespace hermes {
@@ -28,6 +29,7 @@ namespace hermes {
 namespace api {
 
 int Context::default_buffer_organizer_retries;
+int Context::default_read_ahead_depth;
 
 Status RenameBucket(const std::string &old_name,
                     const std::string &new_name,
@@ -106,8 +108,21 @@ void *Hermes::GetAppCommunicator() {
 }
 
 void Hermes::Finalize(bool force_rpc_shutdown) {
+  if (write_back_) {
+    StopWriteBackService(write_back_.get());
+  }
   hermes::Finalize(&context_, &comm_, &rpc_, shmem_name_.c_str(), &trans_arena_,
                    IsApplicationCore(), force_rpc_shutdown);
+  delete context_.placement_cache;
+  context_.placement_cache = 0;
+  StopBufferWriterPool(context_.buffer_writers);
+  context_.buffer_writers = 0;
+}
+
+void Hermes::WaitForWriteBacks() {
+  if (write_back_) {
+    WriteBackBarrier(write_back_.get());
+  }
 }
 
 void Hermes::RemoteFinalize() {
@@ -184,6 +199,12 @@ SharedMemoryContext InitHermesCore(Config *config, CommunicationContext *comm,
   mdm->rpc_state_offset = (u8 *)rpc->state - shmem_base;
 
   InitMetadataManager(mdm, &arenas[kArenaType_MetaData], config, comm->node_id);
+  // NOTE(chogan): A checkpoint contains the BufferPool and MetaData Arenas,
+  // which are the first two Arenas in shared memory.
+  u64 checkpoint_size = (arena_info->sizes[kArenaType_BufferPool] +
+                         arena_info->sizes[kArenaType_MetaData]);
+  InitCheckpoint(mdm, &arenas[kArenaType_MetaData], config, comm->num_nodes,
+                 checkpoint_size);
   InitMetadataStorage(&context, mdm, &arenas[kArenaType_MetaData], config);
 
   // NOTE(chogan): Store the metadata_manager_offset right after the
@@ -192,6 +213,10 @@ SharedMemoryContext InitHermesCore(Config *config, CommunicationContext *comm,
     (ptrdiff_t *)(shmem_base + sizeof(context.buffer_pool_offset));
   *metadata_manager_offset_location = context.metadata_manager_offset;
 
+  // NOTE(chogan): Warm start. Replace the fresh metadata with the state saved
+  // by the previous daemon, if it was created with the same configuration.
+  RestoreCheckpoint(&context, rpc);
+
   return context;
 }
 
@@ -256,6 +281,9 @@ std::shared_ptr<api::Hermes> InitHermes(Config *config, bool is_daemon,
   bool create_shared_files = (comm.proc_kind == ProcessKind::kHermes &&
                               comm.first_on_node);
   InitFilesForBuffering(&context, create_shared_files);
+  if (create_shared_files && config->bandwidth_calibration_size > 0) {
+    CalibrateDeviceBandwidths(&context, config->bandwidth_calibration_size);
+  }
 
   WorldBarrier(&comm);
 
@@ -265,6 +293,9 @@ std::shared_ptr<api::Hermes> InitHermes(Config *config, bool is_daemon,
   result->trans_arena_ = arenas[kArenaType_Transient];
   result->comm_ = comm;
   result->context_ = context;
+  result->context_.placement_cache = new PlacementCache();
+  result->context_.buffer_writers =
+    StartBufferWriterPool(config->parallel_write_threads);
   result->rpc_ = rpc;
 
   // NOTE(chogan): The RPC servers have to be started here because they need to
@@ -282,23 +313,57 @@ std::shared_ptr<api::Hermes> InitHermes(Config *config, bool is_daemon,
 
     std::string bo_address = GetRpcAddress(config, host_number,
                                            config->buffer_organizer_port);
-    // TODO(chogan): @config Probably want a configuration variable for this.
-    int bo_threads = 1;
     StartBufferOrganizer(&result->context_, &result->rpc_, bo_address.c_str(),
-                         bo_threads, config->buffer_organizer_port);
+                         config->buffer_organizer_threads,
+                         config->buffer_organizer_port);
 
     double sleep_ms = config->system_view_state_update_interval_ms;
     StartGlobalSystemViewStateUpdateThread(&result->context_, &result->rpc_,
                                            &result->trans_arena_,
                                            sleep_ms);
+
+    if (config->tiering_interval_ms > 0) {
+      TieringPolicy policy = {};
+      policy.high_watermark = config->tiering_high_watermark;
+      policy.low_watermark = config->tiering_low_watermark;
+      policy.promotion_frequency = config->tiering_promotion_frequency;
+      policy.bytes_per_interval =
+        (i64)(config->tiering_max_mbps * MEGABYTES(1) *
+              (config->tiering_interval_ms / 1000.0));
+      StartTieringThread(&result->context_, &result->rpc_,
+                         &result->trans_arena_, policy,
+                         config->tiering_interval_ms);
+    }
+
+    if (config->defrag_interval_ms > 0) {
+      DefragPolicy policy = {};
+      policy.threshold = config->defrag_threshold;
+      policy.max_steps = config->defrag_max_steps;
+      policy.max_relocations = config->defrag_max_relocations;
+      policy.adaptation_rate = config->slab_adaptation_rate;
+      StartDefragThread(&result->context_, &result->rpc_,
+                        &result->trans_arena_, policy,
+                        config->defrag_interval_ms);
+    }
   }
 
   WorldBarrier(&comm);
 
   api::Context::default_buffer_organizer_retries =
     config->num_buffer_organizer_retries;
+  api::Context::default_read_ahead_depth = config->read_ahead_depth;
+
+  // NOTE(chogan): Each rank gets its own seed so that ranks don't all make the
+  // same random choices.
+  u64 placement_seed = 0;
+  if (config->placement_seed) {
+    placement_seed = (u64)config->placement_seed + (u64)comm.world_proc_id;
+  }
+  SeedPlacementRng(placement_seed);
 
   InitRpcClients(&result->rpc_);
+  result->write_back_ = StartWriteBackService(&result->context_, &result->rpc_,
+                                              config->write_back_threads);
 
   return result;
 }
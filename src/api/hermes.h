@@ -26,6 +26,7 @@
 #include "metadata_management.h"
 #include "rpc.h"
 #include "id.h"
+#include "write_back.h"
 
 namespace hermes {
 namespace api {
@@ -42,6 +43,8 @@ class Hermes {
   hermes::Arena trans_arena_;
   std::string shmem_name_;
   std::string rpc_server_name_;
+  /** Background threads that write Blobs back to files. */
+  std::shared_ptr<hermes::WriteBackService> write_back_;
 
   /** if true will do more checks, warnings, expect slower code */
   const bool debug_mode_ = true;
@@ -70,6 +73,8 @@ class Hermes {
   int GetNumProcesses();
   void *GetAppCommunicator();
   void Finalize(bool force_rpc_shutdown = false);
+  /** Blocks until every write-back this process has enqueued is finished. */
+  void WaitForWriteBacks();
   void RemoteFinalize();
 
   bool BucketContainsBlob(const std::string &bucket_name,
@@ -87,16 +92,31 @@ enum class PlacementPolicy {
   kRandom,
   kRoundRobin,
   kMinimizeIoTime,
+  /** Places each Blob where it finishes writing soonest, counting Device
+   * latency and queued writes, and splits Blobs only when they don't fit. */
+  kMinimizeLatency,
 };
 
 struct Context {
   static int default_buffer_organizer_retries;
+  static int default_read_ahead_depth;
 
   PlacementPolicy policy;
+  /** The number of attempts the BufferOrganizer makes at each move requested by
+   * Bucket::Prefetch. */
   int buffer_organizer_retries;
+  /** The number of Blobs ahead of a sequential scan to prefetch. */
+  int read_ahead_depth;
+  /** Solve kMinimizeIoTime placements with the general linear programming
+   * solver instead of the analytic one. The LP solver only minimizes transfer
+   * time. It ignores Device latency and queued writes, which the analytic
+   * solver charges, so the two can choose different placements. */
+  bool use_lp_solver;
 
   Context() : policy(PlacementPolicy::kRoundRobin),
-              buffer_organizer_retries(default_buffer_organizer_retries) {}
+              buffer_organizer_retries(default_buffer_organizer_retries),
+              read_ahead_depth(default_read_ahead_depth),
+              use_lp_solver(false) {}
 };
 
 struct TraitTag{};
@@ -106,9 +106,24 @@ Blob& VBucket::GetBlob(std::string blob_name, std::string bucket_name) {
   local_blob.resize(blob_size);
   bkt.Get(blob_name, local_blob, ctx);
   bkt.Close(ctx);
+  if (id_.as_int != 0) {
+    RecordVBucketAccess(&hermes_->context_, &hermes_->rpc_, id_,
+                        kAccessType_Read, blob_size);
+  }
   return local_blob;
 }
 
+AccessStats VBucket::GetStats(Context &ctx) {
+  (void)ctx;
+  AccessStats result = {};
+
+  if (id_.as_int != 0) {
+    result = GetVBucketStats(&hermes_->context_, &hermes_->rpc_, id_);
+  }
+
+  return result;
+}
+
 template <class Predicate>
 std::vector<std::string> VBucket::GetLinks(Predicate pred, Context& ctx) {
   LOG(INFO) << "Getting subset of links satisfying pred in VBucket " << name_
@@ -204,69 +219,84 @@ Status VBucket::Delete(Context& ctx) {
 
   LOG(INFO) << "Deleting VBucket " << name_ << '\n';
 
-  for (const auto& t : attached_traits_) {
-    FILE* file = nullptr;
-    if (this->persist) {
-      if (t->type == TraitType::FILE_MAPPING) {
-        FileMappingTrait* fileBackedTrait = (FileMappingTrait*)t;
-        if (fileBackedTrait->fh != nullptr) {
-          file = fileBackedTrait->fh;
+  // NOTE(chogan): Start writing every file-mapped VBucket back in parallel
+  // before running the detach and unlink callbacks.
+  std::vector<WriteBackHandle> write_backs;
+  if (persist) {
+    for (const auto& t : attached_traits_) {
+      if (t->type != TraitType::FILE_MAPPING) {
+        continue;
+      }
+      FileMappingTrait* fileBackedTrait = (FileMappingTrait*)t;
+      if (fileBackedTrait->flush_cb) {
+        continue;
+      }
+      if (fileBackedTrait->offset_map.empty()) {
+        // TODO(hari): @errorhandling offset_map should not be empty
+        continue;
+      }
+
+      std::vector<WriteBackRequest> requests;
+      for (auto ci = linked_blobs_.begin(); ci != linked_blobs_.end(); ++ci) {
+        auto iter = fileBackedTrait->offset_map.find(ci->second);
+        if (iter != fileBackedTrait->offset_map.end()) {
+          BucketID bucket_id = GetBucketIdByName(
+              &hermes_->context_, &hermes_->rpc_, ci->first.c_str());
+          WriteBackRequest request = {};
+          request.blob_id = GetBlobIdByName(&hermes_->context_, &hermes_->rpc_,
+                                            ci->second.c_str(), bucket_id);
+          request.offset = (i64)iter->second;
+          requests.push_back(request);
         } else {
-          std::string open_mode;
-          if (access(fileBackedTrait->filename.c_str(), F_OK) == 0) {
-            open_mode = "r+";
-          } else {
-            open_mode = "w+";
-          }
-          file = fopen(fileBackedTrait->filename.c_str(), open_mode.c_str());
+          // TODO(hari): @errorhandling map doesnt have the blob linked.
         }
       }
+
+      int fd = -1;
+      if (fileBackedTrait->fh != nullptr) {
+        fflush(fileBackedTrait->fh);
+        fd = fileno(fileBackedTrait->fh);
+      }
+      write_backs.push_back(
+        EnqueueWriteBack(hermes_->write_back_.get(), fileBackedTrait->filename,
+                         fd, false, std::move(requests)));
+    }
+  }
+
+  Status result = 0;
+  for (size_t i = 0; i < write_backs.size(); ++i) {
+    if (WaitForWriteBack(write_backs[i]) != 0) {
+      // TODO(chogan): @errorhandling
+      result = 1;
     }
+  }
+
+  for (const auto& t : attached_traits_) {
     for (auto ci = linked_blobs_.begin(); ci != linked_blobs_.end(); ++ci) {
-      if (attached_traits_.size() > 0) {
-        TraitInput input;
-        input.bucket_name = ci->first;
-        input.blob_name = ci->second;
-
-        if (this->persist) {
-          if (t->type == TraitType::FILE_MAPPING) {
-            FileMappingTrait* fileBackedTrait = (FileMappingTrait*)t;
-            // if callback defined by user
-            if (fileBackedTrait->flush_cb) {
-              fileBackedTrait->flush_cb(input, fileBackedTrait);
-            } else {
-              if (!fileBackedTrait->offset_map.empty()) {
-                auto iter = fileBackedTrait->offset_map.find(ci->second);
-                if (iter != fileBackedTrait->offset_map.end()) {
-                  auto blob_id = GetBlobIdByName(
-                      &hermes_->context_, &hermes_->rpc_, ci->second.c_str());
-                  StdIoPersistBlob(&hermes_->context_, &hermes_->rpc_,
-                                   &hermes_->trans_arena_, blob_id, file,
-                                   iter->second);
-                } else {
-                  // TODO(hari): @errorhandling map doesnt have the blob linked.
-                }
-
-              } else {
-                // TODO(hari): @errorhandling offset_map should not be empty
-              }
-            }
-          }
-        }
-        if (t->onDetachFn != nullptr) {
-          t->onDetachFn(input, t);
-          // TODO(hari): @errorhandling Check if detach was successful
-        }
-        if (t->onUnlinkFn != nullptr) {
-          t->onUnlinkFn(input, t);
-          // TODO(hari): @errorhandling Check if unlinking was successful
+      TraitInput input;
+      input.bucket_name = ci->first;
+      input.blob_name = ci->second;
+
+      if (persist && t->type == TraitType::FILE_MAPPING) {
+        FileMappingTrait* fileBackedTrait = (FileMappingTrait*)t;
+        // if callback defined by user
+        if (fileBackedTrait->flush_cb) {
+          fileBackedTrait->flush_cb(input, fileBackedTrait);
         }
       }
+      if (t->onDetachFn != nullptr) {
+        t->onDetachFn(input, t);
+        // TODO(hari): @errorhandling Check if detach was successful
+      }
+      if (t->onUnlinkFn != nullptr) {
+        t->onUnlinkFn(input, t);
+        // TODO(hari): @errorhandling Check if unlinking was successful
+      }
     }
-    if (persist) {
-      if (file != nullptr) {
-        fflush(file);
-        if (fclose(file) != 0) {
+    if (persist && t->type == TraitType::FILE_MAPPING) {
+      FileMappingTrait* fileBackedTrait = (FileMappingTrait*)t;
+      if (fileBackedTrait->fh != nullptr) {
+        if (fclose(fileBackedTrait->fh) != 0) {
           // TODO(chogan): @errorhandling
         }
       }
@@ -274,7 +304,8 @@ Status VBucket::Delete(Context& ctx) {
   }
   linked_blobs_.clear();
   attached_traits_.clear();
-  return Status();
+
+  return result;
 }
 
 }  // namespace api
@@ -77,6 +77,9 @@ class VBucket {
   /** get a blob linked to this vbucket */
   Blob &GetBlob(std::string blob_name, std::string bucket_name);
 
+  /** get the access statistics of blobs read through this vbucket */
+  AccessStats GetStats(Context &ctx);
+
   /** retrieves the subset of links satisfying pred */
   /** could return iterator */
   template <class Predicate>
@@ -10,32 +10,61 @@
  * have access to the file, you may request a copy from help@hdfgroup.org.   *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
+#include <algorithm>
+
 #include "hermes.h"
 #include "data_placement_engine.h"
+#include "metadata_storage.h"
 
 namespace hermes {
 
+/**
+ * Copies a Blob from swap space into the buffers described by @p schema.
+ */
+static int PlaceSwapBlob(SharedMemoryContext *context, RpcContext *rpc,
+                         SwapBlob swap_blob, const std::string &name,
+                         PlacementSchema &schema,
+                         CapacityReservation *reservation) {
+  int result = 0;
+  std::vector<u8> blob_mem(swap_blob.size);
+  Blob blob = {};
+  blob.data = blob_mem.data();
+  blob.size = blob_mem.size();
+  size_t bytes_read = ReadFromSwap(context, blob, swap_blob);
+
+  if (bytes_read != swap_blob.size) {
+    // TODO(chogan): @errorhandling
+    result = 1;
+  } else {
+    for (auto [size, target] : schema) {
+      WaitForIoBudget(context, rpc, target.bits.device_id, size,
+                      kBoPriority_SwapDrain);
+    }
+    Status ret = PlaceBlob(context, rpc, schema, blob, name.c_str(),
+                           swap_blob.bucket_id, true, reservation);
+    if (ret != 0) {
+      // TODO(chogan): @errorhandling
+      result = 1;
+    }
+  }
+
+  return result;
+}
+
 int PlaceInHierarchy(SharedMemoryContext *context, RpcContext *rpc,
                      SwapBlob swap_blob, const std::string &name) {
   int result = 0;
   std::vector<PlacementSchema> schemas;
   std::vector<size_t> sizes(1, swap_blob.size);
   api::Context ctx;
-  Status ret = CalculatePlacement(context, rpc, sizes, schemas, ctx);
+  CapacityReservation reservation = {};
+  Status ret = CalculatePlacement(context, rpc, sizes, schemas, ctx,
+                                  &reservation);
 
   if (ret == 0) {
-    std::vector<u8> blob_mem(swap_blob.size);
-    Blob blob = {};
-    blob.data = blob_mem.data();
-    blob.size = blob_mem.size();
-    size_t bytes_read = ReadFromSwap(context, blob, swap_blob);
-    if (bytes_read != swap_blob.size) {
-      // TODO(chogan): @errorhandling
-      result = 1;
-    }
-
-    ret = PlaceBlob(context, rpc, schemas[0], blob, name.c_str(),
-                    swap_blob.bucket_id, 0, true);
+    result = PlaceSwapBlob(context, rpc, swap_blob, name, schemas[0],
+                           &reservation);
+    ReleaseCapacity(context, &reservation);
   } else {
     // TODO(chogan): @errorhandling
     result = 1;
@@ -44,15 +73,481 @@ int PlaceInHierarchy(SharedMemoryContext *context, RpcContext *rpc,
   return result;
 }
 
+/**
+ * Updates @p entry with the current location of its Blob in swap space, which
+ * changes when swap compaction moves it.
+ *
+ * Returns false if the Blob has since been deleted or already placed in the
+ * hierarchy.
+ */
+static bool RefreshSwapDrainEntry(SharedMemoryContext *context,
+                                  RpcContext *rpc, SwapDrainEntry *entry) {
+  bool result = false;
+  BlobID blob_id = GetBlobIdByName(context, rpc, entry->name.c_str(),
+                                   entry->swap_blob.bucket_id);
+
+  if (!IsNullBlobId(blob_id) && BlobIsInSwap(blob_id)) {
+    std::vector<BufferID> ids = GetBufferIdList(context, rpc, blob_id);
+    entry->swap_blob = VecToSwapBlob(ids);
+    result = true;
+  }
+
+  return result;
+}
+
+/**
+ * Places as many of the swap Blobs in @p entries in the hierarchy as will fit,
+ * in the node's configured SwapDrainOrder, and removes them from @p entries.
+ * Entries whose Blob no longer lives in swap space are dropped.
+ *
+ * Placements are calculated for a whole batch of Blobs at once. If a batch
+ * doesn't fit, it's halved until a single Blob doesn't fit, at which point the
+ * drain stops and the rest of the entries wait for more capacity. After a batch
+ * is placed in full, the batch size is doubled again, up to
+ * `kMaxSwapDrainBatch`.
+ *
+ * Returns the number of Blobs placed.
+ */
+size_t DrainSwap(SharedMemoryContext *context, RpcContext *rpc,
+                 std::vector<SwapDrainEntry> &entries) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  size_t result = 0;
+
+  std::vector<SwapDrainEntry> live;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (RefreshSwapDrainEntry(context, rpc, &entries[i])) {
+      live.push_back(entries[i]);
+    }
+  }
+
+  auto older = [](const SwapDrainEntry &a, const SwapDrainEntry &b) {
+    return a.sequence < b.sequence;
+  };
+  auto smaller = [](const SwapDrainEntry &a, const SwapDrainEntry &b) {
+    return (a.swap_blob.size < b.swap_blob.size ||
+            (a.swap_blob.size == b.swap_blob.size && a.sequence < b.sequence));
+  };
+  if (pool->swap_drain_order == SwapDrainOrder::kSmallestFirst) {
+    std::sort(live.begin(), live.end(), smaller);
+  } else {
+    std::sort(live.begin(), live.end(), older);
+  }
+
+  const size_t kMaxSwapDrainBatch = 64;
+  std::vector<SwapDrainEntry> remaining;
+  size_t begin = 0;
+  size_t batch_size = std::min(live.size(), kMaxSwapDrainBatch);
+
+  while (begin < live.size()) {
+    batch_size = std::min(batch_size, live.size() - begin);
+    std::vector<size_t> sizes(batch_size);
+    for (size_t i = 0; i < batch_size; ++i) {
+      sizes[i] = live[begin + i].swap_blob.size;
+    }
+
+    std::vector<PlacementSchema> schemas;
+    api::Context ctx;
+    CapacityReservation reservation = {};
+    Status ret = CalculatePlacement(context, rpc, sizes, schemas, ctx,
+                                    &reservation);
+
+    if (ret == 0) {
+      bool all_placed = true;
+      for (size_t i = 0; i < batch_size; ++i) {
+        const SwapDrainEntry &entry = live[begin + i];
+        if (PlaceSwapBlob(context, rpc, entry.swap_blob, entry.name,
+                          schemas[i], &reservation) == 0) {
+          result++;
+        } else {
+          // NOTE(chogan): The capacity was there, but the buffers weren't
+          // (e.g., fragmentation). Try again on the next drain.
+          remaining.push_back(entry);
+          all_placed = false;
+        }
+      }
+      ReleaseCapacity(context, &reservation);
+      begin += batch_size;
+      if (all_placed) {
+        // NOTE(chogan): A shrunken batch fit, so grow it back for the rest.
+        batch_size = std::min(batch_size * 2, kMaxSwapDrainBatch);
+      }
+    } else if (batch_size > 1) {
+      batch_size /= 2;
+    } else {
+      break;
+    }
+  }
+
+  for (size_t i = begin; i < live.size(); ++i) {
+    remaining.push_back(live[i]);
+  }
+  entries.swap(remaining);
+
+  return result;
+}
+
+/**
+ * Asks this node's BufferOrganizer to drain its swap queue, if it has
+ * anything queued. Called whenever buffers are released.
+ *
+ * Only one drain request is outstanding at a time, so releasing many buffers
+ * in a row results in a single RPC.
+ */
+void WakeSwapDrain(SharedMemoryContext *context, RpcContext *rpc) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+
+  if (pool->num_queued_swap_blobs.load() > 0) {
+    bool expected = false;
+    if (pool->swap_drain_requested.compare_exchange_strong(expected, true)) {
+      TriggerBufferOrganizer(rpc, kDrainSwap);
+    }
+  }
+}
+
+/**
+ * Migrates the data of @p blob_id to @p dest.
+ *
+ * The data is copied into new buffers on @p dest, and then the Blob's
+ * `BufferID`s are swapped in a single metadata update. If the Blob is modified
+ * or destroyed while the copy is in flight, the swap fails, the new buffers are
+ * released, and the Blob is left untouched. Readers detect a migration that
+ * overlaps their read and retry (see ReadBlobById).
+ *
+ * Must run on the node that owns @p dest, since buffers can only be allocated
+ * from the local BufferPool. Moves below kBoPriority_Foreground wait for the
+ * background I/O budgets of the source and destination Devices.
+ */
 int MoveToTarget(SharedMemoryContext *context, RpcContext *rpc, BlobID blob_id,
-                 TargetID dest) {
-  (void)(context);
-  (void)(rpc);
-  (void)(blob_id);
-  (void)(dest);
-// TODO(chogan): Move blob from current location to Target dest
-  HERMES_NOT_IMPLEMENTED_YET;
+                 TargetID dest, BoPriority priority) {
   int result = 0;
+
+  if (BlobIsInSwap(blob_id) || dest.bits.node_id != rpc->node_id) {
+    // TODO(chogan): @errorhandling Swap blobs are returned to the hierarchy by
+    // PlaceInHierarchy.
+    result = 1;
+    return result;
+  }
+
+  // NOTE(chogan): The generation must be read before the BufferIDs, so that
+  // any modification after this point fails the ReplaceBufferIdList below.
+  u64 generation = GetBlobGeneration(context, rpc, blob_id);
+  if (generation == 0) {
+    // NOTE(chogan): The Blob was destroyed before the move started.
+    result = 1;
+    return result;
+  }
+
+  std::vector<BufferID> old_ids = GetBufferIdList(context, rpc, blob_id);
+  std::vector<u32> old_sizes(old_ids.size());
+  size_t blob_size = 0;
+  bool already_on_dest = true;
+  for (size_t i = 0; i < old_ids.size(); ++i) {
+    old_sizes[i] = GetBufferSize(context, rpc, old_ids[i]);
+    blob_size += old_sizes[i];
+    if (old_ids[i].bits.node_id != dest.bits.node_id ||
+        GetBufferDeviceId(context, rpc, old_ids[i]) != dest.bits.device_id) {
+      already_on_dest = false;
+    }
+  }
+
+  if (already_on_dest) {
+    return result;
+  }
+
+  for (size_t i = 0; i < old_ids.size(); ++i) {
+    if (!BufferIsRemote(rpc, old_ids[i])) {
+      DeviceID src_device = GetBufferDeviceId(context, rpc, old_ids[i]);
+      WaitForIoBudget(context, rpc, src_device, old_sizes[i], priority);
+    }
+  }
+  WaitForIoBudget(context, rpc, dest.bits.device_id, blob_size, priority);
+
+  PlacementSchema schema;
+  schema.push_back(std::make_pair(blob_size, dest));
+  std::vector<BufferID> new_ids = GetBuffers(context, schema);
+
+  if (new_ids.size() == 0) {
+    // TODO(chogan): @errorhandling Not enough space on dest
+    result = 1;
+    return result;
+  }
+
+  std::vector<u8> blob_mem(blob_size);
+  Blob blob = {};
+  blob.data = blob_mem.data();
+  blob.size = blob_mem.size();
+
+  BufferIdArray old_id_array = {};
+  old_id_array.ids = old_ids.data();
+  old_id_array.length = (u32)old_ids.size();
+  size_t bytes_read = ReadBlobFromBuffers(context, rpc, &blob, &old_id_array,
+                                          old_sizes.data());
+
+  if (bytes_read == blob_size) {
+    WriteBlobToBuffers(context, rpc, blob, new_ids);
+    if (ReplaceBufferIdList(context, rpc, blob_id, generation, new_ids)) {
+      ReleaseBuffers(context, rpc, old_ids);
+      WakeTargetEviction(context, rpc, dest);
+    } else {
+      // NOTE(chogan): The Blob changed while we were copying it.
+      result = 1;
+    }
+  } else {
+    // TODO(chogan): @errorhandling
+    result = 1;
+  }
+
+  if (result != 0) {
+    LocalReleaseBuffers(context, new_ids);
+  }
+
+  return result;
+}
+
+/** The most Blobs RunTieringPolicy looks at per call. */
+const u32 kTieringScanSize = 4096;
+
+struct TieringCandidate {
+  BlobID id;
+  u64 size;
+  f64 frequency;
+  u64 last_access_ms;
+};
+
+/**
+ * Orders Blobs by decayed access frequency, breaking ties by recency.
+ */
+static bool IsColder(const TieringCandidate &a, const TieringCandidate &b) {
+  bool result = (a.frequency < b.frequency ||
+                 (a.frequency == b.frequency &&
+                  a.last_access_ms < b.last_access_ms));
+
+  return result;
+}
+
+static f32 GetTargetUsage(Target *target) {
+  f32 result = 0;
+  if (target->capacity) {
+    u64 reserved = target->reserved_space.load();
+    u64 remaining = target->remaining_space.load();
+    u64 available = remaining > reserved ? remaining - reserved : 0;
+    result = 1.0f - ((f32)available / (f32)target->capacity);
+  }
+
+  return result;
+}
+
+/**
+ * Groups @p blob_ids by the index of the Target that holds their first buffer.
+ */
+static std::vector<std::vector<TieringCandidate>>
+GetTieringCandidates(SharedMemoryContext *context, RpcContext *rpc,
+                     const std::vector<BlobID> &blob_ids,
+                     size_t num_targets) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  std::vector<std::vector<TieringCandidate>> result(num_targets);
+
+  // NOTE(chogan): Only Blobs whose metadata lives on this node are considered,
+  // and a Blob belongs to the Target that holds its first buffer.
+  // TODO(chogan): Consider Blobs with local buffers and remote metadata once
+  // we have multi-node tiering.
+  for (size_t i = 0; i < blob_ids.size(); ++i) {
+    BlobID blob_id = blob_ids[i];
+    if (BlobIsInSwap(blob_id)) {
+      continue;
+    }
+    std::vector<BufferID> buffer_ids = LocalGetBufferIdList(mdm, blob_id);
+    if (buffer_ids.size() == 0 || BufferIsRemote(rpc, buffer_ids[0])) {
+      continue;
+    }
+    // TODO(chogan): DeviceID is currently equal to the Target index.
+    DeviceID device_id = LocalGetBufferDeviceId(context, buffer_ids[0]);
+    if ((size_t)device_id >= num_targets) {
+      continue;
+    }
+
+    AccessStats stats = LocalGetBlobStats(mdm, blob_id);
+    TieringCandidate candidate = {};
+    candidate.id = blob_id;
+    candidate.frequency = stats.frequency;
+    candidate.last_access_ms = stats.last_access_ms;
+    for (size_t j = 0; j < buffer_ids.size(); ++j) {
+      candidate.size += GetBufferSize(context, rpc, buffer_ids[j]);
+    }
+    result[device_id].push_back(candidate);
+  }
+
+  return result;
+}
+
+/**
+ * Asks the BufferOrganizer to evict from @p target_id if its usage, including
+ * reservations, is above its high watermark. Requests are coalesced until the
+ * pending eviction finishes.
+ */
+void WakeTargetEviction(SharedMemoryContext *context, RpcContext *rpc,
+                        TargetID target_id) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+
+  // NOTE(chogan): The slowest Target has nowhere to evict to. When it fills
+  // up, new Blobs go to swap.
+  // TODO(chogan): Evict remote Targets once placement can allocate on them.
+  if (target_id.bits.node_id != (u32)rpc->node_id ||
+      (i32)target_id.bits.index + 1 >= pool->num_targets) {
+    return;
+  }
+
+  Target *target = GetTargetFromId(context, target_id);
+  if (GetTargetUsage(target) > target->high_watermark) {
+    bool expected = false;
+    if (target->eviction_requested.compare_exchange_strong(expected, true)) {
+      TriggerBufferOrganizer(rpc, kEvictFromTarget, target_id);
+    }
+  }
+}
+
+/**
+ * Moves the coldest Blobs off of @p target_id until its usage falls to its low
+ * watermark. Each Blob goes to the fastest slower Target that can hold it.
+ * Unlike tiering, eviction isn't rate limited, since Puts fall back to swap if
+ * it doesn't keep up.
+ *
+ * Returns the number of bytes evicted.
+ */
+u64 EvictFromTarget(SharedMemoryContext *context, RpcContext *rpc,
+                    TargetID target_id) {
+  std::vector<TargetID> targets = GetNodeTargets(context);
+  Target *target = GetTargetFromId(context, target_id);
+  size_t index = target_id.bits.index;
+  u64 result = 0;
+
+  f32 usage = GetTargetUsage(target);
+  if (index + 1 < targets.size() && usage > target->high_watermark) {
+    u64 bytes_to_free = (u64)((usage - target->low_watermark) *
+                              (f32)target->capacity);
+    MetadataManager *mdm = GetMetadataManagerFromContext(context);
+    std::vector<std::vector<TieringCandidate>> candidates =
+      GetTieringCandidates(context, rpc, LocalGetAllBlobIds(mdm),
+                           targets.size());
+    std::sort(candidates[index].begin(), candidates[index].end(), IsColder);
+
+    for (size_t i = 0;
+         i < candidates[index].size() && result < bytes_to_free;
+         ++i) {
+      const TieringCandidate &candidate = candidates[index][i];
+      // NOTE(chogan): A move fails without copying anything when the
+      // destination can't reserve the space, so trying each slower Target in
+      // turn is cheap. A Blob that can't be moved anywhere, or that changed
+      // during its move, is skipped.
+      bool moved = false;
+      for (size_t dest = index + 1; dest < targets.size() && !moved; ++dest) {
+        moved = MoveToTarget(context, rpc, candidate.id, targets[dest]) == 0;
+      }
+      if (moved) {
+        result += candidate.size;
+      }
+    }
+  }
+
+  // NOTE(chogan): Cleared only after the moves finish, so Puts that cross the
+  // high watermark in the meantime don't queue the same Blobs again.
+  target->eviction_requested.store(false);
+
+  return result;
+}
+
+/**
+ * Moves Blobs between this node's Targets based on their access statistics.
+ *
+ * Targets are ordered from fastest to slowest. When a Target's usage exceeds
+ * `policy.high_watermark`, its coldest Blobs are demoted to the next Target
+ * until usage would drop to `policy.low_watermark`. Blobs whose decayed access
+ * frequency is at least `policy.promotion_frequency` are promoted to the
+ * fastest Target, hottest first, as long as that keeps it under the low
+ * watermark.
+ *
+ * Each call only considers the next kTieringScanSize Blobs from @p cursor, so
+ * the cost of a tick doesn't grow with the number of Blobs on the node. The
+ * whole node is covered over several ticks.
+ *
+ * Moves are queued on the BufferOrganizer (see EnqueueBlobMove) while
+ * @p budget is positive, and each move's size is subtracted from it. A single
+ * move may overdraw the budget. Returns the number of bytes queued.
+ */
+i64 RunTieringPolicy(SharedMemoryContext *context, RpcContext *rpc,
+                     const TieringPolicy &policy, i64 *budget, u32 *cursor) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  std::vector<TargetID> targets = GetNodeTargets(context);
+  i64 result = 0;
+
+  std::vector<BlobID> blob_ids = LocalScanBlobIds(mdm, cursor,
+                                                  kTieringScanSize);
+  std::vector<std::vector<TieringCandidate>> candidates =
+    GetTieringCandidates(context, rpc, blob_ids, targets.size());
+
+  bool queue_full = false;
+  bool demoted_from_fastest = false;
+
+  // NOTE(chogan): The slowest Target has nowhere to demote to. When it fills
+  // up, new Blobs go to swap.
+  for (size_t i = 0; i + 1 < targets.size() && !queue_full; ++i) {
+    Target *target = GetTarget(context, i);
+    f32 usage = GetTargetUsage(target);
+    if (usage <= policy.high_watermark) {
+      continue;
+    }
+
+    u64 bytes_to_free = (u64)((usage - policy.low_watermark) *
+                              (f32)target->capacity);
+    u64 bytes_freed = 0;
+    std::sort(candidates[i].begin(), candidates[i].end(), IsColder);
+    for (size_t j = 0; j < candidates[i].size(); ++j) {
+      if (bytes_freed >= bytes_to_free || *budget <= 0) {
+        break;
+      }
+      const TieringCandidate &candidate = candidates[i][j];
+      if (!EnqueueBlobMove(context, rpc, candidate.id, targets[i + 1], 1)) {
+        queue_full = true;
+        break;
+      }
+      bytes_freed += candidate.size;
+      *budget -= (i64)candidate.size;
+      result += (i64)candidate.size;
+      demoted_from_fastest = demoted_from_fastest || i == 0;
+    }
+  }
+
+  if (!queue_full && !demoted_from_fastest && targets.size() > 1) {
+    Target *fastest = GetTarget(context, 0);
+    f32 usage = GetTargetUsage(fastest);
+    if (usage < policy.low_watermark) {
+      u64 room = (u64)((policy.low_watermark - usage) *
+                       (f32)fastest->capacity);
+      std::vector<TieringCandidate> hot;
+      for (size_t i = 1; i < candidates.size(); ++i) {
+        for (size_t j = 0; j < candidates[i].size(); ++j) {
+          if (candidates[i][j].frequency >= policy.promotion_frequency) {
+            hot.push_back(candidates[i][j]);
+          }
+        }
+      }
+      std::sort(hot.begin(), hot.end(), IsColder);
+
+      for (size_t i = hot.size(); i > 0 && *budget > 0; --i) {
+        const TieringCandidate &candidate = hot[i - 1];
+        if (candidate.size > room) {
+          continue;
+        }
+        if (!EnqueueBlobMove(context, rpc, candidate.id, targets[0], 1)) {
+          break;
+        }
+        room -= candidate.size;
+        *budget -= (i64)candidate.size;
+        result += (i64)candidate.size;
+      }
+    }
+  }
+
   return result;
 }
 
@@ -17,6 +17,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <assert.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <sched.h>
 #include <stdio.h>
@@ -24,9 +25,19 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -67,6 +78,9 @@
   "(e.g., -DHERMES_MDM_STORAGE_STBDS)."
 #endif
 
+#include "checkpoint.cc"
+#include "write_back.cc"
+
 /**
  * @file buffer_pool.cc
  *
@@ -94,6 +108,9 @@ void Finalize(SharedMemoryContext *context, CommunicationContext *comm,
       bool is_daemon =
         (comm->world_size == comm->num_nodes) && !force_rpc_shutdown;
       FinalizeRpcContext(rpc, is_daemon);
+      // NOTE(chogan): The RPC servers are down, so nothing else is modifying
+      // shared memory.
+      WriteCheckpoint(context, rpc->node_id);
     }
     ReleaseSharedMemoryContext(context);
     shm_unlink(shmem_name);
@@ -104,11 +121,19 @@ void Finalize(SharedMemoryContext *context, CommunicationContext *comm,
 
 void LockBuffer(BufferHeader *header) {
   bool expected = false;
-  while (header->locked.compare_exchange_weak(expected, true)) {
+  while (!header->locked.compare_exchange_weak(expected, true)) {
     // NOTE(chogan): Spin until we get the lock
+    expected = false;
   }
 }
 
+bool TryLockBuffer(BufferHeader *header) {
+  bool expected = false;
+  bool result = header->locked.compare_exchange_strong(expected, true);
+
+  return result;
+}
+
 void UnlockBuffer(BufferHeader *header) {
   header->locked.store(false);
 }
@@ -120,6 +145,20 @@ BufferPool *GetBufferPoolFromContext(SharedMemoryContext *context) {
   return result;
 }
 
+SwapLog *GetSwapLog(SharedMemoryContext *context) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  SwapLog *result = (SwapLog *)((u8 *)mdm + mdm->swap_log_offset);
+
+  return result;
+}
+
+SwapSegment *GetSwapSegment(SwapLog *log, u32 index) {
+  SwapSegment *segments = (SwapSegment *)((u8 *)log + log->segments_offset);
+  SwapSegment *result = segments + index;
+
+  return result;
+}
+
 Device *GetDeviceFromHeader(SharedMemoryContext *context,
                             BufferHeader *header) {
   BufferPool *pool = GetBufferPoolFromContext(context);
@@ -149,7 +188,12 @@ std::vector<f32> GetBandwidths(SharedMemoryContext *context) {
 
   for (int i = 0; i < pool->num_devices; i++) {
     Device *device = GetDeviceById(context, i);
-    result[i] = device->bandwidth_mbps;
+    f32 measured = pool->bandwidth_estimates[i].mbps.load();
+    if (pool->use_measured_bandwidths && measured > 0) {
+      result[i] = measured;
+    } else {
+      result[i] = device->bandwidth_mbps;
+    }
   }
 
   return result;
@@ -234,40 +278,6 @@ BufferHeader *GetFirstDormantHeader(SharedMemoryContext *context) {
 }
 #endif
 
-#if 0
-f32 ComputeFragmentationScore(SharedMemoryContext *context) {
-  BufferPool *pool = GetBufferPoolFromContext(context);
-  BufferHeader *headers = GetHeadersBase(context);
-
-  u32 total_used_headers = 0;
-  f32 usage_score = 0;
-  for (u32 i = 0; i < pool->num_headers; ++i) {
-    BufferHeader *header = &headers[i];
-
-    if (header->in_use) {
-      total_used_headers++;
-
-      // TODO(chogan): Is a lock really necessary? Need to check where
-      // `used` and `capacity` get mutated. We only read them here. Could
-      // just make both variables atomics.
-      LockBuffer(header);
-      f32 percentage_used = header->used / header->capacity;
-      usage_score += percentage_used;
-      UnlockBuffer(header);
-    }
-  }
-
-  f32 percentage_of_used_headers = ((f32)total_used_headers /
-                                    (f32)pool->num_headers);
-  f32 max_usage_score = 1.0f * pool->num_headers;
-  f32 optimal_usage = percentage_of_used_headers * max_usage_score;
-  f32 result = optimal_usage - usage_score;
-
-  // TODO(chogan): Reorganize BufferPool if score is > 0.5 or 0.6
-  return result;
-}
-#endif
-
 i32 GetSlabUnitSize(SharedMemoryContext *context, DeviceID device_id,
                     int slab_index) {
   BufferPool *pool = GetBufferPoolFromContext(context);
@@ -461,7 +471,19 @@ void UpdateBufferingCapacities(SharedMemoryContext *context, i64 adjustment,
   // once we have topologies. This function will need to support TargetIDs
   // instead of DeviceID.
   Target *target = GetTarget(context, device_id);
-  target->remaining_space.fetch_add(adjustment);
+  u64 remaining = target->remaining_space.fetch_add(adjustment) + adjustment;
+
+  // NOTE(chogan): Small changes don't invalidate cached placements, but they
+  // add up, so drift is measured from the last epoch rather than per update.
+  u64 epoch_remaining = target->epoch_remaining_space.load();
+  u64 drift = (remaining > epoch_remaining ? remaining - epoch_remaining :
+               epoch_remaining - remaining);
+  if ((f32)drift > pool->placement_cache_threshold * (f32)epoch_remaining) {
+    if (target->epoch_remaining_space.compare_exchange_strong(epoch_remaining,
+                                                              remaining)) {
+      pool->capacity_epoch.fetch_add(1);
+    }
+  }
 }
 
 void LocalReleaseBuffer(SharedMemoryContext *context, BufferID buffer_id) {
@@ -491,6 +513,7 @@ void ReleaseBuffer(SharedMemoryContext *context, RpcContext *rpc,
   u32 target_node = buffer_id.bits.node_id;
   if (target_node == rpc->node_id) {
     LocalReleaseBuffer(context, buffer_id);
+    WakeSwapDrain(context, rpc);
   } else {
     RpcCall<bool>(rpc, target_node, "RemoteReleaseBuffer", buffer_id);
   }
@@ -533,15 +556,409 @@ BufferID GetFreeBuffer(SharedMemoryContext *context, DeviceID device_id,
   return result;
 }
 
-std::vector<BufferID> GetBuffers(SharedMemoryContext *context,
-                                 const PlacementSchema &schema) {
+static u64 GetIoBudgetTimeUs() {
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  u64 result =
+    std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+
+  return result;
+}
+
+static void RefillIoBudget(IoBudget *budget) {
+  u64 now = GetIoBudgetTimeUs();
+  u64 last = budget->last_refill_us.load();
+
+  // NOTE(chogan): Only the thread that advances last_refill_us adds the tokens
+  // for the elapsed time. If the clock went backwards (e.g., the BufferPool was
+  // restored from a checkpoint after a reboot), just restart from now.
+  if (now != last && budget->last_refill_us.compare_exchange_strong(last, now)) {
+    if (now > last) {
+      f64 elapsed_sec = (f64)(now - last) / 1000000.0;
+      i64 refill = (i64)std::min(elapsed_sec * (f64)budget->bytes_per_sec,
+                                 (f64)budget->burst);
+      i64 tokens = budget->tokens.load();
+      i64 new_tokens = 0;
+      do {
+        new_tokens = std::min(tokens + refill, budget->burst);
+      } while (!budget->tokens.compare_exchange_weak(tokens, new_tokens));
+    }
+  }
+}
+
+/**
+ * Charges @p bytes of BufferOrganizer I/O on @p device_id to the Device's
+ * background budget, which refills at `buffer_organizer_io_share` of its
+ * bandwidth. The budget may go into debt, so a single large transfer is never
+ * refused. Instead, the caller must wait for the returned number of
+ * milliseconds before starting the I/O (see WaitForIoBudget), which keeps the
+ * long term rate under the limit.
+ *
+ * kBoPriority_Foreground work is neither charged nor delayed.
+ */
+f64 ChargeIoBudget(SharedMemoryContext *context, DeviceID device_id,
+                   u64 bytes, BoPriority priority) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  f64 result = 0;
+
+  if (priority == kBoPriority_Foreground || device_id >= pool->num_devices) {
+    return result;
+  }
+
+  IoBudget *budget = &pool->io_budgets[device_id];
+  if (budget->bytes_per_sec > 0) {
+    RefillIoBudget(budget);
+    i64 balance = budget->tokens.fetch_sub((i64)bytes) - (i64)bytes;
+    if (balance < 0) {
+      result = (f64)(-balance) * 1000.0 / (f64)budget->bytes_per_sec;
+    }
+  }
+
+  return result;
+}
+
+static bool WriteAllAt(int fd, const u8 *data, size_t size, u64 offset) {
+  bool result = true;
+  size_t total_bytes_written = 0;
+
+  while (total_bytes_written < size) {
+    ssize_t bytes_written = pwrite(fd, data + total_bytes_written,
+                                   size - total_bytes_written,
+                                   offset + total_bytes_written);
+    if (bytes_written <= 0) {
+      result = false;
+      break;
+    }
+    total_bytes_written += bytes_written;
+  }
+
+  return result;
+}
+
+/**
+ * Returns the number of bytes read, which is less than @p size if the file
+ * ends first.
+ */
+static size_t ReadAllAt(int fd, u8 *data, size_t size, u64 offset) {
+  size_t result = 0;
+
+  while (result < size) {
+    ssize_t bytes_read = pread(fd, data + result, size - result,
+                               offset + result);
+    if (bytes_read <= 0) {
+      break;
+    }
+    result += bytes_read;
+  }
+
+  return result;
+}
+
+/** I/O is folded into a Device's bandwidth estimate in samples of at least this
+ * many bytes so that per-operation overhead on small buffers doesn't dominate.
+ */
+static const u64 kBandwidthSampleBytes = MEGABYTES(1);
+/** The weight of the newest sample in a Device's bandwidth estimate. */
+static const f32 kBandwidthEstimateWeight = 0.25f;
+
+static u64 GetIoTimeNs() {
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  u64 result =
+    std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+
+  return result;
+}
+
+static void SetMeasuredBandwidth(SharedMemoryContext *context,
+                                 DeviceID device_id, f32 mbps) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  BandwidthEstimate *estimate = &pool->bandwidth_estimates[device_id];
+  estimate->mbps.store(mbps);
+
+  // NOTE(chogan): Like capacity changes, bandwidth drift only invalidates
+  // cached placements once it's large enough to change them. The drift is
+  // measured against the last published estimate rather than the Target's
+  // integer `speed`, which is 0 for Devices slower than 1 MiB/s.
+  f32 published = estimate->published_mbps.load();
+  f32 drift = std::abs(mbps - published);
+  if ((published == 0 || drift > pool->placement_cache_threshold * published) &&
+      estimate->published_mbps.compare_exchange_strong(published, mbps)) {
+    GetTarget(context, device_id)->speed.store((u64)mbps);
+    if (pool->use_measured_bandwidths) {
+      pool->capacity_epoch.fetch_add(1);
+    }
+  }
+}
+
+void RecordDeviceIo(SharedMemoryContext *context, DeviceID device_id,
+                    u64 bytes, u64 ns) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  BandwidthEstimate *estimate = &pool->bandwidth_estimates[device_id];
+  estimate->sample_ns.fetch_add(ns);
+  u64 sample_bytes = estimate->sample_bytes.fetch_add(bytes) + bytes;
+
+  // NOTE(chogan): Only the thread that empties the sample folds it into the
+  // estimate.
+  if (sample_bytes >= kBandwidthSampleBytes &&
+      estimate->sample_bytes.compare_exchange_strong(sample_bytes, 0)) {
+    u64 sample_ns = estimate->sample_ns.exchange(0);
+    if (sample_ns > 0) {
+      f32 sample_mbps = (f32)(((f64)sample_bytes / MEGABYTES(1)) /
+                              ((f64)sample_ns * 1e-9));
+      f32 mbps = estimate->mbps.load();
+      if (mbps > 0) {
+        mbps += kBandwidthEstimateWeight * (sample_mbps - mbps);
+      } else {
+        mbps = sample_mbps;
+      }
+      SetMeasuredBandwidth(context, device_id, mbps);
+    }
+  }
+}
+
+void CalibrateDeviceBandwidths(SharedMemoryContext *context, size_t size) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  std::vector<u8> src(size, 'x');
+  std::vector<u8> dest(size, 0);
+  // NOTE(chogan): O_DIRECT needs a block aligned buffer and size.
+  const size_t kDirectIoAlignment = KILOBYTES(4);
+  size_t file_io_size = RoundUpToMultiple(size, kDirectIoAlignment);
+
+  for (int device_id = 0; device_id < pool->num_devices; ++device_id) {
+    Device *device = GetDeviceById(context, device_id);
+    size_t bytes = size;
+    u64 ns = 0;
+
+    if (device->is_byte_addressable) {
+      u64 start = GetIoTimeNs();
+      memcpy(dest.data(), src.data(), size);
+      ns = GetIoTimeNs() - start;
+    } else {
+      std::string mount_point(device->mount_point);
+      bool ends_in_slash = mount_point.back() == '/';
+      std::string path = (mount_point + (ends_in_slash ? "" : "/") +
+                          "device" + std::to_string(device_id) +
+                          "_calibration.hermes");
+      // NOTE(chogan): Bypass the page cache where the file system allows it,
+      // and sync before stopping the timer either way, so we time the Device
+      // and not RAM.
+      int flags = O_WRONLY | O_CREAT | O_TRUNC;
+      int fd = open(path.c_str(), flags | O_DIRECT, 0644);
+      if (fd == -1) {
+        fd = open(path.c_str(), flags, 0644);
+      }
+      if (fd == -1) {
+        // TODO(chogan): @errorhandling
+        LOG(WARNING) << "Can't calibrate the bandwidth of Device " << device_id
+                     << ": failed to open " << path << std::endl;
+        unlink(path.c_str());
+        continue;
+      }
+
+      bytes = file_io_size;
+      u8 *io_buffer = (u8 *)aligned_alloc(kDirectIoAlignment, bytes);
+      bool written = false;
+      if (io_buffer) {
+        memset(io_buffer, 'x', bytes);
+        u64 start = GetIoTimeNs();
+        written = (WriteAllAt(fd, io_buffer, bytes, 0) && fsync(fd) == 0);
+        ns = GetIoTimeNs() - start;
+        free(io_buffer);
+      }
+      close(fd);
+      unlink(path.c_str());
+      if (!written) {
+        // TODO(chogan): @errorhandling
+        LOG(WARNING) << "Can't calibrate the bandwidth of Device " << device_id
+                     << ": failed to write " << path << std::endl;
+        continue;
+      }
+    }
+
+    if (ns > 0) {
+      f32 mbps = (f32)(((f64)bytes / MEGABYTES(1)) / ((f64)ns * 1e-9));
+      SetMeasuredBandwidth(context, device_id, mbps);
+      DLOG(INFO) << "Device " << device_id << " calibrated at " << mbps
+              << " MiB/s" << std::endl;
+    }
+  }
+}
+
+/**
+ * Adds @p size to the demand of the slabs that would serve it best if they had
+ * unlimited buffers: as many of the largest buffers as fit, then the next size
+ * down, with the remainder rounded up to one smallest buffer.
+ */
+static void RecordSlabDemand(SharedMemoryContext *context, DeviceID device_id,
+                             size_t size) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+
+  for (int i = pool->num_slabs[device_id] - 1; i >= 0 && size > 0; --i) {
+    size_t buffer_size = GetSlabBufferSize(context, device_id, i);
+    size_t num_buffers = buffer_size ? size / buffer_size : 0;
+    if (i == 0 && num_buffers * buffer_size < size) {
+      num_buffers++;
+    }
+    if (num_buffers > 0) {
+      u64 demand = num_buffers * buffer_size;
+      pool->slab_demand[device_id][i].fetch_add(demand);
+      size -= std::min((size_t)demand, size);
+    }
+  }
+}
+
+/**
+ * Adds @p bytes to the reservations on @p target if its remaining space not
+ * already claimed by other reservations can hold them.
+ */
+static bool ReserveTargetCapacity(Target *target, u64 bytes) {
+  bool result = false;
+  u64 reserved = target->reserved_space.load();
+
+  while (!result) {
+    u64 remaining = target->remaining_space.load();
+    if (remaining < reserved || remaining - reserved < bytes) {
+      break;
+    }
+    result = target->reserved_space.compare_exchange_weak(reserved,
+                                                          reserved + bytes);
+  }
+
+  return result;
+}
+
+/**
+ * Adds the bytes @p schema needs on each Device to @p bytes, rounded up to the
+ * smallest buffer size, which is an upper bound on what GetBuffers allocates.
+ */
+static void AddCapacityNeeded(SharedMemoryContext *context,
+                              const PlacementSchema &schema,
+                              u64 bytes[kMaxDevices]) {
+  for (auto [size, target_id] : schema) {
+    DeviceID device_id = GetDeviceIdFromTargetId(target_id);
+    size_t smallest_buffer = GetSlabBufferSize(context, device_id, 0);
+    bytes[device_id] += RoundUpToMultiple(size, smallest_buffer);
+  }
+}
+
+/**
+ * Reserves @p bytes on each Device. All or none: on failure every reservation
+ * made so far is dropped.
+ */
+static bool ReserveDeviceCapacity(SharedMemoryContext *context,
+                                  const u64 bytes[kMaxDevices]) {
+  bool result = true;
+
+  for (int i = 0; i < kMaxDevices; ++i) {
+    if (bytes[i] == 0) {
+      continue;
+    }
+    // TODO(chogan): DeviceID is currently equal to the Target index.
+    Target *target = GetTarget(context, i);
+    if (!ReserveTargetCapacity(target, bytes[i])) {
+      for (int j = 0; j < i; ++j) {
+        if (bytes[j]) {
+          GetTarget(context, j)->reserved_space.fetch_sub(bytes[j]);
+        }
+      }
+      result = false;
+      break;
+    }
+  }
+
+  return result;
+}
+
+bool ReserveCapacity(SharedMemoryContext *context,
+                     const std::vector<PlacementSchema> &schemas,
+                     CapacityReservation *reservation) {
+  u64 bytes[kMaxDevices] = {};
+  for (const auto &schema : schemas) {
+    AddCapacityNeeded(context, schema, bytes);
+  }
+
+  bool result = ReserveDeviceCapacity(context, bytes);
+  if (result) {
+    for (int i = 0; i < kMaxDevices; ++i) {
+      reservation->bytes[i] += bytes[i];
+    }
+  }
+
+  return result;
+}
+
+void ReleaseCapacity(SharedMemoryContext *context,
+                     CapacityReservation *reservation) {
+  for (int i = 0; i < kMaxDevices; ++i) {
+    if (reservation->bytes[i]) {
+      GetTarget(context, i)->reserved_space.fetch_sub(reservation->bytes[i]);
+      reservation->bytes[i] = 0;
+    }
+  }
+}
+
+/**
+ * Makes sure @p reservation covers @p schema by reserving whatever part of it
+ * wasn't already reserved when it was planned. Returns false if the Targets
+ * don't have room for that part.
+ */
+static bool TopUpCapacityReservation(SharedMemoryContext *context,
+                                     const PlacementSchema &schema,
+                                     CapacityReservation *reservation) {
+  u64 needed[kMaxDevices] = {};
+  AddCapacityNeeded(context, schema, needed);
+
+  u64 shortfall[kMaxDevices] = {};
+  for (int i = 0; i < kMaxDevices; ++i) {
+    if (needed[i] > reservation->bytes[i]) {
+      shortfall[i] = needed[i] - reservation->bytes[i];
+    }
+  }
+
+  bool result = ReserveDeviceCapacity(context, shortfall);
+  if (result) {
+    for (int i = 0; i < kMaxDevices; ++i) {
+      reservation->bytes[i] += shortfall[i];
+    }
+  }
+
+  return result;
+}
+
+/**
+ * Drops the part of @p reservation that covered @p schema, whose buffers have
+ * either been claimed, at which point remaining_space accounts for them, or
+ * couldn't be.
+ */
+static void ReleaseSchemaCapacity(SharedMemoryContext *context,
+                                  const PlacementSchema &schema,
+                                  CapacityReservation *reservation) {
+  u64 needed[kMaxDevices] = {};
+  AddCapacityNeeded(context, schema, needed);
+
+  for (int i = 0; i < kMaxDevices; ++i) {
+    u64 bytes = std::min(needed[i], reservation->bytes[i]);
+    if (bytes) {
+      GetTarget(context, i)->reserved_space.fetch_sub(bytes);
+      reservation->bytes[i] -= bytes;
+    }
+  }
+}
+
+/**
+ * Takes buffers for @p schema from the free lists. The caller must already hold
+ * capacity reservations that cover it (see ReserveCapacity).
+ */
+static std::vector<BufferID> AllocateBuffers(SharedMemoryContext *context,
+                                             const PlacementSchema &schema) {
   BufferPool *pool = GetBufferPoolFromContext(context);
 
-  bool failed = false;
   std::vector<BufferID> result;
+
+  bool failed = false;
   for (auto [size_left, target] : schema) {
     DeviceID device_id = GetDeviceIdFromTargetId(target);
     std::vector<size_t> num_buffers(pool->num_slabs[device_id], 0);
+    RecordSlabDemand(context, device_id, size_left);
 
     // NOTE(chogan): naive buffer selection algorithm: fill with largest
     // buffers first
@@ -590,6 +1007,75 @@ std::vector<BufferID> GetBuffers(SharedMemoryContext *context,
   return result;
 }
 
+std::vector<BufferID> GetBuffers(SharedMemoryContext *context,
+                                 const PlacementSchema &schema,
+                                 CapacityReservation *reservation) {
+  std::vector<BufferID> result;
+
+  // NOTE(chogan): Admission control. The capacity on every Target is claimed
+  // before touching the free lists, so concurrent placements can't race for
+  // the same buffers. Usually it was already reserved when the placement was
+  // planned (see CalculatePlacement), and only the part that wasn't is
+  // reserved here.
+  CapacityReservation local_reservation = {};
+  if (!reservation) {
+    reservation = &local_reservation;
+  }
+
+  if (TopUpCapacityReservation(context, schema, reservation)) {
+    result = AllocateBuffers(context, schema);
+  } else {
+    DLOG(INFO) << "Not enough capacity to fulfill request" << std::endl;
+  }
+  ReleaseSchemaCapacity(context, schema, reservation);
+
+  return result;
+}
+
+std::vector<std::vector<BufferID>>
+GetBatchBuffers(SharedMemoryContext *context,
+                const std::vector<PlacementSchema> &schemas,
+                CapacityReservation *reservation) {
+  std::vector<std::vector<BufferID>> result;
+
+  // NOTE(chogan): Cover the capacity for the whole batch at once, so that
+  // either every Blob in it is admitted or none are.
+  PlacementSchema combined;
+  for (const auto &schema : schemas) {
+    combined.insert(combined.end(), schema.begin(), schema.end());
+  }
+  CapacityReservation local_reservation = {};
+  if (!reservation) {
+    reservation = &local_reservation;
+  }
+  if (!TopUpCapacityReservation(context, combined, reservation)) {
+    DLOG(INFO) << "Not enough capacity to fulfill batch" << std::endl;
+    ReleaseSchemaCapacity(context, combined, reservation);
+    return result;
+  }
+
+  result.reserve(schemas.size());
+  for (const auto &schema : schemas) {
+    std::vector<BufferID> buffer_ids = AllocateBuffers(context, schema);
+    size_t schema_size = 0;
+    for (auto [size, target] : schema) {
+      (void)target;
+      schema_size += size;
+    }
+    if (buffer_ids.empty() && schema_size > 0) {
+      for (const auto &ids : result) {
+        LocalReleaseBuffers(context, ids);
+      }
+      result.clear();
+      break;
+    }
+    result.push_back(buffer_ids);
+  }
+  ReleaseSchemaCapacity(context, combined, reservation);
+
+  return result;
+}
+
 u32 LocalGetBufferSize(SharedMemoryContext *context, BufferID id) {
   BufferHeader *header = GetHeaderByBufferId(context, id);
   u32 result = header->used;
@@ -608,6 +1094,26 @@ u32 GetBufferSize(SharedMemoryContext *context, RpcContext *rpc, BufferID id) {
   return result;
 }
 
+DeviceID LocalGetBufferDeviceId(SharedMemoryContext *context, BufferID id) {
+  BufferHeader *header = GetHeaderByBufferId(context, id);
+  DeviceID result = header->device_id;
+
+  return result;
+}
+
+DeviceID GetBufferDeviceId(SharedMemoryContext *context, RpcContext *rpc,
+                           BufferID id) {
+  DeviceID result = 0;
+  if (BufferIsRemote(rpc, id)) {
+    result = RpcCall<DeviceID>(rpc, id.bits.node_id, "RemoteGetBufferDeviceId",
+                               id);
+  } else {
+    result = LocalGetBufferDeviceId(context, id);
+  }
+
+  return result;
+}
+
 size_t GetBlobSize(SharedMemoryContext *context, RpcContext *rpc,
                    BufferIdArray *buffer_ids) {
   size_t result = 0;
@@ -748,7 +1254,12 @@ Target *InitTargets(Arena *arena, Config *config, Device *devices,
     target->id = id;
     target->capacity = config->capacities[i];
     target->remaining_space.store(config->capacities[i]);
+    target->reserved_space.store(0);
     target->speed.store(devices[i].bandwidth_mbps);
+    target->high_watermark = config->target_high_watermarks[i];
+    target->low_watermark = config->target_low_watermarks[i];
+    target->eviction_requested.store(false);
+    target->epoch_remaining_space.store(config->capacities[i]);
   }
 
   return result;
@@ -870,6 +1381,10 @@ void MergeRamBufferFreeList(SharedMemoryContext *context, int slab_index) {
                                                          slab_index + 1);
       SetFirstFreeBufferId(context, device_id, slab_index + 1,
                            header_to_merge->id);
+      for (int i = 0; i < merge_factor; ++i) {
+        DecrementAvailableBuffers(context, device_id, slab_index);
+      }
+      IncrementAvailableBuffers(context, device_id, slab_index + 1);
 
       while (saved_free_list_count > 0) {
         // NOTE(chogan): Restore headers that we popped and saved.
@@ -890,6 +1405,56 @@ void MergeRamBufferFreeList(SharedMemoryContext *context, int slab_index) {
   EndTicketMutex(&pool->ticket_mutex);
 }
 
+/**
+ * Splits @p header_to_split, a free RAM buffer from @p slab_index that the
+ * caller has already removed from its free list, into `split_factor` buffers on
+ * the free list of the next slab down. Dormant headers for the new buffers are
+ * searched for starting at @p unused_header_index. The caller must hold the
+ * BufferPool's ticket_mutex.
+ */
+static void SplitRamBufferLocked(SharedMemoryContext *context,
+                                 BufferHeader *header_to_split, int slab_index,
+                                 int split_factor, int new_slab_size_in_bytes,
+                                 u32 *unused_header_index) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  // TODO(chogan): Assuming first Device is RAM
+  DeviceID device_id = 0;
+  BufferHeader *headers = GetHeadersBase(context);
+  ptrdiff_t old_data_offset = header_to_split->data_offset;
+
+  for (int i = 0; i < split_factor; ++i) {
+    BufferHeader *next_unused_header = header_to_split;
+    if (i != 0) {
+      // NOTE(chogan): Find the next dormant header. This is easy to optimize
+      // when splitting since we can keep the live and dormant headers separate
+      // and store `first_dormant_header`, but this isn't possible when merging
+      // (because we can't move headers that are in use). So, we have to scan
+      // the array.
+      next_unused_header = &headers[*unused_header_index];
+      while (!HeaderIsDormant(next_unused_header)) {
+        // NOTE(chogan): Assumes first Device is RAM
+        if (++(*unused_header_index) >= pool->num_headers[0]) {
+          *unused_header_index = 0;
+        }
+        next_unused_header = &headers[*unused_header_index];
+      }
+    }
+
+    ResetHeader(next_unused_header);
+    next_unused_header->data_offset = old_data_offset;
+    next_unused_header->capacity = new_slab_size_in_bytes;
+
+    next_unused_header->next_free = PeekFirstFreeBufferId(context, device_id,
+                                                          slab_index - 1);
+    SetFirstFreeBufferId(context, device_id, slab_index - 1,
+                         next_unused_header->id);
+    IncrementAvailableBuffers(context, device_id, slab_index - 1);
+
+    old_data_offset += new_slab_size_in_bytes;
+  }
+  DecrementAvailableBuffers(context, device_id, slab_index);
+}
+
 // TODO(chogan): @testing Needs more testing for the case when the free list has
 // been jumbled for a while. Currently we just test a nice linear free list.
 void SplitRamBufferFreeList(SharedMemoryContext *context, int slab_index) {
@@ -919,49 +1484,549 @@ void SplitRamBufferFreeList(SharedMemoryContext *context, int slab_index) {
   DeviceID device_id = 0;
   BufferID id = PeekFirstFreeBufferId(context, device_id, slab_index);
   u32 unused_header_index = 0;
-  BufferHeader *headers = GetHeadersBase(context);
-  BufferHeader *next_unused_header = &headers[unused_header_index];
 
   while (id.as_int != 0) {
     BufferHeader *header_to_split = GetHeaderByIndex(context,
                                                      id.bits.header_index);
-    ptrdiff_t old_data_offset = header_to_split->data_offset;
     SetFirstFreeBufferId(context, device_id, slab_index,
                          header_to_split->next_free);
     id = header_to_split->next_free;
+    SplitRamBufferLocked(context, header_to_split, slab_index, split_factor,
+                         new_slab_size_in_bytes, &unused_header_index);
+  }
+  EndTicketMutex(&pool->ticket_mutex);
+}
 
-    for (int i = 0; i < split_factor; ++i) {
-      // NOTE(chogan): Find the next dormant header. This is easy to optimize
-      // when splitting since we can keep the live and dormant headers separate
-      // and store `first_dormant_header`, but this isn't possible when merging
-      // (because we can't move headers that are in use). So, we have to scan
-      // the array.
-      if (i == 0) {
-        // NOTE(chogan): Reuse this header as the first unused one
-        next_unused_header = header_to_split;
-      } else {
-        while (!HeaderIsDormant(next_unused_header)) {
-          // NOTE(chogan): Assumes first Device is RAM
-          if (++unused_header_index >= pool->num_headers[0]) {
-            unused_header_index = 0;
-          }
-          next_unused_header = &headers[unused_header_index];
-        }
-      }
+/**
+ * Returns how far the free RAM is from the configured slab percentages.
+ *
+ * The score is the fraction of free RAM bytes that would have to change slabs
+ * for the free bytes in each slab to match `desired_slab_percentages`. 0 means
+ * the free RAM is distributed exactly as configured, and 1 means none of it is
+ * where it should be.
+ */
+f32 ComputeFragmentationScore(SharedMemoryContext *context) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  // TODO(chogan): @configuration Assumes first Device is RAM
+  DeviceID device_id = 0;
+  std::atomic<u32> *buffers_available = GetAvailableBuffersArray(context,
+                                                                 device_id);
+  f32 result = 0;
+
+  std::vector<f64> free_bytes(pool->num_slabs[device_id]);
+  f64 total_free_bytes = 0;
+  for (int i = 0; i < pool->num_slabs[device_id]; ++i) {
+    free_bytes[i] = ((f64)buffers_available[i].load() *
+                     (f64)GetSlabBufferSize(context, device_id, i));
+    total_free_bytes += free_bytes[i];
+  }
+
+  if (total_free_bytes > 0) {
+    f64 misplaced_bytes = 0;
+    for (int i = 0; i < pool->num_slabs[device_id]; ++i) {
+      f64 desired_bytes = pool->ram_slab_percentages[i] * total_free_bytes;
+      misplaced_bytes += std::max(desired_bytes - free_bytes[i], 0.0);
+    }
+    result = (f32)(misplaced_bytes / total_free_bytes);
+  }
+
+  return result;
+}
+
+/**
+ * Moves the RAM slab percentages @p rate of the way towards the demand recorded
+ * since the last call, then halves the recorded demand. Returns false if no
+ * demand has been recorded.
+ */
+bool AdaptRamSlabPercentages(SharedMemoryContext *context, f32 rate) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  // TODO(chogan): @configuration Assumes first Device is RAM
+  DeviceID device_id = 0;
+  int num_slabs = pool->num_slabs[device_id];
+  bool result = false;
+
+  std::vector<u64> demand(num_slabs);
+  u64 total_demand = 0;
+  for (int i = 0; i < num_slabs; ++i) {
+    demand[i] = pool->slab_demand[device_id][i].load();
+    total_demand += demand[i];
+  }
+
+  if (total_demand > 0 && rate > 0) {
+    // NOTE(chogan): Keep a little free space in every slab so that a change in
+    // the workload doesn't have to wait for a split or merge.
+    const f32 kMinSlabPercentage = 0.05f / num_slabs;
+    f32 total_percentage = 0;
+    for (int i = 0; i < num_slabs; ++i) {
+      f32 observed = (f32)demand[i] / (f32)total_demand;
+      f32 percentage = ((1.0f - rate) * pool->ram_slab_percentages[i] +
+                        rate * observed);
+      pool->ram_slab_percentages[i] = std::max(percentage, kMinSlabPercentage);
+      total_percentage += pool->ram_slab_percentages[i];
+    }
+    for (int i = 0; i < num_slabs; ++i) {
+      pool->ram_slab_percentages[i] /= total_percentage;
+    }
+
+    for (int device = 0; device < pool->num_devices; ++device) {
+      for (int i = 0; i < pool->num_slabs[device]; ++i) {
+        u64 old_demand = pool->slab_demand[device][i].load();
+        pool->slab_demand[device][i].fetch_sub(old_demand / 2);
+      }
+    }
+    result = true;
+  }
+
+  return result;
+}
+
+/**
+ * Reports the occupancy of each slab of @p device_id and how much of the
+ * in-use capacity is wasted by rounding requests up to whole buffers.
+ */
+FragmentationStats GetFragmentationStats(SharedMemoryContext *context,
+                                         DeviceID device_id) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  BufferHeader *headers = GetHeadersBase(context);
+  std::atomic<u32> *buffers_available = GetAvailableBuffersArray(context,
+                                                                 device_id);
+  int num_slabs = pool->num_slabs[device_id];
+  FragmentationStats result = {};
+  result.slabs.resize(num_slabs);
+
+  u64 total_demand = 0;
+  for (int i = 0; i < num_slabs; ++i) {
+    result.slabs[i].buffer_size = GetSlabBufferSize(context, device_id, i);
+    result.slabs[i].num_free = buffers_available[i].load();
+    total_demand += pool->slab_demand[device_id][i].load();
+  }
+  for (int i = 0; i < num_slabs && total_demand > 0; ++i) {
+    result.slabs[i].demand = ((f32)pool->slab_demand[device_id][i].load() /
+                              (f32)total_demand);
+  }
+
+  // NOTE(chogan): The headers are laid out by Device.
+  u32 first_header = 0;
+  for (DeviceID i = 0; i < device_id; ++i) {
+    first_header += pool->num_headers[i];
+  }
+
+  u64 capacity_in_use = 0;
+  u64 bytes_used = 0;
+  for (u32 i = first_header; i < first_header + pool->num_headers[device_id];
+       ++i) {
+    BufferHeader *header = &headers[i];
+    if (HeaderIsDormant(header) || !header->in_use) {
+      continue;
+    }
+    for (int slab = 0; slab < num_slabs; ++slab) {
+      if (result.slabs[slab].buffer_size == header->capacity) {
+        result.slabs[slab].num_in_use++;
+        result.slabs[slab].bytes_used += header->used;
+        break;
+      }
+    }
+    capacity_in_use += header->capacity;
+    bytes_used += header->used;
+  }
+
+  if (capacity_in_use > 0) {
+    result.internal_fragmentation =
+      1.0f - (f32)((f64)bytes_used / (f64)capacity_in_use);
+  }
+  if (device_id == 0) {
+    result.free_space_score = ComputeFragmentationScore(context);
+  }
+
+  return result;
+}
+
+/**
+ * A run of contiguous RAM buffers from the same slab that can be merged into
+ * one buffer of the next slab up once they are all free.
+ */
+struct MergeWindow {
+  /** The `data_offset` of each buffer, in ascending order */
+  std::vector<ptrdiff_t> offsets;
+  int num_in_use;
+};
+
+/** Maps a RAM buffer's `data_offset` to its BufferHeader. */
+typedef std::map<ptrdiff_t, BufferHeader *> RamBufferMap;
+
+static RamBufferMap MakeRamBufferMap(SharedMemoryContext *context) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  BufferHeader *headers = GetHeadersBase(context);
+  RamBufferMap result;
+
+  // NOTE(chogan): This scan doesn't take the ticket_mutex so it won't stall
+  // allocations, which means it's only a hint. Everything is checked again
+  // under the lock before buffers are moved.
+  // TODO(chogan): @configuration Assumes first Device is RAM
+  for (u32 i = 0; i < pool->num_headers[0]; ++i) {
+    BufferHeader *header = &headers[i];
+    if (!HeaderIsDormant(header)) {
+      result[header->data_offset] = header;
+    }
+  }
+
+  return result;
+}
+
+/**
+ * Finds non-overlapping runs of @p merge_factor contiguous buffers of
+ * @p slab_size bytes, ordered by how many of their buffers are in use.
+ */
+static std::vector<MergeWindow> FindMergeWindows(const RamBufferMap &buffers,
+                                                 u32 slab_size,
+                                                 int merge_factor) {
+  std::vector<MergeWindow> result;
+  MergeWindow window = {};
+
+  for (auto iter = buffers.begin(); iter != buffers.end(); ++iter) {
+    BufferHeader *header = iter->second;
+    if (header->capacity != slab_size ||
+        (window.offsets.size() > 0 &&
+         window.offsets.back() + (ptrdiff_t)slab_size != iter->first)) {
+      window.offsets.clear();
+      window.num_in_use = 0;
+    }
+    if (header->capacity == slab_size) {
+      window.offsets.push_back(iter->first);
+      window.num_in_use += header->in_use ? 1 : 0;
+      if (window.offsets.size() == (size_t)merge_factor) {
+        result.push_back(window);
+        window.offsets.clear();
+        window.num_in_use = 0;
+      }
+    }
+  }
+
+  std::stable_sort(result.begin(), result.end(),
+                   [](const MergeWindow &a, const MergeWindow &b) {
+                     return a.num_in_use < b.num_in_use;
+                   });
+
+  return result;
+}
+
+static bool WindowContains(const std::vector<BufferHeader *> &window,
+                           BufferHeader *header) {
+  bool result = std::find(window.begin(), window.end(),
+                          header) != window.end();
+
+  return result;
+}
+
+/**
+ * Moves the contents of the in-use RAM buffer @p header into the free buffer
+ * @p free_header and exchanges their `data_offset`s. The BufferID of the data
+ * doesn't change, so no Blob metadata needs to be updated. The caller must
+ * hold the ticket_mutex.
+ *
+ * Returns false without moving anything if @p header is locked by a reader or
+ * writer.
+ */
+static bool RelocateRamBufferLocked(SharedMemoryContext *context,
+                                    BufferHeader *header,
+                                    BufferHeader *free_header) {
+  // NOTE(chogan): Readers and writers look up `data_offset` after taking the
+  // buffer lock, so they see either the old or the new location, never a
+  // partial copy. Never spin here, since every GetBuffers and ReleaseBuffer
+  // on the node waits for the ticket_mutex we hold.
+  bool result = TryLockBuffer(header);
+  if (result) {
+    memcpy(context->shm_base + free_header->data_offset,
+           context->shm_base + header->data_offset, header->used);
+    std::swap(header->data_offset, free_header->data_offset);
+    UnlockBuffer(header);
+  }
+
+  return result;
+}
+
+/**
+ * Empties @p window by relocating its in-use buffers to free buffers of the
+ * same slab outside of it, then merges it into one buffer of the next slab up.
+ * Returns false if the window changed since it was found or couldn't be
+ * emptied within @p relocation_budget, which is decremented for each
+ * relocation.
+ */
+static bool MergeRamWindow(SharedMemoryContext *context, RamBufferMap *buffers,
+                           const MergeWindow &window, int slab_index,
+                           int new_slab_size_in_bytes,
+                           int *relocation_budget) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  // TODO(chogan): @configuration Assumes first Device is RAM
+  DeviceID device_id = 0;
+  u32 slab_size = GetSlabBufferSize(context, device_id, slab_index);
+  std::vector<BufferHeader *> headers(window.offsets.size(), 0);
+  bool result = true;
+
+  BeginTicketMutex(&pool->ticket_mutex);
+
+  int num_in_use = 0;
+  for (size_t i = 0; i < window.offsets.size() && result; ++i) {
+    auto iter = buffers->find(window.offsets[i]);
+    if (iter == buffers->end()) {
+      result = false;
+      break;
+    }
+    BufferHeader *header = iter->second;
+    if (HeaderIsDormant(header) || header->capacity != slab_size ||
+        header->data_offset != window.offsets[i]) {
+      result = false;
+      break;
+    }
+    headers[i] = header;
+    num_in_use += header->in_use ? 1 : 0;
+  }
+  if (num_in_use > *relocation_budget) {
+    result = false;
+  }
+
+  for (size_t i = 0; i < headers.size() && result; ++i) {
+    BufferHeader *header = headers[i];
+    if (!header->in_use) {
+      continue;
+    }
+
+    BufferHeader *free_header = 0;
+    BufferID id = PeekFirstFreeBufferId(context, device_id, slab_index);
+    while (!IsNullBufferId(id)) {
+      BufferHeader *candidate = GetHeaderByBufferId(context, id);
+      if (!WindowContains(headers, candidate)) {
+        free_header = candidate;
+        break;
+      }
+      id = candidate->next_free;
+    }
+
+    if (free_header && RelocateRamBufferLocked(context, header, free_header)) {
+      ptrdiff_t new_offset = header->data_offset;
+      (*buffers)[window.offsets[i]] = free_header;
+      (*buffers)[new_offset] = header;
+      headers[i] = free_header;
+      (*relocation_budget)--;
+    } else {
+      // NOTE(chogan): No free buffer outside the window, or the buffer is
+      // busy with I/O. Skip the window and try again on a later pass.
+      result = false;
+    }
+  }
+
+  if (result) {
+    // NOTE(chogan): Unlink the window's buffers from the free list in one pass.
+    size_t num_unlinked = 0;
+    BufferHeader *previous = 0;
+    BufferID id = PeekFirstFreeBufferId(context, device_id, slab_index);
+    while (!IsNullBufferId(id) && num_unlinked < headers.size()) {
+      BufferHeader *header = GetHeaderByBufferId(context, id);
+      BufferID next_id = header->next_free;
+      if (WindowContains(headers, header)) {
+        if (previous) {
+          previous->next_free = next_id;
+        } else {
+          SetFirstFreeBufferId(context, device_id, slab_index, next_id);
+        }
+        num_unlinked++;
+      } else {
+        previous = header;
+      }
+      id = next_id;
+    }
+    assert(num_unlinked == headers.size());
+
+    for (size_t i = 1; i < headers.size(); ++i) {
+      buffers->erase(window.offsets[i]);
+      MakeHeaderDormant(headers[i]);
+      DecrementAvailableBuffers(context, device_id, slab_index);
+    }
+    DecrementAvailableBuffers(context, device_id, slab_index);
+
+    BufferHeader *merged_header = headers[0];
+    ResetHeader(merged_header);
+    merged_header->capacity = new_slab_size_in_bytes;
+    merged_header->next_free = PeekFirstFreeBufferId(context, device_id,
+                                                     slab_index + 1);
+    SetFirstFreeBufferId(context, device_id, slab_index + 1,
+                         merged_header->id);
+    IncrementAvailableBuffers(context, device_id, slab_index + 1);
+  }
+
+  EndTicketMutex(&pool->ticket_mutex);
 
-      ResetHeader(next_unused_header);
-      next_unused_header->data_offset = old_data_offset;
-      next_unused_header->capacity = new_slab_size_in_bytes;
+  return result;
+}
 
-      next_unused_header->next_free = PeekFirstFreeBufferId(context, device_id,
-                                                            slab_index - 1);
-      SetFirstFreeBufferId(context, device_id, slab_index - 1,
-                           next_unused_header->id);
+/**
+ * Splits one free RAM buffer from @p slab_index into buffers of the next slab
+ * down. Returns false if the slab has no free buffers.
+ */
+static bool SplitOneRamBuffer(SharedMemoryContext *context,
+                              RamBufferMap *buffers, int slab_index,
+                              int split_factor, int new_slab_size_in_bytes,
+                              u32 *unused_header_index) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  // TODO(chogan): @configuration Assumes first Device is RAM
+  DeviceID device_id = 0;
+  bool result = false;
 
-      old_data_offset += new_slab_size_in_bytes;
+  BeginTicketMutex(&pool->ticket_mutex);
+  BufferID id = PeekFirstFreeBufferId(context, device_id, slab_index);
+  if (!IsNullBufferId(id)) {
+    BufferHeader *header_to_split = GetHeaderByBufferId(context, id);
+    SetFirstFreeBufferId(context, device_id, slab_index,
+                         header_to_split->next_free);
+    SplitRamBufferLocked(context, header_to_split, slab_index, split_factor,
+                         new_slab_size_in_bytes, unused_header_index);
+
+    if (buffers->size() > 0) {
+      // NOTE(chogan): The new buffers are the most recently pushed entries of
+      // the free list below.
+      BufferID new_id = PeekFirstFreeBufferId(context, device_id,
+                                              slab_index - 1);
+      for (int i = 0; i < split_factor && !IsNullBufferId(new_id); ++i) {
+        BufferHeader *header = GetHeaderByBufferId(context, new_id);
+        (*buffers)[header->data_offset] = header;
+        new_id = header->next_free;
+      }
     }
+    result = true;
   }
   EndTicketMutex(&pool->ticket_mutex);
+
+  return result;
+}
+
+/**
+ * Moves free RAM between slabs so that it matches the configured slab
+ * percentages.
+ *
+ * Does nothing unless ComputeFragmentationScore exceeds `policy.threshold`,
+ * and then merges and splits one buffer at a time until the score falls to
+ * half the threshold or `policy.max_steps` is reached. Each step runs under the
+ * ticket_mutex on its own, so allocations are only blocked for one merge or
+ * split. Merging relocates up to `policy.max_relocations` in-use buffers in
+ * total to free up contiguous space. Returns the number of steps taken.
+ */
+int DefragmentRam(SharedMemoryContext *context, const DefragPolicy &policy) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  // TODO(chogan): @configuration Assumes first Device is RAM
+  DeviceID device_id = 0;
+  int num_slabs = pool->num_slabs[device_id];
+  std::atomic<u32> *buffers_available = GetAvailableBuffersArray(context,
+                                                                 device_id);
+  int result = 0;
+
+  if (num_slabs < 2 || ComputeFragmentationScore(context) <= policy.threshold) {
+    return result;
+  }
+
+  RamBufferMap buffers;
+  std::vector<std::vector<MergeWindow>> windows(num_slabs);
+  std::vector<bool> have_windows(num_slabs, false);
+  std::vector<bool> stuck(num_slabs, false);
+  int relocation_budget = policy.max_relocations;
+  u32 unused_header_index = 0;
+
+  while (result < policy.max_steps &&
+         ComputeFragmentationScore(context) > policy.threshold / 2.0f) {
+    std::vector<f64> surplus(num_slabs);
+    f64 total_free_bytes = 0;
+    for (int i = 0; i < num_slabs; ++i) {
+      surplus[i] = ((f64)buffers_available[i].load() *
+                    (f64)GetSlabBufferSize(context, device_id, i));
+      total_free_bytes += surplus[i];
+    }
+    for (int i = 0; i < num_slabs; ++i) {
+      surplus[i] -= pool->ram_slab_percentages[i] * total_free_bytes;
+    }
+
+    // NOTE(chogan): Feed the slab that is furthest below its share from a
+    // neighbor, preferring the neighbor with the most to spare. If neither
+    // neighbor has extra, pull from the side where the extra is so it moves
+    // one slab closer.
+    int target_slab = -1;
+    for (int i = 0; i < num_slabs; ++i) {
+      if (!stuck[i] && (target_slab == -1 ||
+                        surplus[i] < surplus[target_slab])) {
+        target_slab = i;
+      }
+    }
+    if (target_slab == -1) {
+      break;
+    }
+    int richest_slab = (int)(std::max_element(surplus.begin(), surplus.end()) -
+                             surplus.begin());
+    f64 below = target_slab > 0 ? surplus[target_slab - 1] : -1;
+    f64 above = target_slab + 1 < num_slabs ? surplus[target_slab + 1] : -1;
+    bool merge = false;
+    if (below > 0 || above > 0) {
+      merge = below > above;
+    } else {
+      merge = richest_slab < target_slab;
+    }
+    int source_slab = merge ? target_slab - 1 : target_slab + 1;
+    if (source_slab < 0 || source_slab >= num_slabs) {
+      stuck[target_slab] = true;
+      continue;
+    }
+
+    // NOTE(chogan): Only move a buffer if the target slab still needs all of
+    // it. Otherwise the extra could be moved straight back.
+    i32 target_unit_size = GetSlabUnitSize(context, device_id, target_slab);
+    i32 source_unit_size = GetSlabUnitSize(context, device_id, source_slab);
+    u32 bytes_moved = GetSlabBufferSize(context, device_id,
+                                        merge ? target_slab : source_slab);
+    i32 larger_unit_size = std::max(target_unit_size, source_unit_size);
+    i32 smaller_unit_size = std::min(target_unit_size, source_unit_size);
+    if (-surplus[target_slab] < (f64)bytes_moved || smaller_unit_size == 0 ||
+        larger_unit_size % smaller_unit_size != 0) {
+      stuck[target_slab] = true;
+      continue;
+    }
+    int factor = larger_unit_size / smaller_unit_size;
+    int new_slab_size_in_bytes = target_unit_size * pool->block_sizes[0];
+
+    bool success = false;
+    if (merge) {
+      if (buffers.size() == 0) {
+        buffers = MakeRamBufferMap(context);
+      }
+      if (!have_windows[source_slab]) {
+        u32 slab_size = GetSlabBufferSize(context, device_id, source_slab);
+        windows[source_slab] = FindMergeWindows(buffers, slab_size, factor);
+        have_windows[source_slab] = true;
+      }
+      std::vector<MergeWindow> &candidates = windows[source_slab];
+      // NOTE(chogan): The candidates are sorted by how many buffers they
+      // had in use when they were found, so once one is over budget the rest
+      // probably are too.
+      while (!success && candidates.size() > 0 &&
+             candidates.front().num_in_use <= relocation_budget) {
+        MergeWindow window = candidates.front();
+        candidates.erase(candidates.begin());
+        success = MergeRamWindow(context, &buffers, window, source_slab,
+                                 new_slab_size_in_bytes, &relocation_budget);
+      }
+    } else {
+      success = SplitOneRamBuffer(context, &buffers, source_slab, factor,
+                                  new_slab_size_in_bytes,
+                                  &unused_header_index);
+      // NOTE(chogan): Windows found before the split don't include the new
+      // buffers.
+      have_windows[target_slab] = false;
+    }
+
+    if (success) {
+      result++;
+    } else {
+      stuck[target_slab] = true;
+    }
+  }
+
+  return result;
 }
 
 ptrdiff_t InitBufferPool(u8 *shmem_base, Arena *buffer_pool_arena,
@@ -1131,6 +2196,37 @@ ptrdiff_t InitBufferPool(u8 *shmem_base, Arena *buffer_pool_arena,
   pool->targets_offset = (u8 *)targets - shmem_base;
   pool->num_devices = config->num_devices;
   pool->total_headers = total_headers;
+  pool->max_pending_moves = config->buffer_organizer_queue_depth;
+  pool->swap_drain_order = config->swap_drain_order;
+  pool->capacity_epoch.store(0);
+  pool->placement_cache_threshold = config->placement_cache_threshold;
+  pool->use_measured_bandwidths = config->use_measured_bandwidths;
+  pool->parallel_write_threshold = config->parallel_write_threshold;
+  pool->parallel_write_threads = config->parallel_write_threads;
+
+  // TODO(chogan): @configuration Assumes first Device is RAM
+  f32 total_ram_percentage = 0;
+  for (int slab = 0; slab < config->num_slabs[0]; ++slab) {
+    total_ram_percentage += config->desired_slab_percentages[0][slab];
+  }
+  for (int slab = 0; slab < config->num_slabs[0]; ++slab) {
+    pool->ram_slab_percentages[slab] =
+      total_ram_percentage > 0 ?
+      config->desired_slab_percentages[0][slab] / total_ram_percentage : 0;
+  }
+
+  for (int device = 0; device < config->num_devices; ++device) {
+    // NOTE(chogan): Allow bursts of 100 ms worth of I/O, but always at least
+    // one of the largest buffers.
+    IoBudget *budget = &pool->io_budgets[device];
+    budget->bytes_per_sec = (i64)(config->buffer_organizer_io_share *
+                                  config->bandwidths[device] * MEGABYTES(1));
+    i32 largest_buffer = config->num_slabs[device] > 0 ?
+      slab_buffer_sizes[device][config->num_slabs[device] - 1] : 0;
+    budget->burst = std::max(budget->bytes_per_sec / 10, (i64)largest_buffer);
+    budget->tokens.store(budget->burst);
+    budget->last_refill_us.store(GetIoBudgetTimeUs());
+  }
 
   for (int device = 0; device < config->num_devices; ++device) {
     pool->block_sizes[device] = config->block_sizes[device];
@@ -1222,7 +2318,12 @@ void InitFilesForBuffering(SharedMemoryContext *context, bool make_space) {
 
       const char *buffering_fname =
         context->buffering_filenames[device_id][slab].c_str();
-      FILE *buffering_file = fopen(buffering_fname, "w+");
+      // NOTE(chogan): Don't truncate existing buffering files. They may hold
+      // the data for Blobs restored from a metadata checkpoint.
+      FILE *buffering_file = fopen(buffering_fname, "r+");
+      if (!buffering_file) {
+        buffering_file = fopen(buffering_fname, "w+");
+      }
       if (make_space) {
         if (device->has_fallocate) {
           // TODO(chogan): Use posix_fallocate when it is available
@@ -1325,13 +2426,6 @@ void CloseBufferingFiles(SharedMemoryContext *context) {
       }
     }
   }
-
-  if (context->swap_file) {
-    if (fclose(context->swap_file) != 0) {
-      // TODO(chogan): @errorhandling
-      HERMES_NOT_IMPLEMENTED_YET;
-    }
-  }
 }
 
 void ReleaseSharedMemoryContext(SharedMemoryContext *context) {
@@ -1341,11 +2435,45 @@ void ReleaseSharedMemoryContext(SharedMemoryContext *context) {
 
 // IO clients
 
+/**
+ * Returns the stream for the buffering file of @p slab_index on @p device_id,
+ * opening it on first use. Returns NULL if the file can't be opened.
+ *
+ * Several threads of one process may write to the same slab file (see
+ * WriteBlobToBuffers), so the lazy open is guarded by a mutex.
+ */
+static FILE *GetBufferingStream(SharedMemoryContext *context,
+                                DeviceID device_id, int slab_index) {
+  static std::mutex open_streams_mutex;
+  std::lock_guard<std::mutex> lock(open_streams_mutex);
+
+  FILE *result = context->open_streams[device_id][slab_index];
+  if (!result) {
+    // TODO(chogan): Check number of opened files against maximum allowed.
+    // May have to close something.
+    const char *filename =
+      context->buffering_filenames[device_id][slab_index].c_str();
+    result = fopen(filename, "r+");
+    if (result) {
+      context->open_streams[device_id][slab_index] = result;
+    } else {
+      // TODO(chogan): @errorhandling
+      LOG(WARNING) << "Failed to open buffering file " << filename << ": "
+                   << strerror(errno) << std::endl;
+    }
+  }
+
+  return result;
+}
+
 size_t LocalWriteBufferById(SharedMemoryContext *context, BufferID id,
                             const Blob &blob, size_t offset) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
   BufferHeader *header = GetHeaderByIndex(context, id.bits.header_index);
   Device *device = GetDeviceFromHeader(context, header);
   size_t write_size = header->used;
+  std::atomic<u64> *queued_bytes = &pool->queued_write_bytes[device->id];
+  queued_bytes->fetch_add(write_size);
 
   // TODO(chogan): Should this be a TicketMutex? It seems that at any
   // given time, only the DataOrganizer and an application core will
@@ -1355,39 +2483,35 @@ size_t LocalWriteBufferById(SharedMemoryContext *context, BufferID id,
   // ordering.
   LockBuffer(header);
 
+  u64 start_ns = GetIoTimeNs();
   u8 *at = (u8 *)blob.data + offset;
   if (device->is_byte_addressable) {
     u8 *dest = GetRamBufferPtr(context, header->id);
     memcpy(dest, at, write_size);
   } else {
     int slab_index = GetSlabIndexFromHeader(context, header);
-    FILE *file = context->open_streams[device->id][slab_index];
-    if (!file) {
-      // TODO(chogan): Check number of opened files against maximum allowed.
-      // May have to close something.
-      const char *filename =
-        context->buffering_filenames[device->id][slab_index].c_str();
-      file = fopen(filename, "r+");
-      context->open_streams[device->id][slab_index] = file;
-    }
-    fseek(file, header->data_offset, SEEK_SET);
-    [[maybe_unused]] size_t items_written = fwrite(at, write_size, 1, file);
-    // TODO(chogan): @errorhandling
-    assert(items_written == 1);
-    if (fflush(file) != 0) {
+    FILE *file = GetBufferingStream(context, device->id, slab_index);
+    // NOTE(chogan): Positional I/O doesn't share the stream's file position,
+    // so Blobs in the same slab file can be written from several threads.
+    if (!file ||
+        !WriteAllAt(fileno(file), at, write_size, header->data_offset)) {
       // TODO(chogan): @errorhandling
-      LOG(WARNING) << "fflush failed\n";
+      LOG(WARNING) << "Failed to write buffer " << id.as_int << "\n";
     }
     // fsync(fileno(file));
   }
+  u64 elapsed_ns = GetIoTimeNs() - start_ns;
   UnlockBuffer(header);
+  queued_bytes->fetch_sub(write_size);
+  RecordDeviceIo(context, device->id, write_size, elapsed_ns);
 
   return write_size;
 }
 
-void WriteBlobToBuffers(SharedMemoryContext *context, RpcContext *rpc,
-                        const Blob &blob,
-                        const std::vector<BufferID> &buffer_ids) {
+/** Writes @p blob to its @p buffer_ids in order on the calling thread. */
+static void WriteBlobToBuffersSerially(SharedMemoryContext *context,
+                                       RpcContext *rpc, const Blob &blob,
+                                       const std::vector<BufferID> &buffer_ids) {
   size_t bytes_left_to_write = blob.size;
   size_t offset = 0;
   // TODO(chogan): @optimization Handle sequential buffers as one I/O operation
@@ -1414,50 +2538,302 @@ void WriteBlobToBuffers(SharedMemoryContext *context, RpcContext *rpc,
   assert(bytes_left_to_write == 0);
 }
 
-size_t LocalReadBufferById(SharedMemoryContext *context, BufferID id,
-                           Blob *blob, size_t read_offset) {
-  BufferHeader *header = GetHeaderByIndex(context, id.bits.header_index);
-  Device *device = GetDeviceFromHeader(context, header);
-  size_t read_size = header->used;
+/** One buffer's share of a parallel write. */
+struct BufferWrite {
+  const Blob *blob;
+  BufferID id;
+  size_t offset;
+};
 
-  // TODO(chogan): Should this be a TicketMutex? It seems that at any
-  // given time, only the DataOrganizer and an application core will
-  // be trying to write to/from the same BufferID. In that case, it's
-  // first come first serve. However, if it turns out that more
-  // threads will be trying to lock the buffer, we may need to enforce
-  // ordering.
-  LockBuffer(header);
+/**
+ * A persistent pool of threads that help the calling thread write large Blobs
+ * to their buffers, so a Put doesn't pay for creating threads.
+ */
+struct BufferWriterPool {
+  std::mutex mutex;
+  /** Signaled when work is queued or the pool is stopping. */
+  std::condition_variable work_cv;
+  std::deque<std::function<void()>> work;
+  std::vector<std::thread> workers;
+  bool stop_requested;
+};
+
+static void RunBufferWriter(BufferWriterPool *pool) {
+  for (;;) {
+    std::function<void()> work;
+    {
+      std::unique_lock<std::mutex> lock(pool->mutex);
+      pool->work_cv.wait(lock, [pool]() {
+        return pool->stop_requested || !pool->work.empty();
+      });
+      if (pool->work.empty()) {
+        break;
+      }
+      work = std::move(pool->work.front());
+      pool->work.pop_front();
+    }
+    work();
+  }
+}
 
-  size_t result = 0;
-  if (device->is_byte_addressable) {
-    u8 *src = GetRamBufferPtr(context, header->id);
-    memcpy((u8 *)blob->data + read_offset, src, read_size);
-    result = read_size;
-  } else {
-    int slab_index = GetSlabIndexFromHeader(context, header);
-    FILE *file = context->open_streams[device->id][slab_index];
-    if (!file) {
-      // TODO(chogan): Check number of opened files against maximum allowed.
-      // May have to close something.
-      const char *filename =
-        context->buffering_filenames[device->id][slab_index].c_str();
-      file = fopen(filename, "r+");
-    }
-    fseek(file, header->data_offset, SEEK_SET);
-    size_t items_read = fread((u8 *)blob->data + read_offset, read_size, 1,
-                              file);
-    // TODO(chogan): @errorhandling
-    assert(items_read == 1);
-    result = items_read * read_size;
+BufferWriterPool *StartBufferWriterPool(int num_threads) {
+  BufferWriterPool *result = 0;
+  // NOTE(chogan): The thread that calls WriteBlobToBuffers is one of the
+  // writers, so the pool needs one thread less.
+  int hardware_threads = (int)std::max(std::thread::hardware_concurrency(), 1u);
+  int num_workers = std::min(num_threads, hardware_threads) - 1;
+
+  if (num_workers > 0) {
+    result = new BufferWriterPool();
+    result->stop_requested = false;
+    for (int i = 0; i < num_workers; ++i) {
+      result->workers.emplace_back(RunBufferWriter, result);
+    }
   }
-  UnlockBuffer(header);
 
   return result;
 }
 
-size_t ReadBlobFromBuffers(SharedMemoryContext *context, RpcContext *rpc,
-                           Blob *blob, BufferIdArray *buffer_ids,
-                           u32 *buffer_sizes) {
+void StopBufferWriterPool(BufferWriterPool *pool) {
+  if (pool) {
+    {
+      std::lock_guard<std::mutex> lock(pool->mutex);
+      pool->stop_requested = true;
+    }
+    pool->work_cv.notify_all();
+    for (auto &worker : pool->workers) {
+      worker.join();
+    }
+    delete pool;
+  }
+}
+
+/**
+ * Returns how many threads should write @p num_bytes, which can be split into
+ * at most @p max_tasks independent pieces. Returns 1 when the write is below
+ * the BufferPool's `parallel_write_threshold` or this process has no
+ * BufferWriterPool.
+ */
+static size_t GetParallelWriteThreads(SharedMemoryContext *context,
+                                      size_t num_bytes, size_t max_tasks) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  BufferWriterPool *writers = context->buffer_writers;
+  size_t result = 1;
+  if (writers && pool->parallel_write_threads > 1 &&
+      num_bytes >= pool->parallel_write_threshold) {
+    result = std::min({(size_t)pool->parallel_write_threads,
+                       writers->workers.size() + 1,
+                       std::max(max_tasks, (size_t)1)});
+  }
+
+  return result;
+}
+
+/**
+ * The tasks of one parallel write. The BufferWriterPool threads that help with
+ * the write share ownership of it, so a helper that starts after every task is
+ * done finds nothing to do instead of touching freed memory.
+ */
+struct ParallelWrite {
+  SharedMemoryContext *context;
+  RpcContext *rpc;
+  const Blob *blobs;
+  const std::vector<BufferID> *buffer_ids;
+  /** Blobs with a remote buffer. Each is written serially as one task. */
+  std::vector<size_t> remote_blobs;
+  std::vector<std::vector<BufferWrite>> tasks;
+  std::atomic<size_t> next_task;
+  std::mutex mutex;
+  /** Signaled when the last task finishes. */
+  std::condition_variable done_cv;
+  size_t tasks_done;
+};
+
+static void RunParallelWriteTasks(ParallelWrite *write) {
+  size_t num_tasks = write->remote_blobs.size() + write->tasks.size();
+  for (size_t i = write->next_task.fetch_add(1); i < num_tasks;
+       i = write->next_task.fetch_add(1)) {
+    if (i < write->remote_blobs.size()) {
+      size_t blob_index = write->remote_blobs[i];
+      WriteBlobToBuffersSerially(write->context, write->rpc,
+                                 write->blobs[blob_index],
+                                 write->buffer_ids[blob_index]);
+    } else {
+      for (const auto &buffer_write : write->tasks[i -
+                                                   write->remote_blobs.size()]) {
+        LocalWriteBufferById(write->context, buffer_write.id,
+                             *buffer_write.blob, buffer_write.offset);
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(write->mutex);
+    if (++write->tasks_done == num_tasks) {
+      write->done_cv.notify_all();
+    }
+  }
+}
+
+/**
+ * Writes @p num_blobs Blobs, each to its list in @p buffer_ids, with the
+ * calling thread and up to @p num_threads - 1 threads from the process's
+ * BufferWriterPool.
+ *
+ * The writes to each file-backed Device form one task, so every Device is
+ * written concurrently and a Put takes as long as its slowest Device rather
+ * than the sum of them. The RAM buffers are split into contiguous tasks of
+ * about equal size for the remaining threads. Blobs with a remote buffer are
+ * written serially as one task each, since the size of a remote buffer isn't
+ * known without asking its node.
+ */
+static void WriteBlobsInParallel(SharedMemoryContext *context, RpcContext *rpc,
+                                 size_t num_blobs, const Blob *blobs,
+                                 const std::vector<BufferID> *buffer_ids,
+                                 size_t num_threads) {
+  auto write = std::make_shared<ParallelWrite>();
+  write->context = context;
+  write->rpc = rpc;
+  write->blobs = blobs;
+  write->buffer_ids = buffer_ids;
+  write->next_task.store(0);
+  write->tasks_done = 0;
+
+  std::vector<std::vector<BufferWrite>> device_tasks(kMaxDevices);
+  std::vector<BufferWrite> ram_writes;
+  size_t ram_bytes = 0;
+
+  for (size_t i = 0; i < num_blobs; ++i) {
+    bool has_remote_buffer = false;
+    for (const auto &id : buffer_ids[i]) {
+      has_remote_buffer = has_remote_buffer || BufferIsRemote(rpc, id);
+    }
+    if (has_remote_buffer) {
+      write->remote_blobs.push_back(i);
+      continue;
+    }
+
+    size_t offset = 0;
+    for (const auto &id : buffer_ids[i]) {
+      BufferHeader *header = GetHeaderByBufferId(context, id);
+      Device *device = GetDeviceFromHeader(context, header);
+      BufferWrite buffer_write = {&blobs[i], id, offset};
+      if (device->is_byte_addressable) {
+        ram_writes.push_back(buffer_write);
+        ram_bytes += header->used;
+      } else {
+        device_tasks[device->id].push_back(buffer_write);
+      }
+      offset += header->used;
+    }
+    assert(offset == blobs[i].size);
+  }
+
+  // NOTE(chogan): The slower file-backed Devices come first so that they start
+  // as early as possible.
+  std::vector<std::vector<BufferWrite>> &tasks = write->tasks;
+  for (auto &device_task : device_tasks) {
+    if (!device_task.empty()) {
+      tasks.push_back(std::move(device_task));
+    }
+  }
+
+  size_t num_serial_tasks = tasks.size() + write->remote_blobs.size();
+  if (!ram_writes.empty()) {
+    size_t num_ram_tasks = (num_threads > num_serial_tasks ?
+                            num_threads - num_serial_tasks : 1);
+    size_t task_bytes = (ram_bytes + num_ram_tasks - 1) / num_ram_tasks;
+    size_t bytes_in_task = 0;
+    tasks.emplace_back();
+    for (const auto &buffer_write : ram_writes) {
+      if (bytes_in_task >= task_bytes) {
+        tasks.emplace_back();
+        bytes_in_task = 0;
+      }
+      tasks.back().push_back(buffer_write);
+      bytes_in_task += LocalGetBufferSize(context, buffer_write.id);
+    }
+  }
+
+  size_t num_tasks = write->remote_blobs.size() + tasks.size();
+  size_t num_helpers = std::min(num_threads, num_tasks);
+  num_helpers = num_helpers > 0 ? num_helpers - 1 : 0;
+  if (num_helpers > 0) {
+    BufferWriterPool *writers = context->buffer_writers;
+    {
+      std::lock_guard<std::mutex> lock(writers->mutex);
+      for (size_t i = 0; i < num_helpers; ++i) {
+        writers->work.emplace_back([write]() {
+          RunParallelWriteTasks(write.get());
+        });
+      }
+    }
+    writers->work_cv.notify_all();
+  }
+
+  RunParallelWriteTasks(write.get());
+
+  std::unique_lock<std::mutex> lock(write->mutex);
+  write->done_cv.wait(lock, [&write, num_tasks]() {
+    return write->tasks_done == num_tasks;
+  });
+}
+
+void WriteBlobToBuffers(SharedMemoryContext *context, RpcContext *rpc,
+                        const Blob &blob,
+                        const std::vector<BufferID> &buffer_ids) {
+  size_t num_threads = GetParallelWriteThreads(context, blob.size,
+                                               buffer_ids.size());
+  if (num_threads > 1) {
+    WriteBlobsInParallel(context, rpc, 1, &blob, &buffer_ids, num_threads);
+  } else {
+    WriteBlobToBuffersSerially(context, rpc, blob, buffer_ids);
+  }
+}
+
+size_t LocalReadBufferById(SharedMemoryContext *context, BufferID id,
+                           Blob *blob, size_t read_offset) {
+  BufferHeader *header = GetHeaderByIndex(context, id.bits.header_index);
+  Device *device = GetDeviceFromHeader(context, header);
+  // NOTE(chogan): If the Blob was migrated while we were reading it, this
+  // buffer may have been reused by another Blob of a different size. Never
+  // read past the end of the destination. ReadBlobById detects the torn read
+  // and retries.
+  size_t space_left = read_offset < blob->size ? blob->size - read_offset : 0;
+  size_t read_size = std::min((size_t)header->used, space_left);
+
+  // TODO(chogan): Should this be a TicketMutex? It seems that at any
+  // given time, only the DataOrganizer and an application core will
+  // be trying to write to/from the same BufferID. In that case, it's
+  // first come first serve. However, if it turns out that more
+  // threads will be trying to lock the buffer, we may need to enforce
+  // ordering.
+  LockBuffer(header);
+
+  u64 start_ns = GetIoTimeNs();
+  size_t result = 0;
+  if (device->is_byte_addressable) {
+    u8 *src = GetRamBufferPtr(context, header->id);
+    memcpy((u8 *)blob->data + read_offset, src, read_size);
+    result = read_size;
+  } else {
+    int slab_index = GetSlabIndexFromHeader(context, header);
+    FILE *file = GetBufferingStream(context, device->id, slab_index);
+    if (file && read_size > 0) {
+      result = ReadAllAt(fileno(file), (u8 *)blob->data + read_offset,
+                         read_size, header->data_offset);
+      // TODO(chogan): @errorhandling
+      assert(result == read_size);
+    }
+  }
+  u64 elapsed_ns = GetIoTimeNs() - start_ns;
+  UnlockBuffer(header);
+  RecordDeviceIo(context, device->id, result, elapsed_ns);
+
+  return result;
+}
+
+size_t ReadBlobFromBuffers(SharedMemoryContext *context, RpcContext *rpc,
+                           Blob *blob, BufferIdArray *buffer_ids,
+                           u32 *buffer_sizes) {
   size_t total_bytes_read = 0;
   // TODO(chogan): @optimization Handle sequential buffers as one I/O operation
   for (u32 i = 0; i < buffer_ids->length; ++i) {
@@ -1478,7 +2854,9 @@ size_t ReadBlobFromBuffers(SharedMemoryContext *context, RpcContext *rpc,
         std::vector<u8> data =
           RpcCall<std::vector<u8>>(rpc, id.bits.node_id, "RemoteReadBufferById",
                                    id);
-        bytes_read = data.size();
+        size_t space_left = (total_bytes_read < blob->size ?
+                             blob->size - total_bytes_read : 0);
+        bytes_read = std::min(data.size(), space_left);
         // TODO(chogan): @optimization Avoid the copy
         u8 *read_dest = (u8 *)blob->data + total_bytes_read;
         memcpy(read_dest, data.data(), bytes_read);
@@ -1488,8 +2866,6 @@ size_t ReadBlobFromBuffers(SharedMemoryContext *context, RpcContext *rpc,
     }
     total_bytes_read += bytes_read;
   }
-  // TODO(chogan): @errorhandling
-  assert(total_bytes_read == blob->size);
 
   return total_bytes_read;
 }
@@ -1501,230 +2877,867 @@ size_t ReadBlobById(SharedMemoryContext *context, RpcContext *rpc, Arena *arena,
   blob.data = dest.data();
   blob.size = dest.size();
 
-  BufferIdArray buffer_ids = {};
-  if (hermes::BlobIsInSwap(blob_id)) {
-    buffer_ids = GetBufferIdsFromBlobId(arena, context, rpc, blob_id, NULL);
-    SwapBlob swap_blob = IdArrayToSwapBlob(buffer_ids);
-    result = ReadFromSwap(context, blob, swap_blob);
+  // NOTE(chogan): The BufferOrganizer may migrate the Blob while we read it,
+  // in which case the old buffers (or swap segment) are released and possibly
+  // reused. If the Blob's generation changed during the read, the data may be
+  // torn, so we read again from the new location.
+  const int kMaxReadAttempts = 8;
+  for (int attempt = 0; attempt < kMaxReadAttempts; ++attempt) {
+    u64 generation = GetBlobGeneration(context, rpc, blob_id);
+    if (hermes::BlobIsInSwap(blob_id)) {
+      BufferIdArray buffer_ids = GetBufferIdsFromBlobId(arena, context, rpc,
+                                                        blob_id, NULL);
+      SwapBlob swap_blob = IdArrayToSwapBlob(buffer_ids);
+      result = ReadFromSwap(context, blob, swap_blob);
+    } else {
+      u32 *buffer_sizes = 0;
+      BufferIdArray buffer_ids = GetBufferIdsFromBlobId(arena, context, rpc,
+                                                        blob_id,
+                                                        &buffer_sizes);
+      result = ReadBlobFromBuffers(context, rpc, &blob, &buffer_ids,
+                                   buffer_sizes);
+    }
+    // NOTE(chogan): The check for a migration also records the read with the
+    // Blob's metadata owner, so a Get doesn't need another request for it.
+    if (RecordBlobRead(context, rpc, blob_id, generation, result) ==
+        generation) {
+      break;
+    }
+  }
+  // TODO(chogan): @errorhandling
+  assert(result == blob.size);
+
+  return result;
+}
+
+u32 LocalEnqueueBlobMoves(SharedMemoryContext *context, RpcContext *rpc,
+                          const std::vector<BlobID> &blob_ids, TargetID dest,
+                          int retries, BoPriority priority) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  u32 result = 0;
+
+  u32 pending = pool->num_pending_moves.load();
+  while (blob_ids.size() > 0 && pending < pool->max_pending_moves) {
+    u32 num_claimed = std::min((u32)blob_ids.size(),
+                               pool->max_pending_moves - pending);
+    if (pool->num_pending_moves.compare_exchange_weak(pending,
+                                                      pending + num_claimed)) {
+      result = num_claimed;
+      break;
+    }
+  }
+
+  if (result) {
+    // NOTE(chogan): The BufferOrganizer decrements num_pending_moves as each
+    // move completes (see StartBufferOrganizer).
+    const char *func_name = (priority == kBoPriority_Prefetch ?
+                             kPrefetchToTarget : kMoveToTarget);
+    std::vector<BlobID> claimed(blob_ids.begin(), blob_ids.begin() + result);
+    TriggerBufferOrganizer(rpc, func_name, claimed, dest, retries);
+  }
+
+  return result;
+}
+
+/**
+ * Asks the BufferOrganizer on the node that owns @p dest to migrate each of
+ * @p blob_ids to @p dest in the background, in order. The whole batch costs a
+ * single request to the BufferOrganizer.
+ *
+ * Only as many moves are queued as fit under that BufferOrganizer's
+ * `buffer_organizer_queue_depth`, starting from the front of @p blob_ids. Only
+ * kBoPriority_Tiering and kBoPriority_Prefetch moves are supported.
+ *
+ * Returns the number of moves queued.
+ */
+u32 EnqueueBlobMoves(SharedMemoryContext *context, RpcContext *rpc,
+                     const std::vector<BlobID> &blob_ids, TargetID dest,
+                     int retries, BoPriority priority) {
+  u32 result = 0;
+  u32 target_node = dest.bits.node_id;
+
+  if (target_node == rpc->node_id) {
+    result = LocalEnqueueBlobMoves(context, rpc, blob_ids, dest, retries,
+                                   priority);
   } else {
-    u32 *buffer_sizes = 0;
-    buffer_ids = GetBufferIdsFromBlobId(arena, context, rpc, blob_id,
-                                          &buffer_sizes);
-    result = ReadBlobFromBuffers(context, rpc, &blob, &buffer_ids,
-                                 buffer_sizes);
+    result = RpcCall<u32>(rpc, target_node, "RemoteEnqueueBlobMoves", blob_ids,
+                          dest, retries, (int)priority);
   }
 
   return result;
 }
 
-int OpenSwapFile(SharedMemoryContext *context, u32 node_id) {
-  int result = 0;
+/**
+ * Like EnqueueBlobMoves, for a single Blob.
+ *
+ * Returns false without queueing anything if the BufferOrganizer already has
+ * `buffer_organizer_queue_depth` moves pending.
+ */
+bool EnqueueBlobMove(SharedMemoryContext *context, RpcContext *rpc,
+                     BlobID blob_id, TargetID dest, int retries,
+                     BoPriority priority) {
+  std::vector<BlobID> blob_ids(1, blob_id);
+  bool result = EnqueueBlobMoves(context, rpc, blob_ids, dest, retries,
+                                 priority) == 1;
+
+  return result;
+}
 
-  if (!context->swap_file) {
-    MetadataManager *mdm = GetMetadataManagerFromContext(context);
-    std::string swap_path = GetSwapFilename(mdm, node_id);
-    context->swap_file = fopen(swap_path.c_str(), "a+");
+// NOTE(chogan): The top 24 bits of a swap address are the segment index and
+// the bottom 40 bits are the offset within the segment.
+static constexpr int kSwapSegmentOffsetBits = 40;
+static constexpr u64 kSwapRecordMagic = 0x5041575353454d52;
 
-    if (!context->swap_file) {
-      // TODO(chogan): @errorhandling
-      result = 1;
+u64 MakeSwapAddress(u32 segment, u64 offset) {
+  assert(offset < (1ULL << kSwapSegmentOffsetBits));
+  u64 result = ((u64)segment << kSwapSegmentOffsetBits) | offset;
+
+  return result;
+}
+
+u32 GetSwapSegmentIndex(u64 swap_address) {
+  u32 result = (u32)(swap_address >> kSwapSegmentOffsetBits);
+
+  return result;
+}
+
+u64 GetSwapSegmentOffset(u64 swap_address) {
+  u64 result = swap_address & ((1ULL << kSwapSegmentOffsetBits) - 1);
+
+  return result;
+}
+
+/**
+ * Returns a file descriptor for a swap segment file, or -1 on failure. The
+ * caller must close it.
+ */
+static int OpenSwapSegment(SharedMemoryContext *context, u32 node_id,
+                           u32 segment, int flags) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  std::string swap_path = GetSwapFilename(mdm, node_id, segment);
+  int result = open(swap_path.c_str(), flags, S_IRUSR | S_IWUSR);
+
+  return result;
+}
+
+/**
+ * Seals @p full_segment and activates a free segment in its place, unless
+ * another writer already did.
+ *
+ * The last free segment is kept for compaction, which needs somewhere to copy
+ * live records before it can free a segment. Only the compactor may pass
+ * @p use_reserve.
+ *
+ * Returns false if there are no free segments.
+ */
+static bool RotateSwapSegment(SwapLog *log, u32 full_segment,
+                              bool use_reserve) {
+  bool result = false;
+
+  BeginTicketMutex(&log->mutex);
+  if (log->active_segment.load() != full_segment) {
+    result = true;
+  } else {
+    u32 num_free = 0;
+    u32 free_index = log->num_segments;
+    for (u32 i = 0; i < log->num_segments; ++i) {
+      SwapSegment *segment = GetSwapSegment(log, i);
+      if (segment->state.load() == kSwapSegmentState_Free) {
+        if (num_free == 0) {
+          free_index = i;
+        }
+        num_free++;
+      }
+    }
+
+    if (num_free > 1 || (num_free == 1 && use_reserve)) {
+      SwapSegment *segment = GetSwapSegment(log, free_index);
+      segment->bytes_reserved.store(0);
+      segment->bytes_used.store(0);
+      segment->live_bytes.store(0);
+      segment->state.store(kSwapSegmentState_Active);
+      GetSwapSegment(log, full_segment)->state.store(kSwapSegmentState_Sealed);
+      log->active_segment.store(free_index);
+      result = true;
     }
   }
+  EndTicketMutex(&log->mutex);
 
   return result;
 }
 
-SwapBlob WriteToSwap(SharedMemoryContext *context, Blob blob, u32 node_id,
-                     BucketID bucket_id) {
-  SwapBlob result = {};
+/**
+ * Reserves @p size bytes at the end of the active swap segment.
+ *
+ * On success, the caller must write the record and then call
+ * FinishSwapWrite. Returns false if every segment is in use (see
+ * RotateSwapSegment for @p use_reserve).
+ */
+static bool ReserveSwapSpace(SwapLog *log, u64 size, bool use_reserve,
+                             u32 *segment_index, u64 *offset) {
+  bool result = false;
+
+  for (;;) {
+    u32 index = log->active_segment.load();
+    SwapSegment *segment = GetSwapSegment(log, index);
+
+    // NOTE(chogan): Announce the write before checking the state. Compaction
+    // changes the state before checking pending_writes, so one of us always
+    // sees the other.
+    segment->pending_writes.fetch_add(1);
+    if (segment->state.load() == kSwapSegmentState_Active) {
+      u64 begin = segment->bytes_reserved.fetch_add(size);
+      // NOTE(chogan): A record larger than a segment gets a segment to itself.
+      if (begin + size <= log->segment_size || begin == 0) {
+        u64 end = begin + size;
+        u64 used = segment->bytes_used.load();
+        while (used < end &&
+               !segment->bytes_used.compare_exchange_weak(used, end)) {
+        }
+        *segment_index = index;
+        *offset = begin;
+        result = true;
+        break;
+      }
+    }
+    segment->pending_writes.fetch_sub(1);
 
-  if (OpenSwapFile(context, node_id) == 0) {
-    if (fseek(context->swap_file, 0, SEEK_END) != 0) {
-      // TODO(chogan): @errorhandling
-      HERMES_NOT_IMPLEMENTED_YET;
+    if (!RotateSwapSegment(log, index, use_reserve)) {
+      break;
     }
+  }
 
-    long int file_position = ftell(context->swap_file);
-    if (file_position == -1) {
-      // TODO(chogan): @errorhandling
-      HERMES_NOT_IMPLEMENTED_YET;
+  return result;
+}
+
+static void FinishSwapWrite(SwapLog *log, u32 segment_index, u64 data_size) {
+  SwapSegment *segment = GetSwapSegment(log, segment_index);
+  segment->live_bytes.fetch_add(data_size);
+  segment->pending_writes.fetch_sub(1);
+}
+
+/**
+ * Appends @p blob to this node's swap log. Returns false if the swap log is
+ * full or the write fails. Only compaction may write to the reserved segment.
+ */
+static bool AppendToSwap(SharedMemoryContext *context, Blob blob, u32 node_id,
+                         BucketID bucket_id, const std::string &name,
+                         bool for_compaction, SwapBlob *swap_blob) {
+  SwapLog *log = GetSwapLog(context);
+  bool result = false;
+
+  size_t data_offset = RoundUpToMultiple(sizeof(SwapRecordHeader) +
+                                         name.size(), 8);
+  SwapRecordHeader header = {};
+  header.magic = kSwapRecordMagic;
+  header.record_size = data_offset + RoundUpToMultiple(blob.size, 8);
+  header.data_size = blob.size;
+  header.bucket_id = bucket_id;
+  header.name_size = name.size();
+
+  u32 segment_index = 0;
+  u64 record_offset = 0;
+  if (ReserveSwapSpace(log, header.record_size, for_compaction, &segment_index,
+                       &record_offset)) {
+    std::vector<u8> record_prefix(data_offset, 0);
+    memcpy(record_prefix.data(), &header, sizeof(header));
+    memcpy(record_prefix.data() + sizeof(header), name.data(), name.size());
+
+    int fd = OpenSwapSegment(context, node_id, segment_index,
+                             O_RDWR | O_CREAT);
+    bool written = false;
+    if (fd != -1) {
+      written = (WriteAllAt(fd, record_prefix.data(), record_prefix.size(),
+                            record_offset) &&
+                 WriteAllAt(fd, blob.data, blob.size,
+                            record_offset + data_offset));
+      if (close(fd) != 0) {
+        written = false;
+      }
     }
-    result.offset = file_position;
 
-    if (fwrite(blob.data, 1, blob.size, context->swap_file) != blob.size) {
+    if (written) {
+      FinishSwapWrite(log, segment_index, blob.size);
+
+      swap_blob->node_id = node_id;
+      swap_blob->offset = MakeSwapAddress(segment_index,
+                                          record_offset + data_offset);
+      swap_blob->size = blob.size;
+      swap_blob->bucket_id = bucket_id;
+      result = true;
+    } else {
+      // NOTE(chogan): The reserved space holds no live data, so compaction
+      // reclaims it like any other dead record.
       // TODO(chogan): @errorhandling
-      HERMES_NOT_IMPLEMENTED_YET;
+      LOG(WARNING) << "Failed to write Blob '" << name << "' to swap: "
+                   << strerror(errno) << std::endl;
+      FinishSwapWrite(log, segment_index, 0);
     }
+  }
 
-    if (fflush(context->swap_file) != 0) {
+  return result;
+}
+
+/**
+ * Writes @p blob to the swap log and fills out @p swap_blob.
+ *
+ * Returns nonzero if every swap segment is in use or the write fails.
+ */
+Status WriteToSwap(SharedMemoryContext *context, Blob blob, u32 node_id,
+                   BucketID bucket_id, const std::string &name,
+                   SwapBlob *swap_blob) {
+  Status result = 0;
+
+  if (!AppendToSwap(context, blob, node_id, bucket_id, name, false,
+                    swap_blob)) {
+    result = 1;
+  }
+
+  return result;
+}
+
+/**
+ * Returns true if @p segment has few enough live bytes left to be compacted.
+ */
+static bool SwapSegmentNeedsCompaction(SwapLog *log, SwapSegment *segment) {
+  bool result = false;
+
+  if (segment->state.load() == kSwapSegmentState_Sealed) {
+    f32 live_fraction = ((f32)segment->live_bytes.load() /
+                         (f32)log->segment_size);
+    result = live_fraction < log->compaction_threshold;
+  }
+
+  return result;
+}
+
+static void WakeSwapCompaction(SharedMemoryContext *context, RpcContext *rpc) {
+  SwapLog *log = GetSwapLog(context);
+  bool expected = false;
+
+  if (log->compaction_requested.compare_exchange_strong(expected, true)) {
+    TriggerBufferOrganizer(rpc, kCompactSwap);
+  }
+}
+
+/**
+ * Requests a compaction if any sealed segment is below the compaction
+ * threshold. This catches segments that were already mostly garbage when they
+ * were sealed, since no further frees would wake the compactor for them.
+ */
+static void WakeSwapCompactionIfNeeded(SharedMemoryContext *context,
+                                       RpcContext *rpc) {
+  SwapLog *log = GetSwapLog(context);
+
+  for (u32 i = 0; i < log->num_segments; ++i) {
+    if (SwapSegmentNeedsCompaction(log, GetSwapSegment(log, i))) {
+      WakeSwapCompaction(context, rpc);
+      break;
+    }
+  }
+}
+
+void LocalFreeSwapSpace(SharedMemoryContext *context, RpcContext *rpc,
+                        SwapBlob swap_blob) {
+  SwapLog *log = GetSwapLog(context);
+  u32 segment_index = GetSwapSegmentIndex(swap_blob.offset);
+
+  if (segment_index < log->num_segments) {
+    SwapSegment *segment = GetSwapSegment(log, segment_index);
+    u64 live_bytes = segment->live_bytes.load();
+    u64 new_live_bytes = 0;
+    do {
+      new_live_bytes = (live_bytes > swap_blob.size ?
+                        live_bytes - swap_blob.size : 0);
+    } while (!segment->live_bytes.compare_exchange_weak(live_bytes,
+                                                        new_live_bytes));
+
+    if (SwapSegmentNeedsCompaction(log, segment)) {
+      WakeSwapCompaction(context, rpc);
+    }
+  }
+}
+
+/**
+ * Marks the space of @p swap_blob as garbage in the swap log of the node that
+ * wrote it.
+ */
+void FreeSwapSpace(SharedMemoryContext *context, RpcContext *rpc,
+                   SwapBlob swap_blob) {
+  if (swap_blob.node_id == rpc->node_id) {
+    LocalFreeSwapSpace(context, rpc, swap_blob);
+  } else {
+    RpcCall<void>(rpc, swap_blob.node_id, "RemoteFreeSwapSpace", swap_blob);
+  }
+}
+
+/**
+ * Reads the swap record at @p offset of segment @p segment_index.
+ *
+ * Fills out the size of the whole record, the name of its Blob, and the
+ * location of its data. Returns false if there's no valid record at
+ * @p offset.
+ */
+static bool ReadSwapRecord(int fd, u32 node_id, u32 segment_index, u64 offset,
+                           u64 *record_size, std::string *name,
+                           SwapBlob *swap_blob) {
+  bool result = false;
+  SwapRecordHeader header = {};
+
+  if (ReadAllAt(fd, (u8 *)&header, sizeof(header), offset) == sizeof(header) &&
+      header.magic == kSwapRecordMagic) {
+    name->assign(header.name_size, '\0');
+    if (ReadAllAt(fd, (u8 *)&(*name)[0], name->size(),
+                  offset + sizeof(header)) == name->size()) {
+      size_t data_offset = RoundUpToMultiple(sizeof(header) + name->size(), 8);
+      swap_blob->node_id = node_id;
+      swap_blob->offset = MakeSwapAddress(segment_index, offset + data_offset);
+      swap_blob->size = header.data_size;
+      swap_blob->bucket_id = header.bucket_id;
+      *record_size = header.record_size;
+      result = true;
+    }
+  }
+
+  return result;
+}
+
+/**
+ * Copies one swap record out of a segment that's being compacted, if its Blob
+ * still refers to it.
+ *
+ * Returns 0 if the record is no longer needed in the old segment.
+ */
+static int RelocateSwapRecord(SharedMemoryContext *context, RpcContext *rpc,
+                              int fd, SwapBlob old_swap_blob,
+                              const std::string &name) {
+  int result = 0;
+  BlobID blob_id = GetBlobIdByName(context, rpc, name.c_str(),
+                                   old_swap_blob.bucket_id);
+
+  if (!IsNullBlobId(blob_id) && BlobIsInSwap(blob_id)) {
+    u64 generation = GetBlobGeneration(context, rpc, blob_id);
+    std::vector<BufferID> ids = GetBufferIdList(context, rpc, blob_id);
+    SwapBlob current = VecToSwapBlob(ids);
+
+    if (generation != 0 && current.node_id == old_swap_blob.node_id &&
+        current.offset == old_swap_blob.offset) {
+      std::vector<u8> data(old_swap_blob.size);
+      Blob blob = {};
+      blob.data = data.data();
+      blob.size = data.size();
+      u64 offset = GetSwapSegmentOffset(old_swap_blob.offset);
+      SwapBlob new_swap_blob = {};
+
+      if (ReadAllAt(fd, blob.data, blob.size, offset) != blob.size) {
+        // TODO(chogan): @errorhandling
+        result = 1;
+      } else if (!AppendToSwap(context, blob, rpc->node_id,
+                               old_swap_blob.bucket_id, name, true,
+                               &new_swap_blob)) {
+        result = 1;
+      } else {
+        std::vector<BufferID> new_ids = SwapBlobToVec(new_swap_blob);
+        if (!ReplaceBufferIdList(context, rpc, blob_id, generation, new_ids)) {
+          // NOTE(chogan): The Blob was overwritten or deleted while we copied
+          // it, so the copy is garbage and the old record was already freed.
+          LocalFreeSwapSpace(context, rpc, new_swap_blob);
+        }
+      }
+    }
+  }
+
+  return result;
+}
+
+/**
+ * Moves the live records of the sealed segment @p segment_index to the active
+ * segment and returns the segment to the free pool.
+ *
+ * Returns the number of bytes reclaimed.
+ */
+static size_t CompactSwapSegment(SharedMemoryContext *context, RpcContext *rpc,
+                                 u32 segment_index) {
+  SwapLog *log = GetSwapLog(context);
+  SwapSegment *segment = GetSwapSegment(log, segment_index);
+  size_t result = 0;
+
+  u32 expected = kSwapSegmentState_Sealed;
+  if (!segment->state.compare_exchange_strong(expected,
+                                              kSwapSegmentState_Compacting)) {
+    return result;
+  }
+
+  if (segment->pending_writes.load() != 0) {
+    // NOTE(chogan): A writer is still filling its reservation. Try again on
+    // the next compaction.
+    segment->state.store(kSwapSegmentState_Sealed);
+    return result;
+  }
+
+  u64 bytes_used = segment->bytes_used.load();
+  int fd = OpenSwapSegment(context, rpc->node_id, segment_index, O_RDWR);
+  bool relocated_all = (fd != -1 || bytes_used == 0);
+
+  if (fd != -1) {
+    u64 offset = 0;
+    u64 record_size = 0;
+    std::string name;
+    SwapBlob swap_blob = {};
+    while (offset < bytes_used &&
+           ReadSwapRecord(fd, rpc->node_id, segment_index, offset,
+                          &record_size, &name, &swap_blob)) {
+      if (RelocateSwapRecord(context, rpc, fd, swap_blob, name) != 0) {
+        relocated_all = false;
+      }
+      offset += record_size;
+    }
+
+    if (relocated_all && ftruncate(fd, 0) != 0) {
+      // NOTE(chogan): Every record is garbage now, so the next compaction
+      // just retries the truncate.
       // TODO(chogan): @errorhandling
-      HERMES_NOT_IMPLEMENTED_YET;
+      LOG(WARNING) << "Failed to truncate swap segment " << segment_index
+                   << ": " << strerror(errno) << std::endl;
+      relocated_all = false;
     }
+    close(fd);
+  }
+
+  if (relocated_all) {
+    BeginTicketMutex(&log->mutex);
+    segment->bytes_reserved.store(0);
+    segment->bytes_used.store(0);
+    segment->live_bytes.store(0);
+    segment->state.store(kSwapSegmentState_Free);
+    EndTicketMutex(&log->mutex);
+    result = bytes_used;
   } else {
-    // TODO(chogan): @errorhandling
-    HERMES_NOT_IMPLEMENTED_YET;
+    segment->state.store(kSwapSegmentState_Sealed);
   }
 
-  result.node_id = node_id;
-  result.bucket_id = bucket_id;
-  result.size = blob.size;
+  return result;
+}
+
+/**
+ * Compacts every sealed swap segment whose live fraction is below
+ * `swap_compaction_threshold`. Called by the BufferOrganizer.
+ *
+ * Returns the number of bytes reclaimed.
+ */
+size_t CompactSwap(SharedMemoryContext *context, RpcContext *rpc) {
+  SwapLog *log = GetSwapLog(context);
+  size_t result = 0;
+
+  // NOTE(chogan): Clear the request first so that frees during compaction
+  // request another one.
+  log->compaction_requested.store(false);
+
+  for (u32 i = 0; i < log->num_segments; ++i) {
+    SwapSegment *segment = GetSwapSegment(log, i);
+    if (SwapSegmentNeedsCompaction(log, segment)) {
+      result += CompactSwapSegment(context, rpc, i);
+    }
+  }
+
+  return result;
+}
+
+/**
+ * Returns a swap drain entry for every record in this node's swap log.
+ *
+ * The drain queue lives in the BufferOrganizer's memory, so it doesn't
+ * survive a restart, but the swap log does (see RestoreCheckpoint). This
+ * rebuilds the queue from the log. Records that are garbage are dropped by
+ * the first drain (see RefreshSwapDrainEntry), so each Blob only needs to
+ * appear once.
+ */
+std::vector<SwapDrainEntry> GetSwapLogEntries(SharedMemoryContext *context,
+                                              u32 node_id) {
+  SwapLog *log = GetSwapLog(context);
+  std::vector<SwapDrainEntry> result;
+  std::set<std::pair<u64, std::string>> seen;
+
+  for (u32 i = 0; i < log->num_segments; ++i) {
+    SwapSegment *segment = GetSwapSegment(log, i);
+    u64 bytes_used = segment->bytes_used.load();
+    if (segment->state.load() == kSwapSegmentState_Free || bytes_used == 0) {
+      continue;
+    }
+
+    int fd = OpenSwapSegment(context, node_id, i, O_RDONLY);
+    if (fd == -1) {
+      // TODO(chogan): @errorhandling
+      LOG(WARNING) << "Couldn't open swap segment " << i << " to rebuild the "
+                   << "swap drain queue" << std::endl;
+      continue;
+    }
+
+    u64 offset = 0;
+    u64 record_size = 0;
+    SwapDrainEntry entry = {};
+    while (offset < bytes_used &&
+           ReadSwapRecord(fd, node_id, i, offset, &record_size, &entry.name,
+                          &entry.swap_blob)) {
+      if (seen.insert({entry.swap_blob.bucket_id.as_int, entry.name}).second) {
+        entry.sequence = result.size();
+        result.push_back(entry);
+      }
+      offset += record_size;
+    }
+    close(fd);
+  }
 
   return result;
 }
 
-SwapBlob PutToSwap(SharedMemoryContext *context, RpcContext *rpc,
-                   const std::string &name, BucketID bucket_id, const u8 *data,
-                   size_t size) {
+Status PutToSwap(SharedMemoryContext *context, RpcContext *rpc,
+                 const std::string &name, BucketID bucket_id, const u8 *data,
+                 size_t size, SwapBlob *swap_blob, BlobID *blob_id) {
   hermes::Blob blob = {};
   blob.data = (u8 *)data;
   blob.size = size;
 
   u32 target_node = rpc->node_id;
-  SwapBlob swap_blob =  WriteToSwap(context, blob, target_node, bucket_id);
-  std::vector<BufferID> buffer_ids = SwapBlobToVec(swap_blob);
-  AttachBlobToBucket(context, rpc, name.c_str(), bucket_id, buffer_ids, true);
+  Status result = WriteToSwap(context, blob, target_node, bucket_id, name,
+                              swap_blob);
+  // NOTE(chogan): A full log can often be reclaimed, so wake the compactor
+  // whether or not the write succeeded.
+  WakeSwapCompactionIfNeeded(context, rpc);
+
+  if (result == 0) {
+    std::vector<BufferID> buffer_ids = SwapBlobToVec(*swap_blob);
+    BlobID swap_blob_id = AttachBlobToBucket(context, rpc, name.c_str(),
+                                             bucket_id, buffer_ids, true);
+    if (blob_id) {
+      *blob_id = swap_blob_id;
+    }
+  } else {
+    // TODO(chogan): @errorhandling Every swap segment is in use or the write
+    // failed.
+    LOG(WARNING) << "Couldn't write Blob " << name << " to swap space"
+                 << std::endl;
+  }
 
-  return swap_blob;
+  return result;
 }
 
 size_t ReadFromSwap(SharedMemoryContext *context, Blob blob,
-                  SwapBlob swap_blob) {
-  u32 node_id = swap_blob.node_id;
-  if (OpenSwapFile(context, node_id) == 0) {
-    if (fseek(context->swap_file, swap_blob.offset, SEEK_SET) != 0) {
-      // TODO(chogan): @errorhandling
-      HERMES_NOT_IMPLEMENTED_YET;
-    }
-
-    if (fread(blob.data, 1, swap_blob.size, context->swap_file) !=
-        swap_blob.size) {
-      // TODO(chogan): @errorhandling
-      HERMES_NOT_IMPLEMENTED_YET;
-    }
-
+                    SwapBlob swap_blob) {
+  size_t result = 0;
+  u32 segment_index = GetSwapSegmentIndex(swap_blob.offset);
+  int fd = OpenSwapSegment(context, swap_blob.node_id, segment_index,
+                           O_RDONLY);
+
+  if (fd != -1) {
+    size_t size = std::min(blob.size, swap_blob.size);
+    result = ReadAllAt(fd, blob.data, size,
+                       GetSwapSegmentOffset(swap_blob.offset));
+    close(fd);
   } else {
     // TODO(chogan): @errorhandling
-    HERMES_NOT_IMPLEMENTED_YET;
   }
 
-  return swap_blob.size;
+  return result;
 }
 
 Status PlaceBlob(SharedMemoryContext *context, RpcContext *rpc,
                  PlacementSchema &schema, Blob blob, const std::string &name,
-                 BucketID bucket_id, int retries,
-                 bool called_from_buffer_organizer) {
+                 BucketID bucket_id, bool called_from_buffer_organizer,
+                 CapacityReservation *reservation) {
   Status result = 0;
-
-  if (ContainsBlob(context, rpc, bucket_id, name)) {
-    // TODO(chogan) @optimization If the existing buffers are already large
-    // enough to hold the new Blob, then we don't need to release them.
-    // Additionally, no metadata operations would be required.
-    DestroyBlobByName(context, rpc, bucket_id, name);
-  }
+  bool is_swap = false;
+  SwapBlob swap_blob = {};
 
   HERMES_BEGIN_TIMED_BLOCK("GetBuffers");
-  std::vector<BufferID> buffer_ids = GetBuffers(context, schema);
+  std::vector<BufferID> buffer_ids = GetBuffers(context, schema, reservation);
   HERMES_END_TIMED_BLOCK();
 
   if (buffer_ids.size()) {
     HERMES_BEGIN_TIMED_BLOCK("WriteBlobToBuffers");
     WriteBlobToBuffers(context, rpc, blob, buffer_ids);
     HERMES_END_TIMED_BLOCK();
-
-    // NOTE(chogan): Update all metadata associated with this Put
-    AttachBlobToBucket(context, rpc, name.c_str(), bucket_id, buffer_ids);
+  } else if (called_from_buffer_organizer) {
+    // TODO(chogan): @errorhandling The BufferOrganizer failed to place a blob
+    // from swap space into the hierarchy.
+    result = 1;
   } else {
-    if (called_from_buffer_organizer) {
-      // TODO(chogan): @errorhandling The BufferOrganizer failed to place a blob
-      // from swap space into the hierarchy.
-      result = 1;
+    result = WriteToSwap(context, blob, rpc->node_id, bucket_id, name,
+                         &swap_blob);
+    WakeSwapCompactionIfNeeded(context, rpc);
+    if (result == 0) {
+      buffer_ids = SwapBlobToVec(swap_blob);
+      is_swap = true;
     } else {
-      SwapBlob swap_blob = PutToSwap(context, rpc, name, bucket_id, blob.data,
-                                     blob.size);
-      TriggerBufferOrganizer(rpc, kPlaceInHierarchy, name, swap_blob, retries);
+      // TODO(chogan): @errorhandling
+      LOG(WARNING) << "Couldn't write Blob " << name << " to swap space"
+                   << std::endl;
+    }
+  }
+
+  // NOTE(chogan): An existing Blob is only replaced once the new data has a
+  // home, so a failed overwrite leaves it intact.
+  // TODO(chogan) @optimization If the existing buffers are already large
+  // enough to hold the new Blob, then we don't need to release them.
+  // Additionally, no metadata operations would be required.
+  if (result == 0 && called_from_buffer_organizer) {
+    // NOTE(chogan): The BufferOrganizer only moves data, so it doesn't count
+    // as an access, but the new BlobID keeps the old one's history.
+    BlobID existing_blob_id = GetBlobIdByName(context, rpc, name.c_str(),
+                                              bucket_id);
+    AccessStats existing_stats = {};
+    if (!IsNullBlobId(existing_blob_id)) {
+      existing_stats = GetBlobStats(context, rpc, existing_blob_id);
+      DestroyBlobByName(context, rpc, bucket_id, name);
+    }
+    BlobID blob_id = AttachBlobToBucket(context, rpc, name.c_str(), bucket_id,
+                                        buffer_ids);
+    if (!IsNullBlobId(existing_blob_id)) {
+      SetBlobStats(context, rpc, blob_id, existing_stats);
+    }
+  } else if (result == 0) {
+    // NOTE(chogan): The metadata owners replace an existing Blob, carry its
+    // statistics over, and record the write as part of the attach, so a Put
+    // doesn't need separate requests for them.
+    std::vector<std::string> names(1, name);
+    std::vector<std::vector<BufferID>> ids(1, buffer_ids);
+    std::vector<u64> sizes(1, blob.size);
+    AttachBlobsToBucket(context, rpc, names, bucket_id, ids, sizes, is_swap);
+    if (is_swap) {
+      TriggerBufferOrganizer(rpc, kPlaceInHierarchy, name, swap_blob);
     }
   }
 
+  // NOTE(chogan): Evict before the Targets fill up, so Puts keep landing in the
+  // hierarchy instead of swap.
+  for (auto [size, target_id] : schema) {
+    (void)size;
+    WakeTargetEviction(context, rpc, target_id);
+  }
+
   return result;
 }
 
-Status StdIoPersistBucket(SharedMemoryContext *context, RpcContext *rpc,
-                          Arena *arena, BucketID bucket_id,
-                          const std::string &file_name,
-                          const std::string &open_mode) {
-  Status result = 0;
-  FILE *file = fopen(file_name.c_str(), open_mode.c_str());
-
-  if (file) {
-    std::vector<BlobID> blob_ids = GetBlobIds(context, rpc, bucket_id);
-    for (size_t i = 0; i < blob_ids.size(); ++i) {
-      ScopedTemporaryMemory scratch(arena);
-      size_t blob_size = GetBlobSizeById(context, rpc, arena, blob_ids[i]);
-      // TODO(chogan): @optimization We could use the actual Hermes buffers as
-      // the write buffer rather than collecting the whole blob into memory. For
-      // now we pay the cost of data copy in order to only do one I/O call.
-      api::Blob data(blob_size);
-      size_t num_bytes = blob_size > 0 ? sizeof(data[0]) * blob_size : 0;
-      if (ReadBlobById(context, rpc, arena, data, blob_ids[i]) == blob_size) {
-        // TODO(chogan): For now we just write the blobs in the order in which
-        // they were `Put`, but once we have a Trait that represents a file
-        // mapping, we'll need pwrite and offsets.
-        if (fwrite(data.data(), 1, num_bytes, file) != num_bytes) {
-          // TODO(chogan): @errorhandling
-          result = 1;
-          break;
-        }
-      } else {
-        // TODO(chogan): @errorhandling
-        result = 1;
-        break;
-      }
+/**
+ * Writes each of @p blobs to its list of @p buffer_ids. Large batches are
+ * written by several threads (see WriteBlobsInParallel).
+ */
+static void WriteBlobsToBuffers(
+    SharedMemoryContext *context, RpcContext *rpc,
+    const std::vector<Blob> &blobs,
+    const std::vector<std::vector<BufferID>> &buffer_ids) {
+  size_t total_bytes = 0;
+  size_t total_buffers = 0;
+  for (size_t i = 0; i < blobs.size(); ++i) {
+    total_bytes += blobs[i].size;
+    total_buffers += buffer_ids[i].size();
+  }
+  size_t num_threads = GetParallelWriteThreads(context, total_bytes,
+                                               total_buffers);
+
+  if (num_threads > 1) {
+    WriteBlobsInParallel(context, rpc, blobs.size(), blobs.data(),
+                         buffer_ids.data(), num_threads);
+  } else {
+    for (size_t i = 0; i < blobs.size(); ++i) {
+      WriteBlobToBuffersSerially(context, rpc, blobs[i], buffer_ids[i]);
     }
+  }
+}
 
-    if (fclose(file) != 0) {
-      // TODO(chogan): @errorhandling
-      result = 1;
+Status PlaceBlobs(SharedMemoryContext *context, RpcContext *rpc,
+                  const std::vector<PlacementSchema> &schemas,
+                  const std::vector<Blob> &blobs,
+                  const std::vector<std::string> &names, BucketID bucket_id,
+                  CapacityReservation *reservation) {
+  Status result = 0;
+
+  // NOTE(chogan): When a name appears more than once, only its last Blob is
+  // kept, the same as if the Blobs were Put one at a time.
+  std::unordered_map<std::string, size_t> last_index;
+  for (size_t i = 0; i < names.size(); ++i) {
+    last_index[names[i]] = i;
+  }
+  std::vector<PlacementSchema> batch_schemas;
+  std::vector<Blob> batch_blobs;
+  std::vector<std::string> batch_names;
+  for (size_t i = 0; i < names.size(); ++i) {
+    if (last_index[names[i]] == i) {
+      batch_schemas.push_back(schemas[i]);
+      batch_blobs.push_back(blobs[i]);
+      batch_names.push_back(names[i]);
     }
-  } else {
-    // TODO(chogan): @errorhandling
-    result = 1;
   }
 
-  return result;
-}
+  size_t num_blobs = batch_names.size();
+  std::vector<u64> sizes(num_blobs);
+  for (size_t i = 0; i < num_blobs; ++i) {
+    sizes[i] = batch_blobs[i].size;
+  }
 
-api::Status StdIoPersistBlob(SharedMemoryContext *context, RpcContext *rpc,
-                             Arena *arena, BlobID blob_id,
-                             FILE *file , const i32 &offset) {
-  Status result = 0;
+  HERMES_BEGIN_TIMED_BLOCK("GetBatchBuffers");
+  std::vector<std::vector<BufferID>> buffer_ids =
+    GetBatchBuffers(context, batch_schemas, reservation);
+  HERMES_END_TIMED_BLOCK();
 
-  if (file) {
-    ScopedTemporaryMemory scratch(arena);
-    size_t blob_size = GetBlobSizeById(context, rpc, arena, blob_id);
-    // TODO(chogan): @optimization We could use the actual Hermes buffers as
-    // the write buffer rather than collecting the whole blob into memory. For
-    // now we pay the cost of data copy in order to only do one I/O call.
-    api::Blob data(blob_size);
-    size_t num_bytes = blob_size > 0 ? sizeof(data[0]) * blob_size : 0;
-    if (ReadBlobById(context, rpc, arena, data, blob_id) == blob_size) {
-      // TODO(chogan): For now we just write the blobs in the order in which
-      // they were `Put`, but once we have a Trait that represents a file
-      // mapping, we'll need pwrite and offsets.
-      if (offset == -1 || fseek(file, offset, SEEK_SET) == 0) {
-        if (fwrite(data.data(), 1, num_bytes, file) != num_bytes) {
-          // TODO(chogan): @errorhandling
-          result = 1;
-        }
+  // NOTE(chogan): Existing Blobs with the same names are only destroyed once
+  // the new data has a home, either in the hierarchy or in swap space.
+  if (buffer_ids.size()) {
+    HERMES_BEGIN_TIMED_BLOCK("WriteBlobsToBuffers");
+    WriteBlobsToBuffers(context, rpc, batch_blobs, buffer_ids);
+    HERMES_END_TIMED_BLOCK();
+
+    // NOTE(chogan): Update all metadata associated with this batch
+    AttachBlobsToBucket(context, rpc, batch_names, bucket_id, buffer_ids,
+                        sizes);
+  } else {
+    // NOTE(chogan): The hierarchy can't hold the whole batch, so none of it
+    // takes any capacity. The BufferOrganizer moves the Blobs out of swap as
+    // space frees up.
+    std::vector<SwapBlob> swap_blobs;
+    std::vector<std::string> swap_names;
+    std::vector<std::vector<BufferID>> swap_ids;
+    std::vector<u64> swap_sizes;
+    for (size_t i = 0; i < num_blobs; ++i) {
+      SwapBlob swap_blob = {};
+      if (WriteToSwap(context, batch_blobs[i], rpc->node_id, bucket_id,
+                      batch_names[i], &swap_blob) == 0) {
+        swap_blobs.push_back(swap_blob);
+        swap_names.push_back(batch_names[i]);
+        swap_ids.push_back(SwapBlobToVec(swap_blob));
+        swap_sizes.push_back(sizes[i]);
       } else {
-        // TODO(chogan): @errorhandling
+        // TODO(chogan): @errorhandling Every swap segment is in use.
+        LOG(WARNING) << "Swap space is full. Couldn't place Blob "
+                     << batch_names[i] << std::endl;
+        result = 1;
+      }
+    }
+    WakeSwapCompactionIfNeeded(context, rpc);
+
+    if (swap_names.size()) {
+      AttachBlobsToBucket(context, rpc, swap_names, bucket_id, swap_ids,
+                          swap_sizes, true);
+      for (size_t i = 0; i < swap_names.size(); ++i) {
+        TriggerBufferOrganizer(rpc, kPlaceInHierarchy, swap_names[i],
+                               swap_blobs[i]);
       }
     }
+  }
 
-  } else {
-    // TODO(chogan): @errorhandling
-    result = 1;
+  std::set<u64> targets;
+  for (const auto &schema : batch_schemas) {
+    for (auto [size, target_id] : schema) {
+      (void)size;
+      targets.insert(target_id.as_int);
+    }
   }
+  for (u64 target : targets) {
+    TargetID target_id = {};
+    target_id.as_int = target;
+    WakeTargetEviction(context, rpc, target_id);
+  }
+
   return result;
 }
 
@@ -71,7 +71,24 @@ struct Target {
   /** The total capacity of the Target. */
   u64 capacity;
   std::atomic<u64> remaining_space;
+  /** Bytes claimed by placements that haven't finished allocating buffers.
+   * These count as used for admission and planning (see GetBuffers). */
+  std::atomic<u64> reserved_space;
+  /** The measured bandwidth of the Target's Device in MiB/second as of the
+   * last change large enough to invalidate cached placements. Starts at the
+   * configured bandwidth. */
   std::atomic<u64> speed;
+  /** When usage including reservations exceeds this fraction of the capacity,
+   * the BufferOrganizer evicts the coldest Blobs to slower Targets. */
+  f32 high_watermark;
+  /** Eviction stops once usage falls to this fraction of the capacity. */
+  f32 low_watermark;
+  /** True while an eviction from this Target is pending on the
+   * BufferOrganizer. */
+  std::atomic<bool> eviction_requested;
+  /** `remaining_space` when this Target last advanced the BufferPool's
+   * `capacity_epoch`. */
+  std::atomic<u64> epoch_remaining_space;
 };
 
 /**
@@ -134,6 +151,37 @@ struct BufferHeader {
   std::atomic<bool> locked;
 };
 
+/**
+ * A moving estimate of the bandwidth a Device achieves under the real workload.
+ * Foreground and background I/O accumulate bytes and time into a sample, which
+ * is folded into `mbps` once it covers kBandwidthSampleBytes.
+ */
+struct BandwidthEstimate {
+  /** The estimated bandwidth in MiB/second. 0 until the first sample. */
+  std::atomic<f32> mbps;
+  /** The estimate the Target's `speed` was last updated to. Later estimates
+   * only replace it once they drift `placement_cache_threshold` away. */
+  std::atomic<f32> published_mbps;
+  std::atomic<u64> sample_bytes;
+  std::atomic<u64> sample_ns;
+};
+
+/**
+ * A token bucket that limits the rate of background I/O on a Device. It lives
+ * in shared memory so that every process on a node draws from the same budget.
+ */
+struct IoBudget {
+  /** May go negative, in which case the next background I/O waits until the
+   * debt is repaid. */
+  std::atomic<i64> tokens;
+  /** The steady clock time in microseconds of the last refill. */
+  std::atomic<u64> last_refill_us;
+  /** The refill rate. 0 means unlimited. */
+  i64 bytes_per_sec;
+  /** The most tokens that can accumulate while the Device is idle. */
+  i64 burst;
+};
+
 /**
  * Contains information about the layout of the buffers, BufferHeaders, and
  * Devices in shared memory.
@@ -194,6 +242,16 @@ struct BufferPool {
   TicketMutex ticket_mutex;
 
   std::atomic<i64> capacity_adjustments[kMaxDevices];
+  /** The number of Blob moves waiting on this node's BufferOrganizer. */
+  std::atomic<u32> num_pending_moves;
+  /** Moves are rejected while `num_pending_moves` is at this limit. */
+  u32 max_pending_moves;
+  /** The number of swap Blobs waiting for this node's BufferOrganizer to
+   * place them in the hierarchy. */
+  std::atomic<u32> num_queued_swap_blobs;
+  /** True when a swap drain has been requested but hasn't started yet. */
+  std::atomic<bool> swap_drain_requested;
+  SwapDrainOrder swap_drain_order;
 
   /** The block size for each Device. */
   i32 block_sizes[kMaxDevices];
@@ -206,6 +264,81 @@ struct BufferPool {
   i32 num_targets;
   /** The total number of BufferHeaders in the header array. */
   u32 total_headers;
+  /** The configured share of RAM for each slab, normalized to sum to 1. The
+   * defragmenter keeps the free RAM close to this distribution. */
+  f32 ram_slab_percentages[kMaxBufferPoolSlabs];
+  /** Bytes requested from each slab of each Device, assuming every request
+   * were served by the fewest, best fitting buffers. Halved after each slab
+   * adaptation so old requests fade out. */
+  std::atomic<u64> slab_demand[kMaxDevices][kMaxBufferPoolSlabs];
+  /** Background I/O budgets for each Device. */
+  IoBudget io_budgets[kMaxDevices];
+  /** Advances whenever the remaining capacity of a Target drifts more than
+   * `placement_cache_threshold` from its value at the last advance. Placements
+   * cached in an older epoch are discarded (see CalculatePlacement). */
+  std::atomic<u64> capacity_epoch;
+  f32 placement_cache_threshold;
+  /** Bytes being written to each Device right now. Placement uses this to
+   * estimate how long a new write would wait behind them. */
+  std::atomic<u64> queued_write_bytes[kMaxDevices];
+  /** Measured bandwidth of each Device. */
+  BandwidthEstimate bandwidth_estimates[kMaxDevices];
+  /** When true, GetBandwidths returns the measured bandwidths. */
+  bool use_measured_bandwidths;
+  /** Incremented by each round-robin placement on this node. The Target it
+   * starts from is this modulo the number of Targets. */
+  std::atomic<u64> round_robin_cursor;
+  /** Writes of at least this many bytes are split over several threads (see
+   * WriteBlobToBuffers). */
+  size_t parallel_write_threshold;
+  /** The most threads that write one Blob or batch of Blobs. */
+  int parallel_write_threads;
+};
+
+/**
+ * Thresholds for the BufferOrganizer's access-driven tiering. See
+ * RunTieringPolicy and the `tiering_*` configuration variables.
+ */
+struct TieringPolicy {
+  f32 high_watermark;
+  f32 low_watermark;
+  f64 promotion_frequency;
+  /** The number of bytes that may be migrated per tiering interval */
+  i64 bytes_per_interval;
+};
+
+/**
+ * Limits for the BufferOrganizer's RAM defragmentation. See DefragmentRam and
+ * the `defrag_*` configuration variables.
+ */
+struct DefragPolicy {
+  f32 threshold;
+  int max_steps;
+  int max_relocations;
+  /** See Config::slab_adaptation_rate */
+  f32 adaptation_rate;
+};
+
+/**
+ * A snapshot of one slab. See GetFragmentationStats.
+ */
+struct SlabStats {
+  u32 buffer_size;
+  u32 num_free;
+  u32 num_in_use;
+  /** The number of bytes stored in the in-use buffers */
+  u64 bytes_used;
+  /** This slab's share of the recently requested bytes */
+  f32 demand;
+};
+
+struct FragmentationStats {
+  /** The fraction of the capacity of in-use buffers that holds no data, i.e.,
+   * the space lost to rounding requests up to whole buffers. */
+  f32 internal_fragmentation;
+  /** See ComputeFragmentationScore. Only computed for RAM. */
+  f32 free_space_score;
+  std::vector<SlabStats> slabs;
 };
 
 /**
@@ -228,6 +361,9 @@ struct BufferPool {
  * BufferPool *pool = GetBufferPoolFromContext(context);
  * ```
  */
+struct PlacementCache;
+struct BufferWriterPool;
+
 struct SharedMemoryContext {
   /** A pointer to the beginning of shared memory. */
   u8 *shm_base;
@@ -241,7 +377,11 @@ struct SharedMemoryContext {
   // TODO(chogan): Move these into a FileBufferingContext
   std::vector<std::vector<std::string>> buffering_filenames;
   FILE *open_streams[kMaxDevices][kMaxBufferPoolSlabs];
-  FILE *swap_file;
+  /** Placements calculated by this process. Null if caching is disabled. */
+  PlacementCache *placement_cache;
+  /** Threads that help this process write large Blobs (see
+   * WriteBlobToBuffers). Null if writes are never split. */
+  BufferWriterPool *buffer_writers;
 };
 
 struct BufferIdArray;
@@ -315,6 +455,33 @@ void ReleaseSharedMemoryContext(SharedMemoryContext *context);
  */
 void UnmapSharedMemory(SharedMemoryContext *context);
 
+/**
+ * Target capacity that a placement holds from the time it's planned until its
+ * buffers are claimed, so that concurrent placements plan around it.
+ */
+struct CapacityReservation {
+  /** The bytes held on each Device. */
+  u64 bytes[kMaxDevices];
+};
+
+/**
+ * Reserves the capacity every schema in @p schemas needs and adds it to
+ * @p reservation. All or none.
+ *
+ * @return false if some Target doesn't have room, in which case nothing is
+ * reserved.
+ */
+bool ReserveCapacity(SharedMemoryContext *context,
+                     const std::vector<PlacementSchema> &schemas,
+                     CapacityReservation *reservation);
+/**
+ * Drops whatever is left of @p reservation. GetBuffers and GetBatchBuffers
+ * release the part they use, so this only returns the part for placements
+ * that never claimed buffers.
+ */
+void ReleaseCapacity(SharedMemoryContext *context,
+                     CapacityReservation *reservation);
+
 /**
  * Returns a vector of BufferIDs that satisfy the constrains of @p schema.
  *
@@ -325,12 +492,28 @@ void UnmapSharedMemory(SharedMemoryContext *context);
  *
  * @param context The shared memory context for the BufferPool.
  * @param schema A description of the amount and Device of storage requested.
+ * @param reservation The capacity reserved when @p schema was planned, if any.
+ * The part of it that covers @p schema is used up either way.
  *
  * @return A vector of BufferIDs that can be used for storage, and that satisfy
  * @p schema, or an empty vector if the request could not be fulfilled.
  */
 std::vector<BufferID> GetBuffers(SharedMemoryContext *context,
-                                 const PlacementSchema &schema);
+                                 const PlacementSchema &schema,
+                                 CapacityReservation *reservation = NULL);
+/**
+ * Like GetBuffers, but for every schema in @p schemas at once.
+ *
+ * The capacity for the whole batch is reserved before any buffers are taken.
+ * If any schema can't be fulfilled, the buffers already taken for the others
+ * are released and an empty list is returned.
+ *
+ * @return One list of BufferIDs for each of @p schemas, or an empty list.
+ */
+std::vector<std::vector<BufferID>>
+GetBatchBuffers(SharedMemoryContext *context,
+                const std::vector<PlacementSchema> &schemas,
+                CapacityReservation *reservation = NULL);
 /**
  * Returns buffer_ids to the BufferPool free lists so that they can be used
  * again. Data in the buffers is considered abandonded, and can be overwritten.
@@ -387,6 +570,87 @@ struct SwapBlob {
   BucketID bucket_id;
 };
 
+enum SwapSegmentState {
+  kSwapSegmentState_Free,
+  /** New records are appended to the (single) active segment. */
+  kSwapSegmentState_Active,
+  /** The segment is full. Its records are only freed or compacted. */
+  kSwapSegmentState_Sealed,
+  kSwapSegmentState_Compacting,
+};
+
+/**
+ * One fixed-size file of a node's swap log.
+ */
+struct SwapSegment {
+  /** The number of bytes handed out so far. This goes past the segment size
+   * when a reservation fails, which is what seals the segment. */
+  std::atomic<u64> bytes_reserved;
+  /** The end of the last successful reservation. Records are only found
+   * below this offset. */
+  std::atomic<u64> bytes_used;
+  /** The number of Blob bytes in this segment that are still referenced by
+   * a swap Blob. */
+  std::atomic<u64> live_bytes;
+  /** The number of writers that have reserved space in this segment but
+   * haven't finished writing it. */
+  std::atomic<u32> pending_writes;
+  /** A SwapSegmentState. */
+  std::atomic<u32> state;
+};
+
+/**
+ * Swap space is a log of fixed-size segment files per node.
+ *
+ * Writers reserve space in the active segment with an atomic add and write
+ * their record with `pwrite`, so concurrent writers don't serialize on a
+ * lock. When a reservation doesn't fit, the active segment is sealed and the
+ * next free segment takes its place. Freeing a swap Blob only decrements its
+ * segment's `live_bytes`. Sealed segments that fall below the compaction
+ * threshold are compacted by the BufferOrganizer (see CompactSwap).
+ *
+ * A SwapBlob's offset encodes both the segment index and the offset within
+ * the segment (see MakeSwapAddress).
+ */
+struct SwapLog {
+  /** Protects segment state transitions (rotation and reclamation). */
+  TicketMutex mutex;
+  std::atomic<u32> active_segment;
+  /** True when a compaction has been requested but hasn't started yet. */
+  std::atomic<bool> compaction_requested;
+  u32 num_segments;
+  u64 segment_size;
+  f32 compaction_threshold;
+  /** The offset from the SwapLog to its array of `num_segments`
+   * SwapSegments. */
+  ptrdiff_t segments_offset;
+};
+
+/**
+ * The header written in front of every Blob in the swap log. It's followed by
+ * the Blob's name, then its data, so that compaction can find the owner of
+ * each record without an index.
+ */
+struct SwapRecordHeader {
+  u64 magic;
+  /** The size of the whole record, including this header and padding. */
+  u64 record_size;
+  u64 data_size;
+  BucketID bucket_id;
+  u32 name_size;
+  u32 padding;
+};
+
+/**
+ * A swap Blob waiting to be placed in the hierarchy by the BufferOrganizer.
+ */
+struct SwapDrainEntry {
+  SwapBlob swap_blob;
+  std::string name;
+  /** Increases with each queued entry, so lower is older. */
+  u64 sequence;
+};
+
 // TODO(chogan): @metaprogramming Generate this
 enum SwapBlobMembers {
   SwapBlobMembers_NodeId,
@@ -404,6 +668,10 @@ enum SwapBlobMembers {
  * call whether it is writing locally, remotely, to RAM (or a byte addressable
  * Device) or to a file (block addressable Device).
  *
+ * Blobs of at least `parallel_write_threshold` bytes are written by up to
+ * `parallel_write_threads` threads: one per file-backed Device, with the rest
+ * copying RAM buffers.
+ *
  * @param context The shared memory context needed to access BufferPool info.
  * @param blob The data to write.
  * @param buffer_ids The collection of BufferIDs that should buffer the blob.
@@ -412,6 +680,18 @@ void WriteBlobToBuffers(SharedMemoryContext *context, RpcContext *rpc,
                         const Blob &blob,
                         const std::vector<BufferID> &buffer_ids);
 
+/**
+ * Starts the threads that help WriteBlobToBuffers split large writes. The
+ * calling thread is one of the @p num_threads writers, so this returns null if
+ * @p num_threads is 1 or less.
+ */
+BufferWriterPool *StartBufferWriterPool(int num_threads);
+
+/**
+ * Finishes the queued work of @p pool, joins its threads, and frees it.
+ */
+void StopBufferWriterPool(BufferWriterPool *pool);
+
 /**
  * Sketch of how an I/O client might read.
  *
@@ -432,6 +712,10 @@ size_t ReadBlobFromBuffers(SharedMemoryContext *context, RpcContext *rpc,
                            Blob *blob, BufferIdArray *buffer_ids,
                            u32 *buffer_sizes);
 
+/**
+ * Reads Blob @p blob_id into @p dest and records the read in the Blob's access
+ * statistics. Retries if the Blob is migrated during the read.
+ */
 size_t ReadBlobById(SharedMemoryContext *context, RpcContext *rpc, Arena *arena,
                     api::Blob &dest, BlobID blob_id);
 
@@ -440,32 +724,40 @@ size_t LocalWriteBufferById(SharedMemoryContext *context, BufferID id,
 size_t LocalReadBufferById(SharedMemoryContext *context, BufferID id,
                            Blob *blob, size_t offset);
 
-SwapBlob PutToSwap(SharedMemoryContext *context, RpcContext *rpc,
-                   const std::string &name, BucketID bucket_id, const u8 *data,
-                   size_t size);
+api::Status PutToSwap(SharedMemoryContext *context, RpcContext *rpc,
+                      const std::string &name, BucketID bucket_id,
+                      const u8 *data, size_t size, SwapBlob *swap_blob,
+                      BlobID *blob_id = NULL);
 
 template<typename T>
-std::vector<SwapBlob> PutToSwap(SharedMemoryContext *context, RpcContext *rpc,
-                                BucketID id,
-                                std::vector<std::vector<T>> &blobs,
-                                std::vector<std::string> &names) {
+api::Status PutToSwap(SharedMemoryContext *context, RpcContext *rpc,
+                      BucketID id, std::vector<std::vector<T>> &blobs,
+                      std::vector<std::string> &names,
+                      std::vector<SwapBlob> *swap_blobs) {
   size_t num_blobs = blobs.size();
-  std::vector<SwapBlob> result(num_blobs);
+  api::Status result = 0;
 
+  swap_blobs->resize(num_blobs);
   for (size_t i = 0; i < num_blobs; ++i) {
-    SwapBlob swap_blob = PutToSwap(context, rpc, names[i], id,
-                                   (const u8*)blobs[i].data(),
-                                   blobs[i].size() * sizeof(T));
-    result.push_back(swap_blob);
+    if (PutToSwap(context, rpc, names[i], id, (const u8*)blobs[i].data(),
+                  blobs[i].size() * sizeof(T), &(*swap_blobs)[i]) != 0) {
+      result = 1;
+    }
   }
 
   return result;
 }
 
-SwapBlob WriteToSwap(SharedMemoryContext *context, Blob blob, BlobID blob_id,
-                     BucketID bucket_id);
+api::Status WriteToSwap(SharedMemoryContext *context, Blob blob,
+                        u32 node_id, BucketID bucket_id,
+                        const std::string &name, SwapBlob *swap_blob);
 size_t ReadFromSwap(SharedMemoryContext *context, Blob blob,
                     SwapBlob swap_blob);
+void FreeSwapSpace(SharedMemoryContext *context, RpcContext *rpc,
+                   SwapBlob swap_blob);
+size_t CompactSwap(SharedMemoryContext *context, RpcContext *rpc);
+std::vector<SwapDrainEntry> GetSwapLogEntries(SharedMemoryContext *context,
+                                              u32 node_id);
 
 /**
  * Returns a vector of bandwidths in MiB per second.
@@ -475,26 +767,80 @@ size_t ReadFromSwap(SharedMemoryContext *context, Blob blob,
  *
  * @param context The shared memory context needed to access BufferPool info.
  *
+ * If `use_measured_bandwidths` is set in the Config, a Device's measured
+ * bandwidth is returned once it has one.
+ *
  * @return The list of bandwidths, one for each Device, in MiB/sec.
  */
 std::vector<f32> GetBandwidths(SharedMemoryContext *context);
 
+/**
+ * Adds an I/O of @p bytes that took @p ns nanoseconds to the bandwidth estimate
+ * of a Device.
+ */
+void RecordDeviceIo(SharedMemoryContext *context, DeviceID device_id,
+                    u64 bytes, u64 ns);
+
+/**
+ * Times a write of @p size bytes to each Device and uses the result as the
+ * Device's initial measured bandwidth. File-backed Devices are written with
+ * O_DIRECT where possible and synced before the timer stops.
+ */
+void CalibrateDeviceBandwidths(SharedMemoryContext *context, size_t size);
+
 u32 GetBufferSize(SharedMemoryContext *context, RpcContext *rpc, BufferID id);
+DeviceID GetBufferDeviceId(SharedMemoryContext *context, RpcContext *rpc,
+                           BufferID id);
 bool BufferIsByteAddressable(SharedMemoryContext *context, BufferID id);
 int PlaceInHierarchy(SharedMemoryContext *context, RpcContext *rpc,
                      SwapBlob swap_blob, const std::string &blob_name);
+int MoveToTarget(SharedMemoryContext *context, RpcContext *rpc, BlobID blob_id,
+                 TargetID dest, BoPriority priority = kBoPriority_Foreground);
+size_t DrainSwap(SharedMemoryContext *context, RpcContext *rpc,
+                 std::vector<SwapDrainEntry> &entries);
+void WakeSwapDrain(SharedMemoryContext *context, RpcContext *rpc);
+bool EnqueueBlobMove(SharedMemoryContext *context, RpcContext *rpc,
+                     BlobID blob_id, TargetID dest, int retries,
+                     BoPriority priority = kBoPriority_Tiering);
+u32 EnqueueBlobMoves(SharedMemoryContext *context, RpcContext *rpc,
+                     const std::vector<BlobID> &blob_ids, TargetID dest,
+                     int retries, BoPriority priority = kBoPriority_Tiering);
+i64 RunTieringPolicy(SharedMemoryContext *context, RpcContext *rpc,
+                     const TieringPolicy &policy, i64 *budget, u32 *cursor);
+void WakeTargetEviction(SharedMemoryContext *context, RpcContext *rpc,
+                        TargetID target_id);
+u64 EvictFromTarget(SharedMemoryContext *context, RpcContext *rpc,
+                    TargetID target_id);
+f64 ChargeIoBudget(SharedMemoryContext *context, DeviceID device_id,
+                   u64 bytes, BoPriority priority);
+f32 ComputeFragmentationScore(SharedMemoryContext *context);
+int DefragmentRam(SharedMemoryContext *context, const DefragPolicy &policy);
+bool AdaptRamSlabPercentages(SharedMemoryContext *context, f32 rate);
+FragmentationStats GetFragmentationStats(SharedMemoryContext *context,
+                                         DeviceID device_id);
 api::Status PlaceBlob(SharedMemoryContext *context, RpcContext *rpc,
                       PlacementSchema &schema, Blob blob,
-                      const std::string &name, BucketID bucket_id, int retries,
-                      bool called_from_buffer_organizer = false);
-api::Status StdIoPersistBucket(SharedMemoryContext *context, RpcContext *rpc,
-                               Arena *arena, BucketID bucket_id,
-                               const std::string &file_name,
-                               const std::string &open_mode);
-
-api::Status StdIoPersistBlob(SharedMemoryContext *context, RpcContext *rpc,
-                             Arena *arena, BlobID blob_id,
-                             FILE* file, const i32 &offset);
+                      const std::string &name, BucketID bucket_id,
+                      bool called_from_buffer_organizer = false,
+                      CapacityReservation *reservation = NULL);
+/**
+ * Places a batch of Blobs, each with its own schema, as one unit.
+ *
+ * The buffers for the whole batch are taken with GetBatchBuffers, so either
+ * every Blob lands in the hierarchy or none of them take any capacity and they
+ * all go to swap space. The Blobs are written in parallel, and their metadata
+ * is committed with one update per owning node (see AttachBlobsToBucket).
+ * Existing Blobs with the same names are replaced in that same update, so they
+ * survive if the batch can't be placed at all.
+ * @p reservation is the capacity reserved when @p schemas were planned, if
+ * any (see CalculatePlacement).
+ */
+api::Status PlaceBlobs(SharedMemoryContext *context, RpcContext *rpc,
+                       const std::vector<PlacementSchema> &schemas,
+                       const std::vector<Blob> &blobs,
+                       const std::vector<std::string> &names,
+                       BucketID bucket_id,
+                       CapacityReservation *reservation = NULL);
 
 }  // namespace hermes
 
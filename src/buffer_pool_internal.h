@@ -157,6 +157,13 @@ void MergeRamBufferFreeList(SharedMemoryContext *context, int slab_index);
 BufferID PeekFirstFreeBufferId(SharedMemoryContext *context, DeviceID device_id,
                                int slab_index);
 
+/**
+ * Removes the first buffer from the free list of @p slab_index and marks it in
+ * use. Returns a null BufferID if the slab is empty.
+ */
+BufferID GetFreeBuffer(SharedMemoryContext *context, DeviceID device_id,
+                       int slab_index);
+
 /**
  *
  */
@@ -177,6 +184,10 @@ i32 GetSlabUnitSize(SharedMemoryContext *context, DeviceID device_id,
  *
  */
 u32 LocalGetBufferSize(SharedMemoryContext *context, BufferID id);
+DeviceID LocalGetBufferDeviceId(SharedMemoryContext *context, BufferID id);
+u32 LocalEnqueueBlobMoves(SharedMemoryContext *context, RpcContext *rpc,
+                          const std::vector<BlobID> &blob_ids, TargetID dest,
+                          int retries, BoPriority priority);
 /**
  *
  */
@@ -213,6 +224,48 @@ Target *GetTarget(SharedMemoryContext *context, int index);
  */
 Target *GetTargetFromId(SharedMemoryContext *context, TargetID id);
 
+/**
+ * Spins until the calling thread holds @p header's lock.
+ */
+void LockBuffer(BufferHeader *header);
+/**
+ * Takes @p header's lock if it's free. Returns false without waiting otherwise.
+ */
+bool TryLockBuffer(BufferHeader *header);
+void UnlockBuffer(BufferHeader *header);
+
+/**
+ *
+ */
+Device *GetDeviceFromHeader(SharedMemoryContext *context, BufferHeader *header);
+
+/**
+ * Returns the slab that @p header's capacity belongs to on its Device.
+ */
+int GetSlabIndexFromHeader(SharedMemoryContext *context, BufferHeader *header);
+
+/**
+ * Returns true if @p buffer_id lives on a different node than @p rpc.
+ */
+bool BufferIsRemote(RpcContext *rpc, BufferID buffer_id);
+
+/**
+ * Returns the swap log of the node that owns @p context.
+ */
+SwapLog *GetSwapLog(SharedMemoryContext *context);
+SwapSegment *GetSwapSegment(SwapLog *log, u32 index);
+
+/**
+ * Encodes a segment index and an offset within that segment as a SwapBlob
+ * offset.
+ */
+u64 MakeSwapAddress(u32 segment, u64 offset);
+u32 GetSwapSegmentIndex(u64 swap_address);
+u64 GetSwapSegmentOffset(u64 swap_address);
+
+void LocalFreeSwapSpace(SharedMemoryContext *context, RpcContext *rpc,
+                        SwapBlob swap_blob);
+
 /**
  *
  */
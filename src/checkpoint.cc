@@ -0,0 +1,288 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "checkpoint.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "rpc.h"
+
+namespace hermes {
+
+static void HashBytes(u64 *hash, const void *data, size_t size) {
+  // NOTE(chogan): 64 bit FNV-1a
+  const u8 *bytes = (const u8 *)data;
+  for (size_t i = 0; i < size; ++i) {
+    *hash ^= bytes[i];
+    *hash *= 0x100000001B3;
+  }
+}
+
+template<typename T>
+static void HashValue(u64 *hash, const T &val) {
+  HashBytes(hash, &val, sizeof(T));
+}
+
+static void HashStringValue(u64 *hash, const std::string &str) {
+  HashValue(hash, str.size());
+  HashBytes(hash, str.data(), str.size());
+}
+
+u64 ComputeConfigFingerprint(Config *config, u32 num_nodes) {
+  u64 result = 0xCBF29CE484222325;
+
+  HashValue(&result, kCheckpointVersion);
+  HashValue(&result, num_nodes);
+  HashValue(&result, config->num_devices);
+  HashValue(&result, config->num_targets);
+
+  for (int dev = 0; dev < config->num_devices; ++dev) {
+    HashValue(&result, config->capacities[dev]);
+    HashValue(&result, config->block_sizes[dev]);
+    HashValue(&result, config->num_slabs[dev]);
+    for (int slab = 0; slab < config->num_slabs[dev]; ++slab) {
+      HashValue(&result, config->slab_unit_sizes[dev][slab]);
+      HashValue(&result, config->desired_slab_percentages[dev][slab]);
+    }
+    HashValue(&result, config->bandwidths[dev]);
+    HashValue(&result, config->latencies[dev]);
+    HashStringValue(&result, config->mount_points[dev]);
+  }
+
+  for (int i = 0; i < kArenaType_Count; ++i) {
+    HashValue(&result, config->arena_percentages[i]);
+  }
+
+  HashValue(&result, config->max_buckets_per_node);
+  HashValue(&result, config->max_vbuckets_per_node);
+  HashValue(&result, config->system_view_state_update_interval_ms);
+  HashStringValue(&result, config->swap_mount);
+  // NOTE(chogan): Swap addresses depend on the segment size, and the swap log
+  // on disk outlives the daemon.
+  HashValue(&result, config->swap_segment_size);
+  HashValue(&result, config->swap_max_segments);
+  HashStringValue(&result, config->checkpoint_mount);
+
+  return result;
+}
+
+void InitCheckpoint(MetadataManager *mdm, Arena *arena, Config *config,
+                    u32 num_nodes, u64 checkpoint_size) {
+  mdm->config_fingerprint = ComputeConfigFingerprint(config, num_nodes);
+  mdm->checkpoint_size = checkpoint_size;
+  mdm->checkpoint_filename_offset = 0;
+
+  size_t mount_length = config->checkpoint_mount.size();
+  if (mount_length > 0) {
+    bool ends_in_slash = config->checkpoint_mount[mount_length - 1] == '/';
+    std::string prefix = (config->checkpoint_mount + (ends_in_slash ? "" : "/")
+                          + "checkpoint");
+    char *prefix_memory = PushArray<char>(arena, prefix.size() + 1);
+    memcpy(prefix_memory, prefix.c_str(), prefix.size());
+    prefix_memory[prefix.size()] = '\0';
+    mdm->checkpoint_filename_offset = GetOffsetFromMdm(mdm, prefix_memory);
+  }
+}
+
+bool CheckpointIsEnabled(MetadataManager *mdm) {
+  bool result = mdm->checkpoint_filename_offset != 0;
+
+  return result;
+}
+
+std::string GetCheckpointFilename(MetadataManager *mdm, u32 node_id) {
+  char *prefix = (char *)((u8 *)mdm + mdm->checkpoint_filename_offset);
+  std::string result = prefix + std::to_string(node_id) + ".hermes";
+
+  return result;
+}
+
+bool WriteCheckpoint(SharedMemoryContext *context, u32 node_id) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  if (!CheckpointIsEnabled(mdm)) {
+    return false;
+  }
+
+  bool result = false;
+  std::string filename = GetCheckpointFilename(mdm, node_id);
+  // NOTE(chogan): Write to a temporary file and rename it so that a partially
+  // written checkpoint is never restored.
+  std::string tmp_filename = filename + ".tmp";
+
+  CheckpointHeader header = {};
+  header.magic = kCheckpointMagic;
+  header.version = kCheckpointVersion;
+  header.node_id = node_id;
+  header.config_fingerprint = mdm->config_fingerprint;
+  header.size = mdm->checkpoint_size;
+  header.buffer_pool_offset = context->buffer_pool_offset;
+  header.metadata_manager_offset = context->metadata_manager_offset;
+  header.rpc_state_offset = mdm->rpc_state_offset;
+
+  FILE *file = fopen(tmp_filename.c_str(), "w");
+  if (file) {
+    bool wrote_all =
+      (fwrite(&header, sizeof(header), 1, file) == 1 &&
+       fwrite(context->shm_base, header.size, 1, file) == 1 &&
+       fflush(file) == 0 &&
+       fsync(fileno(file)) == 0);
+
+    if (fclose(file) != 0) {
+      wrote_all = false;
+    }
+
+    if (wrote_all && rename(tmp_filename.c_str(), filename.c_str()) == 0) {
+      result = true;
+      LOG(INFO) << "Wrote metadata checkpoint " << filename << " ("
+                << header.size << " bytes)" << std::endl;
+    } else {
+      // TODO(chogan): @errorhandling
+      LOG(WARNING) << "Failed to write metadata checkpoint " << filename
+                   << ": " << strerror(errno) << std::endl;
+      unlink(tmp_filename.c_str());
+    }
+  } else {
+    // TODO(chogan): @errorhandling
+    LOG(WARNING) << "Failed to open metadata checkpoint " << tmp_filename
+                 << ": " << strerror(errno) << std::endl;
+  }
+
+  return result;
+}
+
+static bool CheckpointHeaderIsValid(const CheckpointHeader *header,
+                                    SharedMemoryContext *context,
+                                    MetadataManager *mdm, u32 node_id) {
+  bool result = false;
+
+  if (header->magic != kCheckpointMagic ||
+      header->version != kCheckpointVersion) {
+    LOG(WARNING) << "Unrecognized checkpoint format" << std::endl;
+  } else if (header->node_id != node_id) {
+    LOG(WARNING) << "Checkpoint was written by node " << header->node_id
+                 << std::endl;
+  } else if (header->config_fingerprint != mdm->config_fingerprint) {
+    LOG(WARNING) << "Checkpoint was written with a different configuration"
+                 << std::endl;
+  } else if (header->size != mdm->checkpoint_size ||
+             header->buffer_pool_offset != context->buffer_pool_offset ||
+             header->metadata_manager_offset !=
+             context->metadata_manager_offset ||
+             header->rpc_state_offset != mdm->rpc_state_offset) {
+    LOG(WARNING) << "Checkpoint shared memory layout does not match"
+                 << std::endl;
+  } else {
+    result = true;
+  }
+
+  return result;
+}
+
+bool RestoreCheckpoint(SharedMemoryContext *context, RpcContext *rpc) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  if (!CheckpointIsEnabled(mdm)) {
+    return false;
+  }
+
+  bool result = false;
+  std::string filename = GetCheckpointFilename(mdm, rpc->node_id);
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1) {
+    // NOTE(chogan): No checkpoint, so this is a cold start
+    return result;
+  }
+
+  struct stat st = {};
+  size_t expected_size = sizeof(CheckpointHeader) + mdm->checkpoint_size;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size == expected_size) {
+    u8 *checkpoint = (u8 *)mmap(0, expected_size, PROT_READ, MAP_PRIVATE, fd,
+                                0);
+    if (checkpoint != MAP_FAILED) {
+      CheckpointHeader *header = (CheckpointHeader *)checkpoint;
+      if (CheckpointHeaderIsValid(header, context, mdm, rpc->node_id)) {
+        // NOTE(chogan): The RPC state and the Heap error handlers belong to
+        // this process, so keep the freshly initialized values.
+        std::vector<u8> rpc_state((u8 *)rpc->state,
+                                  (u8 *)rpc->state + rpc->state_size);
+        ArenaErrorFunc *map_heap_error_handler =
+          GetMapHeap(mdm)->error_handler;
+        ArenaErrorFunc *id_heap_error_handler = GetIdHeap(mdm)->error_handler;
+        BufferPool *pool = GetBufferPoolFromContext(context);
+        u32 max_pending_moves = pool->max_pending_moves;
+        SwapDrainOrder swap_drain_order = pool->swap_drain_order;
+        f32 placement_cache_threshold = pool->placement_cache_threshold;
+        bool use_measured_bandwidths = pool->use_measured_bandwidths;
+        size_t parallel_write_threshold = pool->parallel_write_threshold;
+        int parallel_write_threads = pool->parallel_write_threads;
+        f32 swap_compaction_threshold =
+          GetSwapLog(context)->compaction_threshold;
+
+        memcpy(context->shm_base, checkpoint + sizeof(CheckpointHeader),
+               header->size);
+
+        memcpy(rpc->state, rpc_state.data(), rpc->state_size);
+        GetMapHeap(mdm)->error_handler = map_heap_error_handler;
+        GetIdHeap(mdm)->error_handler = id_heap_error_handler;
+        // NOTE(chogan): Queued Blob moves don't survive a restart. The swap
+        // drain queue is rebuilt from the swap log when the BufferOrganizer
+        // starts (see GetSwapLogEntries).
+        pool->num_pending_moves = 0;
+        pool->num_queued_swap_blobs = 0;
+        pool->swap_drain_requested = false;
+        pool->max_pending_moves = max_pending_moves;
+        pool->swap_drain_order = swap_drain_order;
+        pool->placement_cache_threshold = placement_cache_threshold;
+        pool->use_measured_bandwidths = use_measured_bandwidths;
+        pool->parallel_write_threshold = parallel_write_threshold;
+        pool->parallel_write_threads = parallel_write_threads;
+
+        // NOTE(chogan): The swap segment files are still on disk, so the swap
+        // log is restored, minus any in-flight writes or compactions.
+        SwapLog *swap_log = GetSwapLog(context);
+        swap_log->compaction_threshold = swap_compaction_threshold;
+        swap_log->compaction_requested = false;
+        for (u32 i = 0; i < swap_log->num_segments; ++i) {
+          SwapSegment *segment = GetSwapSegment(swap_log, i);
+          segment->pending_writes = 0;
+          if (segment->state == kSwapSegmentState_Compacting) {
+            segment->state = kSwapSegmentState_Sealed;
+          }
+        }
+
+        result = true;
+        LOG(INFO) << "Restored metadata checkpoint " << filename << std::endl;
+      }
+      munmap(checkpoint, expected_size);
+    } else {
+      // TODO(chogan): @errorhandling
+      LOG(WARNING) << "Failed to map metadata checkpoint " << filename << ": "
+                   << strerror(errno) << std::endl;
+    }
+  } else {
+    LOG(WARNING) << "Ignoring metadata checkpoint " << filename
+                 << " with unexpected size" << std::endl;
+  }
+  close(fd);
+
+  if (result) {
+    unlink(filename.c_str());
+  }
+
+  return result;
+}
+
+}  // namespace hermes
@@ -0,0 +1,101 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef HERMES_CHECKPOINT_H_
+#define HERMES_CHECKPOINT_H_
+
+#include <string>
+
+#include "hermes_types.h"
+#include "buffer_pool.h"
+#include "memory_management.h"
+#include "metadata_management.h"
+
+/**
+ * @file checkpoint.h
+ *
+ * Saves the BufferPool and MetadataManager shared memory of a node to a file
+ * when Hermes shuts down, so that a restarted daemon can resume with all its
+ * Buckets and Blobs instead of restaging the data. Everything in shared memory
+ * is stored as offsets, so the checkpoint is a byte copy of the BufferPool and
+ * MetaData Arenas preceded by a CheckpointHeader.
+ */
+
+namespace hermes {
+
+/** "HRMSCKPT" */
+const u64 kCheckpointMagic = 0x48524D53434B5054;
+/** Bump whenever the layout of anything stored in shared memory changes. */
+const u32 kCheckpointVersion = 17;
+
+struct CheckpointHeader {
+  u64 magic;
+  u32 version;
+  u32 node_id;
+  /** Must match the running Config (see ComputeConfigFingerprint) */
+  u64 config_fingerprint;
+  /** The number of bytes of shared memory following this header */
+  u64 size;
+  ptrdiff_t buffer_pool_offset;
+  ptrdiff_t metadata_manager_offset;
+  ptrdiff_t rpc_state_offset;
+};
+
+struct RpcContext;
+
+/**
+ * Hashes every Config value that affects the layout of shared memory or the
+ * location of buffered data. A checkpoint is only restored if this matches.
+ */
+u64 ComputeConfigFingerprint(Config *config, u32 num_nodes);
+
+/**
+ * Stores the checkpoint file name and Config fingerprint in the
+ * MetadataManager. Checkpointing is disabled if `config->checkpoint_mount` is
+ * empty.
+ */
+void InitCheckpoint(MetadataManager *mdm, Arena *arena, Config *config,
+                    u32 num_nodes, u64 checkpoint_size);
+
+/**
+ *
+ */
+bool CheckpointIsEnabled(MetadataManager *mdm);
+
+/**
+ *
+ */
+std::string GetCheckpointFilename(MetadataManager *mdm, u32 node_id);
+
+/**
+ * Writes this node's shared memory to the checkpoint file. Must only be called
+ * when no other process is modifying shared memory (i.e., after the RPC servers
+ * have shut down).
+ *
+ * @return true if a checkpoint was written.
+ */
+bool WriteCheckpoint(SharedMemoryContext *context, u32 node_id);
+
+/**
+ * Replaces freshly initialized shared memory with the contents of this node's
+ * checkpoint, if one exists and was created with the same Config. The RPC state
+ * and Heap error handlers from the fresh initialization are kept. The
+ * checkpoint is removed after it is restored, so a crash of the restarted
+ * daemon results in a cold start rather than stale metadata.
+ *
+ * @return true if the checkpoint was restored.
+ */
+bool RestoreCheckpoint(SharedMemoryContext *context, RpcContext *rpc);
+
+}  // namespace hermes
+
+#endif  // HERMES_CHECKPOINT_H_
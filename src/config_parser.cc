@@ -80,6 +80,34 @@ enum ConfigVariable {
   ConfigVariable_BufferOrganizerPort,
   ConfigVariable_RpcHostNumberRange,
   ConfigVariable_RpcNumThreads,
+  ConfigVariable_CheckpointMount,
+  ConfigVariable_BufferOrganizerQueueDepth,
+  ConfigVariable_TieringIntervalMs,
+  ConfigVariable_TieringHighWatermark,
+  ConfigVariable_TieringLowWatermark,
+  ConfigVariable_TieringPromotionFrequency,
+  ConfigVariable_TieringMaxMbps,
+  ConfigVariable_SwapDrainOrder,
+  ConfigVariable_SwapSegmentSizeMb,
+  ConfigVariable_SwapMaxSegments,
+  ConfigVariable_SwapCompactionThreshold,
+  ConfigVariable_WriteBackThreads,
+  ConfigVariable_DefragIntervalMs,
+  ConfigVariable_DefragThreshold,
+  ConfigVariable_DefragMaxSteps,
+  ConfigVariable_DefragMaxRelocations,
+  ConfigVariable_SlabAdaptationRate,
+  ConfigVariable_TargetHighWatermarks,
+  ConfigVariable_TargetLowWatermarks,
+  ConfigVariable_BufferOrganizerThreads,
+  ConfigVariable_BufferOrganizerIoShare,
+  ConfigVariable_ReadAheadDepth,
+  ConfigVariable_PlacementCacheThreshold,
+  ConfigVariable_PlacementSeed,
+  ConfigVariable_UseMeasuredBandwidths,
+  ConfigVariable_BandwidthCalibrationKb,
+  ConfigVariable_ParallelWriteKb,
+  ConfigVariable_ParallelWriteThreads,
 
   ConfigVariable_Count
 };
@@ -115,6 +143,34 @@ static const char *kConfigVariableStrings[ConfigVariable_Count] = {
   "buffer_organizer_port",
   "rpc_host_number_range",
   "rpc_num_threads",
+  "checkpoint_mount",
+  "buffer_organizer_queue_depth",
+  "tiering_interval_ms",
+  "tiering_high_watermark",
+  "tiering_low_watermark",
+  "tiering_promotion_frequency",
+  "tiering_max_mbps",
+  "swap_drain_order",
+  "swap_segment_size_mb",
+  "swap_max_segments",
+  "swap_compaction_threshold",
+  "write_back_threads",
+  "defrag_interval_ms",
+  "defrag_threshold",
+  "defrag_max_steps",
+  "defrag_max_relocations",
+  "slab_adaptation_rate",
+  "target_high_watermarks",
+  "target_low_watermarks",
+  "buffer_organizer_threads",
+  "buffer_organizer_io_share",
+  "read_ahead_depth",
+  "placement_cache_threshold",
+  "placement_seed",
+  "use_measured_bandwidths",
+  "bandwidth_calibration_kb",
+  "parallel_write_kb",
+  "parallel_write_threads",
 };
 
 struct Token {
@@ -661,6 +717,58 @@ void CheckConstraints(Config *config) {
       config->rpc_domain.empty()) {
     PrintExpectedAndFail("a non-empty value for rpc_domain");
   }
+  if (config->tiering_low_watermark > config->tiering_high_watermark ||
+      config->tiering_high_watermark > 1.0f) {
+    PrintExpectedAndFail("tiering_low_watermark <= tiering_high_watermark <= "
+                         "1.0");
+  }
+  if (config->swap_max_segments < 2 ||
+      config->swap_max_segments > kMaxSwapSegments) {
+    PrintExpectedAndFail("swap_max_segments between 2 and " +
+                         std::to_string(kMaxSwapSegments));
+  }
+  if (config->swap_compaction_threshold >= 1.0f) {
+    PrintExpectedAndFail("swap_compaction_threshold < 1.0");
+  }
+  if (config->write_back_threads < 1) {
+    PrintExpectedAndFail("write_back_threads >= 1");
+  }
+  if (config->defrag_threshold >= 1.0f) {
+    PrintExpectedAndFail("defrag_threshold < 1.0");
+  }
+  if (config->defrag_max_steps < 1 || config->defrag_max_relocations < 0) {
+    PrintExpectedAndFail("defrag_max_steps >= 1 and "
+                         "defrag_max_relocations >= 0");
+  }
+  if (config->slab_adaptation_rate < 0 || config->slab_adaptation_rate > 1.0f) {
+    PrintExpectedAndFail("slab_adaptation_rate between 0 and 1.0");
+  }
+  if (config->buffer_organizer_threads < 1 ||
+      config->buffer_organizer_threads > kMaxBufferOrganizerThreads) {
+    PrintExpectedAndFail("buffer_organizer_threads between 1 and " +
+                         std::to_string(kMaxBufferOrganizerThreads));
+  }
+  if (config->buffer_organizer_io_share > 1.0f) {
+    PrintExpectedAndFail("buffer_organizer_io_share <= 1.0");
+  }
+  if (config->placement_cache_threshold > 1.0f) {
+    PrintExpectedAndFail("placement_cache_threshold <= 1.0");
+  }
+  if (config->parallel_write_threads < 1) {
+    PrintExpectedAndFail("parallel_write_threads >= 1");
+  }
+  if (config->rpc_host_number_range[1] - config->rpc_host_number_range[0] >=
+      (int)kMaxNodes) {
+    PrintExpectedAndFail("rpc_host_number_range spanning at most " +
+                         std::to_string(kMaxNodes) + " nodes");
+  }
+  for (int i = 0; i < config->num_devices; ++i) {
+    if (config->target_low_watermarks[i] > config->target_high_watermarks[i] ||
+        config->target_high_watermarks[i] > 1.0f) {
+      PrintExpectedAndFail("target_low_watermarks <= target_high_watermarks "
+                           "<= 1.0 for each Target");
+    }
+  }
 }
 
 void ParseTokens(TokenList *tokens, Config *config) {
@@ -817,6 +925,130 @@ void ParseTokens(TokenList *tokens, Config *config) {
         config->rpc_num_threads = ParseInt(&tok);
         break;
       }
+      case ConfigVariable_CheckpointMount: {
+        config->checkpoint_mount = ParseString(&tok);
+        break;
+      }
+      case ConfigVariable_BufferOrganizerQueueDepth: {
+        config->buffer_organizer_queue_depth = ParseInt(&tok);
+        break;
+      }
+      case ConfigVariable_TieringIntervalMs: {
+        config->tiering_interval_ms = ParseInt(&tok);
+        break;
+      }
+      case ConfigVariable_TieringHighWatermark: {
+        config->tiering_high_watermark = ParseFloat(&tok);
+        break;
+      }
+      case ConfigVariable_TieringLowWatermark: {
+        config->tiering_low_watermark = ParseFloat(&tok);
+        break;
+      }
+      case ConfigVariable_TieringPromotionFrequency: {
+        config->tiering_promotion_frequency = ParseFloat(&tok);
+        break;
+      }
+      case ConfigVariable_TieringMaxMbps: {
+        config->tiering_max_mbps = ParseFloat(&tok);
+        break;
+      }
+      case ConfigVariable_SwapDrainOrder: {
+        std::string order = ParseString(&tok);
+        if (order == "oldest_first") {
+          config->swap_drain_order = SwapDrainOrder::kOldestFirst;
+        } else if (order == "smallest_first") {
+          config->swap_drain_order = SwapDrainOrder::kSmallestFirst;
+        } else {
+          PrintExpectedAndFail("\"oldest_first\" or \"smallest_first\"");
+        }
+        break;
+      }
+      case ConfigVariable_SwapSegmentSizeMb: {
+        // NOTE(chogan): Convert from MB to bytes
+        config->swap_segment_size = ParseSizet(&tok) * 1024 * 1024;
+        break;
+      }
+      case ConfigVariable_SwapMaxSegments: {
+        config->swap_max_segments = ParseInt(&tok);
+        break;
+      }
+      case ConfigVariable_SwapCompactionThreshold: {
+        config->swap_compaction_threshold = ParseFloat(&tok);
+        break;
+      }
+      case ConfigVariable_WriteBackThreads: {
+        config->write_back_threads = ParseInt(&tok);
+        break;
+      }
+      case ConfigVariable_DefragIntervalMs: {
+        config->defrag_interval_ms = ParseInt(&tok);
+        break;
+      }
+      case ConfigVariable_DefragThreshold: {
+        config->defrag_threshold = ParseFloat(&tok);
+        break;
+      }
+      case ConfigVariable_DefragMaxSteps: {
+        config->defrag_max_steps = ParseInt(&tok);
+        break;
+      }
+      case ConfigVariable_DefragMaxRelocations: {
+        config->defrag_max_relocations = ParseInt(&tok);
+        break;
+      }
+      case ConfigVariable_SlabAdaptationRate: {
+        config->slab_adaptation_rate = ParseFloat(&tok);
+        break;
+      }
+      case ConfigVariable_TargetHighWatermarks: {
+        RequireNumDevices(config);
+        tok = ParseFloatList(tok, config->target_high_watermarks,
+                             config->num_devices);
+        break;
+      }
+      case ConfigVariable_TargetLowWatermarks: {
+        RequireNumDevices(config);
+        tok = ParseFloatList(tok, config->target_low_watermarks,
+                             config->num_devices);
+        break;
+      }
+      case ConfigVariable_BufferOrganizerThreads: {
+        config->buffer_organizer_threads = ParseInt(&tok);
+        break;
+      }
+      case ConfigVariable_BufferOrganizerIoShare: {
+        config->buffer_organizer_io_share = ParseFloat(&tok);
+        break;
+      }
+      case ConfigVariable_ReadAheadDepth: {
+        config->read_ahead_depth = ParseInt(&tok);
+        break;
+      }
+      case ConfigVariable_PlacementCacheThreshold: {
+        config->placement_cache_threshold = ParseFloat(&tok);
+        break;
+      }
+      case ConfigVariable_PlacementSeed: {
+        config->placement_seed = ParseInt(&tok);
+        break;
+      }
+      case ConfigVariable_UseMeasuredBandwidths: {
+        config->use_measured_bandwidths = ParseInt(&tok) != 0;
+        break;
+      }
+      case ConfigVariable_BandwidthCalibrationKb: {
+        config->bandwidth_calibration_size = ParseSizet(&tok) * 1024;
+        break;
+      }
+      case ConfigVariable_ParallelWriteKb: {
+        config->parallel_write_threshold = ParseSizet(&tok) * 1024;
+        break;
+      }
+      case ConfigVariable_ParallelWriteThreads: {
+        config->parallel_write_threads = ParseInt(&tok);
+        break;
+      }
       default: {
         HERMES_INVALID_CODE_PATH;
         break;
@@ -15,14 +15,20 @@
 #include <assert.h>
 #include <math.h>
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
 #include <utility>
 #include <random>
+#include <set>
 #include <map>
 
 #include "ortools/linear_solver/linear_solver.h"
 
 #include "hermes.h"
 #include "hermes_types.h"
+#include "buffer_pool_internal.h"
 #include "metadata_management.h"
 #include "metadata_management_internal.h"
 #include "metadata_storage.h"
@@ -31,6 +37,102 @@ namespace hermes {
 
 using hermes::api::Status;
 
+/**
+ * A xoshiro256** generator for the randomized placement policies.
+ *
+ * Each thread has its own generator (see GetPlacementRng), so drawing a number
+ * costs a few arithmetic instructions instead of a `std::random_device` read
+ * and a `std::mt19937` initialization.
+ */
+struct PlacementRng {
+  using result_type = u64;
+
+  u64 state[4];
+  /** The `placement_seed_generation` this generator was seeded in. */
+  u32 generation;
+
+  static constexpr result_type min() {
+    return 0;
+  }
+
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  result_type operator()() {
+    result_type result = RotateLeft(state[1] * 5, 7) * 9;
+    u64 t = state[1] << 17;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = RotateLeft(state[3], 45);
+
+    return result;
+  }
+
+  static u64 RotateLeft(u64 x, int k) {
+    u64 result = (x << k) | (x >> (64 - k));
+
+    return result;
+  }
+};
+
+static std::atomic<u64> placement_base_seed;
+/** Incremented by SeedPlacementRng so that every thread reseeds. 0 means no
+ * seed has been set yet. */
+static std::atomic<u32> placement_seed_generation;
+/** Hands each thread its own stream of the base seed. */
+static std::atomic<u64> next_placement_stream;
+
+/** Expands @p x into well mixed seed words (SplitMix64). */
+static u64 SplitMix64(u64 *x) {
+  u64 result = (*x += 0x9E3779B97F4A7C15ULL);
+  result = (result ^ (result >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  result = (result ^ (result >> 27)) * 0x94D049BB133111EBULL;
+  result ^= result >> 31;
+
+  return result;
+}
+
+/**
+ * Seeds the placement generators of all threads from @p seed. With the same
+ * seed, the random placement policies make the same decisions on each thread
+ * that starts placing Blobs in the same order. A @p seed of 0 picks a seed from
+ * `std::random_device`.
+ */
+void SeedPlacementRng(u64 seed) {
+  if (seed == 0) {
+    std::random_device dev;
+    seed = ((u64)dev() << 32) | (u64)dev();
+  }
+  placement_base_seed.store(seed);
+  next_placement_stream.store(0);
+  placement_seed_generation.fetch_add(1);
+}
+
+static PlacementRng &GetPlacementRng() {
+  static thread_local PlacementRng rng = {};
+
+  if (placement_seed_generation.load() == 0) {
+    static std::once_flag default_seed;
+    std::call_once(default_seed, []() { SeedPlacementRng(0); });
+  }
+
+  u32 generation = placement_seed_generation.load();
+  if (rng.generation != generation) {
+    u64 stream = next_placement_stream.fetch_add(1);
+    u64 x = placement_base_seed.load() ^ SplitMix64(&stream);
+    for (int i = 0; i < 4; ++i) {
+      rng.state[i] = SplitMix64(&x);
+    }
+    rng.generation = generation;
+  }
+
+  return rng;
+}
+
 std::vector<int> GetValidSplitChoices(size_t blob_size) {
   int split_option = 10;
   // Split the blob if size is greater than 64KB
@@ -47,20 +149,30 @@ std::vector<int> GetValidSplitChoices(size_t blob_size) {
 
   return result;
 }
+
+/** The round-robin cursor for placements that aren't given one. */
+static std::atomic<u64> process_round_robin_cursor;
+
 Status AddRoundRobinSchema(size_t index, std::vector<u64> &node_state,
                            const std::vector<size_t> &blob_sizes,
                            const std::vector<TargetID> &targets,
-                           PlacementSchema &output) {
+                           PlacementSchema &output,
+                           std::atomic<u64> *cursor) {
   Status result = 0;
   TargetID dst = {};
-  DataPlacementEngine dpe;
   size_t num_targets = node_state.size();
-  size_t device_pos {dpe.getCountDevice()};
+  // NOTE(chogan): Claiming the starting position with a single increment
+  // keeps concurrent placements from reading the same cursor and all choosing
+  // the same Target.
+  u64 device_pos = cursor->fetch_add(1);
 
   for (size_t j {0}; j < num_targets; ++j) {
-    size_t adjust_pos = {(j+device_pos)%num_targets};
+    size_t adjust_pos = (j + device_pos) % num_targets;
     if (node_state[adjust_pos] >= blob_sizes[index]) {
-      dpe.setCountDevice((j+device_pos+1)%num_targets);
+      if (j > 0) {
+        // NOTE(chogan): Skip the full Targets for the next placement too.
+        cursor->fetch_add(j);
+      }
       dst = FindTargetIdFromDeviceId(targets, adjust_pos);
       output.push_back(std::make_pair(blob_sizes[index], dst));
       node_state[adjust_pos] -= blob_sizes[index];
@@ -77,12 +189,10 @@ Status AddRoundRobinSchema(size_t index, std::vector<u64> &node_state,
 
 bool SplitBlob(size_t blob_size) {
   bool result = false;
-  std::random_device dev;
-  std::mt19937 rng(dev());
 
   if (blob_size > KILOBYTES(64)) {
-    std::uniform_int_distribution<std::mt19937::result_type> distribution(0, 1);
-    if (distribution(rng) == 1) {
+    std::uniform_int_distribution<int> distribution(0, 1);
+    if (distribution(GetPlacementRng()) == 1) {
       result = true;
     }
   }
@@ -90,18 +200,35 @@ bool SplitBlob(size_t blob_size) {
   return result;
 }
 
-void GetSplitSizes(size_t blob_size, std::vector<size_t> &output) {
-  std::random_device dev;
-  std::mt19937 rng(dev());
-
+void GetSplitSizes(size_t blob_size, std::vector<size_t> &output,
+                   const std::vector<size_t> &buffer_sizes) {
   std::vector<int> split_choice = GetValidSplitChoices(blob_size);
 
   // Random pickup a number from split_choice to split the blob
-  std::uniform_int_distribution<std::mt19937::result_type>
-    position(0, split_choice.size()-1);
-  int split_num = split_choice[position(rng)];
+  std::uniform_int_distribution<size_t> position(0, split_choice.size()-1);
+  int split_num = split_choice[position(GetPlacementRng())];
 
   size_t blob_each_portion {blob_size/split_num};
+  if (!buffer_sizes.empty()) {
+    // NOTE(chogan): A fragment smaller than the largest buffer is stored in a
+    // chain of smaller buffers, and the last one is usually only partly full.
+    // Split into fewer fragments so that each one fills at least one of the
+    // largest buffers, and round all but the last fragment down to a multiple
+    // of the largest buffer that fits in it. Then only the last fragment can
+    // leave a buffer partly empty, the same as an unsplit Blob.
+    size_t max_splits = std::max(blob_size / buffer_sizes.back(), (size_t)1);
+    split_num = (int)std::min((size_t)split_num, max_splits);
+    blob_each_portion = blob_size / split_num;
+
+    size_t unit = buffer_sizes[0];
+    for (size_t buffer_size : buffer_sizes) {
+      if (buffer_size <= blob_each_portion) {
+        unit = buffer_size;
+      }
+    }
+    blob_each_portion = (blob_each_portion / unit) * unit;
+  }
+
   for (int j {0}; j < split_num - 1; ++j) {
     output.push_back(blob_each_portion);
   }
@@ -111,30 +238,34 @@ void GetSplitSizes(size_t blob_size, std::vector<size_t> &output) {
 Status RoundRobinPlacement(std::vector<size_t> &blob_sizes,
                            std::vector<u64> &node_state,
                            std::vector<PlacementSchema> &output,
-                           const std::vector<TargetID> &targets) {
+                           const std::vector<TargetID> &targets,
+                           const std::vector<size_t> &buffer_sizes,
+                           std::atomic<u64> *cursor) {
   Status result = 0;
+  if (!cursor) {
+    cursor = &process_round_robin_cursor;
+  }
   std::vector<u64> ns_local(node_state.begin(), node_state.end());
 
   for (size_t i {0}; i < blob_sizes.size(); ++i) {
-    std::random_device dev;
-    std::mt19937 rng(dev());
     PlacementSchema schema;
 
     // Split the blob
     if (SplitBlob(blob_sizes[i])) {
       // Construct the vector for the splitted blob
       std::vector<size_t> new_blob_size;
-      GetSplitSizes(blob_sizes[i], new_blob_size);
+      GetSplitSizes(blob_sizes[i], new_blob_size, buffer_sizes);
 
       for (size_t k {0}; k < new_blob_size.size(); ++k) {
         result = AddRoundRobinSchema(k, ns_local, new_blob_size, targets,
-                                     schema);
+                                     schema, cursor);
         if (result != 0) {
           break;
         }
       }
     } else {
-      result = AddRoundRobinSchema(i, ns_local, blob_sizes, targets, schema);
+      result = AddRoundRobinSchema(i, ns_local, blob_sizes, targets, schema,
+                                   cursor);
     }
     output.push_back(schema);
   }
@@ -144,8 +275,6 @@ Status RoundRobinPlacement(std::vector<size_t> &blob_sizes,
 
 Status AddRandomSchema(std::multimap<u64, TargetID> &ordered_cap,
                        size_t blob_size, PlacementSchema &schema) {
-  std::random_device rd;
-  std::mt19937 gen(rd());
   Status result = 0;
 
   auto itlow = ordered_cap.lower_bound(blob_size);
@@ -156,7 +285,7 @@ Status AddRandomSchema(std::multimap<u64, TargetID> &ordered_cap,
     // distance from lower bound to the end
     std::uniform_int_distribution<>
       dst_dist(1, std::distance(itlow, ordered_cap.end()));
-    size_t dst_relative = dst_dist(gen);
+    size_t dst_relative = dst_dist(GetPlacementRng());
     std::advance(itlow, dst_relative-1);
     ordered_cap.insert(std::pair<u64, TargetID>((*itlow).first-blob_size,
                                                 (*itlow).second));
@@ -170,19 +299,18 @@ Status AddRandomSchema(std::multimap<u64, TargetID> &ordered_cap,
 
 Status RandomPlacement(std::vector<size_t> &blob_sizes,
                        std::multimap<u64, TargetID> &ordered_cap,
-                       std::vector<PlacementSchema> &output) {
+                       std::vector<PlacementSchema> &output,
+                       const std::vector<size_t> &buffer_sizes) {
   Status result = 0;
 
   for (size_t i {0}; i < blob_sizes.size(); ++i) {
     PlacementSchema schema;
-    std::random_device dev;
-    std::mt19937 rng(dev());
 
     // Split the blob
     if (SplitBlob(blob_sizes[i])) {
       // Construct the vector for the splitted blob
       std::vector<size_t> new_blob_size;
-      GetSplitSizes(blob_sizes[i], new_blob_size);
+      GetSplitSizes(blob_sizes[i], new_blob_size, buffer_sizes);
 
       for (size_t k {0}; k < new_blob_size.size(); ++k) {
         result = AddRandomSchema(ordered_cap, new_blob_size[k], schema);
@@ -201,11 +329,190 @@ Status RandomPlacement(std::vector<size_t> &blob_sizes,
   return result;
 }
 
+// TODO(chogan): Get this number from the api::Context
+/** The fraction of a Target's remaining capacity that one placement may use. */
+static const double kCapacityChangeThreshold = 0.2;
+
+/**
+ * Solves the same linear program as MinimizeIoTimePlacementLp without a
+ * general purpose solver.
+ *
+ * The objective only depends on the total bytes placed on each Target, and the
+ * placement ratio constraints require the fraction of remaining capacity used
+ * on each Target to be non-decreasing in Target order. The used fractions
+ * therefore form a staircase, which is built from steps `d_k` that raise the
+ * level of Targets k and beyond together. A step on Target k places `C_k`
+ * bytes per unit, where `C_k` is the remaining capacity of Targets k and
+ * beyond, and costs `W_k`, their capacity weighted inverse bandwidth. That
+ * leaves two constraints,
+ *
+ *   sum(d_k * C_k) == total bytes, and
+ *   sum(d_k) <= kCapacityChangeThreshold,
+ *
+ * so an optimal solution raises the level of at most two steps. The
+ * candidates are enumerated directly in O(num_targets^2).
+ *
+ * If @p startup_times is given, each Target that receives data also costs its
+ * startup time (see GetStartupTimes). That makes the cost concave, so the
+ * optimum is still one of the candidates, but a step that starts at a slow,
+ * high latency Target can beat one that spreads the data over every Target.
+ *
+ * The resulting Target loads are then filled with the Blobs in order, so each
+ * Blob is split only where it crosses from one Target into the next. Targets
+ * with no remaining capacity receive nothing.
+ */
 Status MinimizeIoTimePlacement(const std::vector<size_t> &blob_sizes,
                                const std::vector<u64> &node_state,
                                const std::vector<f32> &bandwidths,
                                const std::vector<TargetID> &targets,
-                               std::vector<PlacementSchema> &output) {
+                               std::vector<PlacementSchema> &output,
+                               const std::vector<f64> &startup_times) {
+  Status result = 0;
+  const double threshold = kCapacityChangeThreshold;
+
+  std::vector<size_t> usable;
+  for (size_t j = 0; j < targets.size(); ++j) {
+    if (node_state[j] > 0 && bandwidths[j] > 0) {
+      usable.push_back(j);
+    }
+  }
+  const size_t num_steps = usable.size();
+
+  u64 total_size = 0;
+  for (size_t i = 0; i < blob_sizes.size(); ++i) {
+    total_size += blob_sizes[i];
+  }
+
+  // NOTE(chogan): Suffix sums of bytes and cost per unit of fill level, and of
+  // the fixed cost of using every Target from a step on. Costs are in the
+  // units of size / bandwidth, i.e., seconds scaled by MEGABYTES(1).
+  std::vector<double> step_bytes(num_steps + 1, 0);
+  std::vector<double> step_cost(num_steps + 1, 0);
+  std::vector<double> step_startup(num_steps + 1, 0);
+  for (size_t k = num_steps; k > 0; --k) {
+    size_t j = usable[k - 1];
+    step_bytes[k - 1] = step_bytes[k] + (double)node_state[j];
+    step_cost[k - 1] = step_cost[k] + (double)node_state[j] / bandwidths[j];
+    double startup = (startup_times.size() > j ?
+                      startup_times[j] * MEGABYTES(1) : 0);
+    step_startup[k - 1] = step_startup[k] + startup;
+  }
+
+  if (num_steps == 0 || (double)total_size > threshold * step_bytes[0]) {
+    // TODO(chogan): @errorhandling No space left or constraints unsatisfiable.
+    result = 1;
+    return result;
+  }
+
+  const double total = (double)total_size;
+  std::vector<double> levels(num_steps, 0);
+  double best_cost = std::numeric_limits<double>::infinity();
+
+  // NOTE(chogan): A single step only needs to fit under the threshold.
+  for (size_t a = 0; a < num_steps; ++a) {
+    double level = total / step_bytes[a];
+    double cost = level * step_cost[a] + step_startup[a];
+    if (level <= threshold && cost < best_cost) {
+      best_cost = cost;
+      std::fill(levels.begin(), levels.end(), 0);
+      levels[a] = level;
+    }
+  }
+
+  // NOTE(chogan): Two steps only help when the threshold is tight.
+  for (size_t a = 0; a < num_steps; ++a) {
+    for (size_t b = a + 1; b < num_steps; ++b) {
+      double level_a = ((total - threshold * step_bytes[b]) /
+                        (step_bytes[a] - step_bytes[b]));
+      double level_b = threshold - level_a;
+      if (level_a < 0 || level_b < 0) {
+        continue;
+      }
+      double cost = (level_a * step_cost[a] + level_b * step_cost[b] +
+                     step_startup[a]);
+      if (cost < best_cost) {
+        best_cost = cost;
+        std::fill(levels.begin(), levels.end(), 0);
+        levels[a] = level_a;
+        levels[b] = level_b;
+      }
+    }
+  }
+
+  // NOTE(chogan): Convert the staircase into whole bytes per Target, and give
+  // the bytes lost to rounding to the fastest Targets with room for them.
+  std::vector<u64> loads(num_steps);
+  u64 assigned = 0;
+  double level = 0;
+  for (size_t k = 0; k < num_steps; ++k) {
+    level += levels[k];
+    u64 limit = (u64)(threshold * (double)node_state[usable[k]]);
+    loads[k] = std::min((u64)(level * (double)node_state[usable[k]]), limit);
+    assigned += loads[k];
+  }
+  std::vector<size_t> by_bandwidth(num_steps);
+  for (size_t k = 0; k < num_steps; ++k) {
+    by_bandwidth[k] = k;
+  }
+  std::sort(by_bandwidth.begin(), by_bandwidth.end(),
+            [&bandwidths, &usable](size_t a, size_t b) {
+              return bandwidths[usable[a]] > bandwidths[usable[b]];
+            });
+  for (size_t n = 0; n < num_steps && assigned < total_size; ++n) {
+    size_t k = by_bandwidth[n];
+    u64 limit = (u64)(threshold * (double)node_state[usable[k]]);
+    u64 extra = std::min(total_size - assigned,
+                         limit > loads[k] ? limit - loads[k] : 0);
+    loads[k] += extra;
+    assigned += extra;
+  }
+  // NOTE(chogan): Anything left over may go past the threshold, but never past
+  // a Target's admissible capacity.
+  for (size_t n = 0; n < num_steps && assigned < total_size; ++n) {
+    size_t k = by_bandwidth[n];
+    u64 capacity = node_state[usable[k]];
+    u64 extra = std::min(total_size - assigned,
+                         capacity > loads[k] ? capacity - loads[k] : 0);
+    loads[k] += extra;
+    assigned += extra;
+  }
+  if (assigned < total_size) {
+    // TODO(chogan): @errorhandling The Blobs don't fit in the admissible
+    // capacity.
+    result = 1;
+    return result;
+  }
+
+  size_t k = 0;
+  for (size_t i = 0; i < blob_sizes.size(); ++i) {
+    PlacementSchema schema;
+    size_t remaining = blob_sizes[i];
+    while (remaining > 0 && k < num_steps) {
+      size_t portion = std::min((u64)remaining, loads[k]);
+      if (portion > 0) {
+        schema.push_back(std::make_pair(portion, targets[usable[k]]));
+        loads[k] -= portion;
+        remaining -= portion;
+      }
+      if (loads[k] == 0) {
+        ++k;
+      }
+    }
+    if (schema.size() == 0) {
+      // NOTE(chogan): Empty Blobs still need a Target.
+      schema.push_back(std::make_pair(0, targets[usable[0]]));
+    }
+    output.push_back(schema);
+  }
+
+  return result;
+}
+
+Status MinimizeIoTimePlacementLp(const std::vector<size_t> &blob_sizes,
+                                 const std::vector<u64> &node_state,
+                                 const std::vector<f32> &bandwidths,
+                                 const std::vector<TargetID> &targets,
+                                 std::vector<PlacementSchema> &output) {
   using operations_research::MPSolver;
   using operations_research::MPVariable;
   using operations_research::MPConstraint;
@@ -239,14 +546,12 @@ Status MinimizeIoTimePlacement(const std::vector<size_t> &blob_sizes,
   }
   num_constrts += num_blobs;
 
-  // Constraint #2: Minimum Remaining Capacity Constraint
-  // TODO(chogan): Get this number from the api::Context
-  const double minimum_remaining_capacity = 0.1;
+  // Constraint #2: Remaining Capacity Constraint
+  // NOTE(chogan): CalculatePlacement already subtracts the space each Target
+  // keeps free above its high watermark from node_state.
   for (size_t j {0}; j < num_targets; ++j) {
-    double remaining_capacity_threshold =
-      static_cast<double>(node_state[j]) * minimum_remaining_capacity;
     blob_constrt[num_constrts+j] = solver.MakeRowConstraint(
-      0, static_cast<double>(node_state[j]) - remaining_capacity_threshold);
+      0, static_cast<double>(node_state[j]));
     for (size_t i {0}; i < num_blobs; ++i) {
       blob_constrt[num_constrts+j]->SetCoefficient(
         blob_fraction[i][j], static_cast<double>(blob_sizes[i]));
@@ -255,8 +560,7 @@ Status MinimizeIoTimePlacement(const std::vector<size_t> &blob_sizes,
   num_constrts += num_targets;
 
   // Constraint #3: Remaining Capacity Change Threshold
-  // TODO(chogan): Get this number from the api::Context
-  const double capacity_change_threshold = 0.2;
+  const double capacity_change_threshold = kCapacityChangeThreshold;
   for (size_t j {0}; j < num_targets; ++j) {
     blob_constrt[num_constrts+j] =
       solver.MakeRowConstraint(0, capacity_change_threshold * node_state[j]);
@@ -330,6 +634,74 @@ Status MinimizeIoTimePlacement(const std::vector<size_t> &blob_sizes,
   return result;
 }
 
+/**
+ * Places each Blob where it finishes writing soonest.
+ *
+ * Writing a fragment of `s` bytes to Target j takes `startup_times[j] + s /
+ * bandwidth_j`, and the fragments of a Blob are written one after another.
+ * A Blob goes whole to the Target that finishes it first if any Target has
+ * room for it. Otherwise it's split, filling the Targets with the lowest time
+ * per byte for what they can hold, so each additional fragment has to pay for
+ * its own startup time. Every placed byte also lengthens the queue of its
+ * Target for the Blobs placed after it.
+ */
+Status MinimizeLatencyPlacement(const std::vector<size_t> &blob_sizes,
+                                const std::vector<u64> &node_state,
+                                const std::vector<f32> &bandwidths,
+                                const std::vector<f64> &startup_times,
+                                const std::vector<TargetID> &targets,
+                                std::vector<PlacementSchema> &output) {
+  Status result = 0;
+  std::vector<u64> remaining(node_state.begin(), node_state.end());
+  std::vector<f64> startup(targets.size(), 0);
+  for (size_t j = 0; j < targets.size() && j < startup_times.size(); ++j) {
+    startup[j] = startup_times[j];
+  }
+
+  for (size_t i = 0; i < blob_sizes.size(); ++i) {
+    PlacementSchema schema;
+    size_t bytes_left = blob_sizes[i];
+
+    do {
+      size_t best = targets.size();
+      u64 best_portion = 0;
+      f64 best_cost = std::numeric_limits<f64>::infinity();
+      for (size_t j = 0; j < targets.size(); ++j) {
+        if (bandwidths[j] <= 0 || (remaining[j] == 0 && bytes_left > 0)) {
+          continue;
+        }
+        u64 portion = std::min((u64)bytes_left, remaining[j]);
+        f64 seconds = (startup[j] +
+                       (f64)portion / ((f64)bandwidths[j] * MEGABYTES(1)));
+        // NOTE(chogan): Compare time per byte so that a Target that can hold
+        // the whole Blob isn't beaten by a faster one that only holds a sliver.
+        f64 cost = portion > 0 ? seconds / (f64)portion : seconds;
+        if (cost < best_cost) {
+          best = j;
+          best_portion = portion;
+          best_cost = cost;
+        }
+      }
+
+      if (best == targets.size()) {
+        // TODO(chogan): @errorhandling No space left.
+        result = 1;
+        return result;
+      }
+
+      schema.push_back(std::make_pair(best_portion, targets[best]));
+      remaining[best] -= best_portion;
+      startup[best] += (f64)best_portion / ((f64)bandwidths[best] *
+                                            MEGABYTES(1));
+      bytes_left -= best_portion;
+    } while (bytes_left > 0);
+
+    output.push_back(schema);
+  }
+
+  return result;
+}
+
 PlacementSchema AggregateBlobSchema(PlacementSchema &schema) {
   std::unordered_map<u64, u64> place_size;
   PlacementSchema result;
@@ -347,14 +719,190 @@ PlacementSchema AggregateBlobSchema(PlacementSchema &schema) {
   return result;
 }
 
-Status CalculatePlacement(SharedMemoryContext *context, RpcContext *rpc,
-                          std::vector<size_t> &blob_sizes,
-                          std::vector<PlacementSchema> &output,
-                          const api::Context &api_context) {
-  (void)rpc;
+/**
+ * Returns the bytes that can be placed on each of @p targets, given the
+ * available bytes in @p node_state. At least 10% of the available bytes are
+ * always left free, and more if that's what it takes to keep the Target below
+ * its high watermark.
+ */
+static std::vector<u64>
+GetAdmissibleCapacities(SharedMemoryContext *context,
+                        const std::vector<TargetID> &targets,
+                        const std::vector<u64> &node_state) {
+  // TODO(chogan): Get this number from the api::Context
+  const f64 minimum_remaining_capacity = 0.1;
+  std::vector<u64> result(targets.size());
+
+  for (size_t i = 0; i < targets.size(); ++i) {
+    Target *target = GetTargetFromId(context, targets[i]);
+    u64 headroom = (u64)((1.0f - target->high_watermark) *
+                         (f32)target->capacity);
+    u64 below_watermark = (node_state[i] > headroom ?
+                           node_state[i] - headroom : 0);
+    u64 minimum_remaining = (u64)(minimum_remaining_capacity *
+                                  (f64)node_state[i]);
+    result[i] = std::min(below_watermark, node_state[i] - minimum_remaining);
+  }
+
+  return result;
+}
+
+/**
+ * Returns the distinct slab buffer sizes of this node's Devices, smallest
+ * first.
+ *
+ * NOTE(chogan): Split fragments are aligned to these without knowing which
+ * Device they will land on, which assumes that each Device's buffer sizes
+ * divide the larger ones of the other Devices. This holds when all block sizes
+ * and slab unit sizes are powers of 2.
+ */
+static std::vector<size_t> GetNodeBufferSizes(SharedMemoryContext *context) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  std::set<size_t> sizes;
+
+  for (int device_id = 0; device_id < pool->num_devices; ++device_id) {
+    for (int slab = 0; slab < pool->num_slabs[device_id]; ++slab) {
+      sizes.insert(GetSlabBufferSize(context, device_id, slab));
+    }
+  }
+  std::vector<size_t> result(sizes.begin(), sizes.end());
+
+  return result;
+}
+
+/**
+ * Returns the seconds before a write to each of @p targets starts moving data:
+ * the latency of its Device plus the time to drain the writes already queued
+ * on it.
+ */
+static std::vector<f64> GetStartupTimes(SharedMemoryContext *context,
+                                        const std::vector<TargetID> &targets) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  std::vector<f32> bandwidths = GetBandwidths(context);
+  std::vector<f64> result(targets.size());
+
+  for (size_t i = 0; i < targets.size(); ++i) {
+    Device *device = GetDeviceById(context, targets[i].bits.device_id);
+    u64 queued_bytes = pool->queued_write_bytes[device->id].load();
+    f32 bandwidth = bandwidths[device->id];
+    f64 drain_seconds = (bandwidth > 0 ?
+                         (f64)queued_bytes / ((f64)bandwidth * MEGABYTES(1)) :
+                         0);
+    result[i] = (f64)device->latency_ns * 1e-9 + drain_seconds;
+  }
+
+  return result;
+}
+
+/** The most placements a PlacementCache holds before it starts over. */
+static const size_t kMaxCachedPlacements = 1024;
+
+/** Returns true if any writes are queued on the Devices of this node. */
+static bool WritesAreQueued(SharedMemoryContext *context) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  bool result = false;
+  for (int i = 0; i < pool->num_devices && !result; ++i) {
+    result = pool->queued_write_bytes[i].load() > 0;
+  }
+
+  return result;
+}
+
+/**
+ * Returns true if @p api_context always produces the same placement for the
+ * same sizes and capacities. Random and round-robin placements are meant to
+ * differ from one Put to the next, and latency placements follow the write
+ * queues, which change far more often than capacities, so they are never
+ * cached.
+ *
+ * The analytic kMinimizeIoTime solver also charges queued writes (see
+ * GetStartupTimes), so its placements are only cached while nothing is
+ * queued. The queue depth isn't part of the cache key, and a placement
+ * calculated behind a queue would be reused after the queue drained.
+ */
+static bool PlacementIsCacheable(SharedMemoryContext *context,
+                                 const api::Context &api_context) {
+  bool result = (api_context.policy == api::PlacementPolicy::kMinimizeIoTime &&
+                 (api_context.use_lp_solver || !WritesAreQueued(context)));
+
+  return result;
+}
+
+static u64 GetPlacementCacheKey(const api::Context &api_context,
+                                size_t blob_size) {
+  u64 result = (((u64)blob_size << 8) | ((u64)api_context.policy << 1) |
+                (u64)api_context.use_lp_solver);
+
+  return result;
+}
+
+/**
+ * Finds the placement of a single Blob of @p blob_size in @p cache, and
+ * appends it to @p output. Returns false if it isn't cached in @p epoch.
+ */
+static bool GetCachedPlacement(PlacementCache *cache, u64 epoch, u64 key,
+                               std::vector<PlacementSchema> &output) {
+  bool result = false;
+  std::lock_guard<std::mutex> lock(cache->mutex);
+
+  if (cache->epoch != epoch) {
+    cache->schemas.clear();
+    cache->epoch = epoch;
+  }
+
+  auto iter = cache->schemas.find(key);
+  if (iter != cache->schemas.end()) {
+    output.push_back(iter->second);
+    cache->hits++;
+    result = true;
+  } else {
+    cache->misses++;
+  }
+
+  return result;
+}
+
+static void CachePlacement(PlacementCache *cache, u64 epoch, u64 key,
+                           const PlacementSchema &schema) {
+  std::lock_guard<std::mutex> lock(cache->mutex);
+
+  // NOTE(chogan): A placement calculated while the epoch advanced may already
+  // be stale.
+  if (cache->epoch == epoch) {
+    if (cache->schemas.size() >= kMaxCachedPlacements) {
+      cache->schemas.clear();
+    }
+    cache->schemas[key] = schema;
+  }
+}
+
+/**
+ * Calculates a PlacementSchema for each of @p blob_sizes from the current
+ * remaining capacities. Placements are only taken from the PlacementCache if
+ * @p allow_cache is true.
+ */
+static Status PlanPlacement(SharedMemoryContext *context,
+                            std::vector<size_t> &blob_sizes,
+                            std::vector<PlacementSchema> &output,
+                            const api::Context &api_context,
+                            bool allow_cache) {
   std::vector<PlacementSchema> output_tmp;
   Status result = 0;
 
+  PlacementCache *cache = context->placement_cache;
+  bool use_cache = (allow_cache && cache && blob_sizes.size() == 1 &&
+                    PlacementIsCacheable(context, api_context));
+  u64 epoch = 0;
+  u64 key = 0;
+  if (use_cache) {
+    BufferPool *pool = GetBufferPoolFromContext(context);
+    epoch = pool->capacity_epoch.load();
+    key = GetPlacementCacheKey(api_context, blob_sizes[0]);
+    if (GetCachedPlacement(cache, epoch, key, output)) {
+      return result;
+    }
+  }
+
   // TODO(chogan): For now we just look at the node level targets as the default
   // path. Eventually we will need the ability to escalate to neighborhoods, and
   // the entire cluster.
@@ -373,19 +921,40 @@ Status CalculatePlacement(SharedMemoryContext *context, RpcContext *rpc,
         ordered_cap.insert(std::pair<u64, TargetID>(node_state[i], targets[i]));
       }
 
-      result = RandomPlacement(blob_sizes, ordered_cap, output_tmp);
+      result = RandomPlacement(blob_sizes, ordered_cap, output_tmp,
+                               GetNodeBufferSizes(context));
       break;
     }
     case api::PlacementPolicy::kRoundRobin: {
-      result = RoundRobinPlacement(blob_sizes, node_state,
-                                   output_tmp, targets);
+      BufferPool *pool = GetBufferPoolFromContext(context);
+      result = RoundRobinPlacement(blob_sizes, node_state, output_tmp, targets,
+                                   GetNodeBufferSizes(context),
+                                   &pool->round_robin_cursor);
       break;
     }
     case api::PlacementPolicy::kMinimizeIoTime: {
       std::vector<f32> bandwidths = GetBandwidths(context);
+      std::vector<u64> admissible = GetAdmissibleCapacities(context, targets,
+                                                            node_state);
 
-      result = MinimizeIoTimePlacement(blob_sizes, node_state, bandwidths,
-                                       targets, output_tmp);
+      if (api_context.use_lp_solver) {
+        result = MinimizeIoTimePlacementLp(blob_sizes, admissible, bandwidths,
+                                           targets, output_tmp);
+      } else {
+        std::vector<f64> startup_times = GetStartupTimes(context, targets);
+        result = MinimizeIoTimePlacement(blob_sizes, admissible, bandwidths,
+                                         targets, output_tmp, startup_times);
+      }
+      break;
+    }
+    case api::PlacementPolicy::kMinimizeLatency: {
+      std::vector<f32> bandwidths = GetBandwidths(context);
+      std::vector<u64> admissible = GetAdmissibleCapacities(context, targets,
+                                                            node_state);
+      std::vector<f64> startup_times = GetStartupTimes(context, targets);
+
+      result = MinimizeLatencyPlacement(blob_sizes, admissible, bandwidths,
+                                        startup_times, targets, output_tmp);
       break;
     }
   }
@@ -397,6 +966,58 @@ Status CalculatePlacement(SharedMemoryContext *context, RpcContext *rpc,
       CHECK(schema.size() > 0) << "PlacementSchema is empty";
       output.push_back(schema);
     }
+    if (use_cache) {
+      CachePlacement(cache, epoch, key, output.back());
+    }
+  }
+
+  return result;
+}
+
+/**
+ * Calculates a PlacementSchema for each of @p blob_sizes.
+ *
+ * Single Blob placements from deterministic policies are cached in the
+ * process's PlacementCache, so a steady stream of same sized Puts only pays
+ * for a hash lookup until the remaining capacity of some Target drifts by more
+ * than `placement_cache_threshold`.
+ *
+ * This is safe to call from any number of threads and processes at once. The
+ * state it shares is either atomic (the round-robin cursor and the capacity
+ * epoch in the BufferPool), per thread (the random number generator), or
+ * behind a mutex (the PlacementCache).
+ *
+ * If @p reservation is given, the capacity of the placement is reserved as
+ * soon as it's planned, so concurrent placements plan around it instead of on
+ * the same free space. If another placement reserved the space first, the
+ * placement is planned again from the capacity that's left. The caller passes
+ * @p reservation on to GetBuffers or GetBatchBuffers and then releases
+ * whatever is left with ReleaseCapacity. If the space can't be reserved here,
+ * @p reservation stays empty and GetBuffers reserves it when the buffers are
+ * claimed, which may fail.
+ */
+Status CalculatePlacement(SharedMemoryContext *context, RpcContext *rpc,
+                          std::vector<size_t> &blob_sizes,
+                          std::vector<PlacementSchema> &output,
+                          const api::Context &api_context,
+                          CapacityReservation *reservation) {
+  (void)rpc;
+  Status result = PlanPlacement(context, blob_sizes, output, api_context, true);
+
+  if (result == 0 && reservation) {
+    const int kMaxPlacementAttempts = 3;
+    for (int attempt = 1; !ReserveCapacity(context, output, reservation);
+         ++attempt) {
+      if (attempt == kMaxPlacementAttempts) {
+        break;
+      }
+      // NOTE(chogan): A cached placement would plan on the same space again.
+      output.clear();
+      result = PlanPlacement(context, blob_sizes, output, api_context, false);
+      if (result != 0) {
+        break;
+      }
+    }
   }
 
   return result;
@@ -13,7 +13,10 @@
 #ifndef HERMES_DATA_PLACEMENT_ENGINE_H_
 #define HERMES_DATA_PLACEMENT_ENGINE_H_
 
+#include <atomic>
 #include <map>
+#include <mutex>
+#include <unordered_map>
 
 #include "hermes_types.h"
 #include "hermes.h"
@@ -22,40 +25,87 @@ namespace hermes {
 
 using api::Status;
 
-class DataPlacementEngine {
-  static inline size_t count_device_ {};
-
- public:
-  size_t getCountDevice() const {return count_device_;}
-  void setCountDevice(size_t new_count_device) {
-    count_device_ = new_count_device;
-  }
+/**
+ * Placements calculated by one process, reused for later Puts of the same size
+ * until the BufferPool's `capacity_epoch` advances.
+ */
+struct PlacementCache {
+  std::mutex mutex;
+  /** The `capacity_epoch` the cached schemas were calculated in. */
+  u64 epoch;
+  /** Schemas keyed by placement options and blob size. */
+  std::unordered_map<u64, PlacementSchema> schemas;
+  u64 hits;
+  u64 misses;
 };
 
+void SeedPlacementRng(u64 seed);
+
+/**
+ * Places each Blob on the next Target with room for it, splitting Blobs over
+ * 64 KB at random. Non-empty @p buffer_sizes (the node's slab buffer sizes,
+ * smallest first) align the fragments to whole buffers (see GetSplitSizes).
+ *
+ * The rotation is kept in @p cursor, which CalculatePlacement points at the
+ * BufferPool's `round_robin_cursor` so that every thread and process on a node
+ * shares it. Each placement claims its starting Target with one atomic
+ * increment, so concurrent placements start on different Targets. When
+ * @p cursor is null a cursor shared by the whole process is used.
+ */
 Status RoundRobinPlacement(std::vector<size_t> &blob_sizes,
                         std::vector<u64> &node_state,
                            std::vector<PlacementSchema> &output,
-                           const std::vector<TargetID> &targets);
+                           const std::vector<TargetID> &targets,
+                           const std::vector<size_t> &buffer_sizes =
+                           std::vector<size_t>(),
+                           std::atomic<u64> *cursor = nullptr);
 
 Status RandomPlacement(std::vector<size_t> &blob_sizes,
                        std::multimap<u64, TargetID> &ordered_cap,
-                       std::vector<PlacementSchema> &output);
+                       std::vector<PlacementSchema> &output,
+                       const std::vector<size_t> &buffer_sizes =
+                       std::vector<size_t>());
 
 Status MinimizeIoTimePlacement(const std::vector<size_t> &blob_sizes,
                                const std::vector<u64> &node_state,
                                const std::vector<f32> &bandwidths,
                                const std::vector<TargetID> &targets,
-                               std::vector<PlacementSchema> &output);
+                               std::vector<PlacementSchema> &output,
+                               const std::vector<f64> &startup_times =
+                               std::vector<f64>());
+
+Status MinimizeLatencyPlacement(const std::vector<size_t> &blob_sizes,
+                                const std::vector<u64> &node_state,
+                                const std::vector<f32> &bandwidths,
+                                const std::vector<f64> &startup_times,
+                                const std::vector<TargetID> &targets,
+                                std::vector<PlacementSchema> &output);
+
+Status MinimizeIoTimePlacementLp(const std::vector<size_t> &blob_sizes,
+                                 const std::vector<u64> &node_state,
+                                 const std::vector<f32> &bandwidths,
+                                 const std::vector<TargetID> &targets,
+                                 std::vector<PlacementSchema> &output);
 
 Status CalculatePlacement(SharedMemoryContext *context, RpcContext *rpc,
                           std::vector<size_t> &blob_size,
                           std::vector<PlacementSchema> &output,
-                          const api::Context &api_context);
+                          const api::Context &api_context,
+                          CapacityReservation *reservation = NULL);
 
 PlacementSchema AggregateBlobSchema(PlacementSchema &schema);
 
 // internal
 std::vector<int> GetValidSplitChoices(size_t blob_size);
+/**
+ * Splits @p blob_size into a random number of fragments. When @p buffer_sizes
+ * is empty the fragments are equal. Otherwise each fragment fills at least one
+ * of the largest buffers, and all but the last are whole multiples of a buffer
+ * size.
+ */
+void GetSplitSizes(size_t blob_size, std::vector<size_t> &output,
+                   const std::vector<size_t> &buffer_sizes =
+                   std::vector<size_t>());
 Status AddRandomSchema(std::multimap<u64, size_t> &ordered_cap,
                        size_t blob_size, std::vector<PlacementSchema> &output,
                        std::vector<u64> &node_state);
@@ -56,8 +56,15 @@ constexpr int kMaxDevices = 8;
 constexpr int kMaxBucketNameSize = 256;
 constexpr int kMaxBlobNameSize = 64;
 constexpr int kMaxVBucketNameSize = 256;
+constexpr int kMaxSwapSegments = 1024;
+constexpr int kMaxBufferOrganizerThreads = 16;
 
 constexpr char kPlaceInHierarchy[] = "PlaceInHierarchy";
+constexpr char kMoveToTarget[] = "MoveToTarget";
+constexpr char kPrefetchToTarget[] = "PrefetchToTarget";
+constexpr char kDrainSwap[] = "DrainSwap";
+constexpr char kCompactSwap[] = "CompactSwap";
+constexpr char kEvictFromTarget[] = "EvictFromTarget";
 
 #define HERMES_NOT_IMPLEMENTED_YET \
   LOG(FATAL) << __func__ << " not implemented yet\n"
@@ -100,6 +107,40 @@ enum class ProcessKind {
   kCount
 };
 
+/**
+ * The order in which the BufferOrganizer moves Blobs from swap space back into
+ * the hierarchy.
+ */
+enum class SwapDrainOrder {
+  kOldestFirst,
+  kSmallestFirst,
+
+  kCount
+};
+
+/**
+ * The classes of BufferOrganizer work, from highest to lowest priority. Each
+ * class has its own queue, and a class only runs when every higher priority
+ * queue is empty. Work below kBoPriority_Foreground is also limited to a share
+ * of each Device's bandwidth (see ChargeIoBudget).
+ */
+enum BoPriority {
+  /** Work that a client is blocked on or about to be (e.g., evictions that keep
+   * Puts out of swap). */
+  kBoPriority_Foreground,
+  /** Moves of Blobs that are about to be read into a faster Target (see
+   * Bucket::Prefetch). */
+  kBoPriority_Prefetch,
+  kBoPriority_SwapDrain,
+  /** Write-back to files. Runs on the write-back threads of each process, so
+   * only the I/O budget applies. */
+  kBoPriority_Flush,
+  kBoPriority_Tiering,
+  kBoPriority_Defrag,
+
+  kBoPriority_Count
+};
+
 enum ArenaType {
   kArenaType_BufferPool,  // This must always be first
   kArenaType_MetaData,
@@ -148,9 +189,93 @@ struct Config {
   std::string mount_points[kMaxDevices];
   /** The mount point of the swap target. */
   std::string swap_mount;
-  /** The number of times the BufferOrganizer will attempt to place a swap blob
-   * into the hierarchy before giving up.*/
+  /** The directory where metadata checkpoints are written on shutdown and read
+   * on startup. An empty string disables checkpointing.
+   */
+  std::string checkpoint_mount;
+  /** The number of times the BufferOrganizer attempts a Blob move requested by
+   * Bucket::Prefetch before giving up. Blobs in swap space aren't retried;
+   * they stay queued until they're placed in the hierarchy or deleted. */
   int num_buffer_organizer_retries;
+  /** The maximum number of Blob moves that can be waiting on the
+   * BufferOrganizer of a node. Further requests are rejected until the queue
+   * drains. */
+  int buffer_organizer_queue_depth;
+  /** The number of threads that run BufferOrganizer work on each node. */
+  int buffer_organizer_threads;
+  /** The fraction of each Device's bandwidth that background BufferOrganizer
+   * work (swap drains, flushes, tiering, and defragmentation) may use. */
+  f32 buffer_organizer_io_share;
+  /** The number of Blobs ahead of a sequential scan that Bucket::Get prefetches
+   * into the fastest Target. 0 disables read-ahead. */
+  int read_ahead_depth;
+  /** Cached placements are discarded once the remaining capacity of any
+   * Target changes by more than this fraction (see CalculatePlacement). */
+  f32 placement_cache_threshold;
+  /** Seeds the random placement policies so that their decisions can be
+   * reproduced. 0 picks a different seed on every run. */
+  int placement_seed;
+  /** When true, placement uses the bandwidth each Device has achieved so far
+   * instead of `bandwidths`. */
+  bool use_measured_bandwidths;
+  /** The number of bytes written to each Device at startup to seed its
+   * measured bandwidth. 0 skips the calibration. */
+  size_t bandwidth_calibration_size;
+  /** Blobs (or batches of Blobs) of at least this many bytes are written to
+   * their buffers by several threads at once. */
+  size_t parallel_write_threshold;
+  /** The most threads that write one Blob or batch. 1 writes on the calling
+   * thread only. */
+  int parallel_write_threads;
+  /** The order in which Blobs are moved from swap space into the hierarchy
+   * when capacity becomes available. */
+  SwapDrainOrder swap_drain_order;
+  /** The size in bytes of each file in the swap log. */
+  size_t swap_segment_size;
+  /** The maximum number of swap segment files per node. One of them is kept
+   * free for compaction, so at most `swap_max_segments - 1` hold new Blobs. */
+  int swap_max_segments;
+  /** A sealed swap segment is compacted once the fraction of it that still
+   * holds live Blobs falls below this. */
+  f32 swap_compaction_threshold;
+  /** The interval in milliseconds at which the BufferOrganizer rebalances Blobs
+   * between tiers based on their access statistics. 0 disables tiering. */
+  int tiering_interval_ms;
+  /** When the fraction of a Target's capacity in use exceeds this, its coldest
+   * Blobs are demoted to the next Target. */
+  f32 tiering_high_watermark;
+  /** Demotion stops once usage falls to this fraction, and promotion never
+   * fills the fastest Target past it. */
+  f32 tiering_low_watermark;
+  /** The minimum decayed access frequency for a Blob to be promoted to the
+   * fastest Target. */
+  f32 tiering_promotion_frequency;
+  /** The maximum rate in MiB/s at which tiering migrates data. */
+  f32 tiering_max_mbps;
+  /** The number of threads per process that write Blobs back to files for
+   * Bucket::Persist and the FileMappingTrait. */
+  int write_back_threads;
+  /** The interval in milliseconds at which the BufferOrganizer rebalances free
+   * RAM between slabs. 0 disables defragmentation. */
+  int defrag_interval_ms;
+  /** Defragmentation starts when the RAM fragmentation score (see
+   * ComputeFragmentationScore) exceeds this, and stops at half of it. */
+  f32 defrag_threshold;
+  /** The maximum number of merges and splits per defragmentation pass. */
+  int defrag_max_steps;
+  /** The maximum number of in-use buffers moved per defragmentation pass. */
+  int defrag_max_relocations;
+  /** How quickly the RAM slab percentages follow the observed Blob sizes. Each
+   * defragmentation pass moves them this fraction of the way towards the
+   * measured demand. 0 keeps the configured `desired_slab_percentages`. */
+  f32 slab_adaptation_rate;
+  /** For each Target, the fraction of its capacity in use (including
+   * reservations) above which the BufferOrganizer evicts its coldest Blobs to
+   * slower Targets. 1.0 disables eviction. */
+  f32 target_high_watermarks[kMaxDevices];
+  /** For each Target, the fraction of its capacity that eviction frees down
+   * to. */
+  f32 target_low_watermarks[kMaxDevices];
 
   /** The hostname of the RPC server, minus any numbers that Hermes may
    * auto-generate when the rpc_hostNumber_range is specified. */
@@ -187,15 +312,81 @@ union VBucketID {
   u64 as_int;
 };
 
+/**
+ * The most nodes a Hermes cluster can have, since a BlobID only has room for
+ * a 16 bit signed node ID.
+ */
+constexpr u32 kMaxNodes = INT16_MAX;
+
 union BlobID {
   struct {
     u32 buffer_ids_offset;
-    i32 node_id;
+    /** The node that stores the Blob's metadata. Negative for swap Blobs. At
+     * most kMaxNodes. */
+    i16 node_id;
+    /** Detects a stale BlobID whose `buffer_ids_offset` now belongs to another
+     * Blob (see BlobHeader::id_generation). */
+    u16 generation;
   } bits;
 
   u64 as_int;
 };
 
+/**
+ * A point-in-time copy of the access statistics of a Blob, Bucket, or VBucket.
+ *
+ * `frequency` is an exponentially decayed access count (see kStatsHalfLifeMs)
+ * evaluated at the time the snapshot was taken, so larger values mean hotter
+ * data. `last_access_ms` is measured on the monotonic clock of the node that
+ * owns the metadata.
+ */
+struct AccessStats {
+  u64 reads;
+  u64 writes;
+  u64 bytes_read;
+  u64 bytes_written;
+  u64 last_access_ms;
+  f64 frequency;
+};
+
+/** Bit for swap space in BlobPredicate::device_mask */
+constexpr u32 kSwapDeviceMask = 1u << kMaxDevices;
+
+/**
+ * A filter for listing the Blobs in a Bucket.
+ *
+ * The predicate is evaluated on the node that owns each Blob's metadata, so
+ * only matching Blobs are sent back. A value-initialized predicate matches
+ * every Blob. Only the conditions that are set cost anything to evaluate.
+ */
+struct BlobPredicate {
+  /** A glob on the Blob name supporting '*' and '?'. Empty matches all. */
+  std::string name_pattern;
+  /** Minimum Blob size in bytes */
+  u64 min_size;
+  /** Maximum Blob size in bytes. 0 means no limit. */
+  u64 max_size;
+  /**
+   * Match Blobs with at least one buffer on a Device whose bit (1 << DeviceID)
+   * is set. Use kSwapDeviceMask for Blobs in swap space. 0 matches any Device.
+   */
+  u32 device_mask;
+  /** Only match Blobs that have not been accessed for at least this long */
+  u64 min_idle_ms;
+  /** Only match Blobs accessed within this many milliseconds. 0 is no limit */
+  u64 max_idle_ms;
+};
+
+/**
+ * A position in a paginated Blob listing. A value-initialized cursor starts at
+ * the beginning, and `done` is set once every Blob has been visited.
+ */
+struct BlobCursor {
+  /** The position in the Bucket's list of Blobs */
+  u32 index;
+  bool done;
+};
+
 /**
  * Trait types
  */
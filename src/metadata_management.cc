@@ -14,7 +14,11 @@
 
 #include <string.h>
 
+#include <chrono>
+#include <cmath>
+#include <map>
 #include <string>
+#include <unordered_map>
 
 #include "memory_management.h"
 #include "buffer_pool.h"
@@ -156,10 +160,53 @@ VBucketID GetVBucketIdByName(SharedMemoryContext *context, RpcContext *rpc,
   return result;
 }
 
+/**
+ * Appends @p val to @p str as a count of bytes followed by 7 bits per byte,
+ * least significant first. Every byte has its high bit set, so none of them is
+ * 0 and the result can be part of a C string.
+ */
+static void AppendCompactU32(std::string *str, u32 val) {
+  char bytes[kMaxCompactU32Size];
+  int num_bytes = 0;
+  do {
+    bytes[num_bytes++] = (char)(0x80 | (val & 0x7F));
+    val >>= 7;
+  } while (val);
+  str->push_back((char)num_bytes);
+  str->append(bytes, num_bytes);
+}
+
+std::string MakeInternalBlobName(const std::string &name, BucketID id) {
+  // NOTE(chogan): The map keys are C strings, so we can't store the raw bytes
+  // of the BucketID. Instead we use a compact encoding that never contains a
+  // 0 byte. Small BucketIDs take 4 bytes.
+  std::string result;
+  result.reserve(2 * (kMaxCompactU32Size + 1) + name.size());
+  AppendCompactU32(&result, id.bits.index);
+  AppendCompactU32(&result, id.bits.node_id);
+  result += name;
+
+  return result;
+}
+
+/** Returns the Blob name that @p internal_name was made from. */
+static std::string GetBlobNameFromInternalName(
+    const std::string &internal_name) {
+  size_t prefix_length = 0;
+  for (int i = 0; i < 2; ++i) {
+    prefix_length += 1 + (u8)internal_name[prefix_length];
+  }
+  std::string result = internal_name.substr(prefix_length);
+
+  return result;
+}
+
 BlobID GetBlobIdByName(SharedMemoryContext *context, RpcContext *rpc,
-                       const char *name) {
+                       const char *name, BucketID bucket_id) {
+  std::string internal_name = MakeInternalBlobName(name, bucket_id);
   BlobID result = {};
-  result.as_int = GetIdByName(context, rpc, name, kMapType_Blob);
+  result.as_int = GetIdByName(context, rpc, internal_name.c_str(),
+                              kMapType_Blob);
 
   return result;
 }
@@ -178,6 +225,114 @@ std::vector<BlobID> GetBlobIds(SharedMemoryContext *context, RpcContext *rpc,
   return result;
 }
 
+bool BlobMatchesPredicate(SharedMemoryContext *context, RpcContext *rpc,
+                          BlobID blob_id, const BlobPredicate &pred) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  bool result = true;
+
+  if (pred.min_idle_ms || pred.max_idle_ms) {
+    AccessStats stats = LocalGetBlobStats(mdm, blob_id);
+    u64 now = GetStatsTicks();
+    u64 idle_ms = now > stats.last_access_ms ? now - stats.last_access_ms : 0;
+    if (idle_ms < pred.min_idle_ms ||
+        (pred.max_idle_ms && idle_ms > pred.max_idle_ms)) {
+      result = false;
+    }
+  }
+
+  bool check_size = pred.min_size || pred.max_size;
+  if (result && (check_size || pred.device_mask)) {
+    std::vector<BufferID> buffer_ids = LocalGetBufferIdList(mdm, blob_id);
+    u64 blob_size = 0;
+    bool on_device = false;
+
+    if (BlobIsInSwap(blob_id)) {
+      SwapBlob swap_blob = VecToSwapBlob(buffer_ids);
+      blob_size = swap_blob.size;
+      on_device = pred.device_mask & kSwapDeviceMask;
+    } else {
+      for (size_t i = 0; i < buffer_ids.size(); ++i) {
+        if (check_size) {
+          blob_size += GetBufferSize(context, rpc, buffer_ids[i]);
+        }
+        if (pred.device_mask && !on_device) {
+          DeviceID device_id = GetBufferDeviceId(context, rpc, buffer_ids[i]);
+          on_device = pred.device_mask & (1u << device_id);
+        }
+      }
+    }
+
+    if (check_size && (blob_size < pred.min_size ||
+                       (pred.max_size && blob_size > pred.max_size))) {
+      result = false;
+    }
+    if (pred.device_mask && !on_device) {
+      result = false;
+    }
+  }
+
+  return result;
+}
+
+std::vector<BlobID> GetBlobIds(SharedMemoryContext *context, RpcContext *rpc,
+                               BucketID bucket_id, const BlobPredicate &pred,
+                               BlobCursor *cursor, u32 max_results,
+                               std::vector<std::string> *names) {
+  std::vector<BlobID> result;
+  u32 bucket_node = bucket_id.bits.node_id;
+
+  // NOTE(chogan): The cursor walks the Bucket's list of Blobs. Each page of
+  // BlobIDs is filtered on the nodes that store the Blobs, so only matches are
+  // transferred. Blobs removed during a listing may cause other Blobs to be
+  // skipped, since removal moves the last Blob into the removed slot.
+  while (!cursor->done && result.size() < max_results) {
+    u32 remaining = max_results - (u32)result.size();
+    std::vector<BlobID> blob_ids;
+    if (bucket_node == rpc->node_id) {
+      blob_ids = LocalGetBlobIds(context, bucket_id, cursor->index, remaining);
+    } else {
+      blob_ids = RpcCall<std::vector<BlobID>>(rpc, bucket_node,
+                                              "RemoteGetBlobIdRange",
+                                              bucket_id, cursor->index,
+                                              remaining);
+    }
+    cursor->index += (u32)blob_ids.size();
+    cursor->done = blob_ids.size() < remaining;
+
+    std::map<u32, std::vector<BlobID>> blobs_by_node;
+    for (const auto &blob_id : blob_ids) {
+      blobs_by_node[GetBlobNodeId(blob_id)].push_back(blob_id);
+    }
+
+    std::unordered_map<u64, std::string> matches;
+    for (const auto &[target_node, node_blob_ids] : blobs_by_node) {
+      BlobIdPage page = {};
+      if (target_node == rpc->node_id) {
+        page = LocalFilterBlobIds(context, rpc, node_blob_ids, pred);
+      } else {
+        page = RpcCall<BlobIdPage>(rpc, target_node, "RemoteFilterBlobIds",
+                                   node_blob_ids, pred);
+      }
+      for (size_t i = 0; i < page.ids.size(); ++i) {
+        matches[page.ids[i].as_int] = page.names[i];
+      }
+    }
+
+    // NOTE(chogan): Keep the order of the Bucket's list.
+    for (const auto &blob_id : blob_ids) {
+      auto match = matches.find(blob_id.as_int);
+      if (match != matches.end()) {
+        result.push_back(blob_id);
+        if (names) {
+          names->push_back(match->second);
+        }
+      }
+    }
+  }
+
+  return result;
+}
+
 void PutId(MetadataManager *mdm, RpcContext *rpc, const std::string &name,
            u64 id, MapType map_type) {
   u32 target_node = HashString(mdm, rpc, name.c_str());
@@ -234,7 +389,7 @@ BucketID LocalGetNextFreeBucketId(SharedMemoryContext *context, RpcContext *rpc,
     if (!IsNullBucketId(result)) {
       BucketInfo *info = LocalGetBucketInfoByIndex(mdm, result.bits.index);
       info->blobs = {};
-      info->stats = {};
+      ResetStats(&info->stats);
       info->ref_count.store(1);
       info->active = true;
       mdm->first_free_bucket = info->next_free;
@@ -302,7 +457,7 @@ VBucketID GetNextFreeVBucketId(SharedMemoryContext *context, RpcContext *rpc,
     if (!IsNullVBucketId(result)) {
       VBucketInfo *info = GetVBucketInfoByIndex(mdm, result.bits.index);
       info->blobs = {};
-      info->stats = {};
+      ResetStats(&info->stats);
       memset(info->traits, 0, sizeof(TraitID) * kMaxTraitsPerVBucket);
       info->ref_count.store(1);
       info->active = true;
@@ -371,17 +526,20 @@ void AddBlobIdToVBucket(MetadataManager *mdm, RpcContext *rpc, BlobID blob_id,
   }
 }
 
-u32 AllocateBufferIdList(SharedMemoryContext *context, RpcContext *rpc,
-                         u32 target_node,
-                         const std::vector<BufferID> &buffer_ids) {
+BlobID AllocateBufferIdList(SharedMemoryContext *context, RpcContext *rpc,
+                            u32 target_node,
+                            const std::vector<BufferID> &buffer_ids,
+                            const std::string &blob_name, bool is_swap_blob) {
   MetadataManager *mdm = GetMetadataManagerFromContext(context);
-  u32 result = 0;
+  BlobID result = {};
 
   if (target_node == rpc->node_id) {
-    result = LocalAllocateBufferIdList(mdm, buffer_ids);
+    // NOTE(chogan): A negative node_id indicates a swap blob
+    i32 node_id = is_swap_blob ? -(i32)target_node : (i32)target_node;
+    result = LocalAllocateBufferIdList(mdm, buffer_ids, blob_name, node_id);
   } else {
-    result = RpcCall<u32>(rpc, target_node, "RemoteAllocateBufferIdList",
-                          buffer_ids);
+    result = RpcCall<BlobID>(rpc, target_node, "RemoteAllocateBufferIdList",
+                             buffer_ids, blob_name, is_swap_blob);
   }
 
   return result;
@@ -456,29 +614,134 @@ BufferIdArray GetBufferIdsFromBlobName(Arena *arena,
                                        SharedMemoryContext *context,
                                        RpcContext *rpc,
                                        const char *blob_name,
-                                       u32 **sizes) {
-  BlobID blob_id = GetBlobIdByName(context, rpc, blob_name);
+                                       BucketID bucket_id, u32 **sizes) {
+  BlobID blob_id = GetBlobIdByName(context, rpc, blob_name, bucket_id);
   BufferIdArray result = GetBufferIdsFromBlobId(arena, context, rpc, blob_id,
                                                 sizes);
 
   return result;
 }
 
-void AttachBlobToBucket(SharedMemoryContext *context, RpcContext *rpc,
-                        const char *blob_name, BucketID bucket_id,
-                        const std::vector<BufferID> &buffer_ids,
-                        bool is_swap_blob) {
+BlobID AttachBlobToBucket(SharedMemoryContext *context, RpcContext *rpc,
+                          const char *blob_name, BucketID bucket_id,
+                          const std::vector<BufferID> &buffer_ids,
+                          bool is_swap_blob) {
   MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  std::string internal_name = MakeInternalBlobName(blob_name, bucket_id);
 
-  int target_node = HashString(mdm, rpc, blob_name);
-  BlobID blob_id = {};
-  // NOTE(chogan): A negative node_id indicates a swap blob
-  blob_id.bits.node_id = is_swap_blob ? -target_node : target_node;
-  blob_id.bits.buffer_ids_offset = AllocateBufferIdList(context, rpc,
-                                                        target_node,
-                                                        buffer_ids);
-  PutBlobId(mdm, rpc, blob_name, blob_id);
+  u32 target_node = HashString(mdm, rpc, internal_name.c_str());
+  BlobID blob_id = AllocateBufferIdList(context, rpc, target_node, buffer_ids,
+                                        blob_name, is_swap_blob);
+  PutBlobId(mdm, rpc, internal_name, blob_id);
   AddBlobIdToBucket(mdm, rpc, blob_id, bucket_id);
+
+  return blob_id;
+}
+
+std::vector<BlobID>
+LocalAttachBlobs(SharedMemoryContext *context, RpcContext *rpc,
+                 const std::vector<std::string> &internal_names,
+                 const std::vector<std::vector<BufferID>> &buffer_ids,
+                 const std::vector<u64> &sizes, bool is_swap,
+                 std::vector<BlobID> *replaced_ids) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  std::vector<BlobID> result(internal_names.size());
+  replaced_ids->resize(internal_names.size());
+
+  for (size_t i = 0; i < internal_names.size(); ++i) {
+    BlobID existing_blob_id = {};
+    existing_blob_id.as_int = LocalGet(mdm, internal_names[i].c_str(),
+                                       kMapType_Blob);
+    AccessStats existing_stats = {};
+    if (!IsNullBlobId(existing_blob_id)) {
+      // NOTE(chogan): The new Blob gets a new BlobID, so carry the access
+      // history over from the old one.
+      existing_stats = LocalGetBlobStats(mdm, existing_blob_id);
+      FreeBlob(context, rpc, existing_blob_id);
+    }
+
+    // NOTE(chogan): A negative node_id indicates a swap blob
+    i32 node_id = is_swap ? -(i32)rpc->node_id : (i32)rpc->node_id;
+    BlobID blob_id =
+      LocalAllocateBufferIdList(mdm, buffer_ids[i],
+                                GetBlobNameFromInternalName(internal_names[i]),
+                                node_id);
+    if (!IsNullBlobId(existing_blob_id)) {
+      LocalSetBlobStats(mdm, blob_id, existing_stats);
+    }
+    LocalRecordBlobAccess(mdm, blob_id, kAccessType_Write, sizes[i]);
+    LocalPut(mdm, internal_names[i].c_str(), blob_id.as_int, kMapType_Blob);
+    result[i] = blob_id;
+    (*replaced_ids)[i] = existing_blob_id;
+  }
+
+  return result;
+}
+
+void AddBlobIdsToBucket(SharedMemoryContext *context, RpcContext *rpc,
+                        const std::vector<BlobID> &blob_ids,
+                        const std::vector<BlobID> &replaced_ids,
+                        const std::vector<u64> &sizes, BucketID bucket_id) {
+  u32 target_node = bucket_id.bits.node_id;
+
+  if (target_node == rpc->node_id) {
+    LocalAddBlobIdsToBucket(context, bucket_id, blob_ids, replaced_ids, sizes);
+  } else {
+    RpcCall<bool>(rpc, target_node, "RemoteAddBlobIdsToBucket", bucket_id,
+                  blob_ids, replaced_ids, sizes);
+  }
+}
+
+std::vector<BlobID>
+AttachBlobsToBucket(SharedMemoryContext *context, RpcContext *rpc,
+                    const std::vector<std::string> &names, BucketID bucket_id,
+                    const std::vector<std::vector<BufferID>> &buffer_ids,
+                    const std::vector<u64> &sizes, bool is_swap) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  std::vector<BlobID> result(names.size());
+  std::vector<BlobID> replaced_ids(names.size());
+
+  // NOTE(chogan): Group the Blobs by the node that owns their names, so each
+  // node gets a single update.
+  std::map<u32, std::vector<size_t>> blobs_by_node;
+  std::vector<std::string> internal_names(names.size());
+  for (size_t i = 0; i < names.size(); ++i) {
+    internal_names[i] = MakeInternalBlobName(names[i], bucket_id);
+    u32 target_node = HashString(mdm, rpc, internal_names[i].c_str());
+    blobs_by_node[target_node].push_back(i);
+  }
+
+  for (const auto &[target_node, indices] : blobs_by_node) {
+    std::vector<std::string> node_names(indices.size());
+    std::vector<std::vector<BufferID>> node_buffer_ids(indices.size());
+    std::vector<u64> node_sizes(indices.size());
+    for (size_t j = 0; j < indices.size(); ++j) {
+      node_names[j] = internal_names[indices[j]];
+      node_buffer_ids[j] = buffer_ids[indices[j]];
+      node_sizes[j] = sizes[indices[j]];
+    }
+
+    std::vector<BlobID> blob_ids;
+    std::vector<BlobID> node_replaced_ids;
+    if (target_node == rpc->node_id) {
+      blob_ids = LocalAttachBlobs(context, rpc, node_names, node_buffer_ids,
+                                  node_sizes, is_swap, &node_replaced_ids);
+    } else {
+      std::pair<std::vector<BlobID>, std::vector<BlobID>> attached =
+        RpcCall<std::pair<std::vector<BlobID>, std::vector<BlobID>>>(
+          rpc, target_node, "RemoteAttachBlobs", node_names, node_buffer_ids,
+          node_sizes, is_swap);
+      blob_ids = attached.first;
+      node_replaced_ids = attached.second;
+    }
+    for (size_t j = 0; j < indices.size(); ++j) {
+      result[indices[j]] = blob_ids[j];
+      replaced_ids[indices[j]] = node_replaced_ids[j];
+    }
+  }
+  AddBlobIdsToBucket(context, rpc, result, replaced_ids, sizes, bucket_id);
+
+  return result;
 }
 
 void FreeBufferIdList(SharedMemoryContext *context, RpcContext *rpc,
@@ -491,31 +754,76 @@ void FreeBufferIdList(SharedMemoryContext *context, RpcContext *rpc,
   }
 }
 
-void LocalDestroyBlobByName(SharedMemoryContext *context, RpcContext *rpc,
-                            const char *blob_name, BlobID blob_id) {
-  if (!BlobIsInSwap(blob_id)) {
-    std::vector<BufferID> buffer_ids = GetBufferIdList(context, rpc, blob_id);
-    ReleaseBuffers(context, rpc, buffer_ids);
+u64 GetBlobGeneration(SharedMemoryContext *context, RpcContext *rpc,
+                      BlobID blob_id) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  u32 target_node = GetBlobNodeId(blob_id);
+  u64 result = 0;
+
+  if (target_node == rpc->node_id) {
+    result = LocalGetBlobGeneration(mdm, blob_id);
   } else {
-    // TODO(chogan): Invalidate swap region once we have a SwapManager
+    result = RpcCall<u64>(rpc, target_node, "RemoteGetBlobGeneration",
+                          blob_id);
   }
 
-  FreeBufferIdList(context, rpc, blob_id);
+  return result;
+}
 
+/**
+ * Replaces the `BufferID`s of @p blob_id with @p buffer_ids, but only if the
+ * Blob's generation still matches @p expected_generation. Returns false if the
+ * Blob was modified since the generation was read.
+ */
+bool ReplaceBufferIdList(SharedMemoryContext *context, RpcContext *rpc,
+                         BlobID blob_id, u64 expected_generation,
+                         const std::vector<BufferID> &buffer_ids) {
   MetadataManager *mdm = GetMetadataManagerFromContext(context);
-  DeleteId(mdm, rpc, blob_name, kMapType_Blob);
+  u32 target_node = GetBlobNodeId(blob_id);
+  bool result = false;
+
+  if (target_node == rpc->node_id) {
+    result = LocalReplaceBufferIdList(mdm, blob_id, expected_generation,
+                                      buffer_ids);
+  } else {
+    result = RpcCall<bool>(rpc, target_node, "RemoteReplaceBufferIdList",
+                           blob_id, expected_generation, buffer_ids);
+  }
+
+  return result;
 }
 
-void LocalDestroyBlobById(SharedMemoryContext *context, RpcContext *rpc,
-                          BlobID blob_id) {
+/**
+ * Releases a Blob's buffers and its BufferID list, but leaves its name in the
+ * Blob map.
+ */
+void FreeBlob(SharedMemoryContext *context, RpcContext *rpc, BlobID blob_id) {
   if (!BlobIsInSwap(blob_id)) {
     std::vector<BufferID> buffer_ids = GetBufferIdList(context, rpc, blob_id);
     ReleaseBuffers(context, rpc, buffer_ids);
   } else {
-    // TODO(chogan): Invalidate swap region once we have a SwapManager
+    std::vector<BufferID> swap_ids = GetBufferIdList(context, rpc, blob_id);
+    // NOTE(chogan): A stale BlobID has no IDs (see GetBlobHeader).
+    if (swap_ids.size()) {
+      SwapBlob swap_blob = VecToSwapBlob(swap_ids);
+      FreeSwapSpace(context, rpc, swap_blob);
+    }
   }
 
   FreeBufferIdList(context, rpc, blob_id);
+}
+
+void LocalDestroyBlobByName(SharedMemoryContext *context, RpcContext *rpc,
+                            const char *blob_name, BlobID blob_id) {
+  FreeBlob(context, rpc, blob_id);
+
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  DeleteId(mdm, rpc, blob_name, kMapType_Blob);
+}
+
+void LocalDestroyBlobById(SharedMemoryContext *context, RpcContext *rpc,
+                          BlobID blob_id) {
+  FreeBlob(context, rpc, blob_id);
 
   MetadataManager *mdm = GetMetadataManagerFromContext(context);
   std::string blob_name = ReverseGetFromStorage(mdm, blob_id.as_int,
@@ -530,6 +838,38 @@ void LocalDestroyBlobById(SharedMemoryContext *context, RpcContext *rpc,
   }
 }
 
+void LocalDestroyBucketBlobs(SharedMemoryContext *context, RpcContext *rpc,
+                             BucketID bucket_id,
+                             const std::vector<BlobID> &blob_ids) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  for (const auto &blob_id : blob_ids) {
+    std::string blob_name = LocalGetBlobName(mdm, blob_id);
+    FreeBlob(context, rpc, blob_id);
+    DeleteId(mdm, rpc, MakeInternalBlobName(blob_name, bucket_id),
+             kMapType_Blob);
+  }
+}
+
+void DestroyBucketBlobs(SharedMemoryContext *context, RpcContext *rpc,
+                        BucketID bucket_id,
+                        const std::vector<BlobID> &blob_ids) {
+  // NOTE(chogan): Each Blob stores its own name, so the nodes that store the
+  // Blobs can drop them without searching their Blob maps.
+  std::map<u32, std::vector<BlobID>> blobs_by_node;
+  for (const auto &blob_id : blob_ids) {
+    blobs_by_node[GetBlobNodeId(blob_id)].push_back(blob_id);
+  }
+
+  for (const auto &[target_node, node_blob_ids] : blobs_by_node) {
+    if (target_node == rpc->node_id) {
+      LocalDestroyBucketBlobs(context, rpc, bucket_id, node_blob_ids);
+    } else {
+      RpcCall<bool>(rpc, target_node, "RemoteDestroyBucketBlobs", bucket_id,
+                    node_blob_ids);
+    }
+  }
+}
+
 void RemoveBlobFromBucketInfo(SharedMemoryContext *context, RpcContext *rpc,
                               BucketID bucket_id, BlobID blob_id) {
   u32 target_node = bucket_id.bits.node_id;
@@ -543,27 +883,42 @@ void RemoveBlobFromBucketInfo(SharedMemoryContext *context, RpcContext *rpc,
 
 void DestroyBlobByName(SharedMemoryContext *context, RpcContext *rpc,
                        BucketID bucket_id, const std::string &blob_name) {
-  BlobID blob_id = GetBlobIdByName(context, rpc, blob_name.c_str());
+  std::string internal_name = MakeInternalBlobName(blob_name, bucket_id);
+  BlobID blob_id = GetBlobIdByName(context, rpc, blob_name.c_str(), bucket_id);
   if (!IsNullBlobId(blob_id)) {
     u32 blob_id_target_node = GetBlobNodeId(blob_id);
 
     if (blob_id_target_node == rpc->node_id) {
-      LocalDestroyBlobByName(context, rpc, blob_name.c_str(), blob_id);
+      LocalDestroyBlobByName(context, rpc, internal_name.c_str(), blob_id);
     } else {
       RpcCall<bool>(rpc, blob_id_target_node, "RemoteDestroyBlobByName",
-                    blob_name, blob_id);
+                    internal_name, blob_id);
     }
     RemoveBlobFromBucketInfo(context, rpc, bucket_id, blob_id);
   }
 }
 
+void SetBlobName(SharedMemoryContext *context, RpcContext *rpc,
+                 BlobID blob_id, const std::string &name) {
+  u32 target_node = GetBlobNodeId(blob_id);
+  if (target_node == rpc->node_id) {
+    MetadataManager *mdm = GetMetadataManagerFromContext(context);
+    LocalSetBlobName(mdm, blob_id, name);
+  } else {
+    RpcCall<bool>(rpc, target_node, "RemoteSetBlobName", blob_id, name);
+  }
+}
+
 void RenameBlob(SharedMemoryContext *context, RpcContext *rpc,
-                const std::string &old_name, const std::string &new_name) {
+                const std::string &old_name, const std::string &new_name,
+                BucketID bucket_id) {
   MetadataManager *mdm = GetMetadataManagerFromContext(context);
-  BlobID blob_id = GetBlobIdByName(context, rpc, old_name.c_str());
+  BlobID blob_id = GetBlobIdByName(context, rpc, old_name.c_str(), bucket_id);
   if (!IsNullBlobId(blob_id)) {
-    DeleteId(mdm, rpc, old_name, kMapType_Blob);
-    PutBlobId(mdm, rpc, new_name, blob_id);
+    DeleteId(mdm, rpc, MakeInternalBlobName(old_name, bucket_id),
+             kMapType_Blob);
+    PutBlobId(mdm, rpc, MakeInternalBlobName(new_name, bucket_id), blob_id);
+    SetBlobName(context, rpc, blob_id, new_name);
   } else {
     // TODO(chogan): @errorhandling
   }
@@ -571,7 +926,7 @@ void RenameBlob(SharedMemoryContext *context, RpcContext *rpc,
 
 bool ContainsBlob(SharedMemoryContext *context, RpcContext *rpc,
                   BucketID bucket_id, const std::string &blob_name) {
-  BlobID blob_id = GetBlobIdByName(context, rpc, blob_name.c_str());
+  BlobID blob_id = GetBlobIdByName(context, rpc, blob_name.c_str(), bucket_id);
   bool result = false;
 
   if (!IsNullBlobId(blob_id)) {
@@ -580,7 +935,7 @@ bool ContainsBlob(SharedMemoryContext *context, RpcContext *rpc,
       result = LocalContainsBlob(context, bucket_id, blob_id);
     } else {
       result = RpcCall<bool>(rpc, target_node, "RemoteContainsBlob", bucket_id,
-                             blob_name);
+                             blob_id);
     }
   }
 
@@ -664,7 +1019,10 @@ void DecrementRefcount(SharedMemoryContext *context, RpcContext *rpc,
 
 u64 LocalGetRemainingCapacity(SharedMemoryContext *context, TargetID id) {
   Target *target = GetTargetFromId(context, id);
-  u64 result = target->remaining_space.load();
+  // NOTE(chogan): Space reserved by in-flight placements is already spoken for.
+  u64 reserved = target->reserved_space.load();
+  u64 remaining = target->remaining_space.load();
+  u64 result = remaining > reserved ? remaining - reserved : 0;
 
   return result;
 }
@@ -804,10 +1162,11 @@ SystemViewState *CreateSystemViewState(Arena *arena, Config *config) {
   return result;
 }
 
-std::string GetSwapFilename(MetadataManager *mdm, u32 node_id) {
+std::string GetSwapFilename(MetadataManager *mdm, u32 node_id, u32 segment) {
   char *prefix = (char *)((u8 *)mdm + mdm->swap_filename_prefix_offset);
   char *suffix = (char *)((u8 *)mdm + mdm->swap_filename_suffix_offset);
-  std::string result = (prefix + std::to_string(node_id) + suffix);
+  std::string result = (prefix + std::to_string(node_id) + "_" +
+                        std::to_string(segment) + suffix);
 
   return result;
 }
@@ -866,6 +1225,7 @@ void InitMetadataManager(MetadataManager *mdm, Arena *arena, Config *config,
   arena->error_handler = MetadataArenaErrorHandler;
 
   mdm->map_seed = 0x4E58E5DF;
+  mdm->blob_generation = 1;
   SeedHashForStorage(mdm->map_seed);
 
   mdm->system_view_state_update_interval_ms =
@@ -928,6 +1288,19 @@ void InitMetadataManager(MetadataManager *mdm, Arena *arena, Config *config,
       info->next_free.bits.index = i + 1;
     }
   }
+
+  // Initialize SwapLog
+
+  SwapLog *swap_log = PushClearedStruct<SwapLog>(arena);
+  SwapSegment *swap_segments =
+    PushClearedArray<SwapSegment>(arena, config->swap_max_segments);
+  swap_log->num_segments = config->swap_max_segments;
+  swap_log->segment_size = config->swap_segment_size;
+  swap_log->compaction_threshold = config->swap_compaction_threshold;
+  swap_log->segments_offset = (u8 *)swap_segments - (u8 *)swap_log;
+  swap_log->active_segment.store(0);
+  swap_segments[0].state.store(kSwapSegmentState_Active);
+  mdm->swap_log_offset = GetOffsetFromMdm(mdm, swap_log);
 }
 
 VBucketInfo *LocalGetVBucketInfoByIndex(MetadataManager *mdm, u32 index) {
@@ -975,4 +1348,238 @@ void DecrementRefcount(SharedMemoryContext *context, RpcContext *rpc,
   }
 }
 
+u64 GetStatsTicks() {
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  u64 result =
+    std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+
+  return result;
+}
+
+f64 DecayFrequency(f64 frequency, u64 elapsed_ticks) {
+  f64 result = frequency * std::exp2(-(f64)elapsed_ticks / kStatsHalfLifeMs);
+
+  return result;
+}
+
+void ResetStats(Stats *stats) {
+  stats->reads.store(0, std::memory_order_relaxed);
+  stats->writes.store(0, std::memory_order_relaxed);
+  stats->bytes_read.store(0, std::memory_order_relaxed);
+  stats->bytes_written.store(0, std::memory_order_relaxed);
+  stats->last_access_ticks.store(0, std::memory_order_relaxed);
+  stats->frequency.store(0, std::memory_order_relaxed);
+}
+
+void RecordAccess(Stats *stats, AccessType type, u64 bytes, u64 ticks,
+                  u64 count) {
+  const auto relaxed = std::memory_order_relaxed;
+
+  if (type == kAccessType_Read) {
+    stats->reads.fetch_add(count, relaxed);
+    stats->bytes_read.fetch_add(bytes, relaxed);
+  } else {
+    stats->writes.fetch_add(count, relaxed);
+    stats->bytes_written.fetch_add(bytes, relaxed);
+  }
+
+  // NOTE(chogan): Only move last_access_ticks forward so that a slow updater
+  // can't make the Blob look older than it is.
+  u64 last_ticks = stats->last_access_ticks.load(relaxed);
+  while (last_ticks < ticks &&
+         !stats->last_access_ticks.compare_exchange_weak(last_ticks, ticks,
+                                                         relaxed)) {
+  }
+  u64 elapsed_ticks = ticks > last_ticks ? ticks - last_ticks : 0;
+
+  f64 frequency = stats->frequency.load(relaxed);
+  f64 new_frequency = 0;
+  do {
+    new_frequency = DecayFrequency(frequency, elapsed_ticks) + (f64)count;
+  } while (!stats->frequency.compare_exchange_weak(frequency, new_frequency,
+                                                   relaxed));
+}
+
+void SetStats(Stats *stats, const AccessStats &snapshot, u64 ticks) {
+  const auto relaxed = std::memory_order_relaxed;
+  stats->reads.store(snapshot.reads, relaxed);
+  stats->writes.store(snapshot.writes, relaxed);
+  stats->bytes_read.store(snapshot.bytes_read, relaxed);
+  stats->bytes_written.store(snapshot.bytes_written, relaxed);
+  stats->last_access_ticks.store(ticks, relaxed);
+  stats->frequency.store(snapshot.frequency, relaxed);
+}
+
+AccessStats GetStatsSnapshot(Stats *stats, u64 ticks) {
+  const auto relaxed = std::memory_order_relaxed;
+  AccessStats result = {};
+  result.reads = stats->reads.load(relaxed);
+  result.writes = stats->writes.load(relaxed);
+  result.bytes_read = stats->bytes_read.load(relaxed);
+  result.bytes_written = stats->bytes_written.load(relaxed);
+  result.last_access_ms = stats->last_access_ticks.load(relaxed);
+
+  u64 elapsed_ticks =
+    ticks > result.last_access_ms ? ticks - result.last_access_ms : 0;
+  result.frequency = DecayFrequency(stats->frequency.load(relaxed),
+                                    elapsed_ticks);
+
+  return result;
+}
+
+void LocalRecordBucketAccess(SharedMemoryContext *context, BucketID bucket_id,
+                             AccessType type, u64 bytes, u64 count) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  BucketInfo *info = LocalGetBucketInfoById(mdm, bucket_id);
+  // NOTE(chogan): The update may arrive after the slot was freed.
+  if (info->active) {
+    RecordAccess(&info->stats, type, bytes, GetStatsTicks(), count);
+  }
+}
+
+void RecordBucketAccess(SharedMemoryContext *context, RpcContext *rpc,
+                        BucketID bucket_id, AccessType type, u64 bytes,
+                        u64 count) {
+  u32 target_node = bucket_id.bits.node_id;
+  if (target_node == rpc->node_id) {
+    LocalRecordBucketAccess(context, bucket_id, type, bytes, count);
+  } else {
+    RpcCall<void>(rpc, target_node, "RemoteRecordBucketAccess", bucket_id,
+                  (int)type, bytes, count);
+  }
+}
+
+u64 RecordBlobRead(SharedMemoryContext *context, RpcContext *rpc,
+                   BlobID blob_id, u64 expected_generation, u64 bytes) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  u32 target_node = GetBlobNodeId(blob_id);
+  u64 result = 0;
+
+  if (target_node == rpc->node_id) {
+    result = LocalRecordBlobRead(mdm, blob_id, expected_generation, bytes);
+  } else {
+    result = RpcCall<u64>(rpc, target_node, "RemoteRecordBlobRead", blob_id,
+                          expected_generation, bytes);
+  }
+
+  return result;
+}
+
+void RecordBlobAccess(SharedMemoryContext *context, RpcContext *rpc,
+                      BucketID bucket_id, BlobID blob_id, AccessType type,
+                      u64 bytes) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+
+  // NOTE(chogan): Statistics are advisory, so remote updates don't wait for a
+  // response.
+  u32 blob_node = GetBlobNodeId(blob_id);
+  if (blob_node == rpc->node_id) {
+    LocalRecordBlobAccess(mdm, blob_id, type, bytes);
+  } else {
+    RpcCall<void>(rpc, blob_node, "RemoteRecordBlobAccess", blob_id, (int)type,
+                  bytes);
+  }
+
+  RecordBucketAccess(context, rpc, bucket_id, type, bytes);
+}
+
+AccessStats GetBlobStats(SharedMemoryContext *context, RpcContext *rpc,
+                         BlobID blob_id) {
+  AccessStats result = {};
+  u32 target_node = GetBlobNodeId(blob_id);
+
+  if (target_node == rpc->node_id) {
+    MetadataManager *mdm = GetMetadataManagerFromContext(context);
+    result = LocalGetBlobStats(mdm, blob_id);
+  } else {
+    result = RpcCall<AccessStats>(rpc, target_node, "RemoteGetBlobStats",
+                                  blob_id);
+  }
+
+  return result;
+}
+
+void SetBlobStats(SharedMemoryContext *context, RpcContext *rpc,
+                  BlobID blob_id, const AccessStats &stats) {
+  u32 target_node = GetBlobNodeId(blob_id);
+
+  if (target_node == rpc->node_id) {
+    MetadataManager *mdm = GetMetadataManagerFromContext(context);
+    LocalSetBlobStats(mdm, blob_id, stats);
+  } else {
+    RpcCall<bool>(rpc, target_node, "RemoteSetBlobStats", blob_id, stats);
+  }
+}
+
+AccessStats LocalGetBucketStats(SharedMemoryContext *context,
+                                BucketID bucket_id) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  BucketInfo *info = LocalGetBucketInfoById(mdm, bucket_id);
+  AccessStats result = GetStatsSnapshot(&info->stats, GetStatsTicks());
+
+  return result;
+}
+
+AccessStats GetBucketStats(SharedMemoryContext *context, RpcContext *rpc,
+                           BucketID bucket_id) {
+  AccessStats result = {};
+  u32 target_node = bucket_id.bits.node_id;
+
+  if (target_node == rpc->node_id) {
+    result = LocalGetBucketStats(context, bucket_id);
+  } else {
+    result = RpcCall<AccessStats>(rpc, target_node, "RemoteGetBucketStats",
+                                  bucket_id);
+  }
+
+  return result;
+}
+
+void LocalRecordVBucketAccess(SharedMemoryContext *context,
+                              VBucketID vbucket_id, AccessType type,
+                              u64 bytes) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  VBucketInfo *info = LocalGetVBucketInfoById(mdm, vbucket_id);
+  // NOTE(chogan): The update may arrive after the slot was freed.
+  if (info->active) {
+    RecordAccess(&info->stats, type, bytes, GetStatsTicks());
+  }
+}
+
+void RecordVBucketAccess(SharedMemoryContext *context, RpcContext *rpc,
+                         VBucketID vbucket_id, AccessType type, u64 bytes) {
+  u32 target_node = vbucket_id.bits.node_id;
+
+  if (target_node == rpc->node_id) {
+    LocalRecordVBucketAccess(context, vbucket_id, type, bytes);
+  } else {
+    RpcCall<void>(rpc, target_node, "RemoteRecordVBucketAccess", vbucket_id,
+                  (int)type, bytes);
+  }
+}
+
+AccessStats LocalGetVBucketStats(SharedMemoryContext *context,
+                                 VBucketID vbucket_id) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  VBucketInfo *info = LocalGetVBucketInfoById(mdm, vbucket_id);
+  AccessStats result = GetStatsSnapshot(&info->stats, GetStatsTicks());
+
+  return result;
+}
+
+AccessStats GetVBucketStats(SharedMemoryContext *context, RpcContext *rpc,
+                            VBucketID vbucket_id) {
+  AccessStats result = {};
+  u32 target_node = vbucket_id.bits.node_id;
+
+  if (target_node == rpc->node_id) {
+    result = LocalGetVBucketStats(context, vbucket_id);
+  } else {
+    result = RpcCall<AccessStats>(rpc, target_node, "RemoteGetVBucketStats",
+                                  vbucket_id);
+  }
+
+  return result;
+}
+
 }  // namespace hermes
@@ -17,6 +17,7 @@
 
 #include <atomic>
 #include <string>
+#include <vector>
 
 #include "memory_management.h"
 #include "buffer_pool.h"
@@ -33,11 +34,67 @@ enum MapType {
   kMapType_Count
 };
 
+enum AccessType {
+  kAccessType_Read,
+  kAccessType_Write,
+};
+
+/** Half-life of the decayed access frequency kept in Stats */
+const f64 kStatsHalfLifeMs = 60000.0;
+
+/**
+ * Access statistics for a Blob, Bucket, or VBucket.
+ *
+ * Lives in shared memory and is updated on the Put/Get paths with relaxed
+ * atomics, so concurrent updates may occasionally lose a decay step, but never
+ * block. Use GetStatsSnapshot to read a consistent-enough copy.
+ */
 struct Stats {
+  std::atomic<u64> reads;
+  std::atomic<u64> writes;
+  std::atomic<u64> bytes_read;
+  std::atomic<u64> bytes_written;
+  /** Milliseconds on the node's monotonic clock (see GetStatsTicks) */
+  std::atomic<u64> last_access_ticks;
+  /** Decayed access count as of `last_access_ticks` */
+  std::atomic<f64> frequency;
 };
 
+/**
+ * Per-Blob metadata stored between a Blob's embedded `IdList` and its
+ * `BufferID`s.
+ */
+struct BlobHeader {
+  Stats stats;
+  /** Changes every time the Blob's `BufferID`s are replaced, so a migration
+   * can detect that the Blob was modified while its data was being copied. */
+  u64 generation;
+  /** Offset into the id Heap of the Blob's name, without its Bucket prefix */
+  u32 name_offset;
+  u16 name_length;
+  /** Matches `BlobID::bits.generation` until the Blob is freed, then 0 */
+  u16 id_generation;
+};
+
+/**
+ * Blob names are scoped per Bucket. Internally, each Blob name is prefixed with
+ * a compact encoding of its BucketID (see MakeInternalBlobName).
+ *
+ * The Blob map is the same string-keyed IdMap as the Bucket and VBucket maps,
+ * and the key's hash also picks the node that owns the entry, so the Bucket is
+ * folded into the key instead of using a (BucketID, name hash) key. Every
+ * lookup still hashes the whole prefixed key, and each key is 4 bytes longer
+ * for small BucketIDs, up to 12 bytes for large ones.
+ */
+const int kMaxCompactU32Size = 5;
+
+/** Initial capacity of a ChunkedIdList. It doubles each time it fills up. */
 const int kIdListChunkSize = 10;
 
+/**
+ * A growable list of IDs in the metadata id Heap, followed by a hash index from
+ * ID to slot (see metadata_storage_stb_ds.cc).
+ */
 struct ChunkedIdList {
   u32 head_offset;
   u32 length;
@@ -54,6 +111,12 @@ struct BufferIdArray {
   u32 length;
 };
 
+/** The Blobs on one node that match a BlobPredicate (see GetBlobIds) */
+struct BlobIdPage {
+  std::vector<BlobID> ids;
+  std::vector<std::string> names;
+};
+
 struct BucketInfo {
   BucketID next_free;
   ChunkedIdList blobs;
@@ -99,6 +162,12 @@ struct MetadataManager {
 
   ptrdiff_t swap_filename_prefix_offset;
   ptrdiff_t swap_filename_suffix_offset;
+  ptrdiff_t swap_log_offset;
+  /** 0 if checkpointing is disabled (see checkpoint.h) */
+  ptrdiff_t checkpoint_filename_offset;
+  u64 config_fingerprint;
+  /** The number of bytes of shared memory saved in a checkpoint */
+  u64 checkpoint_size;
 
   // TODO(chogan): @optimization Should the TicketMutexes here be reader/writer
   // locks?
@@ -123,6 +192,9 @@ struct MetadataManager {
 
   IdList node_targets;
 
+  /** The next `BlobHeader::generation` to hand out. Protected by `id_mutex`. */
+  u64 blob_generation;
+
   u32 system_view_state_update_interval_ms;
   u32 global_system_view_state_node_id;
   u32 num_buckets;
@@ -155,7 +227,8 @@ void DestroyBlobByName(SharedMemoryContext *context, RpcContext *rpc,
  *
  */
 void RenameBlob(SharedMemoryContext *context, RpcContext *rpc,
-                const std::string &old_name, const std::string &new_name);
+                const std::string &old_name, const std::string &new_name,
+                BucketID bucket_id);
 
 /**
  *
@@ -182,13 +255,19 @@ BufferIdArray GetBufferIdsFromBlobId(Arena *arena,
 BufferIdArray GetBufferIdsFromBlobName(Arena *arena,
                                        SharedMemoryContext *context,
                                        RpcContext *rpc, const char *blob_name,
-                                       u32 **sizes);
+                                       BucketID bucket_id, u32 **sizes);
 
 /**
  *
  */
 BlobID GetBlobIdByName(SharedMemoryContext *context, RpcContext *rpc,
-                       const char *name);
+                       const char *name, BucketID bucket_id);
+
+/**
+ * Returns the key under which the Blob @p name in Bucket @p id is stored in the
+ * Blob map.
+ */
+std::string MakeInternalBlobName(const std::string &name, BucketID id);
 
 /**
  *
@@ -208,12 +287,28 @@ VBucketID GetOrCreateVBucketId(SharedMemoryContext *context, RpcContext *rpc,
                                const std::string &name);
 
 /**
+ * Returns the new BlobID.
+ */
+BlobID AttachBlobToBucket(SharedMemoryContext *context, RpcContext *rpc,
+                          const char *blob_name, BucketID bucket_id,
+                          const std::vector<BufferID> &buffer_ids,
+                          bool is_swap_blob = false);
+
+/**
+ * Attaches each of @p names with its list of @p buffer_ids to a Bucket, like
+ * AttachBlobToBucket, and records a write of @p sizes bytes. A Blob that
+ * already has one of the names is destroyed, and its access statistics carry
+ * over to the new Blob. Instead of a few metadata updates per Blob, this makes
+ * one update on each node that owns some of the Blob names, plus one on the
+ * node that owns the Bucket.
  *
+ * Returns the new BlobIDs in the order of @p names.
  */
-void AttachBlobToBucket(SharedMemoryContext *context, RpcContext *rpc,
-                        const char *blob_name, BucketID bucket_id,
-                        const std::vector<BufferID> &buffer_ids,
-                        bool is_swap_blob = false);
+std::vector<BlobID>
+AttachBlobsToBucket(SharedMemoryContext *context, RpcContext *rpc,
+                    const std::vector<std::string> &names, BucketID bucket_id,
+                    const std::vector<std::vector<BufferID>> &buffer_ids,
+                    const std::vector<u64> &sizes, bool is_swap = false);
 
 /**
  *
@@ -268,6 +363,19 @@ TargetID FindTargetIdFromDeviceId(const std::vector<TargetID> &targets,
  */
 std::vector<BlobID> GetBlobIds(SharedMemoryContext *context, RpcContext *rpc,
                                BucketID bucket_id);
+
+/**
+ * Returns up to @p max_results Blobs in Bucket @p bucket_id that match
+ * @p pred, continuing from @p cursor and advancing it.
+ *
+ * The predicate is evaluated on the nodes that store the Blob metadata, so
+ * only matches are transferred. If @p names is non-null, the matching Blob
+ * names are appended to it in the same order as the returned IDs.
+ */
+std::vector<BlobID> GetBlobIds(SharedMemoryContext *context, RpcContext *rpc,
+                               BucketID bucket_id, const BlobPredicate &pred,
+                               BlobCursor *cursor, u32 max_results,
+                               std::vector<std::string> *names = NULL);
 /**
  *
  */
@@ -290,6 +398,97 @@ void DecrementRefcount(SharedMemoryContext *context, RpcContext *rpc,
  */
 bool IsNullBlobId(BlobID id);
 
+/**
+ * Returns the current time in milliseconds on this node's monotonic clock.
+ */
+u64 GetStatsTicks();
+
+/**
+ * Returns @p frequency decayed by @p elapsed_ticks milliseconds.
+ */
+f64 DecayFrequency(f64 frequency, u64 elapsed_ticks);
+
+/**
+ * Resets all counters in @p stats to 0.
+ */
+void ResetStats(Stats *stats);
+
+/**
+ * Records @p count accesses totaling @p bytes bytes at time @p ticks.
+ */
+void RecordAccess(Stats *stats, AccessType type, u64 bytes, u64 ticks,
+                  u64 count = 1);
+
+/**
+ * Overwrites @p stats with the counters in @p snapshot. The snapshot's
+ * frequency is treated as current as of time @p ticks.
+ */
+void SetStats(Stats *stats, const AccessStats &snapshot, u64 ticks);
+
+/**
+ * Copies @p stats, with the frequency decayed to time @p ticks.
+ */
+AccessStats GetStatsSnapshot(Stats *stats, u64 ticks);
+
+/**
+ * Records an access of @p bytes bytes to a Blob and its Bucket.
+ *
+ * Updates to metadata on remote nodes are sent without waiting for a response.
+ */
+void RecordBlobAccess(SharedMemoryContext *context, RpcContext *rpc,
+                      BucketID bucket_id, BlobID blob_id, AccessType type,
+                      u64 bytes);
+
+/**
+ * Records @p count accesses totaling @p bytes bytes to a Bucket.
+ *
+ * Updates to metadata on remote nodes are sent without waiting for a response.
+ */
+void RecordBucketAccess(SharedMemoryContext *context, RpcContext *rpc,
+                        BucketID bucket_id, AccessType type, u64 bytes,
+                        u64 count = 1);
+
+/**
+ * Records a read of @p bytes bytes from @p blob_id, but only if the Blob's
+ * generation is still @p expected_generation, and returns its current
+ * generation (see GetBlobGeneration). A reader can check for a concurrent
+ * migration and update the Blob's statistics with one request.
+ */
+u64 RecordBlobRead(SharedMemoryContext *context, RpcContext *rpc,
+                   BlobID blob_id, u64 expected_generation, u64 bytes);
+
+/**
+ * Records an access to a Blob through a VBucket.
+ */
+void RecordVBucketAccess(SharedMemoryContext *context, RpcContext *rpc,
+                         VBucketID vbucket_id, AccessType type, u64 bytes);
+
+/**
+ * Returns the access statistics of the Blob @p blob_id.
+ */
+AccessStats GetBlobStats(SharedMemoryContext *context, RpcContext *rpc,
+                         BlobID blob_id);
+
+/**
+ * Overwrites the statistics of @p blob_id with @p stats. Used to carry
+ * statistics across operations that replace a Blob's BlobID, such as
+ * overwriting it or moving it out of swap.
+ */
+void SetBlobStats(SharedMemoryContext *context, RpcContext *rpc,
+                  BlobID blob_id, const AccessStats &stats);
+
+/**
+ * Returns the aggregate access statistics of all Blobs in Bucket @p bucket_id.
+ */
+AccessStats GetBucketStats(SharedMemoryContext *context, RpcContext *rpc,
+                           BucketID bucket_id);
+
+/**
+ * Returns the access statistics of VBucket @p vbucket_id.
+ */
+AccessStats GetVBucketStats(SharedMemoryContext *context, RpcContext *rpc,
+                            VBucketID vbucket_id);
+
 }  // namespace hermes
 
 #endif  // HERMES_METADATA_MANAGEMENT_H_
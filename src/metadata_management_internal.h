@@ -20,6 +20,7 @@ namespace hermes {
 bool IsNullBucketId(BucketID id);
 bool IsNullVBucketId(VBucketID id);
 bool IsNullBlobId(BlobID id);
+u32 GetBlobNodeId(BlobID id);
 bool IsNullTargetId(TargetID id);
 TicketMutex *GetMapMutex(MetadataManager *mdm, MapType map_type);
 VBucketID GetVBucketIdByName(SharedMemoryContext *context, RpcContext *rpc,
@@ -28,16 +29,35 @@ u32 HashString(MetadataManager *mdm, RpcContext *rpc, const char *str);
 MetadataManager *GetMetadataManagerFromContext(SharedMemoryContext *context);
 BucketInfo *LocalGetBucketInfoByIndex(MetadataManager *mdm, u32 index);
 VBucketInfo *GetVBucketInfoByIndex(MetadataManager *mdm, u32 index);
-u32 AllocateBufferIdList(SharedMemoryContext *context, RpcContext *rpc,
-                         u32 target_node,
-                         const std::vector<BufferID> &buffer_ids);
+BlobID AllocateBufferIdList(SharedMemoryContext *context, RpcContext *rpc,
+                            u32 target_node,
+                            const std::vector<BufferID> &buffer_ids,
+                            const std::string &blob_name,
+                            bool is_swap_blob = false);
 std::vector<BufferID> GetBufferIdList(SharedMemoryContext *context,
                                       RpcContext *rpc, BlobID blob_id);
 void FreeBufferIdList(SharedMemoryContext *context, RpcContext *rpc,
                       BlobID blob_id);
+u64 GetBlobGeneration(SharedMemoryContext *context, RpcContext *rpc,
+                      BlobID blob_id);
+bool ReplaceBufferIdList(SharedMemoryContext *context, RpcContext *rpc,
+                         BlobID blob_id, u64 expected_generation,
+                         const std::vector<BufferID> &buffer_ids);
+void SetBlobName(SharedMemoryContext *context, RpcContext *rpc,
+                 BlobID blob_id, const std::string &name);
 
 void LocalAddBlobIdToBucket(MetadataManager *mdm, BucketID bucket_id,
                             BlobID blob_id);
+void LocalAddBlobIdsToBucket(SharedMemoryContext *context, BucketID bucket_id,
+                             const std::vector<BlobID> &blob_ids,
+                             const std::vector<BlobID> &replaced_ids,
+                             const std::vector<u64> &sizes);
+std::vector<BlobID>
+LocalAttachBlobs(SharedMemoryContext *context, RpcContext *rpc,
+                 const std::vector<std::string> &internal_names,
+                 const std::vector<std::vector<BufferID>> &buffer_ids,
+                 const std::vector<u64> &sizes, bool is_swap,
+                 std::vector<BlobID> *replaced_ids);
 void LocalAddBlobIdToVBucket(MetadataManager *mdm, VBucketID vbucket_id,
                              BlobID blob_id);
 std::vector<BufferID> LocalGetBufferIdList(MetadataManager *mdm,
@@ -51,10 +71,18 @@ void LocalDestroyBlobById(SharedMemoryContext *context, RpcContext *rpc,
                           BlobID blob_id);
 void LocalDestroyBlobByName(SharedMemoryContext *context, RpcContext *rpc,
                             const char *blob_name, BlobID blob_id);
+void FreeBlob(SharedMemoryContext *context, RpcContext *rpc, BlobID blob_id);
+void LocalDestroyBucketBlobs(SharedMemoryContext *context, RpcContext *rpc,
+                             BucketID bucket_id,
+                             const std::vector<BlobID> &blob_ids);
+void DestroyBucketBlobs(SharedMemoryContext *context, RpcContext *rpc,
+                        BucketID bucket_id,
+                        const std::vector<BlobID> &blob_ids);
 BucketID LocalGetNextFreeBucketId(SharedMemoryContext *context, RpcContext *rpc,
                                   const std::string &name);
-u32 LocalAllocateBufferIdList(MetadataManager *mdm,
-                              const std::vector<BufferID> &buffer_ids);
+BlobID LocalAllocateBufferIdList(MetadataManager *mdm,
+                                 const std::vector<BufferID> &buffer_ids,
+                                 const std::string &blob_name, i32 node_id);
 void LocalRenameBucket(SharedMemoryContext *context, RpcContext *rpc,
                        BucketID id, const std::string &old_name,
                        const std::string &new_name);
@@ -62,6 +90,29 @@ bool LocalContainsBlob(SharedMemoryContext *context, BucketID bucket_id,
                        BlobID blob_id);
 void LocalRemoveBlobFromBucketInfo(SharedMemoryContext *context,
                                    BucketID bucket_id, BlobID blob_id);
+void LocalRecordBlobAccess(MetadataManager *mdm, BlobID blob_id,
+                           AccessType type, u64 bytes);
+void LocalRecordBucketAccess(SharedMemoryContext *context, BucketID bucket_id,
+                             AccessType type, u64 bytes, u64 count = 1);
+void LocalRecordVBucketAccess(SharedMemoryContext *context,
+                              VBucketID vbucket_id, AccessType type,
+                              u64 bytes);
+AccessStats LocalGetBlobStats(MetadataManager *mdm, BlobID blob_id);
+void LocalSetBlobStats(MetadataManager *mdm, BlobID blob_id,
+                       const AccessStats &stats);
+u64 LocalGetBlobGeneration(MetadataManager *mdm, BlobID blob_id);
+u64 LocalRecordBlobRead(MetadataManager *mdm, BlobID blob_id,
+                        u64 expected_generation, u64 bytes);
+std::string LocalGetBlobName(MetadataManager *mdm, BlobID blob_id);
+void LocalSetBlobName(MetadataManager *mdm, BlobID blob_id,
+                      const std::string &name);
+bool LocalReplaceBufferIdList(MetadataManager *mdm, BlobID blob_id,
+                              u64 expected_generation,
+                              const std::vector<BufferID> &buffer_ids);
+AccessStats LocalGetBucketStats(SharedMemoryContext *context,
+                                BucketID bucket_id);
+AccessStats LocalGetVBucketStats(SharedMemoryContext *context,
+                                 VBucketID vbucket_id);
 void LocalIncrementRefcount(SharedMemoryContext *context, BucketID id);
 void LocalDecrementRefcount(SharedMemoryContext *context, BucketID id);
 void LocalIncrementRefcount(SharedMemoryContext *context, VBucketID id);
@@ -92,9 +143,17 @@ void InitMetadataStorage(SharedMemoryContext *context, MetadataManager *mdm,
 std::vector<u64>
 GetRemainingNodeCapacities(SharedMemoryContext *context,
                            const std::vector<TargetID> &targets);
-std::string GetSwapFilename(MetadataManager *mdm, u32 node_id);
+std::string GetSwapFilename(MetadataManager *mdm, u32 node_id, u32 segment);
 std::vector<BlobID> LocalGetBlobIds(SharedMemoryContext *context,
                                     BucketID bucket_id);
+std::vector<BlobID> LocalGetBlobIds(SharedMemoryContext *context,
+                                    BucketID bucket_id, u32 start_index,
+                                    u32 max_ids);
+BlobIdPage LocalFilterBlobIds(SharedMemoryContext *context, RpcContext *rpc,
+                              const std::vector<BlobID> &blob_ids,
+                              const BlobPredicate &pred);
+bool BlobMatchesPredicate(SharedMemoryContext *context, RpcContext *rpc,
+                          BlobID blob_id, const BlobPredicate &pred);
 
 }  // namespace hermes
 #endif  // HERMES_METADATA_MANAGEMENT_INTERNAL_H_
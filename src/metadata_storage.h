@@ -58,11 +58,41 @@ size_t GetStoredMapSize(MetadataManager *mdm, MapType map_type);
  */
 std::vector<TargetID> GetNodeTargets(SharedMemoryContext *context);
 
+/**
+ * Returns the ID of every Blob whose name is stored on this node.
+ */
+std::vector<BlobID> LocalGetAllBlobIds(MetadataManager *mdm);
+
+/**
+ * Returns the IDs of at most @p max_ids Blobs whose names are stored on this
+ * node, starting at @p cursor, and advances @p cursor past them. The cursor
+ * wraps to the beginning once every Blob has been visited. Blobs added or
+ * removed between calls may be skipped or visited twice in one pass.
+ */
+std::vector<BlobID> LocalScanBlobIds(MetadataManager *mdm, u32 *cursor,
+                                     u32 max_ids);
+
 /**
  *
  */
 std::vector<BlobID> LocalGetBlobIds(SharedMemoryContext *context,
                                     BucketID bucket_id);
+
+/**
+ * Returns up to @p max_ids BlobIDs from Bucket @p bucket_id's list of Blobs,
+ * starting at position @p start_index.
+ */
+std::vector<BlobID> LocalGetBlobIds(SharedMemoryContext *context,
+                                    BucketID bucket_id, u32 start_index,
+                                    u32 max_ids);
+
+/**
+ * Returns the Blobs among @p blob_ids that match @p pred. The Blobs must be
+ * stored on this node.
+ */
+BlobIdPage LocalFilterBlobIds(SharedMemoryContext *context, RpcContext *rpc,
+                              const std::vector<BlobID> &blob_ids,
+                              const BlobPredicate &pred);
 }  // namespace hermes
 
 #endif  // HERMES_METADATA_STORAGE_H_
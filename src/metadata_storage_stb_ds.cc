@@ -174,14 +174,50 @@ u64 *GetIdsPtr(MetadataManager *mdm, T id_list) {
   return result;
 }
 
+/** The number of u64 slots a `BlobHeader` occupies in the id heap. */
+static const u32 kBlobHeaderLength = sizeof(BlobHeader) / sizeof(u64);
+
+/**
+ * Returns the `BlobHeader` stored between an embedded `IdList` and its IDs.
+ *
+ * The caller must hold the `id_mutex` so the list can't be freed while the
+ * `BlobHeader` is being accessed.
+ */
+static BlobHeader *GetEmbeddedBlobHeader(MetadataManager *mdm, u32 offset) {
+  Heap *id_heap = GetIdHeap(mdm);
+  IdList *embedded_id_list = (IdList *)HeapOffsetToPtr(id_heap, offset);
+  BlobHeader *result = (BlobHeader *)(embedded_id_list + 1);
+
+  return result;
+}
+
+/**
+ * Returns the `BlobHeader` of @p blob_id, or NULL if the Blob was freed.
+ *
+ * A freed id list's heap offset may be reused by another Blob, so the header's
+ * `id_generation` must match the one in the BlobID. The caller must hold the
+ * `id_mutex`.
+ */
+static BlobHeader *GetBlobHeader(MetadataManager *mdm, BlobID blob_id) {
+  BlobHeader *result = GetEmbeddedBlobHeader(mdm,
+                                             blob_id.bits.buffer_ids_offset);
+  if (result->id_generation == 0 ||
+      result->id_generation != blob_id.bits.generation) {
+    result = 0;
+  }
+
+  return result;
+}
+
 /**
  * Returns a copy of an embedded `IdList`.
  *
  * An `IdList` that consists of `BufferID`s contains an embedded `IdList` as the
- * first element of the list. This is so the `BlobID` can find information about
- * its buffers from a single offset. If you want a pointer to the `BufferID`s in
- * an `IdList`, then you have to first retrieve the embedded `IdList` using this
- * function, and then use the resulting `IdList` in `GetIdsPtr`.
+ * first element of the list, followed by the Blob's `BlobHeader`. This is so
+ * the `BlobID` can find information about its buffers from a single offset. If
+ * you want a pointer to the `BufferID`s in an `IdList`, then you have to first
+ * retrieve the embedded `IdList` using this function, and then use the
+ * resulting `IdList` in `GetIdsPtr`.
  */
 IdList GetEmbeddedIdList(MetadataManager *mdm, u32 offset) {
   Heap *id_heap = GetIdHeap(mdm);
@@ -202,9 +238,19 @@ IdList GetEmbeddedIdList(MetadataManager *mdm, u32 offset) {
  */
 BufferID *GetBufferIdsPtrFromBlobId(MetadataManager *mdm, BlobID blob_id,
                                     size_t &length) {
-  IdList id_list = GetEmbeddedIdList(mdm, blob_id.bits.buffer_ids_offset);
-  length = id_list.length;
-  BufferID *result = (BufferID *)GetIdsPtr(mdm, id_list);
+  Heap *id_heap = GetIdHeap(mdm);
+  BeginTicketMutex(&mdm->id_mutex);
+  BufferID *result = 0;
+  length = 0;
+  // NOTE(chogan): The embedded IdList must be read under the same lock as the
+  // IDs it points to, since LocalReplaceBufferIdList can change both.
+  if (GetBlobHeader(mdm, blob_id)) {
+    IdList *embedded_id_list =
+      (IdList *)HeapOffsetToPtr(id_heap, blob_id.bits.buffer_ids_offset);
+    length = embedded_id_list->length;
+    result = (BufferID *)HeapOffsetToPtr(id_heap,
+                                         embedded_id_list->head_offset);
+  }
 
   return result;
 }
@@ -238,22 +284,146 @@ void FreeIdList(MetadataManager *mdm, T id_list) {
   EndTicketMutex(&mdm->id_mutex);
 }
 
-void FreeEmbeddedIdList(MetadataManager *mdm, u32 offset) {
+/**
+ * Returns the heap offset of the IDs that were allocated together with the
+ * embedded `IdList` at @p offset. If the embedded `IdList`'s `head_offset`
+ * differs from this, the IDs were moved to a separate allocation by
+ * LocalReplaceBufferIdList.
+ */
+static u32 GetInlineIdsOffset(MetadataManager *mdm, u32 offset) {
+  Heap *id_heap = GetIdHeap(mdm);
+  u64 *embedded_id_list = (u64 *)HeapOffsetToPtr(id_heap, offset);
+  u32 result = GetHeapOffset(id_heap, (u8 *)(embedded_id_list + 1 +
+                                             kBlobHeaderLength));
+
+  return result;
+}
+
+void FreeEmbeddedIdList(MetadataManager *mdm, BlobID blob_id) {
   Heap *id_heap = GetIdHeap(mdm);
+  u32 offset = blob_id.bits.buffer_ids_offset;
   BeginTicketMutex(&mdm->id_mutex);
-  u8 *to_free = HeapOffsetToPtr(id_heap, offset);
-  HeapFree(id_heap, to_free);
+  BlobHeader *header = GetBlobHeader(mdm, blob_id);
+  // NOTE(chogan): A stale BlobID must not free the list of the Blob that now
+  // has its offset.
+  if (header) {
+    IdList *embedded_id_list = (IdList *)HeapOffsetToPtr(id_heap, offset);
+    if (embedded_id_list->head_offset != GetInlineIdsOffset(mdm, offset)) {
+      HeapFree(id_heap,
+               HeapOffsetToPtr(id_heap, embedded_id_list->head_offset));
+    }
+    if (header->name_length) {
+      HeapFree(id_heap, HeapOffsetToPtr(id_heap, header->name_offset));
+    }
+    // NOTE(chogan): Generations start at 1, so a pending move of this Blob
+    // will fail its generation check instead of writing to freed memory.
+    header->generation = 0;
+    header->id_generation = 0;
+    u8 *to_free = HeapOffsetToPtr(id_heap, offset);
+    HeapFree(id_heap, to_free);
+  }
   EndTicketMutex(&mdm->id_mutex);
 }
 
+/**
+ * A `ChunkedIdList` allocation stores `capacity` IDs followed by an open
+ * addressing hash table of `2 * capacity` u32 entries that maps each ID to its
+ * slot in the list. An entry of 0 is empty, otherwise it holds the slot + 1.
+ * This gives O(1) membership tests and removals without touching the order of
+ * the IDs that callers iterate over.
+ */
+static inline u32 GetSlotIndexSize(u32 capacity) {
+  u32 result = 2 * capacity;
+
+  return result;
+}
+
+static inline u32 *GetSlotIndex(u64 *ids, u32 capacity) {
+  u32 *result = (u32 *)(ids + capacity);
+
+  return result;
+}
+
+static inline u32 HashIdForSlotIndex(u64 id, u32 index_size) {
+  // NOTE(chogan): Fibonacci hashing. BlobIDs differ mostly in their low bits.
+  u64 hash = id * 11400714819323198485ull;
+  u32 result = (u32)((hash >> 32) % index_size);
+
+  return result;
+}
+
+/**
+ * Returns the position of @p id in the slot index, or the index size if @p id
+ * is not in the list.
+ */
+static u32 FindSlotIndexEntry(u64 *ids, u32 capacity, u64 id) {
+  u32 index_size = GetSlotIndexSize(capacity);
+  u32 *index = GetSlotIndex(ids, capacity);
+  u32 result = index_size;
+
+  u32 i = HashIdForSlotIndex(id, index_size);
+  while (index[i] != 0) {
+    if (ids[index[i] - 1] == id) {
+      result = i;
+      break;
+    }
+    i = (i + 1) % index_size;
+  }
+
+  return result;
+}
+
+static void InsertIntoSlotIndex(u64 *ids, u32 capacity, u32 slot) {
+  u32 index_size = GetSlotIndexSize(capacity);
+  u32 *index = GetSlotIndex(ids, capacity);
+
+  u32 i = HashIdForSlotIndex(ids[slot], index_size);
+  while (index[i] != 0) {
+    i = (i + 1) % index_size;
+  }
+  index[i] = slot + 1;
+}
+
+/**
+ * Removes the entry at @p pos with backward shift deletion so that lookups
+ * never need tombstones.
+ */
+static void RemoveFromSlotIndex(u64 *ids, u32 capacity, u32 pos) {
+  u32 index_size = GetSlotIndexSize(capacity);
+  u32 *index = GetSlotIndex(ids, capacity);
+
+  u32 hole = pos;
+  u32 i = pos;
+  for (;;) {
+    i = (i + 1) % index_size;
+    if (index[i] == 0) {
+      break;
+    }
+    u32 home = HashIdForSlotIndex(ids[index[i] - 1], index_size);
+    bool stays = (hole <= i) ? (hole < home && home <= i)
+                             : (hole < home || home <= i);
+    if (!stays) {
+      index[hole] = index[i];
+      hole = i;
+    }
+  }
+  index[hole] = 0;
+}
+
 /**
  * Assumes the caller has protected @p id_list with a lock.
  */
 void AllocateOrGrowIdList(MetadataManager *mdm, ChunkedIdList *id_list) {
   Heap *id_heap = GetIdHeap(mdm);
-  // NOTE(chogan): grow capacity by kIdListChunkSize IDs
-  size_t new_capacity = id_list->capacity + kIdListChunkSize;
-  u64 *new_ids = HeapPushArray<u64>(id_heap, new_capacity);
+  // NOTE(chogan): Grow geometrically so that appending N IDs costs O(N) in
+  // total. The slot index takes the same number of bytes as the IDs.
+  u32 new_capacity = (id_list->capacity == 0 ? kIdListChunkSize
+                                             : id_list->capacity * 2);
+  BeginTicketMutex(&mdm->id_mutex);
+  u64 *new_ids = HeapPushArray<u64>(id_heap, 2 * new_capacity);
+  EndTicketMutex(&mdm->id_mutex);
+  memset(GetSlotIndex(new_ids, new_capacity), 0,
+         GetSlotIndexSize(new_capacity) * sizeof(u32));
 
   if (id_list->capacity != 0) {
     // NOTE(chogan): Copy over old ids and then free them
@@ -266,6 +436,10 @@ void AllocateOrGrowIdList(MetadataManager *mdm, ChunkedIdList *id_list) {
     id_list->length = 0;
   }
 
+  for (u32 i = 0; i < id_list->length; ++i) {
+    InsertIntoSlotIndex(new_ids, new_capacity, i);
+  }
+
   id_list->capacity = new_capacity;
   id_list->head_offset = GetHeapOffset(id_heap, (u8 *)new_ids);
 }
@@ -280,10 +454,62 @@ void AppendToChunkedIdList(MetadataManager *mdm, ChunkedIdList *id_list,
   }
 
   u64 *head = GetIdsPtr(mdm, *id_list);
-  head[id_list->length++] = id;
+  u32 slot = id_list->length++;
+  head[slot] = id;
+  InsertIntoSlotIndex(head, id_list->capacity, slot);
   ReleaseIdsPtr(mdm);
 }
 
+/**
+ * Removes @p id from @p id_list in O(1) by moving the last ID into its slot.
+ * Returns true if @p id was found. Assumes the caller has protected @p id_list
+ * with a lock.
+ */
+bool RemoveFromChunkedIdList(MetadataManager *mdm, ChunkedIdList *id_list,
+                             u64 id) {
+  bool result = false;
+  if (id_list->capacity == 0) {
+    return result;
+  }
+
+  u64 *ids = GetIdsPtr(mdm, *id_list);
+  u32 pos = FindSlotIndexEntry(ids, id_list->capacity, id);
+  if (pos < GetSlotIndexSize(id_list->capacity)) {
+    u32 *index = GetSlotIndex(ids, id_list->capacity);
+    u32 slot = index[pos] - 1;
+    u32 last = id_list->length - 1;
+    RemoveFromSlotIndex(ids, id_list->capacity, pos);
+
+    if (slot != last) {
+      u32 last_pos = FindSlotIndexEntry(ids, id_list->capacity, ids[last]);
+      assert(last_pos < GetSlotIndexSize(id_list->capacity));
+      index[last_pos] = slot + 1;
+      ids[slot] = ids[last];
+    }
+    id_list->length--;
+    result = true;
+  }
+  ReleaseIdsPtr(mdm);
+
+  return result;
+}
+
+/**
+ * Assumes the caller has protected @p id_list with a lock.
+ */
+bool ChunkedIdListContains(MetadataManager *mdm, ChunkedIdList *id_list,
+                           u64 id) {
+  bool result = false;
+  if (id_list->capacity != 0) {
+    u64 *ids = GetIdsPtr(mdm, *id_list);
+    u32 pos = FindSlotIndexEntry(ids, id_list->capacity, id);
+    result = pos < GetSlotIndexSize(id_list->capacity);
+    ReleaseIdsPtr(mdm);
+  }
+
+  return result;
+}
+
 void LocalAddBlobIdToBucket(MetadataManager *mdm, BucketID bucket_id,
                             BlobID blob_id) {
   BeginTicketMutex(&mdm->bucket_mutex);
@@ -294,6 +520,30 @@ void LocalAddBlobIdToBucket(MetadataManager *mdm, BucketID bucket_id,
   CheckHeapOverlap(mdm);
 }
 
+void LocalAddBlobIdsToBucket(SharedMemoryContext *context, BucketID bucket_id,
+                             const std::vector<BlobID> &blob_ids,
+                             const std::vector<BlobID> &replaced_ids,
+                             const std::vector<u64> &sizes) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  BeginTicketMutex(&mdm->bucket_mutex);
+  BucketInfo *info = LocalGetBucketInfoById(mdm, bucket_id);
+  for (const auto &replaced_id : replaced_ids) {
+    if (!IsNullBlobId(replaced_id)) {
+      RemoveFromChunkedIdList(mdm, &info->blobs, replaced_id.as_int);
+    }
+  }
+  for (const auto &blob_id : blob_ids) {
+    AppendToChunkedIdList(mdm, &info->blobs, blob_id.as_int);
+  }
+  EndTicketMutex(&mdm->bucket_mutex);
+
+  for (size_t i = 0; i < blob_ids.size(); ++i) {
+    LocalRecordBucketAccess(context, bucket_id, kAccessType_Write, sizes[i]);
+  }
+
+  CheckHeapOverlap(mdm);
+}
+
 void LocalAddBlobIdToVBucket(MetadataManager *mdm, VBucketID vbucket_id,
                              BlobID blob_id) {
   BeginTicketMutex(&mdm->vbucket_mutex);
@@ -318,16 +568,48 @@ IdList AllocateIdList(MetadataManager *mdm, u32 length) {
   return result;
 }
 
-u32 AllocateEmbeddedIdList(MetadataManager *mdm, u32 length) {
+/**
+ * Stores a copy of @p name in the id Heap and points @p header at it. The
+ * caller must hold the `id_mutex`.
+ */
+static void SetEmbeddedBlobName(MetadataManager *mdm, BlobHeader *header,
+                                const std::string &name) {
+  Heap *id_heap = GetIdHeap(mdm);
+  header->name_offset = 0;
+  header->name_length = (u16)name.size();
+  if (header->name_length) {
+    char *name_memory = HeapPushArray<char>(id_heap, header->name_length);
+    memcpy(name_memory, name.data(), header->name_length);
+    header->name_offset = GetHeapOffset(id_heap, (u8 *)name_memory);
+  }
+}
+
+/**
+ * Allocates an embedded `IdList` with room for @p length IDs, and returns its
+ * heap offset. The new `BlobHeader::id_generation` is returned in
+ * @p id_generation.
+ */
+u32 AllocateEmbeddedIdList(MetadataManager *mdm, u32 length,
+                           const std::string &blob_name, u16 *id_generation) {
   static_assert(sizeof(IdList) == sizeof(u64));
+  static_assert(sizeof(BlobHeader) % sizeof(u64) == 0);
   Heap *id_heap = GetIdHeap(mdm);
   BeginTicketMutex(&mdm->id_mutex);
-  // NOTE(chogan): Add 1 extra for the embedded IdList
-  u64 *id_list_memory = HeapPushArray<u64>(id_heap, length + 1);
+  // NOTE(chogan): Add 1 extra for the embedded IdList, plus room for the
+  // BlobHeader
+  u64 *id_list_memory = HeapPushArray<u64>(id_heap,
+                                           length + 1 + kBlobHeaderLength);
   IdList *embedded_id_list = (IdList *)id_list_memory;
+  BlobHeader *header = (BlobHeader *)(embedded_id_list + 1);
+  ResetStats(&header->stats);
+  header->generation = mdm->blob_generation++;
+  // NOTE(chogan): 0 is reserved for freed Blobs.
+  header->id_generation = (u16)(header->generation % 0xFFFF + 1);
+  *id_generation = header->id_generation;
+  SetEmbeddedBlobName(mdm, header, blob_name);
   embedded_id_list->length = length;
   embedded_id_list->head_offset =
-    GetHeapOffset(id_heap, (u8 *)(embedded_id_list + 1));
+    GetHeapOffset(id_heap, (u8 *)(id_list_memory + 1 + kBlobHeaderLength));
   u32 result = GetHeapOffset(id_heap, (u8 *)embedded_id_list);
   EndTicketMutex(&mdm->id_mutex);
   CheckHeapOverlap(mdm);
@@ -351,17 +633,96 @@ std::vector<BlobID> LocalGetBlobIds(SharedMemoryContext *context,
   return result;
 }
 
-u32 LocalAllocateBufferIdList(MetadataManager *mdm,
-                              const std::vector<BufferID> &buffer_ids) {
+std::vector<BlobID> LocalGetBlobIds(SharedMemoryContext *context,
+                                    BucketID bucket_id, u32 start_index,
+                                    u32 max_ids) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  std::vector<BlobID> result;
+
+  BeginTicketMutex(&mdm->bucket_mutex);
+  BucketInfo *info = LocalGetBucketInfoById(mdm, bucket_id);
+  u32 num_blobs = info->blobs.length;
+  if (start_index < num_blobs) {
+    u32 end_index = std::min(num_blobs, start_index + max_ids);
+    result.resize(end_index - start_index);
+    BlobID *blob_ids = (BlobID *)GetIdsPtr(mdm, info->blobs);
+    for (u32 i = start_index; i < end_index; ++i) {
+      result[i - start_index] = blob_ids[i];
+    }
+    ReleaseIdsPtr(mdm);
+  }
+  EndTicketMutex(&mdm->bucket_mutex);
+
+  return result;
+}
+
+std::string LocalGetBlobName(MetadataManager *mdm, BlobID blob_id) {
+  Heap *id_heap = GetIdHeap(mdm);
+  std::string result;
+  BeginTicketMutex(&mdm->id_mutex);
+  BlobHeader *header = GetBlobHeader(mdm, blob_id);
+  if (header && header->name_length) {
+    result.assign((char *)HeapOffsetToPtr(id_heap, header->name_offset),
+                  header->name_length);
+  }
+  EndTicketMutex(&mdm->id_mutex);
+
+  return result;
+}
+
+void LocalSetBlobName(MetadataManager *mdm, BlobID blob_id,
+                      const std::string &name) {
+  Heap *id_heap = GetIdHeap(mdm);
+  BeginTicketMutex(&mdm->id_mutex);
+  BlobHeader *header = GetBlobHeader(mdm, blob_id);
+  if (header) {
+    if (header->name_length) {
+      HeapFree(id_heap, HeapOffsetToPtr(id_heap, header->name_offset));
+    }
+    SetEmbeddedBlobName(mdm, header, name);
+  }
+  EndTicketMutex(&mdm->id_mutex);
+  CheckHeapOverlap(mdm);
+}
+
+BlobIdPage LocalFilterBlobIds(SharedMemoryContext *context, RpcContext *rpc,
+                              const std::vector<BlobID> &blob_ids,
+                              const BlobPredicate &pred) {
+  MetadataManager *mdm = GetMetadataManagerFromContext(context);
+  const char *pattern = pred.name_pattern.c_str();
+  BlobIdPage result = {};
+
+  for (const auto &blob_id : blob_ids) {
+    std::string name = LocalGetBlobName(mdm, blob_id);
+    // NOTE(chogan): An empty pattern matches every name.
+    bool matches = pred.name_pattern.empty() || GlobMatch(pattern,
+                                                          name.c_str());
+    if (matches && BlobMatchesPredicate(context, rpc, blob_id, pred)) {
+      result.ids.push_back(blob_id);
+      result.names.push_back(name);
+    }
+  }
+
+  return result;
+}
+
+BlobID LocalAllocateBufferIdList(MetadataManager *mdm,
+                                 const std::vector<BufferID> &buffer_ids,
+                                 const std::string &blob_name, i32 node_id) {
   static_assert(sizeof(IdList) == sizeof(BufferID));
   u32 length = (u32)buffer_ids.size();
-  u32 id_list_offset = AllocateEmbeddedIdList(mdm, length);
+  u16 id_generation = 0;
+  u32 id_list_offset = AllocateEmbeddedIdList(mdm, length, blob_name,
+                                              &id_generation);
   IdList id_list = GetEmbeddedIdList(mdm, id_list_offset);
   u64 *ids = (u64 *)GetIdsPtr(mdm, id_list);
   CopyIds(ids, (u64 *)buffer_ids.data(), length);
   ReleaseIdsPtr(mdm);
 
-  u32 result = id_list_offset;
+  BlobID result = {};
+  result.bits.buffer_ids_offset = id_list_offset;
+  result.bits.node_id = node_id;
+  result.bits.generation = id_generation;
 
   return result;
 }
@@ -387,9 +748,117 @@ void LocalGetBufferIdList(Arena *arena, MetadataManager *mdm, BlobID blob_id,
   ReleaseIdsPtr(mdm);
 }
 
+void LocalRecordBlobAccess(MetadataManager *mdm, BlobID blob_id,
+                           AccessType type, u64 bytes) {
+  u64 ticks = GetStatsTicks();
+  BeginTicketMutex(&mdm->id_mutex);
+  // NOTE(chogan): Remote stats updates are fire-and-forget, so they can
+  // arrive after the Blob was freed and its id list reused.
+  BlobHeader *header = GetBlobHeader(mdm, blob_id);
+  if (header) {
+    RecordAccess(&header->stats, type, bytes, ticks);
+  }
+  EndTicketMutex(&mdm->id_mutex);
+}
+
+AccessStats LocalGetBlobStats(MetadataManager *mdm, BlobID blob_id) {
+  u64 ticks = GetStatsTicks();
+  BeginTicketMutex(&mdm->id_mutex);
+  BlobHeader *header = GetBlobHeader(mdm, blob_id);
+  AccessStats result = {};
+  if (header) {
+    result = GetStatsSnapshot(&header->stats, ticks);
+  }
+  EndTicketMutex(&mdm->id_mutex);
+
+  return result;
+}
+
+void LocalSetBlobStats(MetadataManager *mdm, BlobID blob_id,
+                       const AccessStats &stats) {
+  u64 ticks = GetStatsTicks();
+  BeginTicketMutex(&mdm->id_mutex);
+  BlobHeader *header = GetBlobHeader(mdm, blob_id);
+  if (header) {
+    SetStats(&header->stats, stats, ticks);
+  }
+  EndTicketMutex(&mdm->id_mutex);
+}
+
+u64 LocalGetBlobGeneration(MetadataManager *mdm, BlobID blob_id) {
+  BeginTicketMutex(&mdm->id_mutex);
+  BlobHeader *header = GetBlobHeader(mdm, blob_id);
+  u64 result = header ? header->generation : 0;
+  EndTicketMutex(&mdm->id_mutex);
+
+  return result;
+}
+
+u64 LocalRecordBlobRead(MetadataManager *mdm, BlobID blob_id,
+                        u64 expected_generation, u64 bytes) {
+  u64 ticks = GetStatsTicks();
+  BeginTicketMutex(&mdm->id_mutex);
+  BlobHeader *header = GetBlobHeader(mdm, blob_id);
+  u64 result = header ? header->generation : 0;
+  if (header && result == expected_generation) {
+    RecordAccess(&header->stats, kAccessType_Read, bytes, ticks);
+  }
+  EndTicketMutex(&mdm->id_mutex);
+
+  return result;
+}
+
+/**
+ * Replaces the `BufferID`s of @p blob_id if its `BlobHeader::generation` still
+ * matches @p expected_generation.
+ *
+ * The 64 bit `generation` is bumped so in-flight readers notice the move, but
+ * the `BlobID` (and so its 16 bit `id_generation`) is unchanged. Note that
+ * `id_generation` only cycles through 1-65535 (see AllocateEmbeddedIdList), so
+ * a stale `BlobID` whose offset has been reused exactly 65535 allocations
+ * later will match the new Blob. Callers that need a stronger guarantee
+ * should compare the 64 bit generation, as this function does.
+ */
+bool LocalReplaceBufferIdList(MetadataManager *mdm, BlobID blob_id,
+                              u64 expected_generation,
+                              const std::vector<BufferID> &buffer_ids) {
+  static_assert(sizeof(BufferID) == sizeof(u64));
+  Heap *id_heap = GetIdHeap(mdm);
+  u32 offset = blob_id.bits.buffer_ids_offset;
+  u32 length = (u32)buffer_ids.size();
+  bool result = false;
+
+  BeginTicketMutex(&mdm->id_mutex);
+  IdList *embedded_id_list = (IdList *)HeapOffsetToPtr(id_heap, offset);
+  BlobHeader *header = GetBlobHeader(mdm, blob_id);
+
+  if (header && header->generation == expected_generation) {
+    u64 *ids = (u64 *)HeapOffsetToPtr(id_heap, embedded_id_list->head_offset);
+    if (length > embedded_id_list->length) {
+      // NOTE(chogan): The new list doesn't fit where the old one was, so it
+      // gets its own allocation. The embedded IdList stays put so the BlobID
+      // remains valid.
+      u64 *new_ids = HeapPushArray<u64>(id_heap, length);
+      if (embedded_id_list->head_offset != GetInlineIdsOffset(mdm, offset)) {
+        HeapFree(id_heap, (u8 *)ids);
+      }
+      ids = new_ids;
+      embedded_id_list->head_offset = GetHeapOffset(id_heap, (u8 *)new_ids);
+    }
+    CopyIds(ids, (u64 *)buffer_ids.data(), length);
+    embedded_id_list->length = length;
+    header->generation = mdm->blob_generation++;
+    result = true;
+  }
+  EndTicketMutex(&mdm->id_mutex);
+  CheckHeapOverlap(mdm);
+
+  return result;
+}
+
 void LocalFreeBufferIdList(SharedMemoryContext *context, BlobID blob_id) {
   MetadataManager *mdm = GetMetadataManagerFromContext(context);
-  FreeEmbeddedIdList(mdm, blob_id.bits.buffer_ids_offset);
+  FreeEmbeddedIdList(mdm, blob_id);
   CheckHeapOverlap(mdm);
 }
 
@@ -398,16 +867,7 @@ void LocalRemoveBlobFromBucketInfo(SharedMemoryContext *context,
   MetadataManager *mdm = GetMetadataManagerFromContext(context);
   BeginTicketMutex(&mdm->bucket_mutex);
   BucketInfo *info = LocalGetBucketInfoById(mdm, bucket_id);
-  ChunkedIdList *blobs = &info->blobs;
-
-  BlobID *blobs_arr = (BlobID *)GetIdsPtr(mdm, *blobs);
-  for (u32 i = 0; i < blobs->length; ++i) {
-    if (blobs_arr[i].as_int == blob_id.as_int) {
-      blobs_arr[i] = blobs_arr[--blobs->length];
-      break;
-    }
-  }
-  ReleaseIdsPtr(mdm);
+  RemoveFromChunkedIdList(mdm, &info->blobs, blob_id.as_int);
   EndTicketMutex(&mdm->bucket_mutex);
 }
 
@@ -416,17 +876,7 @@ bool LocalContainsBlob(SharedMemoryContext *context, BucketID bucket_id,
   MetadataManager *mdm = GetMetadataManagerFromContext(context);
   BeginTicketMutex(&mdm->bucket_mutex);
   BucketInfo *info = LocalGetBucketInfoById(mdm, bucket_id);
-  ChunkedIdList *blobs = &info->blobs;
-  BlobID *blob_id_arr = (BlobID *)GetIdsPtr(mdm, *blobs);
-
-  bool result = false;
-  for (u32 i = 0; i < blobs->length; ++i) {
-    if (blob_id_arr[i].as_int == blob_id.as_int) {
-      result = true;
-      break;
-    }
-  }
-  ReleaseIdsPtr(mdm);
+  bool result = ChunkedIdListContains(mdm, &info->blobs, blob_id.as_int);
   EndTicketMutex(&mdm->bucket_mutex);
 
   return result;
@@ -461,9 +911,7 @@ bool LocalDestroyBucket(SharedMemoryContext *context, RpcContext *rpc,
       }
       ReleaseIdsPtr(mdm);
 
-      for (auto blob_id : blobs_to_destroy) {
-        DestroyBlobById(context, rpc, blob_id);
-      }
+      DestroyBucketBlobs(context, rpc, bucket_id, blobs_to_destroy);
       // Delete BlobId list
       FreeIdList(mdm, info->blobs);
     }
@@ -475,7 +923,7 @@ bool LocalDestroyBucket(SharedMemoryContext *context, RpcContext *rpc,
     // Reset BucketInfo to initial values
     info->ref_count.store(0);
     info->active = false;
-    info->stats = {};
+    ResetStats(&info->stats);
 
     mdm->num_buckets--;
     info->next_free = mdm->first_free_bucket;
@@ -507,6 +955,44 @@ std::vector<TargetID> GetNodeTargets(SharedMemoryContext *context) {
   return result;
 }
 
+std::vector<BlobID> LocalGetAllBlobIds(MetadataManager *mdm) {
+  std::vector<BlobID> result;
+
+  IdMap *map = GetMap(mdm, kMapType_Blob);
+  u32 map_size = (u32)shlen(map);
+  result.reserve(map_size);
+  for (u32 i = 0; i < map_size; ++i) {
+    BlobID blob_id = {};
+    blob_id.as_int = map[i].value;
+    result.push_back(blob_id);
+  }
+  ReleaseMap(mdm, kMapType_Blob);
+
+  return result;
+}
+
+std::vector<BlobID> LocalScanBlobIds(MetadataManager *mdm, u32 *cursor,
+                                     u32 max_ids) {
+  std::vector<BlobID> result;
+
+  IdMap *map = GetMap(mdm, kMapType_Blob);
+  u32 map_size = (u32)shlen(map);
+  if (*cursor >= map_size) {
+    *cursor = 0;
+  }
+  u32 end = std::min(map_size, *cursor + max_ids);
+  result.reserve(end - *cursor);
+  for (u32 i = *cursor; i < end; ++i) {
+    BlobID blob_id = {};
+    blob_id.as_int = map[i].value;
+    result.push_back(blob_id);
+  }
+  *cursor = end;
+  ReleaseMap(mdm, kMapType_Blob);
+
+  return result;
+}
+
 void PutToStorage(MetadataManager *mdm, const char *key, u64 val,
                   MapType map_type) {
   Heap *heap = GetMapHeap(mdm);
@@ -22,6 +22,8 @@
 namespace hermes {
 
 struct RpcContext;
+struct TieringPolicy;
+struct DefragPolicy;
 
 const int kMaxServerNameSize = 128;
 const int kMaxServerSuffixSize = 16;
@@ -75,9 +77,22 @@ std::string GetServerName(RpcContext *rpc, u32 node_id,
 std::string GetProtocol(RpcContext *rpc);
 void StartBufferOrganizer(SharedMemoryContext *context, RpcContext *rpc,
                           const char *addr, int num_threads, int port);
+void StartTieringThread(SharedMemoryContext *context, RpcContext *rpc,
+                        Arena *arena, const TieringPolicy &policy,
+                        double sleep_ms);
+void StartDefragThread(SharedMemoryContext *context, RpcContext *rpc,
+                       Arena *arena, const DefragPolicy &policy,
+                       double sleep_ms);
 void TriggerBufferOrganizer(RpcContext *rpc, const char *func_name,
-                            const std::string &blob_name, SwapBlob swap_blob,
+                            const std::string &blob_name, SwapBlob swap_blob);
+void TriggerBufferOrganizer(RpcContext *rpc, const char *func_name,
+                            const std::vector<BlobID> &blob_ids, TargetID dest,
                             int retries);
+void TriggerBufferOrganizer(RpcContext *rpc, const char *func_name);
+void TriggerBufferOrganizer(RpcContext *rpc, const char *func_name,
+                            TargetID target_id);
+void WaitForIoBudget(SharedMemoryContext *context, RpcContext *rpc,
+                     DeviceID device_id, u64 bytes, BoPriority priority);
 }  // namespace hermes
 
 // TODO(chogan): I don't like that code similar to this is in buffer_pool.cc.
@@ -10,7 +10,9 @@
  * have access to the file, you may request a copy from help@hdfgroup.org.   *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
+#include <chrono>
 #include <string>
+#include <thread>
 
 #include "rpc.h"
 #include "metadata_management_internal.h"
@@ -76,8 +78,9 @@ void ThalliumStartRpcServer(SharedMemoryContext *context, RpcContext *rpc,
     };
 
   function<void(const request&, BufferID)> rpc_release_buffer =
-    [context](const request &req, BufferID id) {
+    [context, rpc](const request &req, BufferID id) {
       LocalReleaseBuffer(context, id);
+      WakeSwapDrain(context, rpc);
       req.respond(true);
     };
 
@@ -100,6 +103,13 @@ void ThalliumStartRpcServer(SharedMemoryContext *context, RpcContext *rpc,
       req.respond(result);
     };
 
+  function<void(const request&, BufferID)> rpc_get_buffer_device_id =
+    [context](const request &req, BufferID id) {
+      DeviceID result = LocalGetBufferDeviceId(context, id);
+
+      req.respond(result);
+    };
+
   function<void(const request&, BufferID, std::vector<u8>, size_t)>
     rpc_write_buffer_by_id = [context](const request &req, BufferID id,
                                        std::vector<u8> data, size_t offset) {
@@ -135,9 +145,17 @@ void ThalliumStartRpcServer(SharedMemoryContext *context, RpcContext *rpc,
 
       u8 *buffer_data = 0;
       size_t size = header->used;
+      std::vector<u8> ram_copy;
 
       if (BufferIsByteAddressable(context, id)) {
-        buffer_data = GetRamBufferPtr(context, id);
+        // NOTE(chogan): The defragmenter may move RAM buffers, so copy the
+        // buffer under its lock instead of holding the lock across the
+        // transfer.
+        ram_copy.resize(size);
+        LockBuffer(header);
+        memcpy(ram_copy.data(), GetRamBufferPtr(context, id), size);
+        UnlockBuffer(header);
+        buffer_data = ram_copy.data();
       } else {
         // TODO(chogan): Probably need a way to lock the trans_arena. Currently
         // an assertion will fire if multiple threads try to use it at once.
@@ -199,6 +217,29 @@ void ThalliumStartRpcServer(SharedMemoryContext *context, RpcContext *rpc,
         req.respond(true);
       };
 
+  function<void(const request &, BucketID, const vector<BlobID> &,
+                const vector<BlobID> &, const vector<u64> &)>
+    rpc_add_blob_ids_bucket = [context](const request &req, BucketID bucket_id,
+                                        const vector<BlobID> &blob_ids,
+                                        const vector<BlobID> &replaced_ids,
+                                        const vector<u64> &sizes) {
+      LocalAddBlobIdsToBucket(context, bucket_id, blob_ids, replaced_ids,
+                              sizes);
+      req.respond(true);
+    };
+
+  function<void(const request &, const vector<string> &,
+                const vector<vector<BufferID>> &, const vector<u64> &, bool)>
+    rpc_attach_blobs = [context, rpc](const request &req,
+                                      const vector<string> &internal_names,
+                                      const vector<vector<BufferID>> &ids,
+                                      const vector<u64> &sizes, bool is_swap) {
+      std::pair<vector<BlobID>, vector<BlobID>> result;
+      result.first = LocalAttachBlobs(context, rpc, internal_names, ids, sizes,
+                                      is_swap, &result.second);
+      req.respond(result);
+    };
+
   function<void(const request &, VBucketID, BlobID)> rpc_add_blob_vbucket =
       [context](const request &req, VBucketID vbucket_id, BlobID blob_id) {
         MetadataManager *mdm = GetMetadataManagerFromContext(context);
@@ -235,15 +276,26 @@ void ThalliumStartRpcServer(SharedMemoryContext *context, RpcContext *rpc,
       req.respond(result);
     };
 
-  function<void(const request&, const vector<BufferID>&)>
+  function<void(const request&, const vector<BufferID>&, const string&,
+                bool)>
     rpc_allocate_buffer_id_list =
-      [context](const request &req, const vector<BufferID> &buffer_ids) {
+      [context, rpc](const request &req, const vector<BufferID> &buffer_ids,
+                     const string &blob_name, bool is_swap_blob) {
         MetadataManager *mdm = GetMetadataManagerFromContext(context);
-        u32 result = LocalAllocateBufferIdList(mdm, buffer_ids);
+        i32 node_id = is_swap_blob ? -(i32)rpc->node_id : (i32)rpc->node_id;
+        BlobID result = LocalAllocateBufferIdList(mdm, buffer_ids, blob_name,
+                                                  node_id);
 
         req.respond(result);
       };
 
+  function<void(const request&, BlobID, const string&)> rpc_set_blob_name =
+    [context](const request &req, BlobID blob_id, const string &name) {
+      MetadataManager *mdm = GetMetadataManagerFromContext(context);
+      LocalSetBlobName(mdm, blob_id, name);
+      req.respond(true);
+    };
+
   function<void(const request&, BucketID, const string&, const string&)>
     rpc_rename_bucket = [context, rpc](const request &req, BucketID id,
                                        const string &old_name,
@@ -279,6 +331,14 @@ void ThalliumStartRpcServer(SharedMemoryContext *context, RpcContext *rpc,
       req.respond(true);
     };
 
+  function<void(const request&, BucketID, const vector<BlobID>&)>
+    rpc_destroy_bucket_blobs = [context, rpc](const request &req,
+                                              BucketID bucket_id,
+                                              const vector<BlobID> &blob_ids) {
+      LocalDestroyBucketBlobs(context, rpc, bucket_id, blob_ids);
+      req.respond(true);
+    };
+
   function<void(const request &, BucketID)> rpc_increment_refcount_bucket =
       [context](const request &req, BucketID id) {
         LocalIncrementRefcount(context, id);
@@ -333,6 +393,122 @@ void ThalliumStartRpcServer(SharedMemoryContext *context, RpcContext *rpc,
       req.respond(result);
     };
 
+  function<void(const request&, BucketID, u32, u32)> rpc_get_blob_id_range =
+    [context](const request &req, BucketID bucket_id, u32 start_index,
+              u32 max_ids) {
+      std::vector<BlobID> result = LocalGetBlobIds(context, bucket_id,
+                                                   start_index, max_ids);
+
+      req.respond(result);
+    };
+
+  function<void(const request&, const vector<BlobID>&, const BlobPredicate&)>
+    rpc_filter_blob_ids =
+    [context, rpc](const request &req, const vector<BlobID> &blob_ids,
+                   const BlobPredicate &pred) {
+      BlobIdPage result = LocalFilterBlobIds(context, rpc, blob_ids, pred);
+
+      req.respond(result);
+    };
+
+  function<void(const request&, BlobID, int, u64)> rpc_record_blob_access =
+    [context](const request &req, BlobID blob_id, int type, u64 bytes) {
+      (void)req;
+      MetadataManager *mdm = GetMetadataManagerFromContext(context);
+      LocalRecordBlobAccess(mdm, blob_id, (AccessType)type, bytes);
+    };
+
+  function<void(const request&, SwapBlob)> rpc_free_swap_space =
+    [context, rpc](const request &req, SwapBlob swap_blob) {
+      (void)req;
+      LocalFreeSwapSpace(context, rpc, swap_blob);
+    };
+
+  function<void(const request&, BucketID, int, u64, u64)>
+    rpc_record_bucket_access =
+    [context](const request &req, BucketID bucket_id, int type, u64 bytes,
+              u64 count) {
+      (void)req;
+      LocalRecordBucketAccess(context, bucket_id, (AccessType)type, bytes,
+                              count);
+    };
+
+  function<void(const request&, BlobID, u64, u64)> rpc_record_blob_read =
+    [context](const request &req, BlobID blob_id, u64 expected_generation,
+              u64 bytes) {
+      MetadataManager *mdm = GetMetadataManagerFromContext(context);
+      u64 result = LocalRecordBlobRead(mdm, blob_id, expected_generation,
+                                       bytes);
+
+      req.respond(result);
+    };
+
+  function<void(const request&, VBucketID, int, u64)>
+    rpc_record_vbucket_access =
+    [context](const request &req, VBucketID vbucket_id, int type, u64 bytes) {
+      (void)req;
+      LocalRecordVBucketAccess(context, vbucket_id, (AccessType)type, bytes);
+    };
+
+  function<void(const request&, BlobID)> rpc_get_blob_stats =
+    [context](const request &req, BlobID blob_id) {
+      MetadataManager *mdm = GetMetadataManagerFromContext(context);
+      AccessStats result = LocalGetBlobStats(mdm, blob_id);
+
+      req.respond(result);
+    };
+
+  function<void(const request&, BlobID, AccessStats)> rpc_set_blob_stats =
+    [context](const request &req, BlobID blob_id, AccessStats stats) {
+      MetadataManager *mdm = GetMetadataManagerFromContext(context);
+      LocalSetBlobStats(mdm, blob_id, stats);
+
+      req.respond(true);
+    };
+
+  function<void(const request&, BlobID)> rpc_get_blob_generation =
+    [context](const request &req, BlobID blob_id) {
+      MetadataManager *mdm = GetMetadataManagerFromContext(context);
+      u64 result = LocalGetBlobGeneration(mdm, blob_id);
+
+      req.respond(result);
+    };
+
+  function<void(const request&, BlobID, u64, std::vector<BufferID>)>
+    rpc_replace_buffer_id_list =
+    [context](const request &req, BlobID blob_id, u64 expected_generation,
+              std::vector<BufferID> buffer_ids) {
+      MetadataManager *mdm = GetMetadataManagerFromContext(context);
+      bool result = LocalReplaceBufferIdList(mdm, blob_id, expected_generation,
+                                             buffer_ids);
+
+      req.respond(result);
+    };
+
+  function<void(const request&, std::vector<BlobID>, TargetID, int, int)>
+    rpc_enqueue_blob_moves =
+    [context, rpc](const request &req, std::vector<BlobID> blob_ids,
+                   TargetID dest, int retries, int priority) {
+      u32 result = LocalEnqueueBlobMoves(context, rpc, blob_ids, dest, retries,
+                                         (BoPriority)priority);
+
+      req.respond(result);
+    };
+
+  function<void(const request&, BucketID)> rpc_get_bucket_stats =
+    [context](const request &req, BucketID bucket_id) {
+      AccessStats result = LocalGetBucketStats(context, bucket_id);
+
+      req.respond(result);
+    };
+
+  function<void(const request&, VBucketID)> rpc_get_vbucket_stats =
+    [context](const request &req, VBucketID vbucket_id) {
+      AccessStats result = LocalGetVBucketStats(context, vbucket_id);
+
+      req.respond(result);
+    };
+
   function<void(const request&)> rpc_finalize =
     [rpc](const request &req) {
       (void)req;
@@ -348,6 +524,7 @@ void ThalliumStartRpcServer(SharedMemoryContext *context, RpcContext *rpc,
 
   rpc_server->define("RemoteReleaseBuffer", rpc_release_buffer);
   rpc_server->define("RemoteGetBufferSize", rpc_get_buffer_size);
+  rpc_server->define("RemoteGetBufferDeviceId", rpc_get_buffer_device_id);
 
   rpc_server->define("RemoteReadBufferById", rpc_read_buffer_by_id);
   rpc_server->define("RemoteWriteBufferById", rpc_write_buffer_by_id);
@@ -357,6 +534,8 @@ void ThalliumStartRpcServer(SharedMemoryContext *context, RpcContext *rpc,
   rpc_server->define("RemotePut", rpc_map_put);
   rpc_server->define("RemoteDelete", rpc_map_delete);
   rpc_server->define("RemoteAddBlobIdToBucket", rpc_add_blob_bucket);
+  rpc_server->define("RemoteAddBlobIdsToBucket", rpc_add_blob_ids_bucket);
+  rpc_server->define("RemoteAttachBlobs", rpc_attach_blobs);
   rpc_server->define("RemoteAddBlobIdToVBucket", rpc_add_blob_vbucket);
   rpc_server->define("RemoteDestroyBucket", rpc_destroy_bucket);
   rpc_server->define("RemoteRenameBucket", rpc_rename_bucket);
@@ -366,9 +545,14 @@ void ThalliumStartRpcServer(SharedMemoryContext *context, RpcContext *rpc,
   rpc_server->define("RemoteGetNextFreeBucketId", rpc_get_next_free_bucket_id);
   rpc_server->define("RemoteRemoveBlobFromBucketInfo",
                     rpc_remove_blob_from_bucket_info);
+  rpc_server->define("RemoteDestroyBucketBlobs", rpc_destroy_bucket_blobs);
   rpc_server->define("RemoteAllocateBufferIdList", rpc_allocate_buffer_id_list);
   rpc_server->define("RemoteGetBufferIdList", rpc_get_buffer_id_list);
   rpc_server->define("RemoteFreeBufferIdList", rpc_free_buffer_id_list);
+  rpc_server->define("RemoteSetBlobName", rpc_set_blob_name);
+  rpc_server->define("RemoteGetBlobGeneration", rpc_get_blob_generation);
+  rpc_server->define("RemoteReplaceBufferIdList", rpc_replace_buffer_id_list);
+  rpc_server->define("RemoteEnqueueBlobMoves", rpc_enqueue_blob_moves);
   rpc_server->define("RemoteIncrementRefcount", rpc_increment_refcount_bucket);
   rpc_server->define("RemoteDecrementRefcount", rpc_decrement_refcount_bucket);
   rpc_server->define("RemoteIncrementRefcountVBucket",
@@ -381,75 +565,199 @@ void ThalliumStartRpcServer(SharedMemoryContext *context, RpcContext *rpc,
   rpc_server->define("RemoteGetGlobalDeviceCapacities",
                      rpc_get_global_device_capacities);
   rpc_server->define("RemoteGetBlobIds", rpc_get_blob_ids);
+  rpc_server->define("RemoteGetBlobIdRange", rpc_get_blob_id_range);
+  rpc_server->define("RemoteFilterBlobIds", rpc_filter_blob_ids);
+  rpc_server->define("RemoteRecordBlobAccess",
+                     rpc_record_blob_access).disable_response();
+  rpc_server->define("RemoteFreeSwapSpace",
+                     rpc_free_swap_space).disable_response();
+  rpc_server->define("RemoteRecordBucketAccess",
+                     rpc_record_bucket_access).disable_response();
+  rpc_server->define("RemoteRecordVBucketAccess",
+                     rpc_record_vbucket_access).disable_response();
+  rpc_server->define("RemoteRecordBlobRead", rpc_record_blob_read);
+  rpc_server->define("RemoteGetBlobStats", rpc_get_blob_stats);
+  rpc_server->define("RemoteSetBlobStats", rpc_set_blob_stats);
+  rpc_server->define("RemoteGetBucketStats", rpc_get_bucket_stats);
+  rpc_server->define("RemoteGetVBucketStats", rpc_get_vbucket_stats);
   rpc_server->define("RemoteFinalize", rpc_finalize).disable_response();
 }
 
+/**
+ * Drains @p queue after updating the counters that WakeSwapDrain reads. The
+ * caller must hold `queue->mutex`.
+ */
+static void DrainSwapQueue(SharedMemoryContext *context, RpcContext *rpc,
+                           SwapDrainQueue *queue) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  // NOTE(chogan): Publish the queue length and clear the request before
+  // draining, so that buffers released during the drain request another one.
+  pool->num_queued_swap_blobs.store((u32)queue->entries.size());
+  pool->swap_drain_requested.store(false);
+
+  size_t num_placed = DrainSwap(context, rpc, queue->entries);
+  pool->num_queued_swap_blobs.store((u32)queue->entries.size());
+
+  if (num_placed) {
+    LOG(INFO) << "Buffer Organizer placed " << num_placed << " blob(s) from "
+              << "swap space. " << queue->entries.size() << " still queued."
+              << std::endl;
+  }
+}
+
+/**
+ * Moves each of @p blob_ids to @p target_id in order, trying each move up to
+ * @p retries times.
+ */
+static void MoveBlobsToTarget(SharedMemoryContext *context, RpcContext *rpc,
+                              const std::vector<BlobID> &blob_ids,
+                              TargetID target_id, int retries,
+                              BoPriority priority) {
+  BufferPool *pool = GetBufferPoolFromContext(context);
+
+  for (size_t i = 0; i < blob_ids.size(); ++i) {
+    for (int attempt = 0; attempt < retries; ++attempt) {
+      if (MoveToTarget(context, rpc, blob_ids[i], target_id, priority) == 0) {
+        break;
+      }
+    }
+    // NOTE(chogan): Incremented in LocalEnqueueBlobMoves
+    pool->num_pending_moves.fetch_sub(1);
+  }
+}
+
 void StartBufferOrganizer(SharedMemoryContext *context, RpcContext *rpc,
                           const char *addr, int num_threads, int port) {
   ThalliumState *state = GetThalliumState(rpc);
 
-  state->bo_engine = new tl::engine(addr, THALLIUM_SERVER_MODE, true,
-                                    num_threads);
+  // NOTE(chogan): Each class of work gets its own queue, and every execution
+  // stream serves all of the queues with the Argobots priority scheduler, so
+  // an idle stream always picks up the highest priority work available and
+  // lower priority work only runs when nothing more urgent is waiting.
+  for (int i = 0; i < kBoPriority_Count; ++i) {
+    ABT_pool_create_basic(ABT_POOL_FIFO, ABT_POOL_ACCESS_MPMC, ABT_TRUE,
+                          &state->bo_pools[i]);
+  }
+  state->num_bo_streams = std::min(num_threads, kMaxBufferOrganizerThreads);
+  for (int i = 0; i < state->num_bo_streams; ++i) {
+    ABT_xstream_create_basic(ABT_SCHED_PRIO, kBoPriority_Count,
+                             state->bo_pools, ABT_SCHED_CONFIG_NULL,
+                             &state->bo_streams[i]);
+  }
+
+  // NOTE(chogan): All handlers run in the pools above, so the engine doesn't
+  // need any RPC threads of its own.
+  state->bo_engine = new tl::engine(addr, THALLIUM_SERVER_MODE, true, 0);
   tl::engine *rpc_server = state->bo_engine;
 
   std::string rpc_server_name = rpc_server->self();
   LOG(INFO) << "Buffer organizer serving at " << rpc_server_name << " with "
-            << num_threads << " RPC threads" << std::endl;
+            << state->num_bo_streams << " threads" << std::endl;
 
   std::string server_name_postfix = ":" + std::to_string(port);
   CopyStringToCharArray(server_name_postfix, state->bo_server_name_postfix,
                         kMaxServerNamePostfix);
 
-  auto rpc_place_in_hierarchy = [context, rpc](const tl::request &req,
-                                               SwapBlob swap_blob,
-                                               const std::string name,
-                                               int retries) {
+  // NOTE(chogan): After a warm start the swap log still holds Blobs that were
+  // queued by the previous daemon, so they're queued again here. They're
+  // drained the next time buffers are released (see WakeSwapDrain).
+  SwapDrainQueue *queue = new SwapDrainQueue();
+  queue->entries = GetSwapLogEntries(context, rpc->node_id);
+  queue->next_sequence = queue->entries.size();
+  state->swap_drain_queue = queue;
+  GetBufferPoolFromContext(context)->num_queued_swap_blobs.store(
+    (u32)queue->entries.size());
+
+  auto rpc_place_in_hierarchy = [context, rpc, queue](const tl::request &req,
+                                                      SwapBlob swap_blob,
+                                                      const std::string name) {
     (void)req;
-    for (int i = 0; i < retries; ++i) {
-      LOG(INFO) << "Buffer Organizer placing blob '" << name
-                << "' in hierarchy. Attempt " << i + 1 << " of " << retries
-                << std::endl;
-      int result = PlaceInHierarchy(context, rpc, swap_blob, name);
-      if (result == 0) {
-        break;
-      } else {
-        // TODO(chogan): We probably don't want to sleep here, but for now this
-        // enables testing.
-        double sleep_ms = 2000;
-        ThalliumState *state = GetThalliumState(rpc);
+    // NOTE(chogan): Rather than retrying on a timer, the Blob stays queued
+    // until it's placed or deleted, and a drain is triggered every time
+    // buffers are released on this node (see WakeSwapDrain).
+    LOG(INFO) << "Buffer Organizer queueing blob '" << name
+              << "' for placement in hierarchy" << std::endl;
+
+    queue->mutex.lock();
+    SwapDrainEntry entry;
+    entry.swap_blob = swap_blob;
+    entry.name = name;
+    entry.sequence = queue->next_sequence++;
+    queue->entries.push_back(entry);
+    DrainSwapQueue(context, rpc, queue);
+    queue->mutex.unlock();
+  };
 
-        if (state && state->bo_engine) {
-          tl::thread::self().sleep(*state->bo_engine, sleep_ms);
-        }
-      }
+  auto rpc_drain_swap = [context, rpc, queue](const tl::request &req) {
+    (void)req;
+    queue->mutex.lock();
+    DrainSwapQueue(context, rpc, queue);
+    queue->mutex.unlock();
+  };
+
+  auto rpc_compact_swap = [context, rpc, queue](const tl::request &req) {
+    (void)req;
+    // NOTE(chogan): Hold the drain queue lock so a drain doesn't read a swap
+    // record while its segment is being reclaimed.
+    queue->mutex.lock();
+    size_t bytes_reclaimed = CompactSwap(context, rpc);
+    queue->mutex.unlock();
+
+    if (bytes_reclaimed) {
+      LOG(INFO) << "Buffer Organizer reclaimed " << bytes_reclaimed
+                << " bytes of swap space" << std::endl;
     }
   };
 
   auto rpc_move_to_target = [context, rpc](const tl::request &req,
-                                           SwapBlob swap_blob,
+                                           std::vector<BlobID> blob_ids,
                                            TargetID target_id, int retries) {
     (void)req;
-    (void)swap_blob;
-    (void)target_id;
-    for (int i = 0; i < retries; ++i) {
-      // TODO(chogan): MoveToTarget(context, rpc, target_id, swap_blob);
-      HERMES_NOT_IMPLEMENTED_YET;
-      int result = 0;
-      if (result == 0) {
-        break;
-      }
+    MoveBlobsToTarget(context, rpc, blob_ids, target_id, retries,
+                      kBoPriority_Tiering);
+  };
+
+  auto rpc_prefetch_to_target = [context, rpc](const tl::request &req,
+                                               std::vector<BlobID> blob_ids,
+                                               TargetID target_id,
+                                               int retries) {
+    (void)req;
+    MoveBlobsToTarget(context, rpc, blob_ids, target_id, retries,
+                      kBoPriority_Prefetch);
+  };
+
+  auto rpc_evict_from_target = [context, rpc](const tl::request &req,
+                                              TargetID target_id) {
+    (void)req;
+    u64 bytes_evicted = EvictFromTarget(context, rpc, target_id);
+    if (bytes_evicted) {
+      LOG(INFO) << "Buffer Organizer evicted " << bytes_evicted
+                << " bytes from Target " << target_id.bits.index << std::endl;
     }
   };
 
-  rpc_server->define("PlaceInHierarchy",
-                     rpc_place_in_hierarchy).disable_response();
-  rpc_server->define("MoveToTarget",
-                     rpc_move_to_target).disable_response();
+  tl::pool foreground_pool(state->bo_pools[kBoPriority_Foreground]);
+  tl::pool prefetch_pool(state->bo_pools[kBoPriority_Prefetch]);
+  tl::pool swap_drain_pool(state->bo_pools[kBoPriority_SwapDrain]);
+  tl::pool tiering_pool(state->bo_pools[kBoPriority_Tiering]);
+  const u16 provider_id = 0;
+
+  rpc_server->define("PlaceInHierarchy", rpc_place_in_hierarchy, provider_id,
+                     swap_drain_pool).disable_response();
+  rpc_server->define("DrainSwap", rpc_drain_swap, provider_id,
+                     swap_drain_pool).disable_response();
+  rpc_server->define("CompactSwap", rpc_compact_swap, provider_id,
+                     swap_drain_pool).disable_response();
+  rpc_server->define("MoveToTarget", rpc_move_to_target, provider_id,
+                     tiering_pool).disable_response();
+  rpc_server->define("PrefetchToTarget", rpc_prefetch_to_target, provider_id,
+                     prefetch_pool).disable_response();
+  rpc_server->define("EvictFromTarget", rpc_evict_from_target, provider_id,
+                     foreground_pool).disable_response();
 }
 
 void TriggerBufferOrganizer(RpcContext *rpc, const char *func_name,
-                            const std::string &blob_name, SwapBlob swap_blob,
-                            int retries) {
+                            const std::string &blob_name, SwapBlob swap_blob) {
   std::string server_name = GetServerName(rpc, rpc->node_id, true);
   std::string protocol = GetProtocol(rpc);
   tl::engine engine(protocol, THALLIUM_CLIENT_MODE, true);
@@ -457,7 +765,63 @@ void TriggerBufferOrganizer(RpcContext *rpc, const char *func_name,
   tl::endpoint server = engine.lookup(server_name);
   remote_proc.disable_response();
   // TODO(chogan): Templatize?
-  remote_proc.on(server)(swap_blob, blob_name, retries);
+  remote_proc.on(server)(swap_blob, blob_name);
+}
+
+void TriggerBufferOrganizer(RpcContext *rpc, const char *func_name) {
+  std::string server_name = GetServerName(rpc, rpc->node_id, true);
+  std::string protocol = GetProtocol(rpc);
+  tl::engine engine(protocol, THALLIUM_CLIENT_MODE, true);
+  tl::remote_procedure remote_proc = engine.define(func_name);
+  tl::endpoint server = engine.lookup(server_name);
+  remote_proc.disable_response();
+  remote_proc.on(server)();
+}
+
+void TriggerBufferOrganizer(RpcContext *rpc, const char *func_name,
+                            const std::vector<BlobID> &blob_ids, TargetID dest,
+                            int retries) {
+  std::string server_name = GetServerName(rpc, rpc->node_id, true);
+  std::string protocol = GetProtocol(rpc);
+  tl::engine engine(protocol, THALLIUM_CLIENT_MODE, true);
+  tl::remote_procedure remote_proc = engine.define(func_name);
+  tl::endpoint server = engine.lookup(server_name);
+  remote_proc.disable_response();
+  remote_proc.on(server)(blob_ids, dest, retries);
+}
+
+void TriggerBufferOrganizer(RpcContext *rpc, const char *func_name,
+                            TargetID target_id) {
+  std::string server_name = GetServerName(rpc, rpc->node_id, true);
+  std::string protocol = GetProtocol(rpc);
+  tl::engine engine(protocol, THALLIUM_CLIENT_MODE, true);
+  tl::remote_procedure remote_proc = engine.define(func_name);
+  tl::endpoint server = engine.lookup(server_name);
+  remote_proc.disable_response();
+  remote_proc.on(server)(target_id);
+}
+
+/**
+ * Charges @p bytes of I/O on @p device_id to its background budget (see
+ * ChargeIoBudget) and waits until the budget allows it. Inside the
+ * BufferOrganizer the wait only suspends the current work item, so its
+ * execution stream keeps serving other queues in the meantime. Threads outside
+ * of Argobots (e.g., the write-back service) just sleep.
+ */
+void WaitForIoBudget(SharedMemoryContext *context, RpcContext *rpc,
+                     DeviceID device_id, u64 bytes, BoPriority priority) {
+  f64 wait_ms = ChargeIoBudget(context, device_id, bytes, priority);
+
+  if (wait_ms > 0) {
+    ThalliumState *state = GetThalliumState(rpc);
+    ABT_thread self = ABT_THREAD_NULL;
+    if (state->bo_engine && ABT_thread_self(&self) == ABT_SUCCESS) {
+      tl::thread::self().sleep(*state->bo_engine, wait_ms);
+    } else {
+      std::this_thread::sleep_for(
+        std::chrono::duration<f64, std::milli>(wait_ms));
+    }
+  }
 }
 
 void StartGlobalSystemViewStateUpdateThread(SharedMemoryContext *context,
@@ -490,8 +854,103 @@ void StartGlobalSystemViewStateUpdateThread(SharedMemoryContext *context,
                                ABT_THREAD_ATTR_NULL, NULL);
 }
 
+void StartTieringThread(SharedMemoryContext *context, RpcContext *rpc,
+                        Arena *arena, const TieringPolicy &policy,
+                        double sleep_ms) {
+  struct ThreadArgs {
+    SharedMemoryContext *context;
+    RpcContext *rpc;
+    TieringPolicy policy;
+    double sleep_ms;
+  };
+
+  auto run_tiering_policy = [](void *args) {
+    ThreadArgs *targs = (ThreadArgs *)args;
+    ThalliumState *state = GetThalliumState(targs->rpc);
+    // NOTE(chogan): Token bucket that refills once per interval. A single move
+    // may overdraw it, in which case the debt is repaid over the following
+    // intervals, so the long term migration rate never exceeds the limit.
+    i64 refill = targs->policy.bytes_per_interval;
+    i64 budget = 0;
+    u32 cursor = 0;
+    while (!state->kill_requested.load()) {
+      tl::thread::self().sleep(*state->bo_engine, targs->sleep_ms);
+      budget = std::min(budget + refill, refill);
+      if (budget > 0 && !state->kill_requested.load()) {
+        RunTieringPolicy(targs->context, targs->rpc, targs->policy, &budget,
+                         &cursor);
+      }
+    }
+  };
+
+  ThreadArgs *args = PushStruct<ThreadArgs>(arena);
+  args->context = context;
+  args->rpc = rpc;
+  args->policy = policy;
+  args->sleep_ms = sleep_ms;
+
+  ThalliumState *state = GetThalliumState(rpc);
+  ABT_thread_create(state->bo_pools[kBoPriority_Tiering], run_tiering_policy,
+                    args, ABT_THREAD_ATTR_NULL, &state->tiering_thread);
+}
+
+void StartDefragThread(SharedMemoryContext *context, RpcContext *rpc,
+                       Arena *arena, const DefragPolicy &policy,
+                       double sleep_ms) {
+  struct ThreadArgs {
+    SharedMemoryContext *context;
+    RpcContext *rpc;
+    DefragPolicy policy;
+    double sleep_ms;
+  };
+
+  auto run_defragmentation = [](void *args) {
+    ThreadArgs *targs = (ThreadArgs *)args;
+    ThalliumState *state = GetThalliumState(targs->rpc);
+    while (!state->kill_requested.load()) {
+      tl::thread::self().sleep(*state->bo_engine, targs->sleep_ms);
+      if (state->kill_requested.load()) {
+        break;
+      }
+      if (targs->policy.adaptation_rate > 0) {
+        AdaptRamSlabPercentages(targs->context, targs->policy.adaptation_rate);
+      }
+      if (ComputeFragmentationScore(targs->context) >
+          targs->policy.threshold) {
+        DeviceID ram_id = 0;
+        FragmentationStats before = GetFragmentationStats(targs->context,
+                                                          ram_id);
+        int steps = DefragmentRam(targs->context, targs->policy);
+        FragmentationStats after = GetFragmentationStats(targs->context,
+                                                         ram_id);
+        LOG(INFO) << "Buffer Organizer rebalanced RAM slabs in " << steps
+                  << " step(s). Free space score: " << before.free_space_score
+                  << " -> " << after.free_space_score
+                  << ", internal fragmentation: "
+                  << before.internal_fragmentation << " -> "
+                  << after.internal_fragmentation << std::endl;
+      }
+    }
+  };
+
+  ThreadArgs *args = PushStruct<ThreadArgs>(arena);
+  args->context = context;
+  args->rpc = rpc;
+  args->policy = policy;
+  args->sleep_ms = sleep_ms;
+
+  ThalliumState *state = GetThalliumState(rpc);
+  ABT_thread_create(state->bo_pools[kBoPriority_Defrag], run_defragmentation,
+                    args, ABT_THREAD_ATTR_NULL, &state->defrag_thread);
+}
+
 void InitRpcContext(RpcContext *rpc, u32 num_nodes, u32 node_id,
                      Config *config) {
+  if (num_nodes > kMaxNodes) {
+    // NOTE(chogan): Node IDs wouldn't fit in a BlobID.
+    LOG(FATAL) << "Hermes supports at most " << kMaxNodes << " nodes, but "
+               << num_nodes << " were requested" << std::endl;
+  }
   rpc->num_nodes = num_nodes;
   rpc->node_id = node_id;
   rpc->start_server = ThalliumStartRpcServer;
@@ -552,6 +1011,14 @@ void FinalizeRpcContext(RpcContext *rpc, bool is_daemon) {
   state->kill_requested.store(true);
   ABT_xstream_join(state->execution_stream);
   ABT_xstream_free(&state->execution_stream);
+  // NOTE(chogan): The periodic BufferOrganizer threads sleep on the engine's
+  // timers, so they must finish before the engine is finalized.
+  if (state->tiering_thread != ABT_THREAD_NULL) {
+    ABT_thread_free(&state->tiering_thread);
+  }
+  if (state->defrag_thread != ABT_THREAD_NULL) {
+    ABT_thread_free(&state->defrag_thread);
+  }
 
   if (is_daemon) {
     state->engine->wait_for_finalize();
@@ -561,8 +1028,16 @@ void FinalizeRpcContext(RpcContext *rpc, bool is_daemon) {
     state->bo_engine->finalize();
   }
 
+  // NOTE(chogan): Joining waits for the BufferOrganizer's queues to empty.
+  for (int i = 0; i < state->num_bo_streams; ++i) {
+    ABT_xstream_join(state->bo_streams[i]);
+    ABT_xstream_free(&state->bo_streams[i]);
+  }
+  state->num_bo_streams = 0;
+
   delete state->engine;
   delete state->bo_engine;
+  delete state->swap_drain_queue;
 }
 
 std::string GetRpcAddress(Config *config, const std::string &host_number,
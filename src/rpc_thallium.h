@@ -30,6 +30,15 @@ namespace hermes {
 const int kMaxServerNamePrefix = 32;
 const int kMaxServerNamePostfix = 8;
 
+/**
+ * Swap Blobs waiting for the BufferOrganizer to place them in the hierarchy.
+ */
+struct SwapDrainQueue {
+  tl::mutex mutex;
+  std::vector<SwapDrainEntry> entries;
+  u64 next_sequence;
+};
+
 struct ThalliumState {
   char server_name_prefix[kMaxServerNamePrefix];
   char server_name_postfix[kMaxServerNamePostfix];
@@ -38,6 +47,16 @@ struct ThalliumState {
   tl::engine *engine;
   tl::engine *bo_engine;
   ABT_xstream execution_stream;
+  /** One queue of BufferOrganizer work per BoPriority */
+  ABT_pool bo_pools[kBoPriority_Count];
+  /** Execution streams that run BufferOrganizer work, highest priority first */
+  ABT_xstream bo_streams[kMaxBufferOrganizerThreads];
+  int num_bo_streams;
+  /** Runs the BufferOrganizer's tiering policy, if enabled */
+  ABT_thread tiering_thread;
+  /** Runs the BufferOrganizer's RAM defragmentation, if enabled */
+  ABT_thread defrag_thread;
+  SwapDrainQueue *swap_drain_queue;
 };
 
 struct ClientThalliumState {
@@ -117,6 +136,56 @@ void serialize(A &ar, SwapBlob &swap_blob) {
   ar & swap_blob.bucket_id;
 }
 
+/**
+ *  Lets Thallium know how to serialize an AccessStats.
+ *
+ * This function is called implicitly by Thallium.
+ *
+ * @param ar An archive provided by Thallium.
+ * @param stats The AccessStats to serialize.
+ */
+template<typename A>
+void serialize(A &ar, AccessStats &stats) {
+  ar & stats.reads;
+  ar & stats.writes;
+  ar & stats.bytes_read;
+  ar & stats.bytes_written;
+  ar & stats.last_access_ms;
+  ar & stats.frequency;
+}
+
+/**
+ *  Lets Thallium know how to serialize a BlobPredicate.
+ *
+ * This function is called implicitly by Thallium.
+ *
+ * @param ar An archive provided by Thallium.
+ * @param pred The BlobPredicate to serialize.
+ */
+template<typename A>
+void serialize(A &ar, BlobPredicate &pred) {
+  ar & pred.name_pattern;
+  ar & pred.min_size;
+  ar & pred.max_size;
+  ar & pred.device_mask;
+  ar & pred.min_idle_ms;
+  ar & pred.max_idle_ms;
+}
+
+/**
+ *  Lets Thallium know how to serialize a BlobIdPage.
+ *
+ * This function is called implicitly by Thallium.
+ *
+ * @param ar An archive provided by Thallium.
+ * @param page The BlobIdPage to serialize.
+ */
+template<typename A>
+void serialize(A &ar, BlobIdPage &page) {
+  ar & page.ids;
+  ar & page.names;
+}
+
 #ifndef THALLIUM_USE_CEREAL
 /**
  *  Lets Thallium know how to serialize a MapType.
@@ -41,6 +41,39 @@ size_t RoundDownToMultiple(size_t val, size_t multiple) {
   return result;
 }
 
+bool GlobMatch(const char *pattern, const char *str) {
+  // NOTE(chogan): Greedy matching that backtracks only to the most recent '*',
+  // which is enough because a later '*' can absorb anything an earlier one
+  // could have.
+  const char *star = 0;
+  const char *star_str = 0;
+
+  while (*str) {
+    // NOTE(chogan): Check for '*' first so that it's a wildcard even when the
+    // name contains a literal '*'.
+    if (*pattern == '*') {
+      star = pattern++;
+      star_str = str;
+    } else if (*pattern == '?' || *pattern == *str) {
+      pattern++;
+      str++;
+    } else if (star) {
+      pattern = star + 1;
+      str = ++star_str;
+    } else {
+      return false;
+    }
+  }
+
+  while (*pattern == '*') {
+    pattern++;
+  }
+
+  bool result = *pattern == '\0';
+
+  return result;
+}
+
 void InitDefaultConfig(Config *config) {
   config->num_devices = 4;
   config->num_targets = 4;
@@ -84,8 +117,38 @@ void InitDefaultConfig(Config *config) {
   config->mount_points[2] = "./";
   config->mount_points[3] = "./";
   config->swap_mount = "./";
+  config->checkpoint_mount = "";
 
   config->num_buffer_organizer_retries = 3;
+  config->buffer_organizer_queue_depth = 64;
+  config->buffer_organizer_threads = 1;
+  config->buffer_organizer_io_share = 0.5f;
+  config->read_ahead_depth = 0;
+  config->placement_cache_threshold = 0.05f;
+  config->placement_seed = 0;
+  config->use_measured_bandwidths = false;
+  config->bandwidth_calibration_size = 0;
+  config->parallel_write_threshold = MEGABYTES(4);
+  config->parallel_write_threads = 8;
+  config->swap_drain_order = SwapDrainOrder::kOldestFirst;
+  config->swap_segment_size = MEGABYTES(64);
+  config->swap_max_segments = 256;
+  config->swap_compaction_threshold = 0.5f;
+  config->tiering_interval_ms = 0;
+  config->tiering_high_watermark = 0.9f;
+  config->tiering_low_watermark = 0.75f;
+  config->tiering_promotion_frequency = 4.0f;
+  config->tiering_max_mbps = 100.0f;
+  config->write_back_threads = 4;
+  config->defrag_interval_ms = 0;
+  config->defrag_threshold = 0.25f;
+  config->defrag_max_steps = 64;
+  config->defrag_max_relocations = 64;
+  config->slab_adaptation_rate = 0;
+  for (int i = 0; i < kMaxDevices; ++i) {
+    config->target_high_watermarks[i] = 1.0f;
+    config->target_low_watermarks[i] = 0.9f;
+  }
 
   config->rpc_server_base_name = "localhost";
   config->rpc_server_suffix = "";
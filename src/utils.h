@@ -86,6 +86,19 @@ size_t RoundUpToMultiple(size_t val, size_t multiple);
  */
 size_t RoundDownToMultiple(size_t val, size_t multiple);
 
+/**
+ * Matches a string against a glob pattern.
+ *
+ * Supports `*` (any run of characters, including none) and `?` (any single
+ * character). All other characters match themselves.
+ *
+ * @param pattern The glob pattern.
+ * @param str The string to test.
+ *
+ * @return true if the whole of @p str matches @p pattern.
+ */
+bool GlobMatch(const char *pattern, const char *str);
+
 /**
  * Fills out a Config struct with default values.
  *
@@ -0,0 +1,386 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#include "write_back.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <utility>
+#include <vector>
+
+#include "buffer_pool_internal.h"
+#include "metadata_management.h"
+#include "metadata_management_internal.h"
+#include "rpc.h"
+
+namespace hermes {
+
+/**
+ * Per-job descriptors for the buffering files of file-backed Devices. The
+ * process-wide FILE streams in the SharedMemoryContext aren't safe to share
+ * with the write-back threads, so each job opens its own.
+ */
+struct BufferingFiles {
+  std::vector<std::vector<int>> fds;
+};
+
+static void CloseBufferingFiles(BufferingFiles *files) {
+  for (size_t i = 0; i < files->fds.size(); ++i) {
+    for (size_t j = 0; j < files->fds[i].size(); ++j) {
+      if (files->fds[i][j] != -1) {
+        close(files->fds[i][j]);
+      }
+    }
+  }
+}
+
+static int GetBufferingFd(SharedMemoryContext *context, BufferingFiles *files,
+                          DeviceID device_id, int slab_index) {
+  if (files->fds.size() <= device_id) {
+    files->fds.resize(device_id + 1);
+  }
+  std::vector<int> &device_fds = files->fds[device_id];
+  if (device_fds.size() <= (size_t)slab_index) {
+    device_fds.resize(slab_index + 1, -1);
+  }
+
+  int result = device_fds[slab_index];
+  if (result == -1) {
+    const char *filename =
+      context->buffering_filenames[device_id][slab_index].c_str();
+    result = open(filename, O_RDONLY);
+    device_fds[slab_index] = result;
+  }
+
+  return result;
+}
+
+static bool PwriteAll(int fd, const u8 *data, size_t size, u64 offset) {
+  bool result = true;
+  size_t total_bytes_written = 0;
+
+  while (total_bytes_written < size) {
+    ssize_t bytes_written = pwrite(fd, data + total_bytes_written,
+                                   size - total_bytes_written,
+                                   offset + total_bytes_written);
+    if (bytes_written <= 0) {
+      result = false;
+      break;
+    }
+    total_bytes_written += bytes_written;
+  }
+
+  return result;
+}
+
+static bool PreadAll(int fd, u8 *data, size_t size, u64 offset) {
+  bool result = true;
+  size_t total_bytes_read = 0;
+
+  while (total_bytes_read < size) {
+    ssize_t bytes_read = pread(fd, data + total_bytes_read,
+                               size - total_bytes_read,
+                               offset + total_bytes_read);
+    if (bytes_read <= 0) {
+      result = false;
+      break;
+    }
+    total_bytes_read += bytes_read;
+  }
+
+  return result;
+}
+
+/**
+ * Writes @p size bytes of buffer @p id to @p fd at @p file_offset through
+ * @p bounce.
+ */
+static api::Status WriteBackBuffer(SharedMemoryContext *context,
+                                   RpcContext *rpc, int fd, BufferID id,
+                                   u32 size, u64 file_offset,
+                                   BufferingFiles *files,
+                                   std::vector<u8> *bounce) {
+  api::Status result = 0;
+
+  if (BufferIsRemote(rpc, id)) {
+    bounce->resize(size);
+    Blob blob = {};
+    blob.data = bounce->data();
+    blob.size = size;
+    BufferIdArray ids = {};
+    ids.ids = &id;
+    ids.length = 1;
+    if (ReadBlobFromBuffers(context, rpc, &blob, &ids, &size) != size ||
+        !PwriteAll(fd, blob.data, size, file_offset)) {
+      // TODO(chogan): @errorhandling
+      result = 1;
+    }
+  } else {
+    BufferHeader *header = GetHeaderByBufferId(context, id);
+    Device *device = GetDeviceFromHeader(context, header);
+    size = std::min(size, header->used);
+    WaitForIoBudget(context, rpc, device->id, size, kBoPriority_Flush);
+
+    if (device->is_byte_addressable) {
+      // NOTE(chogan): Copy the buffer out so the lock isn't held across the
+      // write. The defragmenter can't relocate a locked buffer.
+      bounce->resize(size);
+      LockBuffer(header);
+      memcpy(bounce->data(), GetRamBufferPtr(context, id), size);
+      UnlockBuffer(header);
+      if (!PwriteAll(fd, bounce->data(), size, file_offset)) {
+        // TODO(chogan): @errorhandling
+        result = 1;
+      }
+    } else {
+      int slab_index = GetSlabIndexFromHeader(context, header);
+      int buffering_fd = GetBufferingFd(context, files, device->id,
+                                        slab_index);
+      bounce->resize(size);
+      if (buffering_fd == -1 ||
+          !PreadAll(buffering_fd, bounce->data(), size, header->data_offset) ||
+          !PwriteAll(fd, bounce->data(), size, file_offset)) {
+        // TODO(chogan): @errorhandling
+        result = 1;
+      }
+    }
+  }
+
+  return result;
+}
+
+/**
+ * Writes Blob @p blob_id to @p fd at @p file_offset one buffer at a time, and
+ * stores the number of bytes written in @p blob_size.
+ */
+static api::Status WriteBackBlob(SharedMemoryContext *context, RpcContext *rpc,
+                                 int fd, BlobID blob_id, u64 file_offset,
+                                 BufferingFiles *files, size_t *blob_size) {
+  api::Status result = 1;
+  std::vector<u8> bounce;
+
+  // NOTE(chogan): If the BufferOrganizer moves the Blob while we write it out,
+  // the buffers we wrote from may have been reused, so write it again from its
+  // new location.
+  const int kMaxWriteAttempts = 8;
+  for (int attempt = 0; attempt < kMaxWriteAttempts; ++attempt) {
+    u64 generation = GetBlobGeneration(context, rpc, blob_id);
+    if (generation == 0) {
+      // TODO(chogan): @errorhandling The Blob was deleted.
+      break;
+    }
+
+    api::Status ret = 0;
+    std::vector<BufferID> buffer_ids = GetBufferIdList(context, rpc, blob_id);
+    size_t bytes_written = 0;
+
+    if (BlobIsInSwap(blob_id)) {
+      SwapBlob swap_blob = VecToSwapBlob(buffer_ids);
+      bounce.resize(swap_blob.size);
+      Blob blob = {};
+      blob.data = bounce.data();
+      blob.size = bounce.size();
+      if (ReadFromSwap(context, blob, swap_blob) != swap_blob.size ||
+          !PwriteAll(fd, blob.data, blob.size, file_offset)) {
+        ret = 1;
+      }
+      bytes_written = swap_blob.size;
+    } else {
+      for (size_t i = 0; i < buffer_ids.size() && ret == 0; ++i) {
+        u32 size = GetBufferSize(context, rpc, buffer_ids[i]);
+        ret = WriteBackBuffer(context, rpc, fd, buffer_ids[i], size,
+                              file_offset + bytes_written, files, &bounce);
+        bytes_written += size;
+      }
+    }
+
+    if (GetBlobGeneration(context, rpc, blob_id) == generation) {
+      result = ret;
+      *blob_size = bytes_written;
+      break;
+    }
+  }
+
+  return result;
+}
+
+static api::Status RunWriteBackJob(SharedMemoryContext *context,
+                                   RpcContext *rpc, const WriteBackJob &job,
+                                   u64 *bytes_written) {
+  api::Status result = 0;
+  int fd = job.fd;
+
+  if (fd == -1) {
+    int flags = O_WRONLY | O_CREAT | (job.truncate ? O_TRUNC : 0);
+    fd = open(job.file_name.c_str(), flags, S_IRUSR | S_IWUSR | S_IRGRP |
+              S_IROTH);
+  }
+
+  if (fd != -1) {
+    BufferingFiles files;
+    u64 offset = 0;
+    for (size_t i = 0; i < job.requests.size(); ++i) {
+      const WriteBackRequest &request = job.requests[i];
+      if (request.offset != kWriteBackAppend) {
+        offset = (u64)request.offset;
+      }
+
+      size_t blob_size = 0;
+      if (WriteBackBlob(context, rpc, fd, request.blob_id, offset, &files,
+                        &blob_size) != 0) {
+        // TODO(chogan): @errorhandling
+        result = 1;
+        break;
+      }
+      offset += blob_size;
+      *bytes_written += blob_size;
+    }
+    CloseBufferingFiles(&files);
+
+    if (job.fd == -1 && close(fd) != 0) {
+      // TODO(chogan): @errorhandling
+      result = 1;
+    }
+  } else {
+    // TODO(chogan): @errorhandling
+    LOG(WARNING) << "Couldn't open " << job.file_name << " for write-back"
+                 << std::endl;
+    result = 1;
+  }
+
+  return result;
+}
+
+static void RunWriteBackWorker(WriteBackService *service) {
+  for (;;) {
+    WriteBackJob job;
+    {
+      std::unique_lock<std::mutex> lock(service->mutex);
+      service->work_cv.wait(lock, [service]() {
+        return service->stop_requested || !service->jobs.empty();
+      });
+      if (service->jobs.empty()) {
+        // NOTE(chogan): Only stop once the queue is drained.
+        break;
+      }
+      job = std::move(service->jobs.front());
+      service->jobs.pop_front();
+    }
+
+    u64 bytes_written = 0;
+    api::Status status = RunWriteBackJob(service->context, service->rpc, job,
+                                         &bytes_written);
+    {
+      std::lock_guard<std::mutex> lock(job.completion->mutex);
+      job.completion->status = status;
+      job.completion->bytes_written = bytes_written;
+      job.completion->done = true;
+    }
+    job.completion->done_cv.notify_all();
+
+    {
+      std::lock_guard<std::mutex> lock(service->mutex);
+      if (--service->num_outstanding == 0) {
+        service->idle_cv.notify_all();
+      }
+    }
+  }
+}
+
+std::shared_ptr<WriteBackService>
+StartWriteBackService(SharedMemoryContext *context, RpcContext *rpc,
+                      int num_threads) {
+  std::shared_ptr<WriteBackService> result =
+    std::make_shared<WriteBackService>();
+  result->context = context;
+  result->rpc = rpc;
+  result->num_outstanding = 0;
+  result->stop_requested = false;
+
+  WriteBackService *service = result.get();
+  for (int i = 0; i < num_threads; ++i) {
+    service->workers.emplace_back(RunWriteBackWorker, service);
+  }
+
+  return result;
+}
+
+void StopWriteBackService(WriteBackService *service) {
+  {
+    std::lock_guard<std::mutex> lock(service->mutex);
+    service->stop_requested = true;
+  }
+  service->work_cv.notify_all();
+
+  for (size_t i = 0; i < service->workers.size(); ++i) {
+    service->workers[i].join();
+  }
+  service->workers.clear();
+}
+
+WriteBackHandle EnqueueWriteBack(WriteBackService *service,
+                                 const std::string &file_name, int fd,
+                                 bool truncate,
+                                 std::vector<WriteBackRequest> requests) {
+  WriteBackHandle result = std::make_shared<WriteBackCompletion>();
+  result->done = false;
+  result->status = 0;
+  result->bytes_written = 0;
+
+  WriteBackJob job;
+  job.file_name = file_name;
+  job.fd = fd;
+  job.truncate = truncate;
+  job.requests = std::move(requests);
+  job.completion = result;
+
+  if (!service) {
+    // TODO(chogan): @errorhandling
+    result->status = 1;
+    result->done = true;
+    return result;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(service->mutex);
+    if (service->stop_requested) {
+      // TODO(chogan): @errorhandling
+      result->status = 1;
+      result->done = true;
+      return result;
+    }
+    service->jobs.push_back(std::move(job));
+    service->num_outstanding++;
+  }
+  service->work_cv.notify_one();
+
+  return result;
+}
+
+api::Status WaitForWriteBack(const WriteBackHandle &handle) {
+  std::unique_lock<std::mutex> lock(handle->mutex);
+  handle->done_cv.wait(lock, [&handle]() { return handle->done; });
+  api::Status result = handle->status;
+
+  return result;
+}
+
+void WriteBackBarrier(WriteBackService *service) {
+  std::unique_lock<std::mutex> lock(service->mutex);
+  service->idle_cv.wait(lock, [service]() {
+    return service->num_outstanding == 0;
+  });
+}
+
+}  // namespace hermes
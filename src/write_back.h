@@ -0,0 +1,124 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
+ * Distributed under BSD 3-Clause license.                                   *
+ * Copyright by The HDF Group.                                               *
+ * Copyright by the Illinois Institute of Technology.                        *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This file is part of Hermes. The full Hermes copyright notice, including  *
+ * terms governing use, modification, and redistribution, is contained in    *
+ * the COPYING file, which can be found at the top directory. If you do not  *
+ * have access to the file, you may request a copy from help@hdfgroup.org.   *
+ * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+#ifndef HERMES_WRITE_BACK_H_
+#define HERMES_WRITE_BACK_H_
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hermes_types.h"
+#include "buffer_pool.h"
+
+/**
+ * @file write_back.h
+ *
+ * A per-process pool of threads that writes Blobs to files in the background.
+ * Each job is one file. A job streams its Blobs directly from the buffers
+ * they live in to the file with `pwrite`, without first collecting each Blob
+ * into a contiguous copy. Jobs for different files run in parallel, and the
+ * caller gets a WriteBackHandle to wait on, so an application can keep
+ * computing while its data drains to the PFS.
+ */
+
+namespace hermes {
+
+struct RpcContext;
+
+/** Write the Blob immediately after the previous Blob of the same job. */
+const i64 kWriteBackAppend = -1;
+
+struct WriteBackRequest {
+  BlobID blob_id;
+  /** The file offset to write the Blob at, or kWriteBackAppend. */
+  i64 offset;
+};
+
+/**
+ * The completion state of one WriteBackJob.
+ */
+struct WriteBackCompletion {
+  std::mutex mutex;
+  std::condition_variable done_cv;
+  bool done;
+  api::Status status;
+  u64 bytes_written;
+};
+
+typedef std::shared_ptr<WriteBackCompletion> WriteBackHandle;
+
+struct WriteBackJob {
+  std::string file_name;
+  /** If not -1, the job writes to this descriptor instead of opening
+   * `file_name`, and the caller keeps ownership of it. */
+  int fd;
+  /** Truncate the file before writing */
+  bool truncate;
+  std::vector<WriteBackRequest> requests;
+  WriteBackHandle completion;
+};
+
+struct WriteBackService {
+  SharedMemoryContext *context;
+  RpcContext *rpc;
+  std::mutex mutex;
+  /** Signaled when a job is queued or the service is stopping. */
+  std::condition_variable work_cv;
+  /** Signaled when `num_outstanding` drops to 0. */
+  std::condition_variable idle_cv;
+  std::deque<WriteBackJob> jobs;
+  std::vector<std::thread> workers;
+  /** The number of jobs queued or in progress. */
+  u32 num_outstanding;
+  bool stop_requested;
+};
+
+/**
+ * Starts @p num_threads write-back threads. @p context and @p rpc must outlive
+ * the service.
+ */
+std::shared_ptr<WriteBackService>
+StartWriteBackService(SharedMemoryContext *context, RpcContext *rpc,
+                      int num_threads);
+
+/**
+ * Finishes all queued jobs, then joins the write-back threads.
+ */
+void StopWriteBackService(WriteBackService *service);
+
+/**
+ * Queues the Blobs in @p requests to be written to @p file_name (or to @p fd,
+ * if it isn't -1). Returns immediately.
+ */
+WriteBackHandle EnqueueWriteBack(WriteBackService *service,
+                                 const std::string &file_name, int fd,
+                                 bool truncate,
+                                 std::vector<WriteBackRequest> requests);
+
+/**
+ * Blocks until the job behind @p handle finishes and returns its Status.
+ */
+api::Status WaitForWriteBack(const WriteBackHandle &handle);
+
+/**
+ * Blocks until every job queued on @p service so far has finished.
+ */
+void WriteBackBarrier(WriteBackService *service);
+
+}  // namespace hermes
+
+#endif  // HERMES_WRITE_BACK_H_
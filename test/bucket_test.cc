@@ -12,7 +12,10 @@
 
 #include <cstdio>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <mpi.h>
 #include "zlib.h"
@@ -135,6 +138,50 @@ void TestBucketPersist(std::shared_ptr<hapi::Hermes> hermes) {
   Assert(std::remove(saved_file.c_str()) == 0);
 }
 
+void TestBucketPersistAsync(std::shared_ptr<hapi::Hermes> hermes) {
+  constexpr int bytes_per_blob = KILOBYTES(5);
+  constexpr int num_blobs = 4;
+  constexpr int num_buckets = 2;
+  constexpr int total_bytes = num_blobs * bytes_per_blob;
+
+  hapi::Context ctx;
+  std::vector<std::string> saved_files(num_buckets);
+  std::vector<hermes::WriteBackHandle> handles(num_buckets);
+  std::vector<std::unique_ptr<hapi::Bucket>> buckets;
+
+  for (int b = 0; b < num_buckets; ++b) {
+    std::string name = "async_persist_" + std::to_string(b);
+    buckets.emplace_back(new hapi::Bucket(name, hermes, ctx));
+    for (int i = 0; i < num_blobs; ++i) {
+      hapi::Blob blob(bytes_per_blob, 'a' + b * num_blobs + i);
+      Assert(buckets[b]->Put(std::to_string(i), blob, ctx) == 0);
+    }
+    saved_files[b] = name + ".txt";
+    handles[b] = buckets[b]->PersistAsync(saved_files[b], ctx);
+  }
+
+  hermes->WaitForWriteBacks();
+
+  for (int b = 0; b < num_buckets; ++b) {
+    Assert(hermes::WaitForWriteBack(handles[b]) == 0);
+    Assert(handles[b]->bytes_written == total_bytes);
+    buckets[b]->Destroy(ctx);
+
+    FILE *bkt_file = fopen(saved_files[b].c_str(), "r");
+    Assert(bkt_file);
+    std::vector<hermes::u8> read_buffer(total_bytes);
+    Assert(fread(read_buffer.data(), 1, total_bytes, bkt_file) == total_bytes);
+    Assert(fgetc(bkt_file) == EOF);
+    Assert(fclose(bkt_file) == 0);
+
+    for (int i = 0; i < total_bytes; ++i) {
+      char expected = 'a' + b * num_blobs + i / bytes_per_blob;
+      Assert(read_buffer[i] == expected);
+    }
+    Assert(std::remove(saved_files[b].c_str()) == 0);
+  }
+}
+
 void TestPutOverwrite(std::shared_ptr<hapi::Hermes> hermes) {
   hapi::Context ctx;
   hapi::Bucket bucket("overwrite", hermes, ctx);
@@ -210,6 +257,7 @@ int main(int argc, char **argv) {
     my_vb.Attach(&trait, ctx);  // compress action to data starts
 
     TestBucketPersist(hermes_app);
+    TestBucketPersistAsync(hermes_app);
     TestPutOverwrite(hermes_app);
 
     ///////
@@ -11,6 +11,8 @@
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
 #include <chrono>
+#include <cmath>
+#include <cstring>
 #include <string>
 #include <thread>
 #include <vector>
@@ -20,7 +22,9 @@
 #include "hermes.h"
 #include "bucket.h"
 #include "buffer_pool_internal.h"
+#include "data_placement_engine.h"
 #include "metadata_management_internal.h"
+#include "metadata_storage.h"
 #include "utils.h"
 #include "test_utils.h"
 
@@ -95,9 +99,8 @@ hapi::Status ForceBlobToSwap(Hermes *hermes, hermes::u64 id, hapi::Blob &blob,
   internal_blob.size = blob.size();
   hermes::BucketID bucket_id = {};
   bucket_id.as_int = id;
-  int retries = 3;
   hapi::Status result = PlaceBlob(&hermes->context_, &hermes->rpc_, schema,
-                                  internal_blob, blob_name, bucket_id, retries);
+                                  internal_blob, blob_name, bucket_id);
 
   return result;
 }
@@ -118,6 +121,53 @@ void MakeTwoBufferRAMConfig(hermes::Config *config) {
   config->arena_percentages[hermes::kArenaType_MetaData] = 0.5;
 }
 
+/**
+ * Fills out @p config to represent one 256 KB `Device` (RAM) split evenly
+ * between a slab of 1 block buffers and a slab of 4 block buffers.
+ */
+void MakeTwoSlabRAMConfig(hermes::Config *config) {
+  InitDefaultConfig(config);
+  config->num_devices = 1;
+  config->num_targets = 1;
+  config->capacities[0] = KILOBYTES(256);
+  config->num_slabs[0] = 2;
+  config->slab_unit_sizes[0][0] = 1;
+  config->slab_unit_sizes[0][1] = 4;
+  config->desired_slab_percentages[0][0] = 0.5f;
+  config->desired_slab_percentages[0][1] = 0.5f;
+  config->arena_percentages[hermes::kArenaType_BufferPool] = 0.5;
+  config->arena_percentages[hermes::kArenaType_MetaData] = 0.5;
+}
+
+/**
+ * Polls @p condition until it's true or @p timeout_ms milliseconds pass, and
+ * returns its last value. Used to wait for the BufferOrganizer.
+ */
+template<typename Condition>
+bool WaitUntil(Condition condition, int timeout_ms = 10000) {
+  auto deadline = (std::chrono::steady_clock::now() +
+                   std::chrono::milliseconds(timeout_ms));
+  bool result = condition();
+  while (!result && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    result = condition();
+  }
+
+  return result;
+}
+
+/** Returns the number of free segments in @p log. */
+hermes::u32 CountFreeSwapSegments(hermes::SwapLog *log) {
+  hermes::u32 result = 0;
+  for (hermes::u32 i = 0; i < log->num_segments; ++i) {
+    if (GetSwapSegment(log, i)->state == hermes::kSwapSegmentState_Free) {
+      result++;
+    }
+  }
+
+  return result;
+}
+
 void TestBlobOverwrite() {
   using namespace hermes;  // NOLINT(*)
   Config config = {};
@@ -151,6 +201,135 @@ void TestBlobOverwrite() {
   hermes->Finalize(true);
 }
 
+void TestRamDefragmentation() {
+  using namespace hermes;  // NOLINT(*)
+  Config config = {};
+  MakeTwoSlabRAMConfig(&config);
+  std::shared_ptr<Hermes> hermes = hermes::InitHermesDaemon(&config);
+  SharedMemoryContext *context = &hermes->context_;
+  DeviceID ram_id = 0;
+  std::atomic<u32> *buffers_available =
+    GetAvailableBuffersArray(context, ram_id);
+  u32 small_size = GetSlabBufferSize(context, ram_id, 0);
+
+  // NOTE(chogan): Take all the large buffers and fill all the small ones, then
+  // free 3 out of every 4 small buffers. Merging now requires moving the
+  // remaining ones out of the way.
+  std::vector<BufferID> large_ids;
+  for (BufferID id = GetFreeBuffer(context, ram_id, 1); id.as_int != 0;
+       id = GetFreeBuffer(context, ram_id, 1)) {
+    large_ids.push_back(id);
+  }
+  std::vector<BufferID> kept_ids;
+  for (BufferID id = GetFreeBuffer(context, ram_id, 0); id.as_int != 0;
+       id = GetFreeBuffer(context, ram_id, 0)) {
+    kept_ids.push_back(id);
+  }
+  Assert(kept_ids.size() >= 8);
+  for (size_t i = 0; i < kept_ids.size(); ++i) {
+    GetHeaderByBufferId(context, kept_ids[i])->used = small_size;
+    memset(GetRamBufferPtr(context, kept_ids[i]), 'a' + i % 26, small_size);
+  }
+  for (size_t i = 0; i < kept_ids.size(); ++i) {
+    if (i % 4 != 0) {
+      LocalReleaseBuffer(context, kept_ids[i]);
+      kept_ids[i].as_int = 0;
+    }
+  }
+  Assert(buffers_available[1] == 0);
+
+  f32 score_before = ComputeFragmentationScore(context);
+  Assert(score_before > 0.25f);
+  u64 free_bytes_before = buffers_available[0] * small_size;
+
+  DefragPolicy policy = {};
+  policy.threshold = 0.25f;
+  policy.max_steps = 64;
+  policy.max_relocations = 64;
+  Assert(DefragmentRam(context, policy) > 0);
+
+  Assert(buffers_available[1] > 0);
+  Assert(ComputeFragmentationScore(context) < score_before);
+  u64 free_bytes_after =
+    (buffers_available[0] * small_size +
+     buffers_available[1] * GetSlabBufferSize(context, ram_id, 1));
+  Assert(free_bytes_after == free_bytes_before);
+
+  // NOTE(chogan): Relocated buffers keep their BufferIDs and their data.
+  for (size_t i = 0; i < kept_ids.size(); ++i) {
+    if (kept_ids[i].as_int != 0) {
+      u8 *data = GetRamBufferPtr(context, kept_ids[i]);
+      for (u32 j = 0; j < small_size; ++j) {
+        Assert(data[j] == 'a' + i % 26);
+      }
+      LocalReleaseBuffer(context, kept_ids[i]);
+    }
+  }
+  LocalReleaseBuffers(context, large_ids);
+
+  hermes->Finalize(true);
+}
+
+void TestSlabAdaptation() {
+  using namespace hermes;  // NOLINT(*)
+  Config config = {};
+  MakeTwoSlabRAMConfig(&config);
+  std::shared_ptr<Hermes> hermes = hermes::InitHermesDaemon(&config);
+  SharedMemoryContext *context = &hermes->context_;
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  DeviceID ram_id = 0;
+  TargetID ram_target = testing::DefaultRamTargetId();
+  u32 small_size = GetSlabBufferSize(context, ram_id, 0);
+
+  // NOTE(chogan): Only ask for small buffers until they run out. The large
+  // buffers can't serve these requests.
+  PlacementSchema small_request{std::make_pair(small_size, ram_target)};
+  std::vector<BufferID> ids;
+  for (std::vector<BufferID> ret = GetBuffers(context, small_request);
+       ret.size() > 0;
+       ret = GetBuffers(context, small_request)) {
+    ids.insert(ids.end(), ret.begin(), ret.end());
+  }
+  Assert(ids.size() > 0);
+
+  FragmentationStats before = GetFragmentationStats(context, ram_id);
+  Assert(before.slabs.size() == 2);
+  Assert(before.slabs[0].num_free == 0);
+  Assert(before.slabs[0].num_in_use == ids.size());
+  Assert(before.slabs[0].demand == 1.0f);
+  Assert(before.slabs[1].num_in_use == 0);
+  Assert(before.slabs[1].num_free > 0);
+  Assert(before.internal_fragmentation == 0);
+
+  Assert(AdaptRamSlabPercentages(context, 1.0f));
+  Assert(pool->ram_slab_percentages[0] > 0.9f);
+  f32 adapted_score = ComputeFragmentationScore(context);
+  Assert(adapted_score > 0.9f);
+
+  DefragPolicy policy = {};
+  policy.threshold = 0.1f;
+  policy.max_steps = 64;
+  policy.max_relocations = 0;
+  Assert(DefragmentRam(context, policy) > 0);
+
+  FragmentationStats after = GetFragmentationStats(context, ram_id);
+  Assert(after.slabs[0].num_free > 0);
+  Assert(after.slabs[1].num_free < before.slabs[1].num_free);
+  Assert(after.free_space_score < adapted_score);
+
+  // NOTE(chogan): Half of a small buffer is wasted.
+  PlacementSchema half_request{std::make_pair(small_size / 2, ram_target)};
+  std::vector<BufferID> half = GetBuffers(context, half_request);
+  Assert(half.size() == 1);
+  ids.push_back(half[0]);
+  FragmentationStats with_half = GetFragmentationStats(context, ram_id);
+  f32 expected = 0.5f / (f32)ids.size();
+  Assert(std::abs(with_half.internal_fragmentation - expected) < 1e-4f);
+
+  LocalReleaseBuffers(context, ids);
+  hermes->Finalize(true);
+}
+
 void TestSwap(std::shared_ptr<Hermes> hermes) {
   hapi::Context ctx;
   ctx.policy = hapi::PlacementPolicy::kRandom;
@@ -198,11 +377,12 @@ void TestBufferOrganizer(std::shared_ptr<Hermes> hermes) {
   // and the buffer organizer should move it from swap space to the hierarchy.
   bucket.DeleteBlob(blob1_name, ctx);
 
-  // NOTE(chogan): Give the BufferOrganizer time to finish.
-  std::this_thread::sleep_for(std::chrono::seconds(2));
-
-  Assert(bucket.ContainsBlob(blob2_name));
-  Assert(!bucket.BlobIsInSwap(blob2_name));
+  hermes::BufferPool *pool = GetBufferPoolFromContext(&hermes->context_);
+  Assert(WaitUntil([&]() {
+    return (bucket.ContainsBlob(blob2_name) &&
+            !bucket.BlobIsInSwap(blob2_name) &&
+            pool->num_queued_swap_blobs == 0);
+  }));
 
   hapi::Blob get_result;
   size_t blob_size = bucket.Get(blob2_name, get_result, ctx);
@@ -214,6 +394,842 @@ void TestBufferOrganizer(std::shared_ptr<Hermes> hermes) {
   bucket.Destroy(ctx);
 }
 
+static hermes::u32 GetBlobSwapSegment(std::shared_ptr<Hermes> hermes,
+                                      hapi::Bucket &bucket,
+                                      const std::string &blob_name) {
+  using namespace hermes;  // NOLINT(*)
+  BucketID bucket_id = {};
+  bucket_id.as_int = bucket.GetId();
+  BlobID blob_id = GetBlobIdByName(&hermes->context_, &hermes->rpc_,
+                                   blob_name.c_str(), bucket_id);
+  Assert(BlobIsInSwap(blob_id));
+  std::vector<BufferID> ids = GetBufferIdList(&hermes->context_,
+                                              &hermes->rpc_, blob_id);
+  SwapBlob swap_blob = VecToSwapBlob(ids);
+  u32 result = GetSwapSegmentIndex(swap_blob.offset);
+
+  return result;
+}
+
+void TestSwapCompaction(std::shared_ptr<Hermes> hermes) {
+  using namespace hermes;  // NOLINT(*)
+  hapi::Context ctx;
+  ctx.policy = hapi::PlacementPolicy::kRandom;
+  hapi::Bucket bucket(std::string("swap_log_bucket"), hermes, ctx);
+
+  // NOTE(chogan): Fill our single buffer so the rest of the Blobs stay in swap.
+  hapi::Blob filler(KILOBYTES(4), 'f');
+  hapi::Status status = bucket.Put("swap_log_filler", filler, ctx);
+  Assert(status == 0);
+  Assert(!bucket.BlobIsInSwap("swap_log_filler"));
+
+  // NOTE(chogan): Write Blobs to swap until the active segment is sealed.
+  std::vector<std::string> names;
+  u32 first_segment = 0;
+  for (int i = 0; i < 16; ++i) {
+    std::string name = "swap_log_blob" + std::to_string(i);
+    hapi::Blob data(KILOBYTES(4), 'a' + i);
+    status = ForceBlobToSwap(hermes.get(), bucket.GetId(), data, name.c_str());
+    Assert(status == 0);
+    u32 segment = GetBlobSwapSegment(hermes, bucket, name);
+    if (i == 0) {
+      first_segment = segment;
+    } else if (segment != first_segment) {
+      break;
+    }
+    names.push_back(name);
+  }
+  Assert(names.size() > 0 && names.size() < 16);
+
+  // NOTE(chogan): Delete all but one Blob in the sealed segment, which drops
+  // it below the compaction threshold.
+  for (size_t i = 0; i < names.size() - 1; ++i) {
+    bucket.DeleteBlob(names[i], ctx);
+  }
+
+  SwapLog *log = GetSwapLog(&hermes->context_);
+  Assert(WaitUntil([&]() {
+    return (GetSwapSegment(log, first_segment)->state ==
+            kSwapSegmentState_Free);
+  }));
+
+  std::string survivor = names.back();
+  Assert(bucket.BlobIsInSwap(survivor));
+  Assert(GetBlobSwapSegment(hermes, bucket, survivor) != first_segment);
+
+  hapi::Blob expected(KILOBYTES(4), 'a' + (char)(names.size() - 1));
+  hapi::Blob get_result(KILOBYTES(4));
+  size_t blob_size = bucket.Get(survivor, get_result, ctx);
+  Assert(blob_size == expected.size());
+  Assert(get_result == expected);
+
+  bucket.Destroy(ctx);
+}
+
+void TestSwapFull(std::shared_ptr<Hermes> hermes) {
+  using namespace hermes;  // NOLINT(*)
+  hapi::Context ctx;
+  hapi::Bucket bucket(std::string("swap_full_bucket"), hermes, ctx);
+  SwapLog *log = GetSwapLog(&hermes->context_);
+
+  // NOTE(chogan): Let any compaction from the previous tests finish so the
+  // number of free segments holds still.
+  Assert(WaitUntil([&]() {
+    bool compacting = log->compaction_requested.load();
+    for (u32 i = 0; i < log->num_segments; ++i) {
+      if (GetSwapSegment(log, i)->state == kSwapSegmentState_Compacting) {
+        compacting = true;
+      }
+    }
+    return !compacting;
+  }));
+
+  // NOTE(chogan): Swap space runs out instead of aborting.
+  std::vector<std::string> names;
+  hapi::Status status = 0;
+  for (u32 i = 0; i < 4 * log->num_segments && status == 0; ++i) {
+    std::string name = "swap_full_blob" + std::to_string(i);
+    hapi::Blob data(KILOBYTES(4), 'a' + (i % 26));
+    status = ForceBlobToSwap(hermes.get(), bucket.GetId(), data, name.c_str());
+    if (status == 0) {
+      names.push_back(name);
+    } else {
+      Assert(!bucket.ContainsBlob(name));
+    }
+  }
+  Assert(status != 0);
+  Assert(names.size() > 0);
+
+  // NOTE(chogan): One segment is still free for compaction.
+  Assert(CountFreeSwapSegments(log) == 1);
+
+  // NOTE(chogan): Freeing most of the Blobs lets compaction make room again.
+  for (size_t i = 0; i + 1 < names.size(); ++i) {
+    bucket.DeleteBlob(names[i], ctx);
+  }
+  Assert(WaitUntil([&]() { return CountFreeSwapSegments(log) > 1; }));
+
+  hapi::Blob data(KILOBYTES(4), 'z');
+  status = ForceBlobToSwap(hermes.get(), bucket.GetId(), data,
+                           "swap_full_after");
+  Assert(status == 0);
+
+  hapi::Blob expected(KILOBYTES(4), 'a' + ((names.size() - 1) % 26));
+  hapi::Blob get_result(KILOBYTES(4));
+  size_t blob_size = bucket.Get(names.back(), get_result, ctx);
+  Assert(blob_size == expected.size());
+  Assert(get_result == expected);
+
+  bucket.Destroy(ctx);
+}
+
+void TestSwapLogEntries(std::shared_ptr<Hermes> hermes) {
+  using namespace hermes;  // NOLINT(*)
+  hapi::Context ctx;
+  hapi::Bucket bucket(std::string("swap_entries_bucket"), hermes, ctx);
+
+  // NOTE(chogan): Overwriting a swap Blob leaves its old record in the log.
+  hapi::Blob data(KILOBYTES(4), 'e');
+  Assert(ForceBlobToSwap(hermes.get(), bucket.GetId(), data, "entry0") == 0);
+  Assert(ForceBlobToSwap(hermes.get(), bucket.GetId(), data, "entry1") == 0);
+  Assert(ForceBlobToSwap(hermes.get(), bucket.GetId(), data, "entry1") == 0);
+
+  // NOTE(chogan): A restarted BufferOrganizer queues each Blob once.
+  std::vector<SwapDrainEntry> entries =
+    GetSwapLogEntries(&hermes->context_, hermes->rpc_.node_id);
+  int num_entry0 = 0;
+  int num_entry1 = 0;
+  for (const SwapDrainEntry &entry : entries) {
+    if (entry.swap_blob.bucket_id.as_int == bucket.GetId()) {
+      num_entry0 += entry.name == "entry0";
+      num_entry1 += entry.name == "entry1";
+    }
+  }
+  Assert(num_entry0 == 1);
+  Assert(num_entry1 == 1);
+
+  bucket.Destroy(ctx);
+}
+
+void TestMoveToTarget(std::shared_ptr<Hermes> hermes) {
+  using namespace hermes;  // NOLINT(*)
+  SharedMemoryContext *context = &hermes->context_;
+  RpcContext *rpc = &hermes->rpc_;
+
+  hapi::Context ctx;
+  hapi::Bucket bucket(std::string("move_bucket"), hermes, ctx);
+  std::string blob_name("move_blob");
+  hapi::Blob data(KILOBYTES(64), 'm');
+  hapi::Status status = bucket.Put(blob_name, data, ctx);
+  Assert(status == 0);
+
+  BucketID bucket_id = {};
+  bucket_id.as_int = bucket.GetId();
+  BlobID blob_id = GetBlobIdByName(context, rpc, blob_name.c_str(), bucket_id);
+  std::vector<BufferID> old_ids = GetBufferIdList(context, rpc, blob_id);
+  Assert(old_ids.size() > 0);
+  DeviceID src_device = GetBufferDeviceId(context, rpc, old_ids[0]);
+
+  TargetID dest = {};
+  std::vector<TargetID> targets = GetNodeTargets(context);
+  for (size_t i = 0; i < targets.size(); ++i) {
+    if (targets[i].bits.device_id != src_device) {
+      dest = targets[i];
+      break;
+    }
+  }
+  Assert(!IsNullTargetId(dest));
+
+  u64 generation = GetBlobGeneration(context, rpc, blob_id);
+  u64 dest_capacity = LocalGetRemainingCapacity(context, dest);
+  Assert(MoveToTarget(context, rpc, blob_id, dest) == 0);
+  Assert(LocalGetRemainingCapacity(context, dest) < dest_capacity);
+
+  std::vector<BufferID> new_ids = GetBufferIdList(context, rpc, blob_id);
+  for (size_t i = 0; i < new_ids.size(); ++i) {
+    Assert(GetBufferDeviceId(context, rpc, new_ids[i]) == dest.bits.device_id);
+  }
+
+  // NOTE(chogan): A swap based on a stale generation must be rejected.
+  Assert(GetBlobGeneration(context, rpc, blob_id) != generation);
+  Assert(!ReplaceBufferIdList(context, rpc, blob_id, generation, old_ids));
+
+  hapi::Blob get_result(data.size());
+  size_t blob_size = bucket.Get(blob_name, get_result, ctx);
+  Assert(blob_size == data.size());
+  Assert(get_result == data);
+
+  // NOTE(chogan): Move the Blob back through the BufferOrganizer's queue.
+  TargetID src = {};
+  for (size_t i = 0; i < targets.size(); ++i) {
+    if (targets[i].bits.device_id == src_device) {
+      src = targets[i];
+      break;
+    }
+  }
+  Assert(EnqueueBlobMove(context, rpc, blob_id, src, 1));
+
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  Assert(WaitUntil([&]() { return pool->num_pending_moves == 0; }));
+  new_ids = GetBufferIdList(context, rpc, blob_id);
+  for (size_t i = 0; i < new_ids.size(); ++i) {
+    Assert(GetBufferDeviceId(context, rpc, new_ids[i]) == src_device);
+  }
+
+  blob_size = bucket.Get(blob_name, get_result, ctx);
+  Assert(blob_size == data.size());
+  Assert(get_result == data);
+
+  // NOTE(chogan): Once the Blob is replaced, its old BlobID must not resolve
+  // to the new Blob, even if the new id list reuses the old heap offset.
+  Assert(bucket.Put(blob_name, data, ctx) == 0);
+  BlobID new_blob_id = GetBlobIdByName(context, rpc, blob_name.c_str(),
+                                       bucket_id);
+  Assert(new_blob_id.as_int != blob_id.as_int);
+  Assert(GetBufferIdList(context, rpc, blob_id).empty());
+  Assert(GetBlobGeneration(context, rpc, blob_id) == 0);
+  Assert(MoveToTarget(context, rpc, blob_id, dest) != 0);
+  Assert(!GetBufferIdList(context, rpc, new_blob_id).empty());
+
+  // NOTE(chogan): Late statistics updates for the old BlobID are dropped.
+  AccessStats new_stats = GetBlobStats(context, rpc, new_blob_id);
+  RecordBlobAccess(context, rpc, bucket_id, blob_id, kAccessType_Read,
+                   data.size());
+  SetBlobStats(context, rpc, blob_id, AccessStats{});
+  Assert(GetBlobStats(context, rpc, new_blob_id).reads == new_stats.reads);
+  Assert(GetBlobStats(context, rpc, new_blob_id).writes == new_stats.writes);
+  Assert(GetBlobStats(context, rpc, blob_id).writes == 0);
+
+  bucket.Destroy(ctx);
+}
+
+hermes::DeviceID GetBlobDevice(std::shared_ptr<Hermes> hermes,
+                               hermes::BlobID blob_id) {
+  using namespace hermes;  // NOLINT(*)
+  SharedMemoryContext *context = &hermes->context_;
+  RpcContext *rpc = &hermes->rpc_;
+  std::vector<BufferID> buffer_ids = GetBufferIdList(context, rpc, blob_id);
+  Assert(buffer_ids.size() > 0);
+  DeviceID result = GetBufferDeviceId(context, rpc, buffer_ids[0]);
+
+  return result;
+}
+
+void TestTieringPolicy(std::shared_ptr<Hermes> hermes) {
+  using namespace hermes;  // NOLINT(*)
+  SharedMemoryContext *context = &hermes->context_;
+  RpcContext *rpc = &hermes->rpc_;
+  std::vector<TargetID> targets = GetNodeTargets(context);
+  Assert(targets.size() > 2);
+
+  hapi::Context ctx;
+  hapi::Bucket bucket(std::string("tiering_bucket"), hermes, ctx);
+  hapi::Blob data(KILOBYTES(16), 't');
+  std::string hot_name("hot");
+  std::string cold_name("cold");
+  Assert(bucket.Put(hot_name, data, ctx) == 0);
+  Assert(bucket.Put(cold_name, data, ctx) == 0);
+  BucketID bucket_id = {};
+  bucket_id.as_int = bucket.GetId();
+  BlobID hot_id = GetBlobIdByName(context, rpc, hot_name.c_str(), bucket_id);
+  BlobID cold_id = GetBlobIdByName(context, rpc, cold_name.c_str(),
+                                   bucket_id);
+
+  // NOTE(chogan): Start with the hot Blob on a slow Target and the cold Blob
+  // on the fastest one.
+  Assert(MoveToTarget(context, rpc, hot_id, targets[1]) == 0);
+  Assert(MoveToTarget(context, rpc, cold_id, targets[0]) == 0);
+  AccessStats stats = {};
+  stats.frequency = 100;
+  SetBlobStats(context, rpc, hot_id, stats);
+  stats.frequency = 0;
+  SetBlobStats(context, rpc, cold_id, stats);
+
+  TieringPolicy policy = {};
+  policy.promotion_frequency = 10;
+
+  // NOTE(chogan): With both watermarks at 0, every Target is over the high
+  // watermark, so each Blob is demoted one level and nothing is promoted.
+  policy.high_watermark = 0;
+  policy.low_watermark = 0;
+  i64 budget = MEGABYTES(1);
+  u32 cursor = 0;
+  Assert(RunTieringPolicy(context, rpc, policy, &budget, &cursor) > 0);
+  Assert(WaitUntil([&]() {
+    return (GetBlobDevice(hermes, cold_id) == targets[1].bits.device_id &&
+            GetBlobDevice(hermes, hot_id) == targets[2].bits.device_id);
+  }));
+
+  // NOTE(chogan): With both watermarks at 1, nothing is demoted, and only the
+  // hot Blob is promoted.
+  policy.high_watermark = 1;
+  policy.low_watermark = 1;
+  budget = MEGABYTES(1);
+  Assert(RunTieringPolicy(context, rpc, policy, &budget, &cursor) > 0);
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  Assert(WaitUntil([&]() {
+    return (pool->num_pending_moves == 0 &&
+            GetBlobDevice(hermes, hot_id) == targets[0].bits.device_id);
+  }));
+  Assert(GetBlobDevice(hermes, cold_id) == targets[1].bits.device_id);
+
+  // NOTE(chogan): An exhausted budget moves nothing.
+  policy.high_watermark = 0;
+  policy.low_watermark = 0;
+  budget = 0;
+  Assert(RunTieringPolicy(context, rpc, policy, &budget, &cursor) == 0);
+
+  hapi::Blob get_result(data.size());
+  Assert(bucket.Get(hot_name, get_result, ctx) == data.size());
+  Assert(get_result == data);
+
+  bucket.Destroy(ctx);
+}
+
+void TestTargetWatermarks(std::shared_ptr<Hermes> hermes) {
+  using namespace hermes;  // NOLINT(*)
+  SharedMemoryContext *context = &hermes->context_;
+  RpcContext *rpc = &hermes->rpc_;
+  std::vector<TargetID> targets = GetNodeTargets(context);
+  Assert(targets.size() > 2);
+  Target *fastest = GetTargetFromId(context, targets[0]);
+  u32 small_size = GetSlabBufferSize(context, targets[0].bits.device_id, 0);
+  PlacementSchema request{std::make_pair(small_size, targets[0])};
+
+  // NOTE(chogan): A reservation only lasts until the buffers are allocated.
+  std::vector<BufferID> ids = GetBuffers(context, request);
+  Assert(ids.size() == 1);
+  Assert(fastest->reserved_space.load() == 0);
+  LocalReleaseBuffers(context, ids);
+
+  // NOTE(chogan): Space reserved by another placement is hidden from the
+  // planner and can't be allocated.
+  u64 remaining = fastest->remaining_space.load();
+  u64 claimed = remaining - small_size / 2;
+  fastest->reserved_space.fetch_add(claimed);
+  Assert(LocalGetRemainingCapacity(context, targets[0]) == remaining - claimed);
+  Assert(GetBuffers(context, request).size() == 0);
+  fastest->reserved_space.fetch_sub(claimed);
+  ids = GetBuffers(context, request);
+  Assert(ids.size() == 1);
+  LocalReleaseBuffers(context, ids);
+
+  // NOTE(chogan): A placement holds its capacity from the time it's planned
+  // until its buffers are claimed.
+  hapi::Context plan_ctx;
+  std::vector<size_t> sizes(1, small_size);
+  std::vector<PlacementSchema> planned;
+  CapacityReservation reservation = {};
+  Assert(CalculatePlacement(context, rpc, sizes, planned, plan_ctx,
+                            &reservation) == 0);
+  u64 total_reserved = 0;
+  for (size_t i = 0; i < targets.size(); ++i) {
+    total_reserved += GetTargetFromId(context, targets[i])->reserved_space;
+  }
+  Assert(total_reserved >= small_size);
+  ids = GetBuffers(context, planned[0], &reservation);
+  Assert(ids.size() > 0);
+  for (size_t i = 0; i < targets.size(); ++i) {
+    Assert(GetTargetFromId(context, targets[i])->reserved_space == 0);
+  }
+  ReleaseCapacity(context, &reservation);
+  LocalReleaseBuffers(context, ids);
+
+  hapi::Context ctx;
+  hapi::Bucket bucket(std::string("eviction_bucket"), hermes, ctx);
+  hapi::Blob data(KILOBYTES(16), 'e');
+  std::string warm_name("warm");
+  std::string cold_name("cold");
+  Assert(bucket.Put(warm_name, data, ctx) == 0);
+  Assert(bucket.Put(cold_name, data, ctx) == 0);
+  BucketID bucket_id = {};
+  bucket_id.as_int = bucket.GetId();
+  BlobID warm_id = GetBlobIdByName(context, rpc, warm_name.c_str(), bucket_id);
+  BlobID cold_id = GetBlobIdByName(context, rpc, cold_name.c_str(),
+                                   bucket_id);
+  Assert(MoveToTarget(context, rpc, warm_id, targets[0]) == 0);
+  Assert(MoveToTarget(context, rpc, cold_id, targets[0]) == 0);
+  AccessStats stats = {};
+  stats.frequency = 100;
+  SetBlobStats(context, rpc, warm_id, stats);
+  stats.frequency = 0;
+  SetBlobStats(context, rpc, cold_id, stats);
+
+  f32 high_watermark = fastest->high_watermark;
+  f32 low_watermark = fastest->low_watermark;
+
+  // NOTE(chogan): Ask for half a Blob's worth of space, which only the coldest
+  // Blob should be evicted for.
+  f32 usage = 1.0f - ((f32)LocalGetRemainingCapacity(context, targets[0]) /
+                      (f32)fastest->capacity);
+  fastest->high_watermark = 0;
+  fastest->low_watermark = usage - ((f32)data.size() / 2.0f /
+                                    (f32)fastest->capacity);
+  Assert(EvictFromTarget(context, rpc, targets[0]) == data.size());
+  Assert(GetBlobDevice(hermes, cold_id) == targets[1].bits.device_id);
+  Assert(GetBlobDevice(hermes, warm_id) == targets[0].bits.device_id);
+  Assert(!fastest->eviction_requested.load());
+
+  // NOTE(chogan): Crossing the high watermark wakes the BufferOrganizer, which
+  // frees down to the low watermark.
+  fastest->low_watermark = 0;
+  WakeTargetEviction(context, rpc, targets[0]);
+  Assert(WaitUntil([&]() {
+    return (!fastest->eviction_requested.load() &&
+            GetBlobDevice(hermes, warm_id) == targets[1].bits.device_id);
+  }));
+
+  fastest->high_watermark = high_watermark;
+  fastest->low_watermark = low_watermark;
+
+  hapi::Blob get_result(data.size());
+  Assert(bucket.Get(warm_name, get_result, ctx) == data.size());
+  Assert(get_result == data);
+
+  bucket.Destroy(ctx);
+}
+
+void TestPrefetch(std::shared_ptr<Hermes> hermes) {
+  using namespace hermes;  // NOLINT(*)
+  SharedMemoryContext *context = &hermes->context_;
+  RpcContext *rpc = &hermes->rpc_;
+  std::vector<TargetID> targets = GetNodeTargets(context);
+  Assert(targets.size() > 2);
+  TargetID slowest = targets.back();
+
+  hapi::Context ctx;
+  ctx.read_ahead_depth = 0;
+  hapi::Bucket bucket(std::string("prefetch_bucket"), hermes, ctx);
+  BucketID bucket_id = {};
+  bucket_id.as_int = bucket.GetId();
+  hapi::Blob data(KILOBYTES(16), 'p');
+  const int kNumBlobs = 6;
+  std::vector<BlobID> blob_ids(kNumBlobs);
+  for (int i = 0; i < kNumBlobs; ++i) {
+    std::string name = "ra_" + std::to_string(i);
+    Assert(bucket.Put(name, data, ctx) == 0);
+    blob_ids[i] = GetBlobIdByName(context, rpc, name.c_str(), bucket_id);
+    Assert(MoveToTarget(context, rpc, blob_ids[i], slowest) == 0);
+  }
+  Assert(bucket.Put(std::string("cold"), data, ctx) == 0);
+  BlobID cold_id = GetBlobIdByName(context, rpc, "cold", bucket_id);
+  Assert(MoveToTarget(context, rpc, cold_id, slowest) == 0);
+
+  // NOTE(chogan): An explicit Prefetch moves the Blob to the fastest tier.
+  std::vector<std::string> names(1, std::string("cold"));
+  Assert(bucket.Prefetch(names, (int)targets.size(), ctx) != 0);
+  Assert(bucket.Prefetch(names, 0, ctx) == 0);
+  Assert(WaitUntil([&]() {
+    return GetBlobDevice(hermes, cold_id) == targets[0].bits.device_id;
+  }));
+
+  // NOTE(chogan): Reading "ra_0", "ra_1", and "ra_2" establishes a stride of
+  // 1, so the next read_ahead_depth Blobs are prefetched, and no others.
+  ctx.read_ahead_depth = 2;
+  hapi::Blob get_result(data.size());
+  for (int i = 0; i < 3; ++i) {
+    std::string name = "ra_" + std::to_string(i);
+    Assert(bucket.Get(name, get_result, ctx) == data.size());
+    Assert(get_result == data);
+  }
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  Assert(WaitUntil([&]() {
+    return (pool->num_pending_moves == 0 &&
+            GetBlobDevice(hermes, blob_ids[3]) == targets[0].bits.device_id &&
+            GetBlobDevice(hermes, blob_ids[4]) == targets[0].bits.device_id);
+  }));
+  Assert(GetBlobDevice(hermes, blob_ids[5]) == slowest.bits.device_id);
+
+  // NOTE(chogan): A batch of moves only queues as many as fit under the queue
+  // depth, starting from the front.
+  u32 max_pending_moves = pool->max_pending_moves;
+  pool->max_pending_moves = 1;
+  std::vector<BlobID> batch = {blob_ids[5], cold_id};
+  Assert(EnqueueBlobMoves(context, rpc, batch, targets[0], 1,
+                          kBoPriority_Prefetch) == 1);
+  Assert(WaitUntil([&]() { return pool->num_pending_moves == 0; }));
+  pool->max_pending_moves = max_pending_moves;
+  Assert(GetBlobDevice(hermes, blob_ids[5]) == targets[0].bits.device_id);
+
+  bucket.Destroy(ctx);
+}
+
+void TestPlacementCache(Hermes *hermes) {
+  using namespace hermes;  // NOLINT(*)
+  SharedMemoryContext *context = &hermes->context_;
+  RpcContext *rpc = &hermes->rpc_;
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  PlacementCache *cache = context->placement_cache;
+  Assert(cache);
+
+  hapi::Context ctx;
+  ctx.policy = hapi::PlacementPolicy::kMinimizeIoTime;
+  std::vector<size_t> sizes(1, KILOBYTES(64));
+
+  // NOTE(chogan): The second identical placement comes from the cache.
+  std::vector<PlacementSchema> first;
+  Assert(CalculatePlacement(context, rpc, sizes, first, ctx) == 0);
+  u64 hits = cache->hits;
+  std::vector<PlacementSchema> second;
+  Assert(CalculatePlacement(context, rpc, sizes, second, ctx) == 0);
+  Assert(cache->hits == hits + 1);
+  Assert(second.size() == 1);
+  Assert(second[0].size() == first[0].size());
+  for (size_t i = 0; i < first[0].size(); ++i) {
+    Assert(second[0][i].first == first[0][i].first);
+    Assert(second[0][i].second.as_int == first[0][i].second.as_int);
+  }
+
+  // NOTE(chogan): Randomized policies are never cached.
+  ctx.policy = hapi::PlacementPolicy::kRandom;
+  std::vector<PlacementSchema> random;
+  Assert(CalculatePlacement(context, rpc, sizes, random, ctx) == 0);
+  Assert(cache->hits == hits + 1);
+  ctx.policy = hapi::PlacementPolicy::kMinimizeIoTime;
+
+  // NOTE(chogan): Queued writes change the cost model, so the cache is
+  // bypassed until they drain.
+  u64 misses = cache->misses;
+  pool->queued_write_bytes[0].fetch_add(MEGABYTES(1));
+  std::vector<PlacementSchema> queued;
+  Assert(CalculatePlacement(context, rpc, sizes, queued, ctx) == 0);
+  Assert(cache->hits == hits + 1);
+  Assert(cache->misses == misses);
+  pool->queued_write_bytes[0].fetch_sub(MEGABYTES(1));
+
+  // NOTE(chogan): With a threshold of 0, any allocation starts a new capacity
+  // epoch, which invalidates the cache.
+  std::vector<TargetID> targets = GetNodeTargets(context);
+  f32 threshold = pool->placement_cache_threshold;
+  pool->placement_cache_threshold = 0;
+  u64 epoch = pool->capacity_epoch.load();
+  u32 small_size = GetSlabBufferSize(context, targets[0].bits.device_id, 0);
+  PlacementSchema request{std::make_pair(small_size, targets[0])};
+  std::vector<BufferID> ids = GetBuffers(context, request);
+  Assert(ids.size() == 1);
+  Assert(pool->capacity_epoch.load() > epoch);
+  pool->placement_cache_threshold = threshold;
+
+  misses = cache->misses;
+  std::vector<PlacementSchema> third;
+  Assert(CalculatePlacement(context, rpc, sizes, third, ctx) == 0);
+  Assert(cache->misses == misses + 1);
+  LocalReleaseBuffers(context, ids);
+}
+
+void TestIoBudget(std::shared_ptr<Hermes> hermes) {
+  using namespace hermes;  // NOLINT(*)
+  SharedMemoryContext *context = &hermes->context_;
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  DeviceID device_id = (DeviceID)(pool->num_devices - 1);
+  IoBudget *budget = &pool->io_budgets[device_id];
+  Assert(budget->bytes_per_sec > 0);
+  Assert(budget->burst > 0);
+
+  // NOTE(chogan): Foreground work is never charged.
+  i64 tokens = budget->tokens.load();
+  Assert(ChargeIoBudget(context, device_id, GIGABYTES(1),
+                        kBoPriority_Foreground) == 0);
+  Assert(budget->tokens.load() == tokens);
+
+  // NOTE(chogan): Spending a full burst plus one second's worth of bandwidth
+  // leaves about a second of debt.
+  u64 bytes = (u64)(budget->burst + budget->bytes_per_sec);
+  f64 wait_ms = ChargeIoBudget(context, device_id, bytes, kBoPriority_Tiering);
+  Assert(wait_ms > 900 && wait_ms < 1100);
+
+  // NOTE(chogan): Later background work queues up behind the debt.
+  f64 next_wait_ms = ChargeIoBudget(context, device_id, 1, kBoPriority_Defrag);
+  Assert(next_wait_ms > 0);
+
+  budget->tokens.store(budget->burst);
+}
+
+void TestMeasuredBandwidths(Hermes *hermes) {
+  using namespace hermes;  // NOLINT(*)
+  SharedMemoryContext *context = &hermes->context_;
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  DeviceID device_id = (DeviceID)(pool->num_devices - 1);
+  BandwidthEstimate *estimate = &pool->bandwidth_estimates[device_id];
+  Target *target = GetTarget(context, device_id);
+  f32 configured = GetDeviceById(context, device_id)->bandwidth_mbps;
+
+  pool->use_measured_bandwidths = true;
+  estimate->mbps.store(0);
+  estimate->published_mbps.store(0);
+  estimate->sample_bytes.store(0);
+  estimate->sample_ns.store(0);
+
+  // NOTE(chogan): Until a full sample is collected, the configured bandwidth
+  // is used.
+  RecordDeviceIo(context, device_id, KILOBYTES(512), 250000000);
+  Assert(GetBandwidths(context)[device_id] == configured);
+
+  // NOTE(chogan): 1 MiB in half a second. The first sample is taken as is and
+  // published, which invalidates cached placements.
+  u64 epoch = pool->capacity_epoch.load();
+  RecordDeviceIo(context, device_id, KILOBYTES(512), 250000000);
+  Assert(fabs(GetBandwidths(context)[device_id] - 2.0f) < 1e-3);
+  Assert(target->speed.load() == 2);
+  Assert(pool->capacity_epoch.load() > epoch);
+
+  // NOTE(chogan): Later samples move the estimate part of the way.
+  RecordDeviceIo(context, device_id, MEGABYTES(1), 1000000000);
+  Assert(fabs(GetBandwidths(context)[device_id] - 1.75f) < 1e-3);
+
+  // NOTE(chogan): A steady Device slower than 1 MiB/s leaves cached placements
+  // alone once its estimate is published.
+  estimate->mbps.store(0);
+  estimate->published_mbps.store(0);
+  RecordDeviceIo(context, device_id, MEGABYTES(1), 2000000000);
+  Assert(fabs(GetBandwidths(context)[device_id] - 0.5f) < 1e-3);
+  epoch = pool->capacity_epoch.load();
+  RecordDeviceIo(context, device_id, MEGABYTES(1), 2000000000);
+  Assert(pool->capacity_epoch.load() == epoch);
+
+  pool->use_measured_bandwidths = false;
+  Assert(GetBandwidths(context)[device_id] == configured);
+  estimate->mbps.store(0);
+  estimate->published_mbps.store(0);
+  target->speed.store((u64)configured);
+}
+
+void TestConcurrentPlacement(Hermes *hermes) {
+  using namespace hermes;  // NOLINT(*)
+  SharedMemoryContext *context = &hermes->context_;
+  RpcContext *rpc = &hermes->rpc_;
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  std::vector<TargetID> targets = GetNodeTargets(context);
+  const int kNumThreads = 8;
+  const int kPlacementsPerThread = 256;
+  const size_t kBlobSize = KILOBYTES(4);
+
+  u64 cursor = pool->round_robin_cursor.load();
+  std::vector<std::vector<int>> counts(kNumThreads,
+                                       std::vector<int>(targets.size(), 0));
+  std::vector<int> failures(kNumThreads, 0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      hapi::Context ctx;
+      std::vector<size_t> sizes(1, kBlobSize);
+      for (int i = 0; i < kPlacementsPerThread; ++i) {
+        // NOTE(chogan): Mix in cached and randomized policies to exercise the
+        // rest of the shared placement state.
+        if (i % 4 == 3) {
+          ctx.policy = (t % 2) ? hapi::PlacementPolicy::kMinimizeIoTime :
+            hapi::PlacementPolicy::kRandom;
+        } else {
+          ctx.policy = hapi::PlacementPolicy::kRoundRobin;
+        }
+        std::vector<PlacementSchema> output;
+        if (CalculatePlacement(context, rpc, sizes, output, ctx) != 0 ||
+            output.size() != 1) {
+          failures[t]++;
+          continue;
+        }
+        size_t placed = 0;
+        for (auto [size, target] : output[0]) {
+          placed += size;
+        }
+        if (placed != kBlobSize) {
+          failures[t]++;
+        }
+        if (ctx.policy == hapi::PlacementPolicy::kRoundRobin) {
+          Assert(output[0].size() == 1);
+          counts[t][output[0][0].second.bits.device_id]++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // NOTE(chogan): Every Target has room, so each round-robin placement claims
+  // its own cursor position and the Targets are chosen equally often.
+  int num_round_robin = 0;
+  std::vector<int> totals(targets.size(), 0);
+  for (int t = 0; t < kNumThreads; ++t) {
+    Assert(failures[t] == 0);
+    for (size_t j = 0; j < targets.size(); ++j) {
+      totals[j] += counts[t][j];
+      num_round_robin += counts[t][j];
+    }
+  }
+  Assert(pool->round_robin_cursor.load() == cursor + num_round_robin);
+  for (size_t j = 0; j < targets.size(); ++j) {
+    Assert(totals[j] == num_round_robin / (int)targets.size());
+  }
+}
+
+void TestBatchPlacement(std::shared_ptr<Hermes> hermes) {
+  using namespace hermes;  // NOLINT(*)
+  SharedMemoryContext *context = &hermes->context_;
+  std::vector<TargetID> targets = GetNodeTargets(context);
+  Target *ram_target = GetTargetFromId(context, targets[0]);
+  u64 remaining = ram_target->remaining_space.load();
+
+  // NOTE(chogan): Each half of this batch fits, but together they don't, so
+  // none of it is placed.
+  u64 half = RoundUpToMultiple(remaining / 2 + 1, KILOBYTES(4));
+  std::vector<PlacementSchema> too_big(2);
+  too_big[0].push_back(std::make_pair(half, targets[0]));
+  too_big[1].push_back(std::make_pair(half, targets[0]));
+  Assert(GetBatchBuffers(context, too_big).empty());
+  Assert(ram_target->remaining_space.load() == remaining);
+  Assert(ram_target->reserved_space.load() == 0);
+
+  std::vector<PlacementSchema> fits(2);
+  fits[0].push_back(std::make_pair(KILOBYTES(64), targets[0]));
+  fits[1].push_back(std::make_pair(KILOBYTES(4), targets[0]));
+  std::vector<std::vector<BufferID>> buffer_ids = GetBatchBuffers(context,
+                                                                  fits);
+  Assert(buffer_ids.size() == 2);
+  Assert(!buffer_ids[0].empty() && !buffer_ids[1].empty());
+  Assert(ram_target->remaining_space.load() < remaining);
+  LocalReleaseBuffers(context, buffer_ids[0]);
+  LocalReleaseBuffers(context, buffer_ids[1]);
+  Assert(ram_target->remaining_space.load() == remaining);
+
+  // NOTE(chogan): A batch large enough to be written in parallel. The repeated
+  // name keeps only its last Blob.
+  hapi::Context ctx;
+  hapi::Bucket bucket(std::string("batch_bucket"), hermes, ctx);
+  const int kNumBlobs = 16;
+  std::vector<std::string> names;
+  std::vector<hapi::Blob> blobs;
+  for (int i = 0; i < kNumBlobs; ++i) {
+    names.push_back("batch_" + std::to_string(i));
+    blobs.push_back(hapi::Blob(KILOBYTES(128), (u8)('a' + i)));
+  }
+  names.push_back("batch_0");
+  blobs.push_back(hapi::Blob(KILOBYTES(4), 'z'));
+  Assert(bucket.Put(names, blobs, ctx) == 0);
+
+  for (int i = 1; i < kNumBlobs; ++i) {
+    hapi::Blob result(blobs[i].size());
+    Assert(bucket.Get(names[i], result, ctx) == result.size());
+    Assert(result == blobs[i]);
+  }
+  hapi::Blob last(KILOBYTES(4));
+  Assert(bucket.Get("batch_0", last, ctx) == last.size());
+  Assert(last == blobs.back());
+
+  // NOTE(chogan): Putting the batch again replaces every Blob, and each one
+  // keeps its access history.
+  std::vector<std::string> new_names(names.begin() + 1, names.end());
+  std::vector<hapi::Blob> new_blobs(new_names.size(),
+                                    hapi::Blob(KILOBYTES(4), 'y'));
+  Assert(bucket.Put(new_names, new_blobs, ctx) == 0);
+  for (const auto &name : new_names) {
+    hapi::Blob result(KILOBYTES(4));
+    Assert(bucket.Get(name, result, ctx) == result.size());
+    Assert(result == new_blobs[0]);
+    Assert(bucket.GetBlobStats(name, ctx).writes == 2);
+  }
+
+  bucket.Destroy(ctx);
+}
+
+void TestParallelBlobWrite(Hermes *hermes) {
+  using namespace hermes;  // NOLINT(*)
+  SharedMemoryContext *context = &hermes->context_;
+  RpcContext *rpc = &hermes->rpc_;
+  BufferPool *pool = GetBufferPoolFromContext(context);
+  std::vector<TargetID> targets = GetNodeTargets(context);
+  const size_t kFragmentSize = KILOBYTES(256);
+  Assert(context->buffer_writers);
+  const size_t kBlobSize = kFragmentSize * targets.size();
+
+  std::vector<u8> data(kBlobSize);
+  for (size_t i = 0; i < kBlobSize; ++i) {
+    data[i] = (u8)((i * 31) ^ (i >> 12));
+  }
+  Blob blob = {};
+  blob.data = data.data();
+  blob.size = kBlobSize;
+
+  // NOTE(chogan): Spread the Blob over every Target so that RAM buffers and
+  // each file-backed Device are written by different threads.
+  PlacementSchema schema;
+  for (const auto &target : targets) {
+    schema.push_back(std::make_pair(kFragmentSize, target));
+  }
+
+  size_t threshold = pool->parallel_write_threshold;
+  int num_threads = pool->parallel_write_threads;
+  for (int parallel = 0; parallel < 2; ++parallel) {
+    pool->parallel_write_threshold = parallel ? KILOBYTES(64) : kBlobSize + 1;
+    pool->parallel_write_threads = 8;
+
+    std::vector<BufferID> buffer_ids = GetBuffers(context, schema);
+    Assert(!buffer_ids.empty());
+    std::vector<u32> buffer_sizes(buffer_ids.size());
+    for (size_t i = 0; i < buffer_ids.size(); ++i) {
+      buffer_sizes[i] = GetBufferSize(context, rpc, buffer_ids[i]);
+    }
+
+    WriteBlobToBuffers(context, rpc, blob, buffer_ids);
+
+    std::vector<u8> read_data(kBlobSize, 0);
+    Blob result = {};
+    result.data = read_data.data();
+    result.size = kBlobSize;
+    BufferIdArray buffer_id_arr = {};
+    buffer_id_arr.ids = buffer_ids.data();
+    buffer_id_arr.length = buffer_ids.size();
+    Assert(ReadBlobFromBuffers(context, rpc, &result, &buffer_id_arr,
+                               buffer_sizes.data()) == kBlobSize);
+    Assert(read_data == data);
+
+    LocalReleaseBuffers(context, buffer_ids);
+  }
+
+  pool->parallel_write_threshold = threshold;
+  pool->parallel_write_threads = num_threads;
+}
+
 void PrintUsage(char *program) {
   fprintf(stderr, "Usage %s -[b] [-f <path>]\n", program);
   fprintf(stderr, "  -b\n");
@@ -276,9 +1292,21 @@ int main(int argc, char **argv) {
     std::shared_ptr<Hermes> hermes = hermes::InitHermesDaemon(config_file);
     TestGetBuffers(hermes.get());
     TestGetBandwidths(&hermes->context_);
+    TestConcurrentPlacement(hermes.get());
+    TestBatchPlacement(hermes);
+    TestParallelBlobWrite(hermes.get());
+    TestMoveToTarget(hermes);
+    TestTieringPolicy(hermes);
+    TestTargetWatermarks(hermes);
+    TestPrefetch(hermes);
+    TestPlacementCache(hermes.get());
+    TestIoBudget(hermes);
+    TestMeasuredBandwidths(hermes.get());
     hermes->Finalize(true);
 
     TestBlobOverwrite();
+    TestRamDefragmentation();
+    TestSlabAdaptation();
   }
 
   if (test_swap) {
@@ -296,10 +1324,16 @@ int main(int argc, char **argv) {
     config.desired_slab_percentages[0][3] = 0;
     config.arena_percentages[hermes::kArenaType_BufferPool] = 0.5;
     config.arena_percentages[hermes::kArenaType_MetaData] = 0.5;
+    // NOTE(chogan): Small segments so that a few 4KB Blobs fill one up.
+    config.swap_segment_size = KILOBYTES(16);
+    config.swap_max_segments = 8;
 
     std::shared_ptr<Hermes> hermes = hermes::InitHermesDaemon(&config);
     TestSwap(hermes);
     TestBufferOrganizer(hermes);
+    TestSwapCompaction(hermes);
+    TestSwapLogEntries(hermes);
+    TestSwapFull(hermes);
     hermes->Finalize(true);
   }
 
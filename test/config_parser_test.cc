@@ -71,7 +71,39 @@ int main(int argc, char **argv) {
   Assert(config.mount_points[2] == "./");
   Assert(config.mount_points[3] == "./");
   Assert(config.swap_mount == "./");
+  Assert(config.checkpoint_mount.empty());
   Assert(config.num_buffer_organizer_retries == 3);
+  Assert(config.buffer_organizer_queue_depth == 64);
+  Assert(config.buffer_organizer_threads == 2);
+  Assert(config.buffer_organizer_io_share == 0.5f);
+  Assert(config.read_ahead_depth == 4);
+  Assert(config.placement_cache_threshold == 0.1f);
+  Assert(config.placement_seed == 42);
+  Assert(config.use_measured_bandwidths);
+  Assert(config.bandwidth_calibration_size == MEGABYTES(1));
+  Assert(config.parallel_write_threshold == MEGABYTES(2));
+  Assert(config.parallel_write_threads == 4);
+  Assert(config.swap_drain_order == hermes::SwapDrainOrder::kSmallestFirst);
+  Assert(config.swap_segment_size == MEGABYTES(64));
+  Assert(config.swap_max_segments == 256);
+  Assert(config.swap_compaction_threshold == 0.5f);
+  Assert(config.tiering_interval_ms == 0);
+  Assert(config.tiering_high_watermark == 0.9f);
+  Assert(config.tiering_low_watermark == 0.75f);
+  Assert(config.tiering_promotion_frequency == 4.0f);
+  Assert(config.tiering_max_mbps == 100.0f);
+  Assert(config.write_back_threads == 4);
+  Assert(config.defrag_interval_ms == 0);
+  Assert(config.defrag_threshold == 0.25f);
+  Assert(config.defrag_max_steps == 64);
+  Assert(config.defrag_max_relocations == 64);
+  Assert(config.slab_adaptation_rate == 0.25f);
+  for (int i = 0; i < config.num_devices - 1; ++i) {
+    Assert(config.target_high_watermarks[i] == 0.95f);
+    Assert(config.target_low_watermarks[i] == 0.85f);
+  }
+  Assert(config.target_high_watermarks[config.num_devices - 1] == 1.0f);
+  Assert(config.target_low_watermarks[config.num_devices - 1] == 1.0f);
 
   Assert(config.max_buckets_per_node == 16);
   Assert(config.max_vbuckets_per_node == 8);
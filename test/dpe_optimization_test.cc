@@ -10,6 +10,8 @@
  * have access to the file, you may request a copy from help@hdfgroup.org.   *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
+#include <math.h>
+
 #include <iostream>
 #include <random>
 #include <map>
@@ -55,6 +57,95 @@ void MinimizeIoTimePlaceBlob(std::vector<size_t> &blob_sizes,
   Assert(placed_size == total_sizes);
 }
 
+double GetIoTime(const std::vector<PlacementSchema> &schemas,
+                 const std::vector<f32> &bandwidths) {
+  double result = 0;
+  for (auto &schema : schemas) {
+    for (auto [size, target] : schema) {
+      result += (double)size / bandwidths[target.bits.device_id];
+    }
+  }
+
+  return result;
+}
+
+void TestAnalyticMatchesLp(size_t num_blobs, size_t blob_size) {
+  testing::TargetViewState node_state = testing::InitDeviceState();
+  std::vector<TargetID> targets =
+    testing::GetDefaultTargets(node_state.num_devices);
+  std::vector<size_t> blob_sizes(num_blobs);
+  for (size_t i = 0; i < num_blobs; ++i) {
+    // NOTE(chogan): Vary the sizes so the Blobs don't split evenly.
+    blob_sizes[i] = blob_size + (i % 7) * KILOBYTES(1);
+  }
+
+  std::vector<PlacementSchema> analytic;
+  Assert(MinimizeIoTimePlacement(blob_sizes, node_state.bytes_available,
+                                 node_state.bandwidth, targets,
+                                 analytic) == 0);
+  std::vector<PlacementSchema> lp;
+  Assert(MinimizeIoTimePlacementLp(blob_sizes, node_state.bytes_available,
+                                   node_state.bandwidth, targets, lp) == 0);
+  Assert(analytic.size() == num_blobs);
+  Assert(lp.size() == num_blobs);
+
+  std::vector<u64> loads(node_state.num_devices, 0);
+  for (size_t i = 0; i < num_blobs; ++i) {
+    u64 placed = 0;
+    for (auto [size, target] : analytic[i]) {
+      placed += size;
+      loads[target.bits.device_id] += size;
+    }
+    Assert(placed == blob_sizes[i]);
+  }
+  for (int j = 0; j < node_state.num_devices; ++j) {
+    Assert(loads[j] <= node_state.bytes_available[j] / 5 + 1);
+  }
+
+  double analytic_time = GetIoTime(analytic, node_state.bandwidth);
+  double lp_time = GetIoTime(lp, node_state.bandwidth);
+  std::cout << "\n" << num_blobs << " blobs: analytic I/O time "
+            << analytic_time << ", LP I/O time " << lp_time << '\n'
+            << std::flush;
+  Assert(fabs(analytic_time - lp_time) <= 1e-3 * lp_time);
+}
+
+void TestMinimizeLatencyPlacement() {
+  testing::TargetViewState node_state = testing::InitDeviceState();
+  std::vector<TargetID> targets =
+    testing::GetDefaultTargets(node_state.num_devices);
+  std::vector<f64> startup_times = {1e-6, 1e-5, 5e-5, 1e-3};
+  std::vector<size_t> small(1, KILOBYTES(4));
+
+  // NOTE(chogan): A small Blob stays whole on the fastest Target.
+  std::vector<PlacementSchema> output;
+  Assert(MinimizeLatencyPlacement(small, node_state.bytes_available,
+                                  node_state.bandwidth, startup_times,
+                                  targets, output) == 0);
+  Assert(output.size() == 1);
+  Assert(output[0].size() == 1);
+  Assert(output[0][0].first == KILOBYTES(4));
+  Assert(output[0][0].second.bits.device_id == 0);
+
+  // NOTE(chogan): A long write queue on the fastest Target pushes the Blob to
+  // the next one.
+  startup_times[0] = 1e-2;
+  std::vector<PlacementSchema> queued;
+  Assert(MinimizeLatencyPlacement(small, node_state.bytes_available,
+                                  node_state.bandwidth, startup_times,
+                                  targets, queued) == 0);
+  Assert(queued.size() == 1);
+  Assert(queued[0].size() == 1);
+  Assert(queued[0][0].second.bits.device_id == 1);
+
+  // NOTE(chogan): Blobs larger than all remaining space fail.
+  std::vector<size_t> too_big(1, MEGABYTES(300));
+  std::vector<PlacementSchema> unused;
+  Assert(MinimizeLatencyPlacement(too_big, node_state.bytes_available,
+                                  node_state.bandwidth, startup_times,
+                                  targets, unused) != 0);
+}
+
 int main() {
   testing::TargetViewState node_state = testing::InitDeviceState();
 
@@ -72,5 +163,19 @@ int main() {
   MinimizeIoTimePlaceBlob(blob_sizes2, schemas2, node_state);
   Assert(schemas2.size() == blob_sizes2.size());
 
+  TestAnalyticMatchesLp(1, MEGABYTES(10));
+  TestAnalyticMatchesLp(16, KILOBYTES(512));
+  TestAnalyticMatchesLp(1024, KILOBYTES(8));
+
+  // NOTE(chogan): Asking for more than the change threshold allows fails.
+  std::vector<size_t> too_big(1, MEGABYTES(60));
+  std::vector<PlacementSchema> unused;
+  testing::TargetViewState fresh_state = testing::InitDeviceState();
+  Assert(MinimizeIoTimePlacement(too_big, fresh_state.bytes_available,
+                                 fresh_state.bandwidth,
+                                 testing::GetDefaultTargets(4), unused) != 0);
+
+  TestMinimizeLatencyPlacement();
+
   return 0;
 }
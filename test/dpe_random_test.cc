@@ -54,6 +54,114 @@ void RandomPlaceBlob(std::vector<size_t> &blob_sizes,
   Assert(placed_size == total_sizes);
 }
 
+std::vector<PlacementSchema> PlaceWithSeed(u64 seed) {
+  testing::TargetViewState node_state = testing::InitDeviceState();
+  std::vector<size_t> blob_sizes(16, MEGABYTES(1));
+  std::vector<PlacementSchema> result;
+
+  SeedPlacementRng(seed);
+  Assert(RandomPlacement(blob_sizes, node_state.ordered_cap, result) == 0);
+
+  return result;
+}
+
+void TestSeededPlacementIsReproducible() {
+  std::vector<PlacementSchema> first = PlaceWithSeed(42);
+  std::vector<PlacementSchema> second = PlaceWithSeed(42);
+
+  Assert(first.size() == second.size());
+  for (size_t i = 0; i < first.size(); ++i) {
+    Assert(first[i].size() == second[i].size());
+    for (size_t j = 0; j < first[i].size(); ++j) {
+      Assert(first[i][j].first == second[i][j].first);
+      Assert(first[i][j].second.as_int == second[i][j].second.as_int);
+    }
+  }
+}
+
+/**
+ * Returns the number of buffers needed to store @p size bytes, assuming
+ * unlimited buffers of each of the @p buffer_sizes: as many of the largest as
+ * fit, then the next size down, with the remainder rounded up to one smallest
+ * buffer. The unused bytes of the last buffer are added to @p waste.
+ */
+size_t CountBuffers(size_t size, const std::vector<size_t> &buffer_sizes,
+                    size_t *waste) {
+  size_t result = 0;
+
+  for (int i = (int)buffer_sizes.size() - 1; i >= 0 && size > 0; --i) {
+    size_t num_buffers = size / buffer_sizes[i];
+    size -= num_buffers * buffer_sizes[i];
+    if (i == 0 && size > 0) {
+      num_buffers++;
+      *waste += buffer_sizes[0] - size;
+      size = 0;
+    }
+    result += num_buffers;
+  }
+
+  return result;
+}
+
+void TestSlabAlignedSplits() {
+  const std::vector<size_t> buffer_sizes = {
+    KILOBYTES(4), KILOBYTES(16), KILOBYTES(64), KILOBYTES(128)
+  };
+  const int kNumBlobs = 1000;
+  std::mt19937 size_rng(7);
+  std::uniform_int_distribution<size_t> size_dist(KILOBYTES(64) + 1,
+                                                  MEGABYTES(8));
+  SeedPlacementRng(7);
+
+  size_t equal_buffers = 0;
+  size_t equal_waste = 0;
+  size_t aligned_buffers = 0;
+  size_t aligned_waste = 0;
+  size_t total_size = 0;
+  for (int i = 0; i < kNumBlobs; ++i) {
+    size_t blob_size = size_dist(size_rng);
+    total_size += blob_size;
+
+    std::vector<size_t> equal;
+    GetSplitSizes(blob_size, equal);
+    std::vector<size_t> aligned;
+    GetSplitSizes(blob_size, aligned, buffer_sizes);
+
+    size_t equal_total = 0;
+    for (size_t size : equal) {
+      equal_total += size;
+      equal_buffers += CountBuffers(size, buffer_sizes, &equal_waste);
+    }
+    Assert(equal_total == blob_size);
+
+    size_t aligned_total = 0;
+    for (size_t j = 0; j < aligned.size(); ++j) {
+      aligned_total += aligned[j];
+      aligned_buffers += CountBuffers(aligned[j], buffer_sizes,
+                                      &aligned_waste);
+      if (blob_size >= buffer_sizes.back()) {
+        Assert(aligned[j] >= buffer_sizes.back());
+      }
+      if (j + 1 < aligned.size()) {
+        Assert(aligned[j] % buffer_sizes[0] == 0);
+      }
+    }
+    Assert(aligned_total == blob_size);
+  }
+
+  std::cout << "\nSplitting " << kNumBlobs << " blobs (" << total_size
+            << " bytes)\n"
+            << "  equal splits: " << equal_buffers << " buffers, "
+            << equal_waste << " bytes wasted\n"
+            << "  slab-aligned splits: " << aligned_buffers << " buffers, "
+            << aligned_waste << " bytes wasted\n" << std::flush;
+
+  // NOTE(chogan): Only the last aligned fragment can be unaligned, so the waste
+  // per Blob is never more than that of the equal split.
+  Assert(aligned_waste <= equal_waste);
+  Assert(aligned_buffers < equal_buffers);
+}
+
 int main() {
   testing::TargetViewState node_state = testing::InitDeviceState();
 
@@ -71,5 +179,8 @@ int main() {
   RandomPlaceBlob(blob_sizes2, schemas2, node_state);
   Assert(schemas2.size() == blob_sizes1.size());
 
+  TestSeededPlacementIsReproducible();
+  TestSlabAlignedSplits();
+
   return 0;
 }
@@ -10,6 +10,7 @@
  * have access to the file, you may request a copy from help@hdfgroup.org.   *
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
+#include <set>
 #include <string>
 
 #include <mpi.h>
@@ -18,6 +19,7 @@
 #include "bucket.h"
 #include "vbucket.h"
 #include "metadata_management_internal.h"
+#include "metadata_storage.h"
 #include "test_utils.h"
 
 using namespace hermes;  // NOLINT(*)
@@ -190,6 +192,223 @@ static void TestMaxNameLength(HermesPtr hermes) {
   bucket.Destroy(ctx);
 }
 
+static void TestManyBlobsInBucket(HermesPtr hermes) {
+  // NOTE(chogan): Enough blobs to force several ChunkedIdList resizes, then
+  // remove every other one to exercise the slot index.
+  hapi::Context ctx;
+  std::string name = "many_blobs";
+  hapi::Bucket bucket(name, hermes, ctx);
+  hapi::Blob blob(64, 'x');
+
+  const int kNumBlobs = 200;
+  for (int i = 0; i < kNumBlobs; ++i) {
+    std::string blob_name = "blob" + std::to_string(i);
+    Assert(bucket.Put(blob_name, blob, ctx) == 0);
+  }
+
+  for (int i = 0; i < kNumBlobs; i += 2) {
+    std::string blob_name = "blob" + std::to_string(i);
+    bucket.DeleteBlob(blob_name, ctx);
+  }
+
+  for (int i = 0; i < kNumBlobs; ++i) {
+    std::string blob_name = "blob" + std::to_string(i);
+    bool should_exist = i % 2 == 1;
+    Assert(bucket.ContainsBlob(blob_name) == should_exist);
+  }
+
+  bucket.Destroy(ctx);
+  Assert(!bucket.IsValid());
+}
+
+static void TestBlobNamesArePerBucket(HermesPtr hermes) {
+  hapi::Context ctx;
+  hapi::Bucket bucket1("namespace1", hermes, ctx);
+  hapi::Bucket bucket2("namespace2", hermes, ctx);
+
+  std::string blob_name = "same_name";
+  hapi::Blob blob1(16, 'a');
+  hapi::Blob blob2(32, 'b');
+  Assert(bucket1.Put(blob_name, blob1, ctx) == 0);
+  Assert(bucket2.Put(blob_name, blob2, ctx) == 0);
+
+  Assert(bucket1.GetBlobSize(&hermes->trans_arena_, blob_name, ctx) ==
+         blob1.size());
+  Assert(bucket2.GetBlobSize(&hermes->trans_arena_, blob_name, ctx) ==
+         blob2.size());
+
+  // Small BucketIDs only add a few bytes to each key
+  BucketID bucket2_id = {};
+  bucket2_id.as_int = bucket2.GetId();
+  Assert(MakeInternalBlobName(blob_name, bucket2_id).size() ==
+         blob_name.size() + 4);
+
+  // Destroying one Bucket drops only its own Blob names, even renamed ones
+  Assert(bucket1.RenameBlob(blob_name, "renamed", ctx) == 0);
+  bucket1.Destroy(ctx);
+  Assert(bucket2.ContainsBlob(blob_name));
+  hapi::Blob retrieved(blob2.size());
+  bucket2.Get(blob_name, retrieved, ctx);
+  Assert(retrieved == blob2);
+
+  bucket2.Destroy(ctx);
+  MetadataManager *mdm = GetMetadataManagerFromContext(&hermes->context_);
+  Assert(GetStoredMapSize(mdm, kMapType_Blob) == 0);
+}
+
+static void TestAccessStats(HermesPtr hermes) {
+  hapi::Context ctx;
+  hapi::Bucket bucket("stats", hermes, ctx);
+  std::string blob_name = "hot";
+  const size_t kBlobSize = 128;
+  hapi::Blob blob(kBlobSize, 'h');
+
+  Assert(bucket.Put(blob_name, blob, ctx) == 0);
+  hapi::Blob read_blob(kBlobSize);
+  const u64 kNumReads = 3;
+  for (u64 i = 0; i < kNumReads; ++i) {
+    Assert(bucket.Get(blob_name, read_blob, ctx) == kBlobSize);
+  }
+
+  hermes::AccessStats stats = bucket.GetBlobStats(blob_name, ctx);
+  Assert(stats.writes == 1);
+  Assert(stats.reads == kNumReads);
+  Assert(stats.bytes_written == kBlobSize);
+  Assert(stats.bytes_read == kNumReads * kBlobSize);
+  Assert(stats.frequency > 0 && stats.frequency <= kNumReads + 1);
+
+  // NOTE(chogan): Overwriting a Blob gives it a new BlobID, but its history
+  // should carry over.
+  Assert(bucket.Put(blob_name, blob, ctx) == 0);
+  stats = bucket.GetBlobStats(blob_name, ctx);
+  Assert(stats.writes == 2);
+  Assert(stats.reads == kNumReads);
+
+  std::string cold_name = "cold";
+  Assert(bucket.Put(cold_name, blob, ctx) == 0);
+  hermes::AccessStats cold_stats = bucket.GetBlobStats(cold_name, ctx);
+  Assert(cold_stats.frequency < stats.frequency);
+
+  hermes::AccessStats bucket_stats = bucket.GetStats(ctx);
+  Assert(bucket_stats.writes == 3);
+  Assert(bucket_stats.reads == kNumReads);
+  Assert(bucket_stats.bytes_written == 3 * kBlobSize);
+
+  hermes::AccessStats missing = bucket.GetBlobStats("missing", ctx);
+  Assert(missing.reads == 0 && missing.writes == 0);
+
+  bucket.Destroy(ctx);
+  Assert(!bucket.IsValid());
+}
+
+static void TestFrequencyDecay() {
+  using hermes::DecayFrequency;
+  using hermes::kStatsHalfLifeMs;
+
+  Assert(DecayFrequency(8.0, 0) == 8.0);
+  f64 half = DecayFrequency(8.0, (u64)kStatsHalfLifeMs);
+  Assert(half > 3.99 && half < 4.01);
+  Assert(DecayFrequency(8.0, 1000 * (u64)kStatsHalfLifeMs) < 1e-9);
+
+  hermes::Stats stats;
+  hermes::ResetStats(&stats);
+  hermes::RecordAccess(&stats, hermes::kAccessType_Read, 10, 1000);
+  hermes::RecordAccess(&stats, hermes::kAccessType_Read, 10, 1000);
+  hermes::AccessStats snapshot = hermes::GetStatsSnapshot(&stats, 1000);
+  Assert(snapshot.reads == 2);
+  Assert(snapshot.bytes_read == 20);
+  Assert(snapshot.frequency > 1.99 && snapshot.frequency < 2.01);
+
+  snapshot = hermes::GetStatsSnapshot(&stats, 1000 + (u64)kStatsHalfLifeMs);
+  Assert(snapshot.frequency > 0.99 && snapshot.frequency < 1.01);
+}
+
+static void TestGetBlobNamesWithPredicate(HermesPtr hermes) {
+  hapi::Context ctx;
+  hapi::Bucket bucket("listing", hermes, ctx);
+  hapi::Bucket other_bucket("other_listing", hermes, ctx);
+
+  const int kNumSmall = 10;
+  const int kNumLarge = 5;
+  const u64 kLargeSize = KILOBYTES(4);
+  hapi::Blob small_blob(16, 's');
+  hapi::Blob large_blob(kLargeSize, 'l');
+  for (int i = 0; i < kNumSmall; ++i) {
+    std::string name = "small" + std::to_string(i);
+    Assert(bucket.Put(name, small_blob, ctx) == 0);
+    Assert(other_bucket.Put(name, small_blob, ctx) == 0);
+  }
+  for (int i = 0; i < kNumLarge; ++i) {
+    Assert(bucket.Put("large" + std::to_string(i), large_blob, ctx) == 0);
+  }
+
+  BlobPredicate match_all = {};
+  Assert(bucket.GetBlobNames(match_all, ctx).size() == kNumSmall + kNumLarge);
+
+  BlobPredicate by_name = {};
+  by_name.name_pattern = "small*";
+  Assert(bucket.GetBlobNames(by_name, ctx).size() == kNumSmall);
+  by_name.name_pattern = "large?";
+  Assert(bucket.GetBlobNames(by_name, ctx).size() == kNumLarge);
+  by_name.name_pattern = "none*";
+  Assert(bucket.GetBlobNames(by_name, ctx).size() == 0);
+
+  BlobPredicate by_size = {};
+  by_size.min_size = kLargeSize;
+  std::vector<std::string> large_names = bucket.GetBlobNames(by_size, ctx);
+  Assert(large_names.size() == kNumLarge);
+  for (size_t i = 0; i < large_names.size(); ++i) {
+    Assert(large_names[i].rfind("large", 0) == 0);
+  }
+  by_size.min_size = 0;
+  by_size.max_size = 16;
+  Assert(bucket.GetBlobNames(by_size, ctx).size() == kNumSmall);
+
+  BlobPredicate by_device = {};
+  by_device.device_mask = kSwapDeviceMask - 1;
+  Assert(bucket.GetBlobNames(by_device, ctx).size() == kNumSmall + kNumLarge);
+
+  BlobPredicate by_idle = {};
+  by_idle.max_idle_ms = 60 * 60 * 1000;
+  Assert(bucket.GetBlobNames(by_idle, ctx).size() == kNumSmall + kNumLarge);
+  by_idle.max_idle_ms = 0;
+  by_idle.min_idle_ms = 60 * 60 * 1000;
+  Assert(bucket.GetBlobNames(by_idle, ctx).size() == 0);
+
+  // NOTE(chogan): Pages smaller than the listing must visit every Blob exactly
+  // once.
+  BlobCursor cursor = {};
+  std::set<std::string> seen;
+  const u32 kPageSize = 3;
+  while (!cursor.done) {
+    std::vector<std::string> page = bucket.GetBlobNames(match_all, cursor,
+                                                        kPageSize, ctx);
+    Assert(page.size() <= kPageSize);
+    for (size_t i = 0; i < page.size(); ++i) {
+      Assert(seen.insert(page[i]).second);
+    }
+  }
+  Assert(seen.size() == kNumSmall + kNumLarge);
+
+  // NOTE(chogan): Listings report a renamed Blob by its new name.
+  Assert(bucket.RenameBlob("large0", "renamed", ctx) == 0);
+  by_name.name_pattern = "renamed";
+  std::vector<std::string> renamed = bucket.GetBlobNames(by_name, ctx);
+  Assert(renamed.size() == 1 && renamed[0] == "renamed");
+  by_name.name_pattern = "large*";
+  Assert(bucket.GetBlobNames(by_name, ctx).size() == kNumLarge - 1);
+
+  // NOTE(chogan): A '*' in the pattern is a wildcard even when the name
+  // contains a literal '*'.
+  Assert(bucket.Put("*ab", small_blob, ctx) == 0);
+  by_name.name_pattern = "*b";
+  std::vector<std::string> starred = bucket.GetBlobNames(by_name, ctx);
+  Assert(starred.size() == 1 && starred[0] == "*ab");
+
+  bucket.Destroy(ctx);
+  other_bucket.Destroy(ctx);
+}
+
 int main(int argc, char **argv) {
   int mpi_threads_provided;
   MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &mpi_threads_provided);
@@ -208,6 +427,11 @@ int main(int argc, char **argv) {
   TestRenameBucket(hermes);
   TestBucketRefCounting(hermes);
   TestMaxNameLength(hermes);
+  TestManyBlobsInBucket(hermes);
+  TestBlobNamesArePerBucket(hermes);
+  TestAccessStats(hermes);
+  TestFrequencyDecay();
+  TestGetBlobNamesWithPredicate(hermes);
 
   hermes->Finalize(true);
 